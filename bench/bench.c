@@ -0,0 +1,907 @@
+/* Performance harness for the solver
+ *
+ * Times field loading, f_eval() and f_eval_batch(), the element kernels, mesh construction, global assembly, the banded LU factorization and solve,
+ * and end-to-end solver.out runs, for L2 and L3 meshes from 10^2 elements up to --max-elements.
+ * The accuracy benchmarks time complete solves of L2, L3 and p-element meshes refined just enough to reach fixed errors,
+ * and the stabilization benchmarks find the meshes that plain Galerkin and SUPG elements need as the Péclet number grows.
+ * The nonlinear benchmarks compare full and modified Newton steps (per_item_ns is the time per step).
+ * The transient benchmarks time the implicit schemes, whose steps reuse one decomposition (per_item_ns is the time per step).
+ * Each case is repeated until it has run for at least --min-time seconds (or --max-repeats times), and the median and minimum are reported.
+ *
+ * Results are written as CSV rows of
+ *	benchmark,kind,field,size,repeats,median_s,min_s,per_item_ns
+ * where `size` is the element (or call) count and `per_item_ns` is the median divided by the number of items processed.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <dirent.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "fe_section.h"
+#include "function_field.h"
+#include "band_matrix.h"
+#include "post_processing.h"
+#include "p_elements.h"
+#include "cpu_dispatch.h"
+#include "nonlinear.h"
+#include "time_stepping.h"
+
+#define MAX_FIELDS 64
+#define MAX_REPEATS_LIMIT 1000
+#define KERNEL_CALLS 10000
+#define F_EVAL_CALLS 1000000
+
+// Every predefined field covers [1, 11] (the natural log field starts just above zero)
+#define DOMAIN_START 1.0
+#define DOMAIN_END 11.0
+
+struct Bench_Settings {
+	long max_elements;
+	double min_time;
+	int max_repeats;
+	const char *fields_dir;
+	const char *default_field;
+	const char *solver;
+	FILE *output;
+
+};
+
+struct Bench_Case {
+	const char *benchmark;
+	const char *kind;
+	const char *field;
+	long size;
+	double items;
+	void (*setup) (void *); // Untimed, before every repeat; may be NULL
+	void (*run) (void *);
+	void *args;
+
+};
+
+static double now_seconds() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec + now.tv_nsec/1e9;
+
+}
+
+static int compare_doubles(const void *a, const void *b) {
+	double x = *(const double*) a, y = *(const double*) b;
+
+	return (x > y) - (x < y);
+
+}
+
+static void run_case(struct Bench_Settings *settings, struct Bench_Case *c) {
+	double times[MAX_REPEATS_LIMIT];
+	double total = 0;
+	int repeats = 0;
+
+	while (repeats < settings->max_repeats && (repeats < 3 || total < settings->min_time)) {
+		if (c->setup != NULL) {
+			c->setup(c->args);
+		}
+
+		double begin = now_seconds();
+		c->run(c->args);
+		times[repeats] = now_seconds() - begin;
+		total += times[repeats++];
+
+		// Long cases are not worth repeating
+		if (repeats == 1 && times[0] > 10*settings->min_time) {
+			break;
+		}
+	}
+
+	qsort(times, repeats, sizeof(double), compare_doubles);
+	double median = (repeats % 2) ? times[repeats/2] : (times[repeats/2 - 1] + times[repeats/2])/2;
+
+	fprintf(settings->output, "%s,%s,%s,%ld,%d,%.9e,%.9e,%.3f\n",
+			c->benchmark, c->kind, c->field, c->size, repeats, median, times[0], median/c->items*1e9);
+	fflush(settings->output);
+	printf("%-20s %-3s %-32s %10ld  median %.6f s  (%.1f ns/item, %d repeats)\n",
+		   c->benchmark, c->kind, c->field, c->size, median, median/c->items*1e9, repeats);
+	fflush(stdout);
+
+}
+
+/* Field benchmarks */
+
+struct Field_Args {
+	const char *path;
+	struct Function_Field *field;
+	double *x_values;
+	double *f_values; // Output of f_eval_batch()
+	double sink;
+
+};
+
+static void load_field_run(void *args) {
+	struct Field_Args *a = (struct Field_Args*) args;
+	FILE *file = fopen(a->path, "r");
+	struct Function_Field field;
+	input_function_field(&field, file);
+	fclose(file);
+	free_function_field(&field);
+
+}
+
+static void f_eval_run(void *args) {
+	struct Field_Args *a = (struct Field_Args*) args;
+	double sum = 0, f;
+	for (int i = 0; i < F_EVAL_CALLS; i++) {
+		f_eval(a->field, a->x_values[i], &f);
+		sum += f;
+	}
+	a->sink = sum;
+
+}
+
+static void f_eval_batch_run(void *args) {
+	struct Field_Args *a = (struct Field_Args*) args;
+	f_eval_batch(a->field, a->x_values, F_EVAL_CALLS, a->f_values);
+	a->sink = a->f_values[F_EVAL_CALLS - 1];
+
+}
+
+/* Element kernel benchmarks */
+
+struct Kernel_Args {
+	struct Element_Linear *element;
+	struct Function_Field *field;
+
+};
+
+static void coefficient_kernel_run(void *args) {
+	struct Kernel_Args *a = (struct Kernel_Args*) args;
+	for (int i = 0; i < KERNEL_CALLS; i++) {
+		gsl_matrix_free(output_coefficient_matrix(a->element, -1, -5));
+	}
+
+}
+
+static void constant_kernel_run(void *args) {
+	struct Kernel_Args *a = (struct Kernel_Args*) args;
+	for (int i = 0; i < KERNEL_CALLS; i++) {
+		gsl_vector_free(output_constant_vector(a->element, a->field));
+	}
+
+}
+
+/* Mesh, assembly and solve benchmarks */
+
+struct Mesh_Args {
+	Element_2D_Type kind;
+	long num_elements;
+	struct Mesh mesh;
+	struct Function_Field *field;
+	struct Band_Matrix K_coeff; // Assembled, with the Dirichlet rows in place
+	struct Band_Matrix K_lu;
+	gsl_vector *F_const;
+
+};
+
+static void mesh_build_run(void *args) {
+	struct Mesh_Args *a = (struct Mesh_Args*) args;
+	struct Mesh mesh;
+	generate_uniform_mesh(&mesh, DOMAIN_START, DOMAIN_END, a->num_elements, a->kind);
+	free_mesh_memory(&mesh);
+
+}
+
+static void assembly_run(void *args) {
+	struct Mesh_Args *a = (struct Mesh_Args*) args;
+	struct Band_Matrix K_coeff;
+	assemble_coefficient_matrix(&a->mesh, -1, -5, &K_coeff);
+	gsl_vector_free(assemble_constant_vector(&a->mesh, a->field));
+	free_band_matrix(&K_coeff);
+
+}
+
+static void factor_setup(void *args) {
+	struct Mesh_Args *a = (struct Mesh_Args*) args;
+	free_band_matrix(&a->K_lu);
+	copy_band_matrix(&a->K_lu, &a->K_coeff);
+
+}
+
+static void factor_run(void *args) {
+	struct Mesh_Args *a = (struct Mesh_Args*) args;
+	band_lu_decomp(&a->K_lu);
+
+}
+
+static void triangular_solve_run(void *args) {
+	struct Mesh_Args *a = (struct Mesh_Args*) args;
+	gsl_vector_free(solve_ode_factorized(&a->mesh, &a->K_lu, a->F_const, -1, 1));
+
+}
+
+/* Fixed-error benchmarks
+ *
+ * README Homogenous Case 5, y'' + 10y' + 7y = 0 on [0, 1] with y(0) = 0 and y(1) = 1, has a closed-form solution.
+ * Each discretization is refined by doubling its element count until the largest error at ACCURACY_SAMPLES points reaches the target,
+ * and the complete solve (mesh, assembly and banded LU) at that size is timed; `size` is the number of unknowns.
+ */
+
+#define ACCURACY_SAMPLES 10001
+#define ACCURACY_A 10.0
+#define ACCURACY_B 7.0
+
+struct Accuracy_Args {
+	int order; // 0 for an L2 or L3 mesh of `kind`
+	Element_2D_Type kind;
+	long num_elements;
+	struct Function_Field *field;
+
+};
+
+static double accuracy_zero(double x) {
+	return 0;
+
+}
+
+static double accuracy_exact(double x) {
+	double r1 = (-ACCURACY_A + sqrt(ACCURACY_A*ACCURACY_A - 4*ACCURACY_B))/2;
+	double r2 = (-ACCURACY_A - sqrt(ACCURACY_A*ACCURACY_A - 4*ACCURACY_B))/2;
+
+	return (exp(r1*x) - exp(r2*x))/(exp(r1) - exp(r2));
+
+}
+
+// Solves at the current size and, with `check`, returns the largest error (-1 if the solve failed); also gives the number of unknowns
+static double accuracy_solve(struct Accuracy_Args *a, long *num_dofs, bool check) {
+	static double x[ACCURACY_SAMPLES], y[ACCURACY_SAMPLES];
+	for (int i = 0; i < ACCURACY_SAMPLES; i++) {
+		x[i] = (double) i/(ACCURACY_SAMPLES - 1);
+	}
+
+	int status;
+	if (a->order > 0) {
+		struct P_Mesh mesh;
+		gsl_vector *solution = NULL;
+		if (generate_uniform_p_mesh(&mesh, 0, 1, a->num_elements, a->order)) {
+			return -1;
+		}
+		status = solve_ode_p(&mesh, &solution, ACCURACY_A, ACCURACY_B, 0, 1, a->field) || (check && evaluate_p_solution(&mesh, solution, x, ACCURACY_SAMPLES, y, NULL));
+		*num_dofs = mesh.num_dofs;
+		gsl_vector_free(solution);
+		free_p_mesh(&mesh);
+	}
+	else {
+		struct Mesh mesh;
+		struct ODE_Solution solution;
+		struct Solver_Options options = {0};
+		if (generate_uniform_mesh(&mesh, 0, 1, a->num_elements, a->kind)) {
+			return -1;
+		}
+		status = solve_ode_constant_opts(&mesh, &solution, ACCURACY_A, ACCURACY_B, 0, 1, a->field, &options);
+		if (status == 0) {
+			status = check ? evaluate_solution(&mesh, &solution, x, ACCURACY_SAMPLES, y, NULL) : 0;
+			free_solution_memory(&solution);
+		}
+		*num_dofs = mesh.num_nodes;
+		free_mesh_memory(&mesh);
+	}
+	if (status || !check) {
+		return status ? -1 : 0;
+	}
+
+	double error = 0;
+	for (int i = 0; i < ACCURACY_SAMPLES; i++) {
+		error = fmax(error, fabs(y[i] - accuracy_exact(x[i])));
+	}
+
+	return error;
+
+}
+
+static void accuracy_run(void *args) {
+	long num_dofs;
+	accuracy_solve((struct Accuracy_Args*) args, &num_dofs, false);
+
+}
+
+static void bench_accuracy(struct Bench_Settings *settings) {
+	const char *kind_names[4] = {"L2", "L3", "p4", "p8"};
+	int orders[4] = {0, 0, 4, 8};
+	Element_2D_Type kinds[4] = {LINEAR, QUAD, LINEAR, LINEAR};
+	double targets[3] = {1e-4, 1e-6, 1e-8};
+
+	struct Function_Field field;
+	if (create_function_field(&field, -1, 2, 301, accuracy_zero)) {
+		return;
+	}
+
+	for (int t = 0; t < 3; t++) {
+		char benchmark[32];
+		snprintf(benchmark, sizeof(benchmark), "fixed_error_%.0e", targets[t]);
+
+		for (int k = 0; k < 4; k++) {
+			struct Accuracy_Args a = {orders[k], kinds[k], 1, &field};
+			long num_dofs = 0;
+			double error;
+			while ((error = accuracy_solve(&a, &num_dofs, true)) > targets[t] && a.num_elements <= settings->max_elements/2) {
+				a.num_elements *= 2;
+			}
+			if (error < 0 || error > targets[t]) {
+				printf("%-20s %-3s did not reach the target within %ld elements\n", benchmark, kind_names[k], settings->max_elements);
+				continue;
+			}
+
+			struct Bench_Case run = {benchmark, kind_names[k], "-", num_dofs, num_dofs, NULL, accuracy_run, &a};
+			run_case(settings, &run);
+		}
+	}
+	free_function_field(&field);
+
+}
+
+/* Stabilization benchmarks
+ *
+ * y'' + Ay' + 7y = 0 on [0, 1] with y(0) = 0 and y(1) = 1 has a boundary layer of width 1/A at x = 0, and a Péclet number of A (unit length and diffusion).
+ * Galerkin elements oscillate until the cell Péclet number A*h/2 is below about 1, so L2 and L3 meshes, with and without SUPG, are refined by doubling
+ * from 4 elements until the largest error at their nodes is below STABILIZATION_TARGET; `size` is that element count, and the complete solve is timed.
+ */
+
+#define STABILIZATION_TARGET 1e-2
+
+struct Stabilization_Args {
+	double a;
+	Element_2D_Type kind;
+	bool supg;
+	long num_elements;
+	struct Function_Field *field;
+
+};
+
+// Solves at the current size and, with `check`, returns the largest nodal error (-1 if the solve failed)
+static double stabilization_solve(struct Stabilization_Args *s, bool check) {
+	struct Mesh mesh;
+	struct ODE_Solution solution;
+	struct Solver_Options options = {0};
+	options.supg = s->supg;
+	if (generate_uniform_mesh(&mesh, 0, 1, s->num_elements, s->kind)) {
+		return -1;
+	}
+	if (solve_ode_constant_opts(&mesh, &solution, s->a, ACCURACY_B, 0, 1, s->field, &options)) {
+		free_mesh_memory(&mesh);
+		return -1;
+	}
+
+	double error = 0;
+	double r1 = (-s->a + sqrt(s->a*s->a - 4*ACCURACY_B))/2;
+	double r2 = (-s->a - sqrt(s->a*s->a - 4*ACCURACY_B))/2;
+	for (uint32_t i = 0; check && i < mesh.num_nodes; i++) {
+		double x = mesh.node_coordinates[i];
+		// e^(r2) underflows for large A; the exact solution is then e^(r1 (x - 1)) - e^(r2 x - r1)
+		double exact = (exp(r1*(x - 1)) - exp(r2*x - r1))/(1 - exp(r2 - r1));
+		error = fmax(error, fabs(gsl_vector_get(solution.solution_coeff, i) - exact));
+	}
+	free_solution_memory(&solution);
+	free_mesh_memory(&mesh);
+
+	return error;
+
+}
+
+static void stabilization_run(void *args) {
+	stabilization_solve((struct Stabilization_Args*) args, false);
+
+}
+
+static void bench_stabilization(struct Bench_Settings *settings) {
+	const char *kind_names[2] = {"L2", "L3"};
+	Element_2D_Type kinds[2] = {LINEAR, QUAD};
+
+	struct Function_Field field;
+	if (create_function_field(&field, -1, 2, 301, accuracy_zero)) {
+		return;
+	}
+
+	for (double a = 10; a <= 1e5; a *= 10) {
+		for (int supg = 0; supg < 2; supg++) {
+			char benchmark[32];
+			snprintf(benchmark, sizeof(benchmark), "%s_pe_%.0e", supg ? "supg" : "galerkin", a);
+
+			for (int k = 0; k < 2; k++) {
+				struct Stabilization_Args s = {a, kinds[k], supg, 4, &field};
+				double error;
+				while ((error = stabilization_solve(&s, true)) > STABILIZATION_TARGET && s.num_elements <= settings->max_elements/2) {
+					s.num_elements *= 2;
+				}
+				if (error < 0 || error > STABILIZATION_TARGET) {
+					printf("%-20s %-3s did not reach the target within %ld elements\n", benchmark, kind_names[k], settings->max_elements);
+					continue;
+				}
+
+				struct Bench_Case run = {benchmark, kind_names[k], "-", s.num_elements, s.num_elements, NULL, stabilization_run, &s};
+				run_case(settings, &run);
+			}
+		}
+	}
+	free_function_field(&field);
+
+}
+
+/* Nonlinear benchmarks
+ *
+ * y'' + y' - y^3 - y = f with the solution sin(pi x) on [0, 1], by full Newton (a decomposed tangent per step) and modified Newton (one tangent for as long as it keeps converging).
+ * The complete solve is timed, and per_item_ns is the time per Newton step.
+ */
+
+struct Nonlinear_Args {
+	Element_2D_Type kind;
+	Newton_Method method;
+	long num_elements;
+	struct Function_Field *field;
+	struct Newton_Report report;
+
+};
+
+static double nonlinear_g(double y, void *context) {
+	return -y*y*y - y;
+
+}
+
+static double nonlinear_dg(double y, void *context) {
+	return -3*y*y - 1;
+
+}
+
+static double nonlinear_f(double x) {
+	double s = sin(M_PI*x);
+
+	return -M_PI*M_PI*s + M_PI*cos(M_PI*x) - s*s*s - s;
+
+}
+
+static void nonlinear_run(void *args) {
+	struct Nonlinear_Args *n = args;
+	struct Nonlinear_Term g = {nonlinear_g, nonlinear_dg, NULL};
+	struct Newton_Options options = {0};
+	options.method = n->method;
+	struct Mesh mesh;
+	struct ODE_Solution solution;
+	if (generate_uniform_mesh(&mesh, 0, 1, n->num_elements, n->kind)) {
+		return;
+	}
+	if (solve_ode_nonlinear(&mesh, &solution, 1, &g, 0, 0, n->field, &options, &n->report) == 0) {
+		free_solution_memory(&solution);
+	}
+	free_mesh_memory(&mesh);
+
+}
+
+static void bench_nonlinear(struct Bench_Settings *settings) {
+	const char *kind_names[2] = {"L2", "L3"};
+	Element_2D_Type kinds[2] = {LINEAR, QUAD};
+	const char *method_names[2] = {"newton_full", "newton_modified"};
+
+	struct Function_Field field;
+	if (create_function_field(&field, -1, 2, 100001, nonlinear_f)) {
+		return;
+	}
+
+	for (long size = 10000; size <= settings->max_elements && size <= 1000000; size *= 10) {
+		for (int k = 0; k < 2; k++) {
+			for (int m = 0; m < 2; m++) {
+				struct Nonlinear_Args n = {kinds[k], (Newton_Method) m, size, &field};
+				nonlinear_run(&n);
+				if (!n.report.converged) {
+					printf("%-20s %-3s did not converge on %ld elements (residual %.1e)\n", method_names[m], kind_names[k], size, n.report.residual);
+					continue;
+				}
+
+				struct Bench_Case run = {method_names[m], kind_names[k], "-", size, n.report.iterations, NULL, nonlinear_run, &n};
+				run_case(settings, &run);
+				printf("%-20s %-3s %10ld  %d steps, %d tangents (%.1f%% of the time)\n", method_names[m], kind_names[k], size, n.report.iterations, n.report.factorizations,
+					   100*n.report.factor_seconds/n.report.seconds);
+			}
+		}
+	}
+	free_function_field(&field);
+
+}
+
+/* Transient benchmarks
+ *
+ * u_t = u_xx + u_x - 2u + f from sin(pi x) over 100 steps of 1e-3, with the source of the solution e^(-t) sin(pi x) ("timed")
+ * or with that source at t = 0 ("steady", assembled once). The complete run is timed, and per_item_ns is the time per step;
+ * the setup (assembly and decompositions) is printed next to it.
+ */
+
+struct Transient_Args {
+	Element_2D_Type kind;
+	Time_Scheme scheme;
+	bool steady;
+	long num_elements;
+	struct Time_Report report;
+
+};
+
+static double transient_source(double x, double t, void *context) {
+	return exp(-t)*((M_PI*M_PI + 1)*sin(M_PI*x) - M_PI*cos(M_PI*x));
+
+}
+
+static double steady_transient_source(double x, double t, void *context) {
+	return transient_source(x, 0, context);
+
+}
+
+static void transient_run(void *args) {
+	struct Transient_Args *r = args;
+	struct Mesh mesh;
+	struct ODE_Solution solution;
+	if (generate_uniform_mesh(&mesh, 0, 1, r->num_elements, r->kind)) {
+		return;
+	}
+
+	gsl_vector *initial = gsl_vector_alloc(mesh.num_nodes);
+	for (uint32_t i = 0; i < mesh.num_nodes; i++) {
+		gsl_vector_set(initial, i, sin(M_PI*mesh.node_coordinates[i]));
+	}
+	struct Time_Problem problem = {1, -2, r->steady ? steady_transient_source : transient_source, NULL, r->steady, 0, 0, initial};
+	struct Time_Options options = {r->scheme, 0, 1e-3, 100, 0, NULL};
+	if (solve_ode_transient(&mesh, &solution, &problem, &options, &r->report) == 0) {
+		free_solution_memory(&solution);
+	}
+	gsl_vector_free(initial);
+	free_mesh_memory(&mesh);
+
+}
+
+static void bench_transient(struct Bench_Settings *settings) {
+	const char *kind_names[2] = {"L2", "L3"};
+	Element_2D_Type kinds[2] = {LINEAR, QUAD};
+	const char *scheme_names[3] = {"backward_euler", "crank_nicolson", "bdf2"};
+	const char *source_names[2] = {"timed", "steady"};
+
+	for (long size = 10000; size <= settings->max_elements && size <= 100000; size *= 10) {
+		for (int k = 0; k < 2; k++) {
+			for (int m = 0; m < 3; m++) {
+				for (int steady = 0; steady < 2; steady++) {
+					struct Transient_Args r = {kinds[k], (Time_Scheme) m, steady, size};
+					struct Bench_Case run = {scheme_names[m], kind_names[k], source_names[steady], size, 100, NULL, transient_run, &r};
+					run_case(settings, &run);
+					printf("%-20s %-3s %-6s %10ld  %d decompositions, setup %.1f ms, %.2f ms per step\n", scheme_names[m], kind_names[k], source_names[steady], size,
+						   r.report.factorizations, 1e3*r.report.factor_seconds, 1e3*r.report.seconds_per_step);
+				}
+			}
+		}
+	}
+
+}
+
+/* End-to-end CLI benchmark */
+
+struct CLI_Args {
+	const char *solver;
+	const char *field_path;
+	char elements[32];
+	const char *work_dir;
+
+};
+
+// Runs solver.out in a scratch directory, as a user would
+static void cli_run(void *args) {
+	struct CLI_Args *a = (struct CLI_Args*) args;
+
+	pid_t pid = fork();
+	if (pid == 0) {
+		int null_fd = open("/dev/null", O_WRONLY);
+		dup2(null_fd, STDOUT_FILENO);
+		dup2(null_fd, STDERR_FILENO);
+		if (chdir(a->work_dir) != 0) {
+			_exit(127);
+		}
+		execl(a->solver, a->solver, "-1", "-5", "-1", "1", a->field_path, "1", "11", a->elements, (char*) NULL);
+		_exit(127);
+	}
+
+	int status;
+	waitpid(pid, &status, 0);
+
+}
+
+static int list_fields(const char *dir, char names[MAX_FIELDS][256]) {
+	DIR *d = opendir(dir);
+	if (d == NULL) {
+		fprintf(stderr, "Could not open the field directory %s.\n", dir);
+		return -1;
+	}
+
+	int count = 0;
+	struct dirent *entry;
+	while ((entry = readdir(d)) != NULL && count < MAX_FIELDS) {
+		size_t length = strlen(entry->d_name);
+		if (length > 4 && strcmp(entry->d_name + length - 4, ".dat") == 0) {
+			snprintf(names[count++], 256, "%s", entry->d_name);
+		}
+	}
+	closedir(d);
+
+	qsort(names, count, 256, (int (*) (const void*, const void*)) strcmp);
+
+	return count;
+
+}
+
+// dir/name into a PATH_MAX buffer; fails instead of truncating
+static int join_field_path(char path[PATH_MAX], const char *dir, const char *name) {
+	int length = snprintf(path, PATH_MAX, "%s/%s", dir, name);
+	if (length < 0 || length >= PATH_MAX) {
+		fprintf(stderr, "The path of %s in %s is too long.\n", name, dir);
+		return 1;
+	}
+
+	return 0;
+
+}
+
+static struct Function_Field* load_field(const char *dir, const char *name) {
+	char path[PATH_MAX];
+	if (join_field_path(path, dir, name)) {
+		return NULL;
+	}
+
+	FILE *file = fopen(path, "r");
+	if (file == NULL) {
+		fprintf(stderr, "Could not open %s.\n", path);
+		return NULL;
+	}
+
+	struct Function_Field *field = malloc(sizeof(struct Function_Field));
+	input_function_field(field, file);
+	fclose(file);
+
+	return field;
+
+}
+
+static void bench_fields(struct Bench_Settings *settings, char names[MAX_FIELDS][256], int num_fields) {
+	double *x_values = malloc(F_EVAL_CALLS*sizeof(double));
+	double *f_values = malloc(F_EVAL_CALLS*sizeof(double));
+	srand(1);
+	for (int i = 0; i < F_EVAL_CALLS; i++) {
+		x_values[i] = DOMAIN_START + (DOMAIN_END - DOMAIN_START)*rand()/(double) RAND_MAX;
+	}
+
+	struct Element_Linear l2, l3;
+	create_element_L2(&l2, 2, 2.5);
+	create_element_L3(&l3, 2, 2.25, 2.5);
+
+	for (int f = 0; f < num_fields; f++) {
+		char path[PATH_MAX];
+		if (join_field_path(path, settings->fields_dir, names[f])) {
+			continue;
+		}
+		struct Function_Field *field = load_field(settings->fields_dir, names[f]);
+		if (field == NULL) {
+			continue;
+		}
+
+		struct Field_Args field_args = {path, field, x_values, f_values, 0};
+		struct Bench_Case load = {"field_load", "-", names[f], (long) field->number_of_points, field->number_of_points, NULL, load_field_run, &field_args};
+		run_case(settings, &load);
+
+		struct Bench_Case eval = {"f_eval", "-", names[f], F_EVAL_CALLS, F_EVAL_CALLS, NULL, f_eval_run, &field_args};
+		run_case(settings, &eval);
+
+		struct Bench_Case eval_batch = {"f_eval_batch", "-", names[f], F_EVAL_CALLS, F_EVAL_CALLS, NULL, f_eval_batch_run, &field_args};
+		run_case(settings, &eval_batch);
+
+		struct Kernel_Args l2_args = {&l2, field}, l3_args = {&l3, field};
+		struct Bench_Case constant_l2 = {"kernel_constant", "L2", names[f], KERNEL_CALLS, KERNEL_CALLS, NULL, constant_kernel_run, &l2_args};
+		struct Bench_Case constant_l3 = {"kernel_constant", "L3", names[f], KERNEL_CALLS, KERNEL_CALLS, NULL, constant_kernel_run, &l3_args};
+		run_case(settings, &constant_l2);
+		run_case(settings, &constant_l3);
+
+		free_function_field(field);
+		free(field);
+	}
+
+	// The coefficient matrix does not depend on the field
+	struct Kernel_Args l2_args = {&l2, NULL}, l3_args = {&l3, NULL};
+	struct Bench_Case coefficient_l2 = {"kernel_coefficient", "L2", "-", KERNEL_CALLS, KERNEL_CALLS, NULL, coefficient_kernel_run, &l2_args};
+	struct Bench_Case coefficient_l3 = {"kernel_coefficient", "L3", "-", KERNEL_CALLS, KERNEL_CALLS, NULL, coefficient_kernel_run, &l3_args};
+	run_case(settings, &coefficient_l2);
+	run_case(settings, &coefficient_l3);
+
+	free_element_memory(&l2);
+	free_element_memory(&l3);
+	free(x_values);
+	free(f_values);
+
+}
+
+static void bench_mesh_sizes(struct Bench_Settings *settings, struct Function_Field *field) {
+	const char *kind_names[2] = {"L2", "L3"};
+	Element_2D_Type kinds[2] = {LINEAR, QUAD};
+
+	for (long n = 100; n <= settings->max_elements; n *= 10) {
+		for (int k = 0; k < 2; k++) {
+			struct Mesh_Args a;
+			memset(&a, 0, sizeof(struct Mesh_Args));
+			a.kind = kinds[k];
+			a.num_elements = n;
+			a.field = field;
+
+			struct Bench_Case build = {"mesh_build", kind_names[k], "-", n, n, NULL, mesh_build_run, &a};
+			run_case(settings, &build);
+
+			if (generate_uniform_mesh(&a.mesh, DOMAIN_START, DOMAIN_END, n, kinds[k])) {
+				continue;
+			}
+
+			struct Bench_Case assembly = {"assembly", kind_names[k], settings->default_field, n, n, NULL, assembly_run, &a};
+			run_case(settings, &assembly);
+
+			// Matrix with the Dirichlet rows in place, copied before each factorization
+			assemble_coefficient_matrix(&a.mesh, -1, -5, &a.K_coeff);
+			band_matrix_set_row_identity(&a.K_coeff, 0);
+			band_matrix_set_row_identity(&a.K_coeff, a.mesh.num_nodes - 1);
+			a.F_const = assemble_constant_vector(&a.mesh, field);
+
+			struct Bench_Case factor = {"factor", kind_names[k], "-", n, n, factor_setup, factor_run, &a};
+			run_case(settings, &factor);
+
+			struct Bench_Case solve = {"triangular_solve", kind_names[k], "-", n, n, NULL, triangular_solve_run, &a};
+			run_case(settings, &solve);
+
+			free_band_matrix(&a.K_lu);
+			free_band_matrix(&a.K_coeff);
+			gsl_vector_free(a.F_const);
+			free_mesh_memory(&a.mesh);
+		}
+	}
+
+}
+
+static void bench_cli(struct Bench_Settings *settings, char names[MAX_FIELDS][256], int num_fields) {
+	if (access(settings->solver, X_OK) != 0) {
+		fprintf(stderr, "Skipping the CLI benchmarks; %s is not executable (run `make` first).\n", settings->solver);
+		return;
+	}
+
+	char work_dir[] = "/tmp/ode_bench_XXXXXX";
+	if (mkdtemp(work_dir) == NULL) {
+		fprintf(stderr, "Skipping the CLI benchmarks; could not create a scratch directory.\n");
+		return;
+	}
+
+	char solver[PATH_MAX], field_path[PATH_MAX];
+	if (realpath(settings->solver, solver) == NULL) {
+		return;
+	}
+
+	struct CLI_Args a = {solver, field_path, "", work_dir};
+
+	// Every field at a fixed size, then the size sweep with the default field
+	for (int f = 0; f < num_fields; f++) {
+		char relative[PATH_MAX];
+		if (join_field_path(relative, settings->fields_dir, names[f]) || realpath(relative, field_path) == NULL) {
+			continue;
+		}
+		snprintf(a.elements, sizeof(a.elements), "%d", 1000);
+
+		struct Bench_Case run = {"cli_field", "L2", names[f], 1000, 1000, NULL, cli_run, &a};
+		run_case(settings, &run);
+	}
+
+	char relative[PATH_MAX];
+	if (join_field_path(relative, settings->fields_dir, settings->default_field) == 0 && realpath(relative, field_path) != NULL) {
+		for (long n = 100; n <= settings->max_elements; n *= 10) {
+			snprintf(a.elements, sizeof(a.elements), "%ld", n);
+
+			struct Bench_Case run = {"cli", "L2", settings->default_field, n, n, NULL, cli_run, &a};
+			run_case(settings, &run);
+		}
+	}
+
+	char file[1100];
+	snprintf(file, sizeof(file), "%s/input_mesh.in", work_dir);
+	remove(file);
+	snprintf(file, sizeof(file), "%s/solution_output.dat", work_dir);
+	remove(file);
+	rmdir(work_dir);
+
+}
+
+static void print_usage() {
+	printf("Usage: bench.out [--max-elements N] [--min-time seconds] [--max-repeats N] [--fields dir] [--field name] [--solver path] [--output file] [--only fields|sizes|accuracy|stabilization|nonlinear|transient|cli]\n");
+
+}
+
+int main(int argc, char **argv) {
+	struct Bench_Settings settings = {10000000, 0.2, 20, "../predefined_fields", "sine_field.dat", "../solver.out", NULL};
+	const char *output_path = "results.csv";
+	const char *only = NULL;
+
+	for (int i = 1; i < argc; i++) {
+		if (i + 1 >= argc) {
+			print_usage();
+			return 1;
+		}
+
+		if (strcmp(argv[i], "--max-elements") == 0) settings.max_elements = atol(argv[++i]);
+		else if (strcmp(argv[i], "--min-time") == 0) settings.min_time = atof(argv[++i]);
+		else if (strcmp(argv[i], "--max-repeats") == 0) settings.max_repeats = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--fields") == 0) settings.fields_dir = argv[++i];
+		else if (strcmp(argv[i], "--field") == 0) settings.default_field = argv[++i];
+		else if (strcmp(argv[i], "--solver") == 0) settings.solver = argv[++i];
+		else if (strcmp(argv[i], "--output") == 0) output_path = argv[++i];
+		else if (strcmp(argv[i], "--only") == 0) only = argv[++i];
+		else {
+			print_usage();
+			return 1;
+		}
+	}
+
+	if (settings.max_repeats < 1 || settings.max_repeats > MAX_REPEATS_LIMIT) {
+		fprintf(stderr, "--max-repeats must be between 1 and %d.\n", MAX_REPEATS_LIMIT);
+		return 1;
+	}
+
+	settings.output = fopen(output_path, "w");
+	if (settings.output == NULL) {
+		fprintf(stderr, "Could not open %s for writing.\n", output_path);
+		return 1;
+	}
+	fprintf(settings.output, "benchmark,kind,field,size,repeats,median_s,min_s,per_item_ns\n");
+	printf("Element kernels dispatched to %s.\n", dispatch_isa_level());
+
+	char names[MAX_FIELDS][256];
+	int num_fields = list_fields(settings.fields_dir, names);
+	if (num_fields < 0) {
+		fclose(settings.output);
+		return 1;
+	}
+
+	if (only == NULL || strcmp(only, "fields") == 0) {
+		bench_fields(&settings, names, num_fields);
+	}
+
+	if (only == NULL || strcmp(only, "sizes") == 0) {
+		struct Function_Field *field = load_field(settings.fields_dir, settings.default_field);
+		if (field != NULL) {
+			bench_mesh_sizes(&settings, field);
+			free_function_field(field);
+			free(field);
+		}
+	}
+
+	if (only == NULL || strcmp(only, "accuracy") == 0) {
+		bench_accuracy(&settings);
+	}
+
+	if (only == NULL || strcmp(only, "stabilization") == 0) {
+		bench_stabilization(&settings);
+	}
+
+	if (only == NULL || strcmp(only, "nonlinear") == 0) {
+		bench_nonlinear(&settings);
+	}
+
+	if (only == NULL || strcmp(only, "transient") == 0) {
+		bench_transient(&settings);
+	}
+
+	if (only == NULL || strcmp(only, "cli") == 0) {
+		bench_cli(&settings, names, num_fields);
+	}
+
+	fclose(settings.output);
+	printf("Results written to %s.\n", output_path);
+
+	return 0;
+
+}
@@ -0,0 +1,65 @@
+"""Compares a benchmark results file against a stored baseline.
+
+Usage: python3 compare.py [baseline.csv] [results.csv] [--threshold 0.10] [--floor 1e-6]
+
+Rows are matched on (benchmark, kind, field, size).
+A case regresses when its median time exceeds the baseline median by more than the threshold fraction;
+cases whose baseline median is below the floor (in seconds) are reported but never flagged, as they are mostly timer noise.
+The exit status is 1 if any case regressed and 2 if a file could not be read.
+"""
+import argparse
+import csv
+import sys
+
+
+def read_results(path):
+    with open(path, newline='') as f:
+        return {
+            (row['benchmark'], row['kind'], row['field'], int(row['size'])): float(row['median_s'])
+            for row in csv.DictReader(f)
+        }
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Flag benchmark regressions against a baseline.')
+    parser.add_argument('baseline')
+    parser.add_argument('results')
+    parser.add_argument('--threshold', type=float, default=0.10, help='allowed slowdown as a fraction (default 0.10)')
+    parser.add_argument('--floor', type=float, default=1e-6, help='baseline medians below this many seconds are not flagged')
+    args = parser.parse_args()
+
+    try:
+        baseline = read_results(args.baseline)
+        results = read_results(args.results)
+    except OSError as error:
+        print(f'Could not read the results: {error}.')
+        print('Record a baseline with `make bench-baseline` after a run on the reference machine.')
+        return 2
+
+    regressions = 0
+    print(f'{"benchmark":<20} {"kind":<4} {"field":<32} {"size":>10} {"baseline_s":>12} {"current_s":>12} {"change":>8}')
+    for key in sorted(results):
+        if key not in baseline:
+            continue
+
+        old, new = baseline[key], results[key]
+        change = (new - old)/old if old > 0 else 0.0
+        flag = ''
+        if change > args.threshold and old >= args.floor:
+            flag = '  REGRESSION'
+            regressions += 1
+
+        benchmark, kind, field, size = key
+        print(f'{benchmark:<20} {kind:<4} {field:<32} {size:>10} {old:>12.6g} {new:>12.6g} {change:>+8.1%}{flag}')
+
+    missing = sorted(set(baseline) - set(results))
+    if missing:
+        print(f'{len(missing)} baseline case(s) were not run.')
+
+    print(f'{regressions} regression(s) above {args.threshold:.0%}.')
+
+    return 1 if regressions else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -1,3 +1,5 @@
+import sys
+
 import pandas as pd
 import numpy as np
 import matplotlib.pyplot as plt
@@ -16,12 +18,75 @@ y = lambda x: c1*np.exp(-4*x) + c2*np.exp(x) - ((3/4)*x**2 + (17/8)*x + (47/32))
 
 """
 
+# Magic bytes at the start of a binary solution file (see src/solution_writer.c)
+BINARY_MAGIC = b"ODESOL01"
+
+def read_binary_solutions(filename):
+    """Returns a list of (index, x, y) records from a binary solution file."""
+    raw = np.fromfile(filename, dtype=np.uint8)
+    if raw[:8].tobytes() != BINARY_MAGIC:
+        raise ValueError(f"{filename} is not a binary solution file")
+
+    records = []
+    offset = 8
+    while offset < raw.size:
+        index, num_nodes = np.frombuffer(raw, dtype=np.uint64, count=2, offset=offset)
+        offset += 16
+        values = np.frombuffer(raw, dtype=np.float64, count=2*int(num_nodes), offset=offset)
+        offset += values.nbytes
+        records.append((int(index), values[:int(num_nodes)], values[int(num_nodes):]))
+
+    return records
+
+def read_solutions(filename):
+    with open(filename, "rb") as f:
+        is_binary = f.read(8) == BINARY_MAGIC
+
+    if is_binary:
+        return read_binary_solutions(filename)
+
+    with open(filename) as f:
+        header = f.readline().rstrip("\n").split("\t")
+
+    # Columnar output; one y_N column per solution on the shared x column
+    if len(header) > 1 and header[1].startswith("y_"):
+        dataframe = pd.read_csv(filename, sep="\t")
+        x_values = dataframe["x"].to_numpy()
+        return [(int(column[2:]), x_values, dataframe[column].to_numpy()) for column in header[1:]]
+
+    return read_text_solutions(filename)
+
+def read_text_solutions(filename):
+    """Returns a list of (index, x, y) records from a text solution file.
+
+    The x/y header is written once; indexed (batch) output precedes each record with a `# case N` line.
+    """
+    records = []
+    index, x_values, y_values = 0, [], []
+    with open(filename) as f:
+        f.readline()
+        for line in f:
+            line = line.strip()
+            if line.startswith("# case"):
+                if x_values:
+                    records.append((index, np.array(x_values), np.array(y_values)))
+                index, x_values, y_values = int(line.split()[2]), [], []
+            elif line and not line.startswith("#"):
+                x, y = line.split("\t")
+                x_values.append(float(x))
+                y_values.append(float(y))
+
+    if x_values:
+        records.append((index, np.array(x_values), np.array(y_values)))
+
+    return records
+
 # Name of the solver output file
-solver_file = "solution_output.dat"
+solver_file = sys.argv[1] if len(sys.argv) > 1 else "solution_output.dat"
 
-dataframe = pd.read_csv(solver_file, sep="\t")
-x_0 = dataframe["x"].iat[0]
-x_1 = dataframe["x"].iat[-1]
+solutions = read_solutions(solver_file)
+x_0 = solutions[0][1][0]
+x_1 = solutions[0][1][-1]
 
 x = np.linspace(x_0, x_1, 200)
 #y_ref = y(x)
@@ -29,7 +94,8 @@ x = np.linspace(x_0, x_1, 200)
 
 # Plot and output
 plt.figure(figsize = (15, 10))
-plt.plot(dataframe["x"], dataframe["y"], "-ok", label="Solver")
+for index, x_values, y_values in solutions:
+    plt.plot(x_values, y_values, "-o", label="Solver" if len(solutions) == 1 else f"Solver (case {index})")
 # plt.plot(x, y_ref, label="Reference") # Used for any reference solution; originally used for the deprecated functions above.
 plt.legend()
 plt.grid()
@@ -0,0 +1,69 @@
+// Header file for the adaptive mesh refinement loop and its gradient-recovery error estimator
+#ifndef ADAPTIVE_H
+#define ADAPTIVE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "fe_section.h"
+#include "function_field.h"
+#include "p_elements.h"
+
+#define ADAPTIVE_MAX_STEPS 50
+// Fraction of the estimated squared error that the marked elements must account for (Dörfler marking)
+#define ADAPTIVE_DEFAULT_MARKING 0.5
+#define ADAPTIVE_DEFAULT_MAX_NODES 1000000
+
+// Zero-initialize for the defaults, apart from the tolerance
+struct Adaptive_Options {
+	double tolerance; // Estimated relative error to reach (recovered derivative against the computed one, in L2)
+	int max_steps; // Solves before giving up; 0 for ADAPTIVE_MAX_STEPS
+	uint32_t max_nodes; // No refinement beyond this many nodes; 0 for ADAPTIVE_DEFAULT_MAX_NODES
+	double marking_fraction; // 0 for ADAPTIVE_DEFAULT_MARKING
+
+};
+
+// Degrees of freedom against the estimated error, one entry per solve
+struct Adaptive_Report {
+	int num_steps;
+	uint32_t num_nodes[ADAPTIVE_MAX_STEPS];
+	double error_estimate[ADAPTIVE_MAX_STEPS];
+	bool converged;
+
+};
+
+// hp-adaptivity: marked elements whose bubble coefficients decay faster than e^(-k*HP_DEFAULT_SMOOTHNESS) are raised one order, the others are split
+#define HP_DEFAULT_SMOOTHNESS 1.0
+#define HP_DEFAULT_MAX_DOFS 100000
+
+// Zero-initialize for the defaults, apart from the tolerance
+struct HP_Options {
+	double tolerance; // Estimated relative error in y' to reach
+	int max_steps; // 0 for ADAPTIVE_MAX_STEPS
+	size_t max_dofs; // 0 for HP_DEFAULT_MAX_DOFS
+	double marking_fraction; // 0 for ADAPTIVE_DEFAULT_MARKING
+	double smoothness_threshold; // 0 for HP_DEFAULT_SMOOTHNESS
+
+};
+
+struct HP_Report {
+	int num_steps;
+	size_t num_dofs[ADAPTIVE_MAX_STEPS];
+	double error_estimate[ADAPTIVE_MAX_STEPS];
+	uint32_t p_refined[ADAPTIVE_MAX_STEPS]; // Elements raised one order after each solve
+	uint32_t h_refined[ADAPTIVE_MAX_STEPS]; // Elements split after each solve
+	bool converged;
+
+};
+
+bool mesh_refinable(struct Mesh* input_mesh);
+int estimate_element_errors(struct Mesh* input_mesh, struct ODE_Solution* solution, double* indicators, double* relative_error);
+int refine_mesh(struct Mesh* input_mesh, const bool* marked, struct Mesh* refined);
+int solve_ode_adaptive(struct Mesh* input_mesh, struct ODE_Solution* solution, double a, double b, double d1, double d2, struct Function_Field *function_field,
+					   const struct Adaptive_Options* adaptive, struct Solver_Options* options, struct Adaptive_Report* report);
+
+int estimate_hp_errors(struct P_Mesh* mesh, const gsl_vector* solution, double* indicators, double* decay_rates, double* relative_error);
+int solve_ode_hp(struct P_Mesh* mesh, gsl_vector** solution, double a, double b, double d1, double d2, struct Function_Field *function_field,
+				 const struct HP_Options* hp, struct HP_Report* report);
+
+#endif
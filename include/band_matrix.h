@@ -0,0 +1,118 @@
+// Header file for the Band Matrix struct and its associated routines
+#ifndef BAND_MATRIX_H
+#define BAND_MATRIX_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_permutation.h>
+
+// Row-major band storage.
+// Row i holds columns (i - lower) through (i + lower + upper); the extra `lower` columns above the band hold the fill-in from row interchanges during the LU decomposition.
+// Entry (i, j) is at data[i*width + (j - i + lower)].
+struct Band_Matrix {
+	size_t size;
+	int lower, upper; // Number of sub- and super-diagonals of the (unfactored) matrix
+	int width; // 2*lower + upper + 1
+	double* data;
+	size_t* pivots; // Row interchanges; only valid once `factored` is set
+	bool factored;
+
+};
+
+// Single-precision LU factors of a band matrix (same layout), for the mixed-precision solve
+struct Band_Matrix_Float {
+	size_t size;
+	int lower, upper;
+	int width;
+	float* data;
+	size_t* pivots;
+	bool factored;
+
+};
+
+// Saved rows of a band decomposition, for refactoring it after a change to its later rows; see band_lu_refactor()
+#define BAND_CHECKPOINT_INTERVAL 64
+
+struct Band_Checkpoints {
+	size_t interval; // Columns between checkpoints
+	size_t count;
+	double* rows; // `lower` rows of the band (width entries each) per checkpoint
+
+};
+
+/* Band matrix whose rows wrap around, as in the systems of periodic meshes: entry (i, j) is stored in the band when |i - j| is within the bandwidth,
+ * and in one of the two corner blocks when it is only within the bandwidth cyclically.
+ * With the band B, A = B + U V^T, where U holds the unit columns of the first and last `corner` rows and V^T the corner blocks;
+ * the decomposition factors B and the capacitance matrix I + V^T B^-1 U of the Sherman-Morrison-Woodbury formula, so a solve stays O(size).
+ */
+struct Cyclic_Band_Matrix {
+	struct Band_Matrix band;
+	int corner; // Rows and columns of each corner block (the bandwidth)
+	double* upper_corner; // Entry (i, size - corner + j) at [i*corner + j]
+	double* lower_corner; // Entry (size - corner + i, j) at [i*corner + j]
+	double* Q; // B^-1 U, 2*corner columns of `size` entries
+	gsl_matrix* capacitance; // LU of I + V^T Q
+	gsl_permutation* permutation;
+	bool factored;
+
+};
+
+// Iterative refinement stops once ||b - A x|| <= sqrt(n)*DBL_EPSILON*||A||*||x|| (infinity norms), or gives up after this many steps
+#define BAND_REFINE_MAX_ITERATIONS 30
+
+struct Refinement_Report {
+	int iterations; // Refinement steps taken (each one a residual and a single-precision solve)
+	double residual; // ||b - A x|| (infinity norm) of the returned solution, computed in double precision
+	double backward_error; // residual/(||A||*||x|| + ||b||)
+	bool fallback; // The single-precision factors did not converge, so the solution comes from a double-precision factorization
+
+};
+
+int create_band_matrix(struct Band_Matrix* m, size_t size, int lower, int upper);
+int copy_band_matrix(struct Band_Matrix* dest, const struct Band_Matrix* src);
+void free_band_matrix(struct Band_Matrix* m);
+
+double band_matrix_get(const struct Band_Matrix* m, size_t i, size_t j);
+void band_matrix_set(struct Band_Matrix* m, size_t i, size_t j, double x);
+void band_matrix_add(struct Band_Matrix* m, size_t i, size_t j, double x);
+void band_matrix_set_row_identity(struct Band_Matrix* m, size_t i);
+
+int band_lu_decomp(struct Band_Matrix* m);
+int band_lu_decomp_checkpointed(struct Band_Matrix* m, struct Band_Checkpoints* checkpoints, size_t interval);
+int band_lu_refactor(struct Band_Matrix* m, const struct Band_Matrix* a, struct Band_Checkpoints* checkpoints, size_t first_changed_row);
+void free_band_checkpoints(struct Band_Checkpoints* checkpoints);
+int band_lu_solve(const struct Band_Matrix* m, const gsl_vector* b, gsl_vector* x);
+void band_lu_substitute(const struct Band_Matrix* m, double* y, size_t stride);
+void band_matrix_apply(const struct Band_Matrix* m, const double* x, double* y);
+double band_matrix_norm_inf(const struct Band_Matrix* m);
+gsl_matrix* band_matrix_to_dense(const struct Band_Matrix* m);
+
+int create_cyclic_band_matrix(struct Cyclic_Band_Matrix* m, size_t size, int bandwidth);
+void free_cyclic_band_matrix(struct Cyclic_Band_Matrix* m);
+void cyclic_band_matrix_add(struct Cyclic_Band_Matrix* m, size_t i, size_t j, double x);
+int cyclic_lu_decomp(struct Cyclic_Band_Matrix* m);
+int cyclic_lu_solve(const struct Cyclic_Band_Matrix* m, const gsl_vector* b, gsl_vector* x);
+
+int band_lu_decomp_float(struct Band_Matrix_Float* lu, const struct Band_Matrix* m);
+void free_band_matrix_float(struct Band_Matrix_Float* lu);
+int band_lu_solve_float(const struct Band_Matrix_Float* lu, double* x);
+int band_mixed_solve(const struct Band_Matrix* m, const gsl_vector* b, gsl_vector* x, struct Refinement_Report* report);
+
+// Pointer to entry (i, j); (j - i) must lie within [-lower, lower + upper]
+static inline double* band_matrix_ptr(const struct Band_Matrix* m, size_t i, size_t j) {
+	return &m->data[i*m->width + (ptrdiff_t) j - (ptrdiff_t) i + m->lower];
+}
+
+static inline float* band_matrix_float_ptr(const struct Band_Matrix_Float* m, size_t i, size_t j) {
+	return &m->data[i*m->width + (ptrdiff_t) j - (ptrdiff_t) i + m->lower];
+}
+
+#endif
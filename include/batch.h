@@ -0,0 +1,51 @@
+// Header file for the batch manifest runner
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "fe_section.h"
+#include "function_field.h"
+#include "solution_writer.h"
+#include "thread_pool.h"
+
+#define BATCH_LINE_LENGTH 2048
+#define BATCH_DEFAULT_OUTPUT "batch_output.bin"
+
+// One manifest line: the same fields as `solver.out [A] [B] [d1] [d2] [function field file] [start] [end] [number of elements]`
+struct Batch_Case {
+	size_t index; // Position among the cases in the manifest; used as the output record index
+	double a, b, d1, d2;
+	char *field_path;
+	double start, end;
+	int num_elements;
+
+};
+
+struct Batch_Options {
+	size_t num_threads; // 0 for one per processor
+	const char *output_path;
+	Writer_Format format;
+	struct Solver_Stats *stats; // Totals over every thread; NULL to skip
+
+};
+
+struct Batch_Summary {
+	size_t num_cases;
+	size_t num_groups; // Distinct mesh and field pairs, each assembled once
+	size_t num_factorizations; // Distinct (mesh, a, b) triples, each factorized once
+	size_t num_failed;
+	double seconds;
+
+};
+
+int read_batch_manifest(FILE *manifest, struct Batch_Case **cases, size_t *num_cases);
+void free_batch_cases(struct Batch_Case *cases, size_t num_cases);
+int run_batch(FILE *manifest, struct Batch_Options *options, struct Batch_Summary *summary);
+
+#endif
@@ -0,0 +1,32 @@
+// Header file for the runtime instruction set dispatch of the hot kernels
+#ifndef CPU_DISPATCH_H
+#define CPU_DISPATCH_H
+
+// Functions marked ODE_DISPATCH are compiled once per x86-64 level and the loader picks the widest one the CPU supports (GCC function multiversioning).
+// The baseline level guarantees SSE2, x86-64-v3 adds AVX2 and FMA, and x86-64-v4 adds AVX-512.
+// Compile with -DODE_NO_DISPATCH to build a single version (e.g. together with -march=native).
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__linux__) && !defined(ODE_NO_DISPATCH)
+#define ODE_DISPATCH_ENABLED
+#define ODE_DISPATCH __attribute__((target_clones("arch=x86-64-v4", "arch=x86-64-v3", "default")))
+#else
+#define ODE_DISPATCH
+#endif
+
+// Name of the version the dispatched kernels run on this machine
+static inline const char* dispatch_isa_level() {
+#ifdef ODE_DISPATCH_ENABLED
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("x86-64-v4")) {
+		return "x86-64-v4 (AVX-512)";
+	}
+	if (__builtin_cpu_supports("x86-64-v3")) {
+		return "x86-64-v3 (AVX2)";
+	}
+	return "x86-64 (SSE2)";
+#else
+	return "single version";
+#endif
+
+}
+
+#endif
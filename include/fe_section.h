@@ -1,3 +1,6 @@
+#ifndef FE_SECTION_H
+#define FE_SECTION_H
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
@@ -11,6 +14,8 @@
 #include <gsl/gsl_permutation.h>
 
 #include "function_field.h"
+#include "solver_stats.h"
+#include "multigrid.h"
 
 
 typedef enum {
@@ -56,12 +61,53 @@ struct Element_Conn {
 
 };
 
+// Largest node count that the Mesh counters can hold
+#define MESH_MAX_NODES INT32_MAX
+
+// Constant coefficients of one region (material) of a mesh
+struct Mesh_Region {
+	double a, b;
+
+};
+
 struct Mesh {
 	struct Element_Conn* connectivity_grid;
 	struct Element_Linear* elements;
 	double *node_coordinates;
-	uint16_t num_nodes;
-	uint16_t num_elements;
+	uint32_t num_nodes;
+	uint32_t num_elements;
+	// Optional regions; see regions.h. A mesh without them has element_region == NULL and num_regions == 0
+	uint32_t* element_region; // Region of each element, an index into `regions`
+	struct Mesh_Region* regions;
+	uint32_t num_regions;
+
+};
+
+// Quantity-of-interest reductions; see post_processing.h
+typedef enum {
+	QOI_INTEGRAL = 1 << 0, // Integral of y over the mesh domain
+	QOI_MAX_ABS = 1 << 1, // Maximum |y| over the nodes
+	QOI_PROBES = 1 << 2, // y at the requested probe points
+	QOI_FLUX_START = 1 << 3, // dy/dx at the first node
+	QOI_FLUX_END = 1 << 4 // dy/dx at the last node
+} QoI_Flags;
+
+struct QoI_Request {
+	unsigned int flags; // Bitwise OR of QoI_Flags
+	const double* probe_points; // Must be in ascending order; only used with QOI_PROBES
+	size_t num_probes;
+
+};
+
+struct QoI_Result {
+	unsigned int flags; // The quantities that were computed
+	double integral;
+	double max_abs;
+	double max_abs_location;
+	double* probe_values; // num_probes long
+	size_t num_probes;
+	double flux_start;
+	double flux_end;
 
 };
 
@@ -70,6 +116,66 @@ struct ODE_Solution {
 	// These fields can be NULL; it is an optional output
 	gsl_matrix* coeff_matrix_global;
 	gsl_vector* const_vector_global;
+	struct QoI_Result* qoi;
+	struct Solver_Stats* stats; // Phase timings and counters of the solve; see solver_stats.h
+	struct Refinement_Report* refinement; // Mixed-precision solves only: the final residual and refinement steps; see band_matrix.h
+	struct Iterative_Report* iterative; // Iterative solves only: the final residual and iterations; see krylov.h
+
+};
+
+// Solver for the assembled band system
+typedef enum {
+	SOLVER_BAND_LU, // Direct banded LU (the default)
+	SOLVER_MULTIGRID, // Geometric multigrid on the mesh hierarchy; see multigrid.h
+	SOLVER_BICGSTAB, // BiCGSTAB, optionally preconditioned with a multigrid cycle; see krylov.h
+	SOLVER_MATRIX_FREE // Jacobi-preconditioned BiCGSTAB on the element-by-element operator; the matrix is never assembled (see matrix_free.h)
+} Linear_Solver;
+
+typedef enum {
+	BOUNDARY_DIRICHLET, // y = value
+	BOUNDARY_NEUMANN, // y' = value
+	BOUNDARY_ROBIN // y' + alpha*y = value
+} Boundary_Type;
+
+struct Boundary_Condition {
+	Boundary_Type type;
+	double value;
+	double alpha; // Robin only
+
+};
+
+// Conditions at the start and end of the mesh. They only change the two boundary rows of the band and the constant vector,
+// so they are applied to the assembled arrays in place (see apply_boundary_matrix() and apply_boundary_vector()) and can change between solves without assembling again.
+struct Boundary_Spec {
+	struct Boundary_Condition start, end;
+
+};
+
+/* Optional settings for solve_ode_constant_opts(); zero-initialize for the defaults.
+ * validate_solver_options() rejects the combinations that cannot work together:
+ *	streaming:            no global arrays, mixed precision, iterative solver, SUPG, periodic mesh or boundary spec (the band is never formed)
+ *	mixed_precision:      band LU only
+ *	periodic:             band LU only, without global arrays or mixed precision (the cyclic band has its own solve)
+ *	boundary:             no periodic mesh, matrix-free or multigrid solve (these only take Dirichlet rows)
+ *	SOLVER_MATRIX_FREE:   no global arrays, mixed precision, multigrid preconditioner or SUPG (the matrix is never assembled)
+ * L3 meshes are only condensed by a default solve: band LU in double precision, without global arrays, SUPG, a periodic mesh or a boundary spec.
+ */
+struct Solver_Options {
+	bool output_global_arrays;
+	struct QoI_Request* qoi; // NULL skips the quantity-of-interest reductions
+	bool collect_stats; // Attach a Solver_Stats to the solution
+	bool streaming; // Fuse the assembly with the forward elimination instead of forming the global matrix; see streaming_solver.h
+	const char* scratch_path; // Streaming only: file (mapped with mmap()) for the back-substitution data; NULL keeps it in memory
+	bool no_condensation; // Solve L3 meshes as the full system instead of condensing out the middle nodes; see static_condensation.h
+	size_t num_threads; // Threads for the element work of a condensed L3 solve; 0 or 1 keeps it on the calling thread
+	bool mixed_precision; // Factor the band in single precision and refine the solution to double-precision accuracy
+	Linear_Solver linear_solver;
+	Multigrid_Cycle cycle; // For SOLVER_MULTIGRID, and SOLVER_BICGSTAB with multigrid_preconditioner
+	bool multigrid_preconditioner; // SOLVER_BICGSTAB: precondition with one multigrid cycle
+	double tolerance; // Iterative solvers: relative residual to reach; 0 for ITERATIVE_DEFAULT_TOLERANCE
+	bool supg; // Streamline-upwind Petrov-Galerkin stabilization for convection-dominated A
+	bool periodic; // y and y' at the end of the mesh match those at the start instead of taking d1 and d2
+	const struct Boundary_Spec* boundary; // Conditions at the ends in place of y = d1 and d2, which are ignored
 
 };
 
@@ -77,9 +183,40 @@ struct ODE_Solution {
 
 // Main Functions
 int parse_input_file(FILE* input_stream, struct Mesh* mesh_object, Element_2D_Type mesh_kind);
+int build_mesh_from_nodes(struct Mesh* mesh_object, double* node_coors, int num_nodes, Element_2D_Type mesh_kind);
+int generate_uniform_mesh(struct Mesh* mesh_object, double start, double end, int num_elements, Element_2D_Type mesh_kind);
+int mesh_bandwidth(struct Mesh* input_mesh);
 int solve_ode_constant(struct Mesh* input_mesh, struct ODE_Solution* solution, double a, double b, double d1, double d2, struct Function_Field *function_field, bool output_global_arrays);
+int solve_ode_constant_opts(struct Mesh* input_mesh, struct ODE_Solution* solution, double a, double b, double d1, double d2, struct Function_Field *function_field, struct Solver_Options* options);
+const char* validate_solver_options(const struct Solver_Options* options);
 int output_solution_data(struct Mesh* input_mesh, struct ODE_Solution* input_solution);
 
+// Reusable solve phases; the factorization only depends on the mesh, a and b
+struct Band_Matrix;
+int assemble_coefficient_matrix(struct Mesh* input_mesh, double a, double b, struct Band_Matrix* K_coeff);
+gsl_vector* assemble_constant_vector(struct Mesh* input_mesh, struct Function_Field *function_field);
+int factorize_ode_constant(struct Mesh* input_mesh, double a, double b, struct Band_Matrix* K_lu);
+gsl_vector* solve_ode_factorized(struct Mesh* input_mesh, const struct Band_Matrix* K_lu, const gsl_vector* F_const, double d1, double d2);
+// Boundary conditions; only the affected entries of the two boundary rows are touched
+struct Boundary_Spec dirichlet_boundary(double d1, double d2);
+void apply_boundary_matrix(struct Band_Matrix* K_coeff, const struct Boundary_Spec* boundary);
+void apply_boundary_vector(gsl_vector* F_const, const struct Boundary_Spec* boundary);
+int factorize_ode_boundary(const struct Band_Matrix* K_coeff, const struct Boundary_Spec* boundary, struct Band_Matrix* K_lu);
+gsl_vector* solve_ode_boundary(const struct Band_Matrix* K_lu, const gsl_vector* F_const, const struct Boundary_Spec* boundary);
+
+// Element blocks: the local arrays of up to ELEMENT_BLOCK elements are computed together
+#define ELEMENT_BLOCK 64
+#define MAX_ELEMENT_NODES 3
+int output_element_block(Element_2D_Type kind, int count, const double (*x)[ELEMENT_BLOCK], double a, double b, struct Function_Field *function_field, double (*k)[ELEMENT_BLOCK], double (*F)[ELEMENT_BLOCK]);
+int output_coefficient_block(Element_2D_Type kind, int count, const double (*x)[ELEMENT_BLOCK], double a, double b, double (*k)[ELEMENT_BLOCK]);
+int output_operator_block(Element_2D_Type kind, int count, const double (*x)[ELEMENT_BLOCK], double (*stiffness)[ELEMENT_BLOCK], double (*convection)[ELEMENT_BLOCK], double (*mass)[ELEMENT_BLOCK]);
+int apply_element_block(Element_2D_Type kind, int count, const double (*x)[ELEMENT_BLOCK], double a, double b, const double (*u)[ELEMENT_BLOCK], double (*y)[ELEMENT_BLOCK]);
+// Per-point arrays (xq[q*count + e]) for coefficients that vary over the mesh; see variable_coefficients.h
+int element_quadrature_points(Element_2D_Type kind);
+int output_quadrature_point_block(Element_2D_Type kind, int count, const double (*x)[ELEMENT_BLOCK], double* xq);
+int output_variable_coefficient_block(Element_2D_Type kind, int count, const double (*x)[ELEMENT_BLOCK], const double* aq, const double* bq, double (*k)[ELEMENT_BLOCK]);
+int output_load_block(Element_2D_Type kind, int count, const double (*x)[ELEMENT_BLOCK], const double* fq, double (*F)[ELEMENT_BLOCK]);
+
 // Creation Functions
 gsl_vector* output_constant_vector(struct Element_Linear* element, struct Function_Field *function_field);
 gsl_matrix* output_coefficient_matrix(struct Element_Linear* element, double a, double b);
@@ -112,4 +249,16 @@ struct Coefficient_Matrix_Funcs {
 double constant_vector_composition(double zeta, void* func_params);
 double coefficient_matrix_composition(double zeta, void* func_params);
 
+// Shape functions (defined in shape_functions.c)
+double L2_N0(double zeta);
+double L2_N1(double zeta);
+double L2_N0_D(double zeta);
+double L2_N1_D(double zeta);
+double L3_N0(double zeta);
+double L3_N1(double zeta);
+double L3_N2(double zeta);
+double L3_N0_D(double zeta);
+double L3_N1_D(double zeta);
+double L3_N2_D(double zeta);
 
+#endif
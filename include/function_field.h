@@ -1,4 +1,7 @@
 // Header file for the Function Field struct and its associated routines
+#ifndef FUNCTION_FIELD_H
+#define FUNCTION_FIELD_H
+
 #include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -16,5 +19,7 @@ int create_function_field(struct Function_Field *field, double start, double end
 int input_function_field(struct Function_Field *field, FILE *file_stream);
 int output_function_field(struct Function_Field *field, char *filename);
 int f_eval(struct Function_Field *field, double x, double *f);
+int f_eval_batch(struct Function_Field *field, const double *x, size_t n, double *f);
 void free_function_field(struct Function_Field *field);
 
+#endif
@@ -0,0 +1,44 @@
+// Header file for the hardware performance counters (perf_event_open)
+#ifndef HW_COUNTERS_H
+#define HW_COUNTERS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+	HW_CYCLES,
+	HW_INSTRUCTIONS,
+	HW_CACHE_MISSES, // Last level cache misses
+	HW_BRANCH_MISSES,
+	HW_NUM_EVENTS
+} Hw_Event;
+
+typedef enum {
+	HW_ELEMENT_LOOP, // Element loops of the global assembly (including the f_eval() calls they make)
+	HW_F_EVAL, // f_eval()
+	HW_FACTOR, // band_lu_decomp()
+	HW_NUM_REGIONS
+} Hw_Region;
+
+// Counter values at the start of a region
+struct Hw_Snapshot {
+	uint64_t values[HW_NUM_EVENTS];
+	uint64_t nested; // Regions the thread had completed, to correct the enclosing region for their measurement cost
+	bool valid;
+
+};
+
+// Set by hw_counters_enable(); the regions are only measured while it is set and a Solver_Stats is active
+extern bool hw_counters_requested;
+
+int hw_counters_enable();
+const char* hw_counters_unavailable_reason();
+bool hw_event_available(Hw_Event event);
+bool hw_counters_read(struct Hw_Snapshot* snapshot);
+bool hw_counters_accumulate(const struct Hw_Snapshot* begin, uint64_t* totals);
+const char* hw_event_name(Hw_Event event);
+const char* hw_region_name(Hw_Region region);
+
+#endif
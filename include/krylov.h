@@ -0,0 +1,30 @@
+// Header file for the Krylov (BiCGSTAB) solver and the report shared by the iterative solvers
+#ifndef KRYLOV_H
+#define KRYLOV_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// y = A*x; the context is whatever the operator needs (e.g. a struct Band_Matrix)
+typedef void (*Krylov_Operator)(void* context, const double* x, double* y);
+// z = M^-1*r for a preconditioner M close to A; NULL means no preconditioning
+typedef void (*Krylov_Preconditioner)(void* context, const double* r, double* z);
+
+// Stop once the backward error ||b - A x||/(||A||*||x|| + ||b||) (infinity norms) is at most the tolerance.
+// Measuring against ||b|| alone would not do: the interior load entries shrink with the element size while ||A|| grows with 1/h.
+#define ITERATIVE_DEFAULT_TOLERANCE 1e-12
+#define KRYLOV_DEFAULT_MAX_ITERATIONS 10000
+
+struct Iterative_Report {
+	int iterations; // Krylov iterations or multigrid cycles
+	double residual; // Backward error of the returned solution
+	bool converged;
+
+};
+
+void krylov_band_operator(void* matrix, const double* x, double* y);
+double backward_error(const double* r, const double* x, const double* b, size_t n, double operator_norm);
+int bicgstab_solve(size_t n, Krylov_Operator apply, void* operator_context, double operator_norm, Krylov_Preconditioner precondition, void* preconditioner_context,
+				   const double* b, double* x, double tolerance, int max_iterations, struct Iterative_Report* report);
+
+#endif
@@ -0,0 +1,28 @@
+// Header file for the matrix-free coefficient operator and its Jacobi preconditioner
+#ifndef MATRIX_FREE_H
+#define MATRIX_FREE_H
+
+#include <gsl/gsl_vector.h>
+
+#include "fe_section.h"
+#include "function_field.h"
+#include "krylov.h"
+
+// The global coefficient matrix with its Dirichlet rows, applied element by element without being assembled
+struct Matrix_Free_Operator {
+	struct Mesh* mesh;
+	double a, b;
+	double* inverse_diagonal; // Jacobi preconditioner; 1 in the Dirichlet rows and wherever the diagonal vanishes
+	double norm_inf; // Infinity norm of the operator, for the stopping test
+
+};
+
+int create_matrix_free_operator(struct Matrix_Free_Operator* op, struct Mesh* input_mesh, double a, double b);
+void free_matrix_free_operator(struct Matrix_Free_Operator* op);
+
+void matrix_free_apply(void* op, const double* x, double* y);
+void jacobi_precondition(void* op, const double* r, double* z);
+
+int solve_ode_matrix_free(struct Mesh* input_mesh, gsl_vector** solution, double a, double b, double d1, double d2, struct Function_Field *function_field, double tolerance, struct Iterative_Report* report);
+
+#endif
@@ -0,0 +1,58 @@
+// Header file for the geometric multigrid solver on nested 1D meshes
+#ifndef MULTIGRID_H
+#define MULTIGRID_H
+
+#include <stddef.h>
+
+#include "band_matrix.h"
+#include "krylov.h"
+
+// Levels are coarsened until they have at most this many nodes; the coarsest one is solved directly
+#define MULTIGRID_COARSEST_NODES 64
+#define MULTIGRID_MAX_LEVELS 40
+// Coarsening also stops before a level whose rows have off-diagonal sums above this multiple of the diagonal
+// (convection at cell Péclet numbers above 1, or a positive B on coarse meshes), where Gauss-Seidel stops smoothing
+#define MULTIGRID_MAX_DOMINANCE_RATIO 1.5
+#define MULTIGRID_DEFAULT_MAX_CYCLES 100
+// Gauss-Seidel sweeps before and after the coarse-grid correction
+#define MULTIGRID_SMOOTHING_STEPS 2
+
+typedef enum {
+	MULTIGRID_V_CYCLE,
+	MULTIGRID_W_CYCLE,
+	MULTIGRID_F_CYCLE
+} Multigrid_Cycle;
+
+struct Multigrid_Level {
+	size_t size;
+	const struct Band_Matrix* A; // The caller's matrix on the finest level, `coarse` below it
+	struct Band_Matrix coarse;
+
+	// Interpolation from the next coarser level: node j takes weight[j] of coarse node parent[j] and (1 - weight[j]) of parent[j] + 1
+	size_t* parent;
+	double* weight;
+
+	const double* b;
+	double* x;
+	double* r;
+	double* storage; // b and x of the coarser levels, r of all of them
+
+};
+
+struct Multigrid {
+	int num_levels;
+	struct Multigrid_Level levels[MULTIGRID_MAX_LEVELS];
+	struct Band_Matrix coarsest_lu;
+	Multigrid_Cycle cycle;
+
+};
+
+int create_multigrid(struct Multigrid* mg, const double* node_coordinates, const struct Band_Matrix* A, Multigrid_Cycle cycle);
+void free_multigrid(struct Multigrid* mg);
+
+void multigrid_cycle(struct Multigrid* mg, const double* b, double* x);
+void multigrid_fmg(struct Multigrid* mg, const double* b, double* x);
+int multigrid_solve(struct Multigrid* mg, const double* b, double* x, double tolerance, int max_cycles, struct Iterative_Report* report);
+void multigrid_precondition(void* mg, const double* r, double* z);
+
+#endif
@@ -0,0 +1,60 @@
+// Header file for the Newton solver of y'' + A y' + g(y) = f
+#ifndef NONLINEAR_H
+#define NONLINEAR_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "fe_section.h"
+#include "function_field.h"
+
+// g(y) and dg/dy; both take the context of the struct
+struct Nonlinear_Term {
+	double (*g) (double y, void* context);
+	double (*dg) (double y, void* context);
+	void* context;
+
+};
+
+typedef enum {
+	NEWTON_FULL, // Assemble and decompose the tangent at every iteration
+	NEWTON_MODIFIED // Keep the decomposed tangent for as long as it keeps reducing the residual (see NEWTON_MODIFIED_MAX_RATIO)
+} Newton_Method;
+
+// Stop once ||R|| <= tolerance*(||K y|| + ||G(y)|| + ||F||) (infinity norms), for the residual R = K y + G(y) - F of the linear part K and the g-term G
+#define NEWTON_DEFAULT_TOLERANCE 1e-10
+#define NEWTON_DEFAULT_MAX_ITERATIONS 50
+// Modified Newton decomposes the tangent again after a step that reduces the residual by less than this factor
+#define NEWTON_MODIFIED_MAX_RATIO 0.5
+// The line search halves the step at most this many times, until the residual has decreased (Armijo condition on ||R||)
+#define NEWTON_MAX_BACKTRACKS 10
+
+// Zero-initialize for full Newton without line search or continuation, to NEWTON_DEFAULT_TOLERANCE
+struct Newton_Options {
+	Newton_Method method;
+	bool line_search;
+	int continuation_steps; // Solve with f scaled by 1/steps, 2/steps, ..., 1, each from the previous solution; 0 or 1 solves with f directly
+	double tolerance; // 0 for NEWTON_DEFAULT_TOLERANCE
+	int max_iterations; // Per continuation step; 0 for NEWTON_DEFAULT_MAX_ITERATIONS
+	const gsl_vector* initial_guess; // NULL starts from the line between the boundary values
+
+};
+
+struct Newton_Report {
+	int iterations; // Newton steps, over all continuation steps
+	int factorizations; // Tangents assembled and decomposed
+	int residual_evaluations;
+	int backtracks; // Step halvings of the line search
+	int continuation_steps;
+	double residual; // Relative residual of the returned solution
+	bool converged;
+	double seconds;
+	double seconds_per_iteration;
+	double factor_seconds; // Assembling and decomposing the tangents
+
+};
+
+int solve_ode_nonlinear(struct Mesh* input_mesh, struct ODE_Solution* solution, double a, const struct Nonlinear_Term* g, double d1, double d2, struct Function_Field *function_field,
+						const struct Newton_Options* options, struct Newton_Report* report);
+
+#endif
@@ -0,0 +1,45 @@
+// Header file for the arbitrary-order (p) elements with hierarchical Lobatto shape functions
+#ifndef P_ELEMENTS_H
+#define P_ELEMENTS_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <gsl/gsl_vector.h>
+
+#include "function_field.h"
+
+#define P_MAX_ORDER 10
+// Gauss-Legendre points per element of order p; p + 1 integrate the element matrices exactly, the rest go to the load vector
+#define P_QUADRATURE_POINTS(p) ((p) + 3)
+
+/* Element e spans vertices[e] to vertices[e + 1] and has order[e] + 1 unknowns, numbered first_dof[e] to first_dof[e + 1]:
+ * its left vertex, its order[e] - 1 bubble coefficients and its right vertex (which is the next element's left vertex).
+ * Keeping each element's unknowns together gives a band of max(order) sub- and super-diagonals.
+ * The bubbles vanish at the vertices, so the vertex unknowns are the solution values there.
+ */
+struct P_Mesh {
+	uint32_t num_elements;
+	double* vertices;
+	int* order;
+	size_t* first_dof;
+	size_t num_dofs;
+	int max_order;
+
+};
+
+int create_p_mesh(struct P_Mesh* mesh, const double* vertices, uint32_t num_elements, const int* order);
+int generate_uniform_p_mesh(struct P_Mesh* mesh, double start, double end, uint32_t num_elements, int order);
+void free_p_mesh(struct P_Mesh* mesh);
+int parse_p_mesh_file(FILE* input_stream, struct P_Mesh* mesh);
+int output_p_mesh_file(const struct P_Mesh* mesh, FILE* output_stream);
+
+double lobatto_shape(int k, double zeta);
+double lobatto_derivative(int k, double zeta);
+
+struct Band_Matrix;
+int assemble_p_system(struct P_Mesh* mesh, double a, double b, struct Function_Field *function_field, struct Band_Matrix* K_coeff, gsl_vector** F_const);
+int solve_ode_p(struct P_Mesh* mesh, gsl_vector** solution, double a, double b, double d1, double d2, struct Function_Field *function_field);
+int evaluate_p_solution(struct P_Mesh* mesh, const gsl_vector* solution, const double* x_query, size_t num_points, double* y_out, double* dydx_out);
+
+#endif
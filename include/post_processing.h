@@ -0,0 +1,17 @@
+// Header file for the post-processing routines that work on a solved mesh
+#ifndef POST_PROCESSING_H
+#define POST_PROCESSING_H
+
+#include "fe_section.h"
+
+// Number of query points that are mapped and evaluated together within one element
+#define EVALUATION_BATCH 256
+
+// Gauss-Legendre points used for the quantity-of-interest integral (matches the L3 element quadrature)
+#define QOI_QUADRATURE_POINTS 10
+
+int evaluate_solution(struct Mesh* input_mesh, struct ODE_Solution* input_solution, const double* x_query, size_t num_points, double* y_out, double* dydx_out);
+int compute_qoi(struct Mesh* input_mesh, struct ODE_Solution* input_solution, struct QoI_Request* request, struct QoI_Result* result);
+void free_qoi_result(struct QoI_Result* result);
+
+#endif
@@ -0,0 +1,60 @@
+// Header file for meshes of several regions (materials), each with its own constant A and B
+#ifndef REGIONS_H
+#define REGIONS_H
+
+#include <stddef.h>
+
+#include "fe_section.h"
+#include "band_matrix.h"
+#include "function_field.h"
+
+// Elements of one region and kind, with the parts of their coefficient matrices: k = stiffness + a*convection + b*mass
+struct Region_Block {
+	Element_2D_Type kind;
+	uint32_t region;
+	int count;
+	int size; // Nodes per element
+	uint32_t nodes[MAX_ELEMENT_NODES][ELEMENT_BLOCK];
+	double stiffness[MAX_ELEMENT_NODES*MAX_ELEMENT_NODES][ELEMENT_BLOCK];
+	double convection[MAX_ELEMENT_NODES*MAX_ELEMENT_NODES][ELEMENT_BLOCK];
+	double mass[MAX_ELEMENT_NODES*MAX_ELEMENT_NODES][ELEMENT_BLOCK];
+
+};
+
+struct Region_Cache {
+	uint32_t first_block; // In the operator's block array
+	uint32_t num_blocks;
+	// Elements of other regions that share a node with the region (block*ELEMENT_BLOCK + column), in the operator's neighbor array
+	uint32_t first_neighbor;
+	uint32_t num_neighbors;
+	size_t first_row; // Lowest node of the region's elements; the band rows before it do not depend on the region
+
+};
+
+/* The assembled and decomposed band of a region mesh, kept up to date as the coefficients of its regions change.
+ * The element operators only depend on the geometry, so they are integrated once per element and grouped by region;
+ * a new A or B for a region reassembles the band rows of that region's nodes, and the decomposition is redone from the region's first row on.
+ */
+struct Region_Operator {
+	struct Mesh* mesh; // Its region table holds the current coefficients
+	struct Region_Cache* regions;
+	struct Region_Block* blocks;
+	uint32_t num_blocks;
+	uint32_t* neighbors;
+	unsigned char* row_marks; // Rows being reassembled; all clear between updates
+	struct Band_Matrix K; // With the Dirichlet rows
+	struct Band_Matrix K_lu;
+	struct Band_Checkpoints checkpoints;
+	size_t first_changed_row; // Of K since it was last decomposed; SIZE_MAX when K_lu is current
+
+};
+
+int assign_mesh_regions(struct Mesh* input_mesh, const uint32_t* element_region, const struct Mesh_Region* regions, uint32_t num_regions);
+
+int create_region_operator(struct Region_Operator* op, struct Mesh* input_mesh);
+int set_region_coefficients(struct Region_Operator* op, uint32_t region, double a, double b);
+int factorize_region_operator(struct Region_Operator* op);
+int solve_ode_regions(struct Region_Operator* op, struct ODE_Solution* solution, double d1, double d2, struct Function_Field *function_field);
+void free_region_operator(struct Region_Operator* op);
+
+#endif
@@ -0,0 +1,67 @@
+// Header file for the Solution Writer struct and its associated routines
+#ifndef SOLUTION_WRITER_H
+#define SOLUTION_WRITER_H
+
+#include <pthread.h>
+
+#include "fe_section.h"
+
+typedef enum {
+	WRITER_TEXT, // Tab-delimited `x\ty` text with round-trip precision
+	WRITER_BINARY, // Raw native-endian doubles; see solution_writer.c for the layout
+	WRITER_COLUMNAR // Tab-delimited text with one `y` column per submitted solution (sweeps)
+} Writer_Format;
+
+// Index to pass when the record is not part of a sweep or batch
+#define WRITER_NO_INDEX SIZE_MAX
+
+// Size of the formatting buffer handed to fwrite in one go
+#define WRITER_BUFFER_SIZE (1 << 20)
+// Number of submitted solutions allowed to wait on the writer thread before submit_solution() blocks
+#define WRITER_MAX_QUEUED 64
+
+// Magic bytes at the start of a WRITER_BINARY file
+#define WRITER_BINARY_MAGIC "ODESOL01"
+
+struct Writer_Record {
+	size_t index;
+	size_t num_nodes;
+	double *x_values;
+	double *y_values;
+	struct Writer_Record *next;
+
+};
+
+struct Solution_Writer {
+	FILE *output_file;
+	Writer_Format format;
+
+	// Formatting buffer; only touched by the writer thread
+	char *buffer;
+	size_t buffer_used;
+
+	// Records waiting on the writer thread
+	struct Writer_Record *queue_head, *queue_tail;
+	size_t queued_records;
+
+	// Columnar records are held until the writer is closed, since every row needs every solution
+	struct Writer_Record *columns_head, *columns_tail;
+	size_t num_columns;
+
+	bool closing;
+	int status; // Non-zero once a write has failed; guarded by lock while the writer thread runs
+
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t not_empty;
+	pthread_cond_t not_full;
+
+};
+
+int open_solution_writer(struct Solution_Writer *writer, const char *path, Writer_Format format);
+int submit_solution(struct Solution_Writer *writer, struct Mesh *mesh, struct ODE_Solution *solution, size_t index);
+int submit_solution_values(struct Solution_Writer *writer, const double *x_values, const double *y_values, size_t num_nodes, size_t index);
+int close_solution_writer(struct Solution_Writer *writer);
+int output_solution_file(struct Mesh *input_mesh, struct ODE_Solution *input_solution, const char *path, Writer_Format format);
+
+#endif
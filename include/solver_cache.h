@@ -0,0 +1,51 @@
+// Header file for the content-hashed LRU Solver Cache
+#ifndef SOLVER_CACHE_H
+#define SOLVER_CACHE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+// Entries are reference counted: an evicted entry stays alive until its last holder releases it
+struct Cache_Entry {
+	uint64_t key;
+	void *value;
+	void (*free_value) (void *);
+	size_t references;
+	bool evicted;
+
+	// Recency list; the head is the most recently used entry
+	struct Cache_Entry *prev;
+	struct Cache_Entry *next;
+
+};
+
+struct Solver_Cache {
+	pthread_mutex_t lock;
+	struct Cache_Entry *head;
+	struct Cache_Entry *tail;
+	size_t num_entries;
+	size_t capacity;
+
+	size_t hits;
+	size_t misses;
+	size_t evictions;
+
+};
+
+uint64_t hash_bytes(uint64_t hash, const void *data, size_t length);
+uint64_t hash_double(uint64_t hash, double value);
+
+int create_solver_cache(struct Solver_Cache *cache, size_t capacity);
+struct Cache_Entry* cache_acquire(struct Solver_Cache *cache, uint64_t key);
+struct Cache_Entry* cache_insert(struct Solver_Cache *cache, uint64_t key, void *value, void (*free_value) (void *));
+void cache_release(struct Solver_Cache *cache, struct Cache_Entry *entry);
+void free_solver_cache(struct Solver_Cache *cache);
+
+#endif
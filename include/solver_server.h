@@ -0,0 +1,68 @@
+// Header file for the persistent Solver Server
+#ifndef SOLVER_SERVER_H
+#define SOLVER_SERVER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "fe_section.h"
+#include "function_field.h"
+#include "solver_cache.h"
+#include "thread_pool.h"
+
+#define SERVER_LINE_LENGTH 4096
+#define SERVER_PATH_LENGTH 1024
+#define SERVER_ID_LENGTH 64
+#define SERVER_DEFAULT_CACHE_ENTRIES 64
+
+/* Line protocol (one request per line, `key=value` fields separated by spaces):
+ *	SOLVE a=<A> b=<B> d1=<d1> d2=<d2> field=<field file> start=<start> end=<end> elements=<n> [kind=L2|L3] [id=<tag>] [values=0]
+ *	SOLVE a=<A> b=<B> d1=<d1> d2=<d2> field=<field file> mesh=<mesh file> [kind=L2|L3] [id=<tag>] [values=0]
+ *	STATS
+ *	SHUTDOWN
+ * A solve is answered with
+ *	OK id=<tag> nodes=<N> field=hit|miss mesh=hit|miss load=hit|miss factor=hit|miss time_us=<t>
+ * followed by N lines of `x\ty` (unless values=0), and failures with `ERROR id=<tag> <message>`.
+ */
+struct Solve_Request {
+	char id[SERVER_ID_LENGTH];
+	Element_2D_Type kind;
+	double a, b, d1, d2;
+	char field_path[SERVER_PATH_LENGTH];
+
+	// Either a mesh file, or a uniform mesh over [start, end]
+	char mesh_path[SERVER_PATH_LENGTH];
+	double start, end;
+	int num_elements;
+
+	bool send_values;
+
+};
+
+struct Solver_Server {
+	struct Solver_Cache cache;
+	struct Thread_Pool pool;
+
+	int listen_fd; // -1 when serving a pipe
+	int output_fd; // Protocol output when serving a pipe
+	int wake_fds[2]; // Workers hand socket connections back to the accept loop through this pipe
+	pthread_mutex_t output_lock;
+
+	pthread_mutex_t stats_lock;
+	size_t requests_served;
+	size_t requests_failed;
+	bool shutting_down;
+
+};
+
+int create_solver_server(struct Solver_Server *server, size_t num_threads, size_t cache_entries);
+int parse_solve_request(char *line, struct Solve_Request *request);
+int handle_server_line(struct Solver_Server *server, char *line, FILE *response);
+int run_solver_server(struct Solver_Server *server, const char *socket_path);
+void free_solver_server(struct Solver_Server *server);
+
+#endif
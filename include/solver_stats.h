@@ -0,0 +1,103 @@
+// Header file for the per-phase solver statistics
+#ifndef SOLVER_STATS_H
+#define SOLVER_STATS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "hw_counters.h"
+
+typedef enum {
+	STATS_PARSE, // Reading mesh and function field files
+	STATS_ELEMENT_BUILD, // Creating the element objects and connectivity grid
+	STATS_LOCAL_KERNELS, // Element coefficient matrices and constant vectors (quadrature)
+	STATS_SCATTER, // Adding the local arrays into the global ones
+	STATS_BC, // Applying the boundary conditions
+	STATS_FACTOR, // LU decomposition
+	STATS_SOLVE, // Triangular solves
+	STATS_OUTPUT, // Writing the solution
+	STATS_NUM_PHASES
+} Stats_Phase;
+
+typedef enum {
+	STATS_ELEMENTS, // Elements assembled
+	STATS_QUAD_EVALS, // Integrand evaluations by the quadrature rules
+	STATS_F_EVALS, // f_eval() calls
+	STATS_ALLOCATIONS, // Allocation requests made by the solver routines
+	STATS_BYTES, // Bytes requested by those allocations
+	STATS_REFINEMENTS, // Iterative refinement steps of mixed-precision solves
+	STATS_ITERATIONS, // Krylov iterations, multigrid cycles and Newton steps
+	STATS_REFACTORED_ROWS, // Rows eliminated again by incremental refactorizations (band_lu_refactor())
+	STATS_NUM_COUNTERS
+} Stats_Counter;
+
+struct Solver_Stats {
+	double phase_seconds[STATS_NUM_PHASES];
+	uint64_t counters[STATS_NUM_COUNTERS];
+	uint64_t hw_counts[HW_NUM_REGIONS][HW_NUM_EVENTS]; // Only recorded after hw_counters_enable()
+	uint64_t hw_entries[HW_NUM_REGIONS];
+
+};
+
+// Statistics are recorded into the calling thread's active struct (if any), so the library routines do not need an extra argument
+extern _Thread_local struct Solver_Stats* active_stats;
+
+struct Solver_Stats* stats_activate(struct Solver_Stats* stats);
+void stats_merge(struct Solver_Stats* dest, const struct Solver_Stats* src);
+int output_stats_json(FILE* output, const struct Solver_Stats* stats);
+const char* stats_phase_name(Stats_Phase phase);
+const char* stats_counter_name(Stats_Counter counter);
+
+// Compile with -DODE_NO_STATS to remove the instrumentation altogether
+#ifndef ODE_NO_STATS
+
+static inline void stats_clock(struct timespec* t) {
+	if (active_stats != NULL) {
+		clock_gettime(CLOCK_MONOTONIC, t);
+	}
+
+}
+
+static inline void stats_add_time(Stats_Phase phase, const struct timespec* begin) {
+	if (active_stats != NULL) {
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		active_stats->phase_seconds[phase] += (now.tv_sec - begin->tv_sec) + (now.tv_nsec - begin->tv_nsec)/1e9;
+	}
+
+}
+
+static inline void stats_hw_begin(struct Hw_Snapshot* s) {
+	s->valid = (active_stats != NULL && hw_counters_requested && hw_counters_read(s));
+
+}
+
+static inline void stats_hw_end(Hw_Region region, const struct Hw_Snapshot* begin) {
+	if (begin->valid && active_stats != NULL && hw_counters_accumulate(begin, active_stats->hw_counts[region])) {
+		active_stats->hw_entries[region]++;
+	}
+
+}
+
+#define STATS_TIMER_START(name) struct timespec name; stats_clock(&name)
+#define STATS_TIMER_STOP(name, phase) stats_add_time(phase, &name)
+#define STATS_COUNT(counter, n) do { if (active_stats != NULL) active_stats->counters[counter] += (n); } while (0)
+#define STATS_ALLOC(bytes) do { if (active_stats != NULL) { active_stats->counters[STATS_ALLOCATIONS]++; active_stats->counters[STATS_BYTES] += (bytes); } } while (0)
+#define STATS_HW_START(name) struct Hw_Snapshot name; stats_hw_begin(&name)
+#define STATS_HW_STOP(name, region) stats_hw_end(region, &name)
+
+#else
+
+#define STATS_TIMER_START(name) ((void) 0)
+#define STATS_TIMER_STOP(name, phase) ((void) 0)
+#define STATS_COUNT(counter, n) ((void) 0)
+#define STATS_ALLOC(bytes) ((void) 0)
+#define STATS_HW_START(name) ((void) 0)
+#define STATS_HW_STOP(name, region) ((void) 0)
+
+#endif
+
+#endif
@@ -0,0 +1,30 @@
+// Header file for the static condensation of the L3 middle nodes
+#ifndef STATIC_CONDENSATION_H
+#define STATIC_CONDENSATION_H
+
+#include <stdbool.h>
+#include <gsl/gsl_vector.h>
+
+#include "fe_section.h"
+#include "function_field.h"
+
+// Elements per thread below which the element work is not split (starting a thread costs about as much as condensing this many elements)
+#define CONDENSE_MIN_CHUNK 8192
+// A middle node whose diagonal is this small relative to the rest of its row is not eliminated without pivoting; the solve falls back to the full system
+#define CONDENSE_PIVOT_TOLERANCE 1e-8
+
+// Returned by solve_ode_condensed() when it had to give up on the condensation
+#define CONDENSE_FALLBACK -1
+
+// Element e's middle row and its vertex block after the middle node has been eliminated
+struct Condensed_Element {
+	double k[2][2]; // Left and right vertex
+	double f[2];
+	double k_m0, k_mm, k_m2, f_m; // For recovering the middle node
+
+};
+
+bool mesh_condensable(struct Mesh* input_mesh);
+int solve_ode_condensed(struct Mesh* input_mesh, gsl_vector** solution, double a, double b, double d1, double d2, struct Function_Field *function_field, size_t num_threads);
+
+#endif
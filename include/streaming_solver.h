@@ -0,0 +1,32 @@
+// Header file for the streaming solver (assembly fused with the banded forward elimination)
+#ifndef STREAMING_SOLVER_H
+#define STREAMING_SOLVER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <gsl/gsl_vector.h>
+
+#include "fe_section.h"
+#include "function_field.h"
+
+// Node coordinates read one at a time, in ascending order, so that a mesh never has to be held in memory
+struct Node_Stream {
+	uint32_t num_nodes;
+	uint32_t next_index;
+	double previous;
+
+	FILE* file; // Mesh file in the format read by parse_input_file(); NULL for a uniform mesh
+	double start, end, step;
+
+};
+
+int open_node_stream_file(struct Node_Stream* nodes, FILE* mesh_stream);
+int open_node_stream_uniform(struct Node_Stream* nodes, double start, double end, int num_elements, Element_2D_Type mesh_kind);
+int next_node(struct Node_Stream* nodes, double* x);
+
+// Both return the solution vector, or NULL on error.
+// `scratch_path` names a file for the back-substitution data (removed again before returning); NULL keeps it in memory.
+gsl_vector* solve_ode_streaming(struct Mesh* input_mesh, double a, double b, double d1, double d2, struct Function_Field *function_field, const char* scratch_path);
+gsl_vector* solve_ode_streaming_nodes(struct Node_Stream* nodes, Element_2D_Type mesh_kind, double a, double b, double d1, double d2, struct Function_Field *function_field, const char* scratch_path);
+
+#endif
@@ -0,0 +1,40 @@
+// Header file for the fixed-size worker Thread Pool
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+struct Thread_Task {
+	void (*function) (void *);
+	void *args;
+	struct Thread_Task *next;
+
+};
+
+struct Thread_Pool {
+	pthread_t *threads;
+	size_t num_threads;
+
+	pthread_mutex_t lock;
+	pthread_cond_t work_available;
+	pthread_cond_t work_done;
+
+	// FIFO of tasks that have not been picked up yet
+	struct Thread_Task *queue_head;
+	struct Thread_Task *queue_tail;
+	size_t pending_tasks; // Queued plus running
+	bool shutting_down;
+
+};
+
+int create_thread_pool(struct Thread_Pool *pool, size_t num_threads);
+int submit_task(struct Thread_Pool *pool, void (*function) (void *), void *args);
+void wait_thread_pool(struct Thread_Pool *pool);
+void free_thread_pool(struct Thread_Pool *pool);
+size_t default_thread_count();
+int parallel_for(size_t count, size_t num_threads, size_t min_chunk, int (*body) (void *, size_t, size_t), void *args);
+
+#endif
@@ -0,0 +1,54 @@
+// Header file for the implicit time integration of u_t = u_xx + A u_x + B u + f(x, t)
+#ifndef TIME_STEPPING_H
+#define TIME_STEPPING_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <gsl/gsl_vector.h>
+
+#include "fe_section.h"
+#include "band_matrix.h"
+#include "solution_writer.h"
+
+typedef enum {
+	TIME_BACKWARD_EULER, // First order, L-stable
+	TIME_CRANK_NICOLSON, // Second order, A-stable; sharp initial data decays slowly and oscillates
+	TIME_BDF2 // Second order, L-stable; the first step is a backward Euler step, which needs a decomposition of its own
+} Time_Scheme;
+
+typedef double (*Source_Callback)(double x, double t, void* context);
+
+// u_t = u_xx + A u_x + B u + f(x, t) with u = d1 and d2 at the ends of the mesh
+struct Time_Problem {
+	double a, b;
+	Source_Callback f; // NULL for f = 0
+	void* context; // Passed to f
+	bool steady_source; // f does not depend on t, so its load vector is assembled once instead of at every step
+	double d1, d2;
+	const gsl_vector* initial; // Nodal values of u at t0; the boundary values are replaced by d1 and d2
+
+};
+
+// Snapshots go to the writer with the step number as their index (a "# case" marker in text files, a column of a columnar file)
+struct Time_Options {
+	Time_Scheme scheme;
+	double t0, dt;
+	size_t num_steps;
+	size_t snapshot_interval; // Steps between snapshots, starting with the initial state; 0 for the final state only
+	struct Solution_Writer* writer; // NULL to keep no snapshots
+
+};
+
+struct Time_Report {
+	size_t steps;
+	int factorizations;
+	size_t snapshots;
+	double seconds;
+	double factor_seconds; // Assembling M and K and decomposing the step matrices
+	double seconds_per_step; // Of the steps alone
+
+};
+
+int solve_ode_transient(struct Mesh* input_mesh, struct ODE_Solution* solution, const struct Time_Problem* problem, const struct Time_Options* options, struct Time_Report* report);
+
+#endif
@@ -0,0 +1,49 @@
+// Header file for the trace-event timeline (Chrome/Perfetto JSON)
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TRACE_DEFAULT_EVENTS 65536 // Per thread; older events are overwritten once a thread's buffer is full
+
+struct Trace_Event {
+	const char* name; // Names and categories must be string literals (only the pointer is kept)
+	const char* category;
+	uint64_t timestamp_ns; // Since trace_start(); the beginning, for spans
+	int64_t value; // Duration in nanoseconds for spans, the value for counters
+	char phase; // 'X' (complete span), 'i'nstant or 'C'ounter, as in the trace-event format
+
+};
+
+// Set by trace_start(); nothing is recorded until then
+extern bool trace_enabled;
+
+int trace_start(const char* path, size_t events_per_thread);
+void trace_set_thread_name(const char* name);
+uint64_t trace_now();
+void trace_record(char phase, const char* name, const char* category, uint64_t timestamp_ns, int64_t value);
+int trace_dump();
+int output_trace_json(FILE* output);
+
+// Compile with -DODE_NO_TRACE to remove the tracing calls altogether
+#ifndef ODE_NO_TRACE
+
+// A span is recorded as one event with its beginning and duration when it ends, so a span left by an early return is simply dropped
+#define TRACE_SPAN_START(name) uint64_t name = trace_enabled ? trace_now() : 0
+#define TRACE_SPAN_STOP(name, label, category) do { if (trace_enabled) trace_record('X', label, category, name, trace_now() - name); } while (0)
+#define TRACE_INSTANT(label, category) do { if (trace_enabled) trace_record('i', label, category, trace_now(), 0); } while (0)
+#define TRACE_COUNTER(label, category, value) do { if (trace_enabled) trace_record('C', label, category, trace_now(), value); } while (0)
+
+#else
+
+#define TRACE_SPAN_START(name) ((void) 0)
+#define TRACE_SPAN_STOP(name, label, category) ((void) 0)
+#define TRACE_INSTANT(label, category) ((void) 0)
+#define TRACE_COUNTER(label, category, value) ((void) 0)
+
+#endif
+
+#endif
@@ -0,0 +1,59 @@
+// Header file for the solves with coefficients A(x) and B(x) that vary over the mesh
+#ifndef VARIABLE_COEFFICIENTS_H
+#define VARIABLE_COEFFICIENTS_H
+
+#include <stddef.h>
+#include <gsl/gsl_vector.h>
+
+#include "fe_section.h"
+#include "function_field.h"
+
+typedef double (*Coefficient_Callback)(double x, void* context);
+
+// A coefficient given as a tabulated field, a callback, or (with both NULL) a constant
+struct Coefficient_Function {
+	struct Function_Field* field;
+	Coefficient_Callback callback;
+	void* context; // Passed to the callback
+	double constant;
+
+};
+
+// The elements of one block, gathered as the element kernels take them
+struct Coefficient_Block {
+	Element_2D_Type kind;
+	int count;
+	int size; // Nodes per element
+	int num_points; // Quadrature points per element
+	size_t offset; // Of the block's values in the per-point arrays, which hold point q of element e at offset + q*count + e
+	double x[MAX_ELEMENT_NODES][ELEMENT_BLOCK];
+	uint32_t nodes[MAX_ELEMENT_NODES][ELEMENT_BLOCK];
+
+};
+
+/* A and B at the quadrature points of every element of a mesh, evaluated once when the table is created.
+ * The points themselves are kept as well, so the load vector of any forcing field is evaluated there without recomputing them;
+ * the table serves any number of assemblies and solves, as long as the mesh is not changed.
+ */
+struct Coefficient_Table {
+	struct Mesh* mesh;
+	uint32_t num_blocks;
+	struct Coefficient_Block* blocks;
+	size_t num_values;
+	double* xq;
+	double* a;
+	double* b;
+
+};
+
+int create_coefficient_table(struct Coefficient_Table* table, struct Mesh* input_mesh, const struct Coefficient_Function* a, const struct Coefficient_Function* b);
+int update_coefficient_table(struct Coefficient_Table* table, const struct Coefficient_Function* a, const struct Coefficient_Function* b);
+void free_coefficient_table(struct Coefficient_Table* table);
+
+struct Band_Matrix;
+int assemble_variable_matrix(const struct Coefficient_Table* table, struct Band_Matrix* K_coeff);
+gsl_vector* assemble_variable_vector(const struct Coefficient_Table* table, struct Function_Field *function_field);
+int factorize_ode_variable(const struct Coefficient_Table* table, struct Band_Matrix* K_lu);
+int solve_ode_variable(const struct Coefficient_Table* table, struct ODE_Solution* solution, double d1, double d2, struct Function_Field *function_field);
+
+#endif
@@ -0,0 +1,512 @@
+/* Adaptive mesh refinement
+ *
+ * Each solve is followed by a gradient-recovery (Zienkiewicz-Zhu) error estimate: the derivative of the solution jumps between elements,
+ * and averaging it at the shared nodes gives a recovered derivative G that is more accurate than the computed one.
+ * The indicator of element e is the squared L2 norm of G - y' over the element, and their sum estimates the error in y'.
+ * The elements that account for a fixed fraction of the estimated error are split in two and the problem is solved again,
+ * until the estimate relative to the L2 norm of y' reaches the tolerance.
+ *
+ * On p-element meshes the hierarchical coefficients do both jobs instead. The bubble derivatives are orthonormal on the reference element,
+ * so c_k^2/J is the share of |y'|^2 carried by mode k, the highest mode estimates the element's error, and the rate at which the coefficients decay
+ * tells a smooth solution (raise the order, which converges exponentially) from an unresolved one (split the element).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "adaptive.h"
+#include "trace.h"
+
+// Position of the element nodes in the isoparametric coordinate
+static const double node_zeta[2][MAX_ELEMENT_NODES] = {{-1, 1}, {-1, 0, 1}};
+
+// Three-point Gauss-Legendre rule; the indicator integrands are at most quartic on elements with centered middle nodes
+static const double gauss_points[3] = {-0.774596669241483377, 0, 0.774596669241483377};
+static const double gauss_weights[3] = {5.0/9, 8.0/9, 5.0/9};
+
+static double (*const shape[2][MAX_ELEMENT_NODES]) (double) = {{L2_N0, L2_N1}, {L3_N0, L3_N1, L3_N2}};
+static double (*const shape_derv[2][MAX_ELEMENT_NODES]) (double) = {{L2_N0_D, L2_N1_D}, {L3_N0_D, L3_N1_D, L3_N2_D}};
+
+static int element_nodes(struct Mesh* input_mesh, uint32_t e, const int** node_id) {
+	struct Element_Conn* conn = &input_mesh->connectivity_grid[e];
+	*node_id = (conn->kind == QUAD) ? conn->node_list.L3.node_id : conn->node_list.L2.node_id;
+
+	return (conn->kind == QUAD) ? 3 : 2;
+
+}
+
+// dy/dx and the Jacobian at zeta within an element with node coordinates x and values y
+static double element_derivative(Element_2D_Type kind, int size, const double* x, const double* y, double zeta, double* jacobian) {
+	double dy = 0, dx = 0;
+	for (int i = 0; i < size; i++) {
+		dy += y[i]*shape_derv[kind][i](zeta);
+		dx += x[i]*shape_derv[kind][i](zeta);
+	}
+	*jacobian = dx;
+
+	return dy/dx;
+
+}
+
+// Meshes built by build_mesh_from_nodes(): elements of one kind, in order, each starting at the last node of the one before it
+bool mesh_refinable(struct Mesh* input_mesh) {
+	if (input_mesh->num_elements == 0 || input_mesh->connectivity_grid == NULL || input_mesh->node_coordinates == NULL) {
+		return false;
+	}
+
+	Element_2D_Type kind = input_mesh->connectivity_grid[0].kind;
+	int span = (kind == QUAD) ? 2 : 1;
+	if (input_mesh->num_nodes != span*(size_t) input_mesh->num_elements + 1) {
+		return false;
+	}
+	for (uint32_t e = 0; e < input_mesh->num_elements; e++) {
+		const int* node_id;
+		element_nodes(input_mesh, e, &node_id);
+		if (input_mesh->connectivity_grid[e].kind != kind || node_id[0] != span*(int64_t) e) {
+			return false;
+		}
+	}
+
+	return true;
+
+}
+
+// Averages each element's derivative at the nodes it shares; the two end nodes are extrapolated linearly from the next two vertices instead,
+// since they only have one element to average and the error is often largest there (boundary layers)
+static void recover_derivative(struct Mesh* input_mesh, const double* y, double* g, double* weight) {
+	Element_2D_Type kind = input_mesh->connectivity_grid[0].kind;
+	const double* x = input_mesh->node_coordinates;
+	memset(g, 0, input_mesh->num_nodes*sizeof(double));
+	memset(weight, 0, input_mesh->num_nodes*sizeof(double));
+
+	for (uint32_t e = 0; e < input_mesh->num_elements; e++) {
+		const int* node_id;
+		int size = element_nodes(input_mesh, e, &node_id);
+		double x_e[MAX_ELEMENT_NODES], y_e[MAX_ELEMENT_NODES], jacobian;
+		for (int i = 0; i < size; i++) {
+			x_e[i] = x[node_id[i]];
+			y_e[i] = y[node_id[i]];
+		}
+		for (int i = 0; i < size; i++) {
+			g[node_id[i]] += element_derivative(kind, size, x_e, y_e, node_zeta[kind][i], &jacobian);
+			weight[node_id[i]] += 1;
+		}
+	}
+	for (uint32_t i = 0; i < input_mesh->num_nodes; i++) {
+		g[i] /= weight[i];
+	}
+
+	uint32_t num_elements = input_mesh->num_elements;
+	if (num_elements >= 2) {
+		int last = (kind == QUAD) ? 2 : 1;
+		const int *first_element, *second_element;
+		element_nodes(input_mesh, 0, &first_element);
+		element_nodes(input_mesh, 1, &second_element);
+		int v0 = first_element[0], v1 = first_element[last], v2 = second_element[last];
+		g[v0] = g[v1] + (x[v0] - x[v1])*(g[v2] - g[v1])/(x[v2] - x[v1]);
+
+		element_nodes(input_mesh, num_elements - 1, &first_element);
+		element_nodes(input_mesh, num_elements - 2, &second_element);
+		v0 = first_element[last];
+		v1 = first_element[0];
+		v2 = second_element[0];
+		g[v0] = g[v1] + (x[v0] - x[v1])*(g[v2] - g[v1])/(x[v2] - x[v1]);
+	}
+
+}
+
+// indicators[e] is the squared L2 norm of the recovered minus the computed derivative over element e;
+// relative_error is the square root of their sum relative to the L2 norm of the computed derivative
+int estimate_element_errors(struct Mesh* input_mesh, struct ODE_Solution* solution, double* indicators, double* relative_error) {
+	if (!mesh_refinable(input_mesh)) {
+		printf("The error estimator needs a mesh of one element kind with its nodes in order.\n");
+		return 1;
+	}
+
+	size_t n = input_mesh->num_nodes;
+	double* g = malloc(2*n*sizeof(double));
+	if (g == NULL) {
+		printf("Error allocating the recovered derivative of length %zu.\n", n);
+		return 1;
+	}
+	STATS_ALLOC(2*n*sizeof(double));
+
+	TRACE_SPAN_START(estimate_span);
+	const double* y = solution->solution_coeff->data;
+	recover_derivative(input_mesh, y, g, g + n);
+
+	Element_2D_Type kind = input_mesh->connectivity_grid[0].kind;
+	double error = 0, norm = 0;
+	for (uint32_t e = 0; e < input_mesh->num_elements; e++) {
+		const int* node_id;
+		int size = element_nodes(input_mesh, e, &node_id);
+		double x_e[MAX_ELEMENT_NODES], y_e[MAX_ELEMENT_NODES], g_e[MAX_ELEMENT_NODES];
+		for (int i = 0; i < size; i++) {
+			x_e[i] = input_mesh->node_coordinates[node_id[i]];
+			y_e[i] = y[node_id[i]];
+			g_e[i] = g[node_id[i]];
+		}
+
+		indicators[e] = 0;
+		for (int q = 0; q < 3; q++) {
+			double jacobian;
+			double dydx = element_derivative(kind, size, x_e, y_e, gauss_points[q], &jacobian);
+			double recovered = 0;
+			for (int i = 0; i < size; i++) {
+				recovered += g_e[i]*shape[kind][i](gauss_points[q]);
+			}
+
+			double w = gauss_weights[q]*fabs(jacobian);
+			indicators[e] += w*(recovered - dydx)*(recovered - dydx);
+			norm += w*dydx*dydx;
+		}
+		error += indicators[e];
+	}
+	*relative_error = sqrt(error)/((norm > 0) ? sqrt(norm) : 1);
+	TRACE_SPAN_STOP(estimate_span, "error estimate", "solver");
+	free(g);
+
+	return 0;
+
+}
+
+// Splits the marked elements of a mesh accepted by mesh_refinable() in two; L3 elements are split at their middle node, which keeps it as a vertex
+int refine_mesh(struct Mesh* input_mesh, const bool* marked, struct Mesh* refined) {
+	if (!mesh_refinable(input_mesh)) {
+		printf("Only meshes of one element kind with their nodes in order can be refined.\n");
+		return 1;
+	}
+
+	Element_2D_Type kind = input_mesh->connectivity_grid[0].kind;
+	int span = (kind == QUAD) ? 2 : 1;
+	size_t num_marked = 0;
+	for (uint32_t e = 0; e < input_mesh->num_elements; e++) {
+		num_marked += marked[e];
+	}
+	size_t num_nodes = input_mesh->num_nodes + span*num_marked;
+	if (num_nodes > MESH_MAX_NODES) {
+		printf("The refined mesh would have %zu nodes, more than the %d a mesh can hold.\n", num_nodes, MESH_MAX_NODES);
+		return 1;
+	}
+
+	double* nodes = malloc(num_nodes*sizeof(double));
+	if (nodes == NULL) {
+		printf("Error allocating the refined mesh of %zu nodes.\n", num_nodes);
+		return 1;
+	}
+	STATS_ALLOC(num_nodes*sizeof(double));
+
+	const double* x = input_mesh->node_coordinates;
+	size_t k = 0;
+	for (uint32_t e = 0; e < input_mesh->num_elements; e++) {
+		size_t first = span*(size_t) e;
+		for (int i = 0; i < span; i++) {
+			nodes[k++] = x[first + i];
+			if (marked[e]) {
+				nodes[k++] = (x[first + i] + x[first + i + 1])/2;
+			}
+		}
+	}
+	nodes[k] = x[input_mesh->num_nodes - 1];
+
+	return build_mesh_from_nodes(refined, nodes, (int) num_nodes, kind);
+
+}
+
+struct Ranked_Element {
+	double indicator;
+	uint32_t e;
+
+};
+
+static int compare_ranked(const void* p, const void* q) {
+	double a = ((const struct Ranked_Element*) p)->indicator;
+	double b = ((const struct Ranked_Element*) q)->indicator;
+
+	return (a < b) - (a > b);
+
+}
+
+// Dörfler marking: the fewest elements whose indicators add up to `fraction` of the total
+static int mark_elements(const double* indicators, uint32_t num_elements, double fraction, bool* marked) {
+	struct Ranked_Element* ranked = malloc(num_elements*sizeof(struct Ranked_Element));
+	if (ranked == NULL) {
+		printf("Error allocating the marking order of %u elements.\n", num_elements);
+		return 1;
+	}
+	STATS_ALLOC(num_elements*sizeof(struct Ranked_Element));
+
+	double total = 0;
+	for (uint32_t e = 0; e < num_elements; e++) {
+		ranked[e].indicator = indicators[e];
+		ranked[e].e = e;
+		marked[e] = false;
+		total += indicators[e];
+	}
+	qsort(ranked, num_elements, sizeof(struct Ranked_Element), compare_ranked);
+
+	double sum = 0;
+	for (uint32_t i = 0; i < num_elements && (i == 0 || sum < fraction*total); i++) {
+		marked[ranked[i].e] = true;
+		sum += ranked[i].indicator;
+	}
+	free(ranked);
+
+	return 0;
+
+}
+
+// Solves, estimates and refines until the estimated relative error reaches the tolerance, the step limit or the node limit.
+// The input mesh is replaced by each refined mesh (the caller frees the final one as usual), and the solution is that of the final mesh.
+// Returns 0 when the tolerance was not reached as well; report->converged tells them apart.
+int solve_ode_adaptive(struct Mesh* input_mesh, struct ODE_Solution* solution, double a, double b, double d1, double d2, struct Function_Field *function_field,
+					   const struct Adaptive_Options* adaptive, struct Solver_Options* options, struct Adaptive_Report* report) {
+	int max_steps = (adaptive->max_steps > 0 && adaptive->max_steps < ADAPTIVE_MAX_STEPS) ? adaptive->max_steps : ADAPTIVE_MAX_STEPS;
+	uint32_t max_nodes = (adaptive->max_nodes > 0) ? adaptive->max_nodes : ADAPTIVE_DEFAULT_MAX_NODES;
+	double fraction = (adaptive->marking_fraction > 0) ? adaptive->marking_fraction : ADAPTIVE_DEFAULT_MARKING;
+
+	report->num_steps = 0;
+	report->converged = false;
+	if (!mesh_refinable(input_mesh)) {
+		printf("Only meshes of one element kind with their nodes in order can be refined.\n");
+		return 1;
+	}
+
+	while (true) {
+		if (solve_ode_constant_opts(input_mesh, solution, a, b, d1, d2, function_field, options)) {
+			return 1;
+		}
+
+		uint32_t num_elements = input_mesh->num_elements;
+		double* indicators = malloc(num_elements*(sizeof(double) + sizeof(bool)));
+		if (indicators == NULL) {
+			printf("Error allocating the error indicators of %u elements.\n", num_elements);
+			free_solution_memory(solution);
+			return 1;
+		}
+		STATS_ALLOC(num_elements*(sizeof(double) + sizeof(bool)));
+		bool* marked = (bool*) (indicators + num_elements);
+
+		double estimate;
+		if (estimate_element_errors(input_mesh, solution, indicators, &estimate)) {
+			free(indicators);
+			free_solution_memory(solution);
+			return 1;
+		}
+		report->num_nodes[report->num_steps] = input_mesh->num_nodes;
+		report->error_estimate[report->num_steps] = estimate;
+		report->num_steps++;
+
+		report->converged = (estimate <= adaptive->tolerance);
+		if (report->converged || report->num_steps == max_steps) {
+			free(indicators);
+			return 0;
+		}
+
+		struct Mesh refined;
+		if (mark_elements(indicators, num_elements, fraction, marked)) {
+			free(indicators);
+			free_solution_memory(solution);
+			return 1;
+		}
+		size_t num_marked = 0;
+		for (uint32_t e = 0; e < num_elements; e++) {
+			num_marked += marked[e];
+		}
+		if (input_mesh->num_nodes + (input_mesh->num_nodes - 1)/num_elements*num_marked > max_nodes) {
+			// The last solve stands
+			free(indicators);
+			return 0;
+		}
+
+		int status = refine_mesh(input_mesh, marked, &refined);
+		free(indicators);
+		if (status) {
+			free_solution_memory(solution);
+			return 1;
+		}
+		free_solution_memory(solution);
+		free_mesh_memory(input_mesh);
+		*input_mesh = refined;
+	}
+
+}
+
+/* hp-adaptivity on p-element meshes */
+
+// Least-squares slope of -log|c_k| over the last (up to four) bubble coefficients; bubbles of one order only count as smooth
+static double coefficient_decay(const double* c, int p) {
+	int first = (p - 3 > 2) ? p - 3 : 2;
+	int count = p - first + 1;
+	if (count < 2) {
+		return INFINITY;
+	}
+
+	double mean_k = 0, mean_log = 0, log_c[4];
+	for (int k = first; k <= p; k++) {
+		log_c[k - first] = log(fmax(fabs(c[k - 1]), 1e-300));
+		mean_k += k;
+		mean_log += log_c[k - first];
+	}
+	mean_k /= count;
+	mean_log /= count;
+
+	double covariance = 0, variance = 0;
+	for (int k = first; k <= p; k++) {
+		covariance += (k - mean_k)*(log_c[k - first] - mean_log);
+		variance += (k - mean_k)*(k - mean_k);
+	}
+
+	return -covariance/variance;
+
+}
+
+// indicators[e] is c_p^2/J for the highest bubble of element e, decay_rates[e] the decay rate of its bubble coefficients,
+// and relative_error the square root of the indicator sum relative to the L2 norm of y'
+int estimate_hp_errors(struct P_Mesh* mesh, const gsl_vector* solution, double* indicators, double* decay_rates, double* relative_error) {
+	double error = 0, norm = 0;
+	for (uint32_t e = 0; e < mesh->num_elements; e++) {
+		int p = mesh->order[e];
+		double J = (mesh->vertices[e + 1] - mesh->vertices[e])/2;
+		const double* c = &solution->data[mesh->first_dof[e]];
+
+		// The constant derivative of the vertex functions is orthogonal to the bubble derivatives
+		double slope = (c[p] - c[0])/2;
+		norm += 2*slope*slope/J;
+		for (int k = 2; k <= p; k++) {
+			norm += c[k - 1]*c[k - 1]/J;
+		}
+
+		if (p == 1) {
+			// No bubble to measure; an L2 element is always split
+			indicators[e] = 2*slope*slope/J;
+			decay_rates[e] = 0;
+		}
+		else {
+			indicators[e] = c[p - 1]*c[p - 1]/J;
+			decay_rates[e] = coefficient_decay(c, p);
+		}
+		error += indicators[e];
+	}
+	*relative_error = sqrt(error)/((norm > 0) ? sqrt(norm) : 1);
+
+	return 0;
+
+}
+
+// Raises the marked smooth elements one order and splits the other marked ones into two of the same order
+static int refine_hp_mesh(struct P_Mesh* mesh, const bool* marked, const double* decay_rates, double threshold, struct P_Mesh* refined, uint32_t* p_refined, uint32_t* h_refined) {
+	uint32_t num_elements = mesh->num_elements;
+	for (uint32_t e = 0; e < mesh->num_elements; e++) {
+		num_elements += (marked[e] && !(decay_rates[e] >= threshold && mesh->order[e] < P_MAX_ORDER));
+	}
+
+	double* vertices = malloc((num_elements + 1)*sizeof(double));
+	int* orders = malloc(num_elements*sizeof(int));
+	if (vertices == NULL || orders == NULL) {
+		printf("Error allocating the refined mesh of %u elements.\n", num_elements);
+		free(vertices);
+		free(orders);
+		return 1;
+	}
+
+	uint32_t k = 0;
+	*p_refined = 0;
+	*h_refined = 0;
+	for (uint32_t e = 0; e < mesh->num_elements; e++) {
+		vertices[k] = mesh->vertices[e];
+		orders[k++] = mesh->order[e];
+		if (!marked[e]) {
+			continue;
+		}
+
+		if (decay_rates[e] >= threshold && mesh->order[e] < P_MAX_ORDER) {
+			orders[k - 1]++;
+			(*p_refined)++;
+		}
+		else {
+			vertices[k] = (mesh->vertices[e] + mesh->vertices[e + 1])/2;
+			orders[k++] = mesh->order[e];
+			(*h_refined)++;
+		}
+	}
+	vertices[k] = mesh->vertices[mesh->num_elements];
+
+	int status = create_p_mesh(refined, vertices, num_elements, orders);
+	free(vertices);
+	free(orders);
+
+	return status;
+
+}
+
+// Solves, estimates and refines a p-element mesh until the estimated relative error reaches the tolerance, the step limit or the unknown limit.
+// As with solve_ode_adaptive(), the mesh is replaced by each refined one and the solution is that of the final mesh.
+int solve_ode_hp(struct P_Mesh* mesh, gsl_vector** solution, double a, double b, double d1, double d2, struct Function_Field *function_field,
+				 const struct HP_Options* hp, struct HP_Report* report) {
+	int max_steps = (hp->max_steps > 0 && hp->max_steps < ADAPTIVE_MAX_STEPS) ? hp->max_steps : ADAPTIVE_MAX_STEPS;
+	size_t max_dofs = (hp->max_dofs > 0) ? hp->max_dofs : HP_DEFAULT_MAX_DOFS;
+	double fraction = (hp->marking_fraction > 0) ? hp->marking_fraction : ADAPTIVE_DEFAULT_MARKING;
+	double threshold = (hp->smoothness_threshold > 0) ? hp->smoothness_threshold : HP_DEFAULT_SMOOTHNESS;
+
+	report->num_steps = 0;
+	report->converged = false;
+	*solution = NULL;
+
+	while (true) {
+		if (solve_ode_p(mesh, solution, a, b, d1, d2, function_field)) {
+			return 1;
+		}
+
+		uint32_t num_elements = mesh->num_elements;
+		double* indicators = malloc(num_elements*(2*sizeof(double) + sizeof(bool)));
+		if (indicators == NULL) {
+			printf("Error allocating the error indicators of %u elements.\n", num_elements);
+			gsl_vector_free(*solution);
+			*solution = NULL;
+			return 1;
+		}
+		STATS_ALLOC(num_elements*(2*sizeof(double) + sizeof(bool)));
+		double* decay_rates = indicators + num_elements;
+		bool* marked = (bool*) (decay_rates + num_elements);
+
+		TRACE_SPAN_START(estimate_span);
+		double estimate;
+		estimate_hp_errors(mesh, *solution, indicators, decay_rates, &estimate);
+		TRACE_SPAN_STOP(estimate_span, "error estimate", "solver");
+
+		int step = report->num_steps++;
+		report->num_dofs[step] = mesh->num_dofs;
+		report->error_estimate[step] = estimate;
+		report->p_refined[step] = 0;
+		report->h_refined[step] = 0;
+
+		report->converged = (estimate <= hp->tolerance);
+		if (report->converged || report->num_steps == max_steps || mark_elements(indicators, num_elements, fraction, marked)) {
+			free(indicators);
+			return 0;
+		}
+
+		struct P_Mesh refined;
+		int status = refine_hp_mesh(mesh, marked, decay_rates, threshold, &refined, &report->p_refined[step], &report->h_refined[step]);
+		free(indicators);
+		if (status) {
+			gsl_vector_free(*solution);
+			*solution = NULL;
+			return 1;
+		}
+		if (refined.num_dofs > max_dofs) {
+			// The last solve stands
+			report->p_refined[step] = 0;
+			report->h_refined[step] = 0;
+			free_p_mesh(&refined);
+			return 0;
+		}
+
+		gsl_vector_free(*solution);
+		free_p_mesh(mesh);
+		*mesh = refined;
+	}
+
+}
@@ -0,0 +1,773 @@
+/* Banded matrix storage and LU decomposition with partial pivoting
+ *
+ * The global coefficient matrix of a 1D mesh only couples nodes that share an element, so it is banded:
+ * one sub- and super-diagonal for L2 meshes and two for L3 meshes.
+ * Storing and factoring just the band is O(n) in both memory and work, where the dense LU is O(n^2) and O(n^3).
+ *
+ * The mixed-precision solve factors a single-precision copy of the band, which halves the memory traffic of the factorization and the triangular solves,
+ * and recovers double-precision accuracy by iterative refinement against the double-precision matrix:
+ *	r = b - A x (double),	solve LU d = r (single-precision factors),	x += d
+ *
+ * Periodic meshes couple the last nodes to the first ones as well, which adds two corner blocks to the band.
+ * Those are a low-rank update A = B + U V^T of the band B (rank twice the bandwidth), so the Sherman-Morrison-Woodbury formula
+ *	A^-1 b = z - Q (I + V^T Q)^-1 V^T z,	with B z = b and B Q = U
+ * solves the cyclic system with the band LU, the columns Q (decomposed along with B) and a capacitance matrix of at most 4x4 for L3 meshes.
+ */
+#include "band_matrix.h"
+#include "solver_stats.h"
+#include "trace.h"
+
+#include <float.h>
+#include <gsl/gsl_linalg.h>
+
+int create_band_matrix(struct Band_Matrix* m, size_t size, int lower, int upper) {
+	m->size = size;
+	m->lower = lower;
+	m->upper = upper;
+	m->width = 2*lower + upper + 1;
+	m->factored = false;
+
+	m->data = calloc(size*m->width, sizeof(double));
+	m->pivots = malloc(size*sizeof(size_t));
+
+	if (m->data == NULL || m->pivots == NULL) {
+		printf("Error allocating a band matrix of size %zu and bandwidth (%d, %d).\n", size, lower, upper);
+		free(m->data);
+		free(m->pivots);
+		return 1;
+	}
+	STATS_ALLOC(size*m->width*sizeof(double));
+	STATS_ALLOC(size*sizeof(size_t));
+
+	return 0;
+
+}
+
+int copy_band_matrix(struct Band_Matrix* dest, const struct Band_Matrix* src) {
+	if (create_band_matrix(dest, src->size, src->lower, src->upper)) {
+		return 1;
+	}
+
+	memcpy(dest->data, src->data, src->size*src->width*sizeof(double));
+	memcpy(dest->pivots, src->pivots, src->size*sizeof(size_t));
+	dest->factored = src->factored;
+
+	return 0;
+
+}
+
+void free_band_matrix(struct Band_Matrix* m) {
+	free(m->data);
+	free(m->pivots);
+	m->data = NULL;
+	m->pivots = NULL;
+
+}
+
+// Entries outside of the stored band are zero
+double band_matrix_get(const struct Band_Matrix* m, size_t i, size_t j) {
+	ptrdiff_t offset = (ptrdiff_t) j - (ptrdiff_t) i;
+	if (offset < -m->lower || offset > m->lower + m->upper) {
+		return 0;
+	}
+
+	return *band_matrix_ptr(m, i, j);
+
+}
+
+void band_matrix_set(struct Band_Matrix* m, size_t i, size_t j, double x) {
+	assert((ptrdiff_t) j - (ptrdiff_t) i >= -m->lower && (ptrdiff_t) j - (ptrdiff_t) i <= m->upper);
+	*band_matrix_ptr(m, i, j) = x;
+
+}
+
+void band_matrix_add(struct Band_Matrix* m, size_t i, size_t j, double x) {
+	assert((ptrdiff_t) j - (ptrdiff_t) i >= -m->lower && (ptrdiff_t) j - (ptrdiff_t) i <= m->upper);
+	*band_matrix_ptr(m, i, j) += x;
+
+}
+
+// Replaces row i with the corresponding row of the identity (used for Dirichlet rows); only the stored band is touched
+void band_matrix_set_row_identity(struct Band_Matrix* m, size_t i) {
+	memset(&m->data[i*m->width], 0, m->width*sizeof(double));
+	*band_matrix_ptr(m, i, i) = 1;
+
+}
+
+// Eliminates columns first to n - 1 of a band matrix whose earlier columns are already decomposed.
+// With checkpoints, rows k to k + lower - 1 are saved before every step k that is a multiple of the interval:
+// they are the only rows that earlier steps have touched but not finished, so the decomposition can be restarted from k (see band_lu_refactor()).
+static int band_lu_eliminate(struct Band_Matrix* m, size_t first, struct Band_Checkpoints* checkpoints) {
+	size_t n = m->size;
+	size_t saved = (size_t) m->lower*m->width;
+
+	for (size_t k = first; k < n; k++) {
+		size_t last_row = (k + m->lower < n - 1) ? k + m->lower : n - 1;
+		size_t last_col = (k + m->lower + m->upper < n - 1) ? k + m->lower + m->upper : n - 1;
+
+		if (checkpoints != NULL && k % checkpoints->interval == 0) {
+			size_t rows = (k + m->lower < n) ? (size_t) m->lower : n - k;
+			memcpy(&checkpoints->rows[(k/checkpoints->interval)*saved], &m->data[k*m->width], rows*m->width*sizeof(double));
+		}
+
+		// Find the pivot within the band of column k
+		size_t p = k;
+		double max = fabs(*band_matrix_ptr(m, k, k));
+		for (size_t i = k + 1; i <= last_row; i++) {
+			double value = fabs(*band_matrix_ptr(m, i, k));
+			if (value > max) {
+				max = value;
+				p = i;
+			}
+		}
+
+		m->pivots[k] = p;
+		if (max == 0) {
+			printf("The band matrix is singular; no pivot found for column %zu.\n", k);
+			return 1;
+		}
+
+		if (p != k) {
+			double* row_k = band_matrix_ptr(m, k, k);
+			double* row_p = band_matrix_ptr(m, p, k);
+			for (size_t j = 0; j <= last_col - k; j++) {
+				double temp = row_k[j];
+				row_k[j] = row_p[j];
+				row_p[j] = temp;
+			}
+		}
+
+		// Eliminate column k from the rows below
+		double pivot = *band_matrix_ptr(m, k, k);
+		double* row_k = band_matrix_ptr(m, k, k + 1);
+		for (size_t i = k + 1; i <= last_row; i++) {
+			double* a_ik = band_matrix_ptr(m, i, k);
+			double l = *a_ik/pivot;
+			*a_ik = l;
+
+			if (l == 0) {
+				continue;
+			}
+
+			double* row_i = a_ik + 1;
+			for (size_t j = 0; j < last_col - k; j++) {
+				row_i[j] -= l*row_k[j];
+			}
+		}
+	}
+
+	m->factored = true;
+
+	return 0;
+
+}
+
+// In-place LU decomposition with partial pivoting (the banded equivalent of gsl_linalg_LU_decomp).
+// Multipliers are stored below the diagonal and the row interchanges in `pivots`; they are applied in order by band_lu_solve().
+int band_lu_decomp(struct Band_Matrix* m) {
+	STATS_TIMER_START(factor_timer);
+	STATS_HW_START(factor_counters);
+	TRACE_SPAN_START(factor_span);
+
+	int status = band_lu_eliminate(m, 0, NULL);
+
+	STATS_HW_STOP(factor_counters, HW_FACTOR);
+	STATS_TIMER_STOP(factor_timer, STATS_FACTOR);
+	TRACE_SPAN_STOP(factor_span, "factor", "solver");
+
+	return status;
+
+}
+
+// band_lu_decomp() that saves the partly eliminated rows every `interval` columns (0 for BAND_CHECKPOINT_INTERVAL),
+// so that band_lu_refactor() can redo only the columns after a change
+int band_lu_decomp_checkpointed(struct Band_Matrix* m, struct Band_Checkpoints* checkpoints, size_t interval) {
+	checkpoints->interval = (interval > 0) ? interval : BAND_CHECKPOINT_INTERVAL;
+	checkpoints->count = (m->size + checkpoints->interval - 1)/checkpoints->interval;
+	checkpoints->rows = malloc(checkpoints->count*m->lower*m->width*sizeof(double));
+	if (checkpoints->rows == NULL && checkpoints->count*m->lower > 0) {
+		printf("Error allocating %zu checkpoints of the band decomposition.\n", checkpoints->count);
+		return 1;
+	}
+	STATS_ALLOC(checkpoints->count*m->lower*m->width*sizeof(double));
+
+	STATS_TIMER_START(factor_timer);
+	TRACE_SPAN_START(factor_span);
+	int status = band_lu_eliminate(m, 0, checkpoints);
+	STATS_TIMER_STOP(factor_timer, STATS_FACTOR);
+	TRACE_SPAN_STOP(factor_span, "factor", "solver");
+
+	if (status) {
+		free_band_checkpoints(checkpoints);
+	}
+
+	return status;
+
+}
+
+// Decomposes `a` into m, which holds the decomposition (by band_lu_decomp_checkpointed()) of a matrix that only differed from `a` in the rows from first_changed_row on.
+// Columns before the last checkpoint that no changed row reaches keep their factors: before step k, the rows from k + lower on have not been touched yet,
+// so the rows from the checkpoint's k + lower on are copied from `a` and the elimination restarts at k.
+int band_lu_refactor(struct Band_Matrix* m, const struct Band_Matrix* a, struct Band_Checkpoints* checkpoints, size_t first_changed_row) {
+	if (!m->factored || checkpoints->rows == NULL || a->size != m->size || a->lower != m->lower || a->upper != m->upper) {
+		printf("Only a checkpointed decomposition of a matrix of the same size and bandwidth can be refactored.\n");
+		return 1;
+	}
+	if (first_changed_row >= m->size) {
+		return 0;
+	}
+
+	size_t n = m->size;
+	size_t lower = (size_t) m->lower;
+	size_t k = (first_changed_row >= lower) ? ((first_changed_row - lower)/checkpoints->interval)*checkpoints->interval : 0;
+
+	STATS_TIMER_START(factor_timer);
+	TRACE_SPAN_START(factor_span);
+	if (k == 0) {
+		memcpy(m->data, a->data, n*m->width*sizeof(double));
+	}
+	else {
+		size_t rows = (k + lower < n) ? lower : n - k;
+		memcpy(&m->data[k*m->width], &checkpoints->rows[(k/checkpoints->interval)*lower*m->width], rows*m->width*sizeof(double));
+		if (k + lower < n) {
+			memcpy(&m->data[(k + lower)*m->width], &a->data[(k + lower)*m->width], (n - k - lower)*m->width*sizeof(double));
+		}
+	}
+	STATS_COUNT(STATS_REFACTORED_ROWS, n - k);
+
+	int status = band_lu_eliminate(m, k, checkpoints);
+	STATS_TIMER_STOP(factor_timer, STATS_FACTOR);
+	TRACE_SPAN_STOP(factor_span, "refactor", "solver");
+
+	return status;
+
+}
+
+void free_band_checkpoints(struct Band_Checkpoints* checkpoints) {
+	free(checkpoints->rows);
+	checkpoints->rows = NULL;
+	checkpoints->count = 0;
+
+}
+
+int band_lu_solve(const struct Band_Matrix* m, const gsl_vector* b, gsl_vector* x) {
+	if (!m->factored) {
+		printf("The band matrix has to be decomposed with band_lu_decomp() before solving.\n");
+		return 1;
+	}
+
+	STATS_TIMER_START(solve_timer);
+	TRACE_SPAN_START(solve_span);
+	if (x != b) {
+		gsl_vector_memcpy(x, b);
+	}
+
+	band_lu_substitute(m, x->data, x->stride);
+	STATS_TIMER_STOP(solve_timer, STATS_SOLVE);
+	TRACE_SPAN_STOP(solve_span, "triangular solve", "solver");
+
+	return 0;
+
+}
+
+// The forward and back substitutions of band_lu_solve(), in place on y (with the given stride) and without instrumentation,
+// for callers that solve many small systems inside an already timed phase
+void band_lu_substitute(const struct Band_Matrix* m, double* y, size_t s) {
+	size_t n = m->size;
+
+	// Forward substitution, applying the row interchanges in the order they were made
+	for (size_t k = 0; k < n; k++) {
+		size_t p = m->pivots[k];
+		if (p != k) {
+			double temp = y[k*s];
+			y[k*s] = y[p*s];
+			y[p*s] = temp;
+		}
+
+		size_t last_row = (k + m->lower < n - 1) ? k + m->lower : n - 1;
+		for (size_t i = k + 1; i <= last_row; i++) {
+			y[i*s] -= *band_matrix_ptr(m, i, k)*y[k*s];
+		}
+	}
+
+	// Back substitution with U, which has lower + upper super-diagonals after pivoting
+	for (size_t i = n; i-- > 0;) {
+		size_t last_col = (i + m->lower + m->upper < n - 1) ? i + m->lower + m->upper : n - 1;
+		const double* row_i = band_matrix_ptr(m, i, i);
+		double sum = y[i*s];
+		for (size_t j = i + 1; j <= last_col; j++) {
+			sum -= row_i[j - i]*y[j*s];
+		}
+		y[i*s] = sum/row_i[0];
+	}
+
+}
+
+// y = A*x for an unfactored matrix
+void band_matrix_apply(const struct Band_Matrix* m, const double* x, double* y) {
+	size_t n = m->size;
+
+	for (size_t i = 0; i < n; i++) {
+		size_t first_col = (i > (size_t) m->lower) ? i - m->lower : 0;
+		size_t last_col = (i + m->upper < n - 1) ? i + m->upper : n - 1;
+		const double* row_i = band_matrix_ptr(m, i, first_col);
+
+		double sum = 0;
+		for (size_t j = first_col; j <= last_col; j++) {
+			sum += row_i[j - first_col]*x[j];
+		}
+		y[i] = sum;
+	}
+
+}
+
+// ||A|| (infinity norm, the largest absolute row sum) of an unfactored matrix
+double band_matrix_norm_inf(const struct Band_Matrix* m) {
+	double norm = 0;
+	for (size_t i = 0; i < m->size; i++) {
+		double row_sum = 0;
+		for (int j = 0; j < m->width; j++) {
+			row_sum += fabs(m->data[i*m->width + j]);
+		}
+		norm = fmax(norm, row_sum);
+	}
+
+	return norm;
+
+}
+
+// Dense copy of an unfactored matrix, for callers that want the global arrays
+gsl_matrix* band_matrix_to_dense(const struct Band_Matrix* m) {
+	gsl_matrix* dense = gsl_matrix_calloc(m->size, m->size);
+	if (dense == NULL) {
+		return NULL;
+	}
+
+	for (size_t i = 0; i < m->size; i++) {
+		size_t first_col = (i > (size_t) m->lower) ? i - m->lower : 0;
+		size_t last_col = (i + m->upper < m->size - 1) ? i + m->upper : m->size - 1;
+		for (size_t j = first_col; j <= last_col; j++) {
+			gsl_matrix_set(dense, i, j, *band_matrix_ptr(m, i, j));
+		}
+	}
+
+	return dense;
+
+}
+
+int band_lu_decomp_float(struct Band_Matrix_Float* lu, const struct Band_Matrix* m) {
+	size_t n = m->size;
+	lu->size = n;
+	lu->lower = m->lower;
+	lu->upper = m->upper;
+	lu->width = m->width;
+	lu->factored = false;
+
+	lu->data = malloc(n*m->width*sizeof(float));
+	lu->pivots = malloc(n*sizeof(size_t));
+	if (lu->data == NULL || lu->pivots == NULL) {
+		printf("Error allocating single-precision factors of size %zu and bandwidth (%d, %d).\n", n, m->lower, m->upper);
+		free_band_matrix_float(lu);
+		return 1;
+	}
+	STATS_ALLOC(n*m->width*sizeof(float));
+	STATS_ALLOC(n*sizeof(size_t));
+
+	for (size_t i = 0; i < n*m->width; i++) {
+		lu->data[i] = (float) m->data[i];
+	}
+
+	STATS_TIMER_START(factor_timer);
+	STATS_HW_START(factor_counters);
+	TRACE_SPAN_START(factor_span);
+
+	// The same elimination as band_lu_decomp()
+	for (size_t k = 0; k < n; k++) {
+		size_t last_row = (k + lu->lower < n - 1) ? k + lu->lower : n - 1;
+		size_t last_col = (k + lu->lower + lu->upper < n - 1) ? k + lu->lower + lu->upper : n - 1;
+
+		size_t p = k;
+		float max = fabsf(*band_matrix_float_ptr(lu, k, k));
+		for (size_t i = k + 1; i <= last_row; i++) {
+			float value = fabsf(*band_matrix_float_ptr(lu, i, k));
+			if (value > max) {
+				max = value;
+				p = i;
+			}
+		}
+
+		lu->pivots[k] = p;
+		if (max == 0) {
+			printf("The single-precision band matrix is singular; no pivot found for column %zu.\n", k);
+			free_band_matrix_float(lu);
+			return 1;
+		}
+
+		if (p != k) {
+			float* row_k = band_matrix_float_ptr(lu, k, k);
+			float* row_p = band_matrix_float_ptr(lu, p, k);
+			for (size_t j = 0; j <= last_col - k; j++) {
+				float temp = row_k[j];
+				row_k[j] = row_p[j];
+				row_p[j] = temp;
+			}
+		}
+
+		float pivot = *band_matrix_float_ptr(lu, k, k);
+		float* row_k = band_matrix_float_ptr(lu, k, k + 1);
+		for (size_t i = k + 1; i <= last_row; i++) {
+			float* a_ik = band_matrix_float_ptr(lu, i, k);
+			float l = *a_ik/pivot;
+			*a_ik = l;
+
+			if (l == 0) {
+				continue;
+			}
+
+			float* row_i = a_ik + 1;
+			for (size_t j = 0; j < last_col - k; j++) {
+				row_i[j] -= l*row_k[j];
+			}
+		}
+	}
+
+	lu->factored = true;
+	STATS_HW_STOP(factor_counters, HW_FACTOR);
+	STATS_TIMER_STOP(factor_timer, STATS_FACTOR);
+	TRACE_SPAN_STOP(factor_span, "factor (single precision)", "solver");
+
+	return 0;
+
+}
+
+void free_band_matrix_float(struct Band_Matrix_Float* lu) {
+	free(lu->data);
+	free(lu->pivots);
+	lu->data = NULL;
+	lu->pivots = NULL;
+
+}
+
+// Solves in place with the single-precision factors; the vector itself stays in double precision
+int band_lu_solve_float(const struct Band_Matrix_Float* lu, double* x) {
+	if (!lu->factored) {
+		printf("The single-precision factors have to be computed with band_lu_decomp_float() before solving.\n");
+		return 1;
+	}
+
+	size_t n = lu->size;
+	STATS_TIMER_START(solve_timer);
+
+	for (size_t k = 0; k < n; k++) {
+		size_t p = lu->pivots[k];
+		if (p != k) {
+			double temp = x[k];
+			x[k] = x[p];
+			x[p] = temp;
+		}
+
+		size_t last_row = (k + lu->lower < n - 1) ? k + lu->lower : n - 1;
+		for (size_t i = k + 1; i <= last_row; i++) {
+			x[i] -= *band_matrix_float_ptr(lu, i, k)*x[k];
+		}
+	}
+
+	for (size_t i = n; i-- > 0;) {
+		size_t last_col = (i + lu->lower + lu->upper < n - 1) ? i + lu->lower + lu->upper : n - 1;
+		const float* row_i = band_matrix_float_ptr(lu, i, i);
+		double sum = x[i];
+		for (size_t j = i + 1; j <= last_col; j++) {
+			sum -= row_i[j - i]*x[j];
+		}
+		x[i] = sum/row_i[0];
+	}
+	STATS_TIMER_STOP(solve_timer, STATS_SOLVE);
+
+	return 0;
+
+}
+
+static double norm_inf(const double* x, size_t n) {
+	double norm = 0;
+	for (size_t i = 0; i < n; i++) {
+		norm = fmax(norm, fabs(x[i]));
+	}
+
+	return norm;
+
+}
+
+// r = b - A*x; returns ||r|| (infinity norm)
+static double band_residual(const struct Band_Matrix* m, const double* x, const double* b, double* r) {
+	STATS_TIMER_START(residual_timer);
+	band_matrix_apply(m, x, r);
+	for (size_t i = 0; i < m->size; i++) {
+		r[i] = b[i] - r[i];
+	}
+	STATS_TIMER_STOP(residual_timer, STATS_SOLVE);
+
+	return norm_inf(r, m->size);
+
+}
+
+// Solves A x = b for an unfactored matrix with single-precision factors and iterative refinement.
+// If the refinement does not converge (roughly when cond(A) approaches 1/FLT_EPSILON), the solve is repeated with a double-precision factorization.
+int band_mixed_solve(const struct Band_Matrix* m, const gsl_vector* b, gsl_vector* x, struct Refinement_Report* report) {
+	size_t n = m->size;
+	double* work = malloc(3*n*sizeof(double));
+	if (work == NULL) {
+		printf("Error allocating the refinement vectors of length %zu.\n", n);
+		return 1;
+	}
+	STATS_ALLOC(3*n*sizeof(double));
+	double* rhs = work;
+	double* y = work + n;
+	double* r = work + 2*n;
+
+	for (size_t i = 0; i < n; i++) {
+		rhs[i] = gsl_vector_get(b, i);
+	}
+
+	double norm_A = band_matrix_norm_inf(m);
+
+	report->iterations = 0;
+	report->fallback = true;
+	double norm_r = INFINITY;
+
+	struct Band_Matrix_Float lu;
+	if (band_lu_decomp_float(&lu, m) == 0) {
+		TRACE_SPAN_START(refine_span);
+		memcpy(y, rhs, n*sizeof(double));
+		band_lu_solve_float(&lu, y);
+
+		double previous = INFINITY;
+		while (true) {
+			norm_r = band_residual(m, y, rhs, r);
+			if (norm_r <= sqrt((double) n)*DBL_EPSILON*norm_A*norm_inf(y, n)) {
+				report->fallback = false;
+				break;
+			}
+			// Diverging or stagnating: the single-precision factors are too inaccurate for this matrix
+			if (!isfinite(norm_r) || norm_r > previous/2 || report->iterations == BAND_REFINE_MAX_ITERATIONS) {
+				break;
+			}
+
+			band_lu_solve_float(&lu, r);
+			for (size_t i = 0; i < n; i++) {
+				y[i] += r[i];
+			}
+			previous = norm_r;
+			report->iterations++;
+		}
+		free_band_matrix_float(&lu);
+		TRACE_SPAN_STOP(refine_span, "iterative refinement", "solver");
+	}
+	STATS_COUNT(STATS_REFINEMENTS, report->iterations);
+
+	if (report->fallback) {
+		struct Band_Matrix full;
+		if (copy_band_matrix(&full, m)) {
+			free(work);
+			return 1;
+		}
+		if (band_lu_decomp(&full)) {
+			free_band_matrix(&full);
+			free(work);
+			return 1;
+		}
+
+		memcpy(y, rhs, n*sizeof(double));
+		gsl_vector_view y_view = gsl_vector_view_array(y, n);
+		band_lu_solve(&full, &y_view.vector, &y_view.vector);
+		free_band_matrix(&full);
+		norm_r = band_residual(m, y, rhs, r);
+	}
+
+	report->residual = norm_r;
+	report->backward_error = norm_r/(norm_A*norm_inf(y, n) + norm_inf(rhs, n));
+	for (size_t i = 0; i < n; i++) {
+		gsl_vector_set(x, i, y[i]);
+	}
+	free(work);
+
+	return 0;
+
+}
+
+// A cyclic band of the given size; the corner blocks need size >= 2*bandwidth so that they do not overlap
+int create_cyclic_band_matrix(struct Cyclic_Band_Matrix* m, size_t size, int bandwidth) {
+	memset(m, 0, sizeof(struct Cyclic_Band_Matrix));
+	if (size < 2*(size_t) bandwidth || size == 0) {
+		printf("A cyclic band of bandwidth %d needs at least %d rows, not %zu (a periodic mesh needs at least 2 elements).\n", bandwidth, (bandwidth > 0) ? 2*bandwidth : 1, size);
+		return 1;
+	}
+	if (create_band_matrix(&m->band, size, bandwidth, bandwidth)) {
+		return 1;
+	}
+
+	m->corner = bandwidth;
+	if (bandwidth > 0) {
+		size_t k = 2*(size_t) bandwidth;
+		m->upper_corner = calloc(bandwidth*bandwidth, sizeof(double));
+		m->lower_corner = calloc(bandwidth*bandwidth, sizeof(double));
+		m->Q = malloc(k*size*sizeof(double));
+		m->capacitance = gsl_matrix_alloc(k, k);
+		m->permutation = gsl_permutation_alloc(k);
+		if (m->upper_corner == NULL || m->lower_corner == NULL || m->Q == NULL || m->capacitance == NULL || m->permutation == NULL) {
+			printf("Error allocating the corners of a cyclic band of size %zu.\n", size);
+			free_cyclic_band_matrix(m);
+			return 1;
+		}
+		STATS_ALLOC((2*bandwidth*bandwidth + k*size)*sizeof(double));
+	}
+
+	return 0;
+
+}
+
+void free_cyclic_band_matrix(struct Cyclic_Band_Matrix* m) {
+	free_band_matrix(&m->band);
+	free(m->upper_corner);
+	free(m->lower_corner);
+	free(m->Q);
+	if (m->capacitance != NULL) {
+		gsl_matrix_free(m->capacitance);
+	}
+	if (m->permutation != NULL) {
+		gsl_permutation_free(m->permutation);
+	}
+	memset(m, 0, sizeof(struct Cyclic_Band_Matrix));
+
+}
+
+// Adds x to entry (i, j), which has to be within the bandwidth of the diagonal, directly or across the ends
+void cyclic_band_matrix_add(struct Cyclic_Band_Matrix* m, size_t i, size_t j, double x) {
+	size_t n = m->band.size;
+	size_t c = (size_t) m->corner;
+	ptrdiff_t d = (ptrdiff_t) j - (ptrdiff_t) i;
+	if (d >= -m->band.lower && d <= m->band.upper) {
+		band_matrix_add(&m->band, i, j, x);
+	}
+	else if (d > 0) {
+		assert(i < c && j >= n - c);
+		m->upper_corner[i*c + (j - (n - c))] += x;
+	}
+	else {
+		assert(j < c && i >= n - c);
+		m->lower_corner[(i - (n - c))*c + j] += x;
+	}
+
+}
+
+// Row r of V^T (the corner entries of row r of U's rows) times the vector y
+static double cyclic_corner_product(const struct Cyclic_Band_Matrix* m, size_t r, const double* y) {
+	size_t n = m->band.size;
+	size_t c = (size_t) m->corner;
+	double sum = 0;
+	for (size_t j = 0; j < c; j++) {
+		sum += (r < c) ? m->upper_corner[r*c + j]*y[n - c + j] : m->lower_corner[(r - c)*c + j]*y[j];
+	}
+
+	return sum;
+
+}
+
+// Decomposes the band in place and forms the capacitance matrix; returns 1 if either is singular
+int cyclic_lu_decomp(struct Cyclic_Band_Matrix* m) {
+	if (band_lu_decomp(&m->band)) {
+		return 1;
+	}
+
+	size_t n = m->band.size;
+	size_t c = (size_t) m->corner;
+	size_t k = 2*c;
+	STATS_TIMER_START(factor_timer);
+	for (size_t l = 0; l < k; l++) {
+		double* q = &m->Q[l*n];
+		memset(q, 0, n*sizeof(double));
+		q[(l < c) ? l : n - k + l] = 1;
+		band_lu_substitute(&m->band, q, 1);
+	}
+
+	int status = 0;
+	if (k > 0) {
+		int signum;
+		for (size_t r = 0; r < k; r++) {
+			for (size_t l = 0; l < k; l++) {
+				gsl_matrix_set(m->capacitance, r, l, (r == l) + cyclic_corner_product(m, r, &m->Q[l*n]));
+			}
+		}
+		gsl_linalg_LU_decomp(m->capacitance, m->permutation, &signum);
+		for (size_t r = 0; r < k; r++) {
+			if (gsl_matrix_get(m->capacitance, r, r) == 0) {
+				printf("The capacitance matrix of the cyclic band is singular.\n");
+				status = 1;
+				break;
+			}
+		}
+	}
+	STATS_TIMER_STOP(factor_timer, STATS_FACTOR);
+	m->factored = (status == 0);
+
+	return status;
+
+}
+
+// Solves A x = b with the decomposition of cyclic_lu_decomp(); x may be b
+int cyclic_lu_solve(const struct Cyclic_Band_Matrix* m, const gsl_vector* b, gsl_vector* x) {
+	if (!m->factored) {
+		printf("The cyclic band has to be decomposed with cyclic_lu_decomp() before solving.\n");
+		return 1;
+	}
+
+	size_t n = m->band.size;
+	size_t c = (size_t) m->corner;
+	size_t k = 2*c;
+	STATS_TIMER_START(solve_timer);
+	if (x != b) {
+		gsl_vector_memcpy(x, b);
+	}
+	band_lu_substitute(&m->band, x->data, x->stride);
+
+	if (k > 0) {
+		// z = V^T x, then x -= Q w with (I + V^T Q) w = z
+		double z[k], w[k];
+		double* y = x->data;
+		double* contiguous = NULL;
+		if (x->stride != 1) {
+			contiguous = malloc(n*sizeof(double));
+			if (contiguous == NULL) {
+				printf("Error allocating the cyclic solve of size %zu.\n", n);
+				return 1;
+			}
+			for (size_t i = 0; i < n; i++) {
+				contiguous[i] = gsl_vector_get(x, i);
+			}
+			y = contiguous;
+		}
+
+		for (size_t r = 0; r < k; r++) {
+			z[r] = cyclic_corner_product(m, r, y);
+		}
+		gsl_vector_view z_view = gsl_vector_view_array(z, k);
+		gsl_vector_view w_view = gsl_vector_view_array(w, k);
+		gsl_linalg_LU_solve(m->capacitance, m->permutation, &z_view.vector, &w_view.vector);
+		for (size_t l = 0; l < k; l++) {
+			const double* q = &m->Q[l*n];
+			for (size_t i = 0; i < n; i++) {
+				y[i] -= q[i]*w[l];
+			}
+		}
+
+		if (contiguous != NULL) {
+			for (size_t i = 0; i < n; i++) {
+				gsl_vector_set(x, i, contiguous[i]);
+			}
+			free(contiguous);
+		}
+	}
+	STATS_TIMER_STOP(solve_timer, STATS_SOLVE);
+
+	return 0;
+
+}
@@ -0,0 +1,389 @@
+/* Batch manifest runner
+ *
+ * Cases are sorted so that the ones sharing a mesh and field form a group, and within a group the ones sharing a and b form a subgroup.
+ * Each group builds its mesh and load vector once; each subgroup factorizes once and then only does the triangular solves for its boundary values.
+ * Groups and subgroups run on the thread pool, and every solution goes to one Solution_Writer record indexed by its manifest case.
+ */
+#include "batch.h"
+#include "band_matrix.h"
+#include "trace.h"
+
+#include <time.h>
+
+struct Batch_Context {
+	struct Thread_Pool pool;
+	struct Solution_Writer writer;
+
+	pthread_mutex_t lock;
+	size_t num_failed;
+	size_t num_factorizations;
+	struct Solver_Stats *stats; // Each task records into its own struct and merges it in here
+
+};
+
+struct Batch_Group {
+	struct Batch_Context *context;
+	struct Batch_Case **cases; // Sorted by a, then b
+	size_t num_cases;
+	struct Function_Field *field; // NULL if the field file could not be read
+
+	struct Mesh mesh;
+	gsl_vector *F_const;
+	atomic_size_t remaining_subgroups; // The last subgroup to finish frees the mesh and load vector
+
+};
+
+struct Batch_Subgroup {
+	struct Batch_Group *group;
+	size_t first_case;
+	size_t num_cases;
+
+};
+
+// Tasks run on different workers, so each one activates its own statistics
+static struct Solver_Stats* begin_task_stats(struct Batch_Context *context, struct Solver_Stats *task_stats) {
+	memset(task_stats, 0, sizeof(struct Solver_Stats));
+
+	return stats_activate(context->stats != NULL ? task_stats : NULL);
+
+}
+
+static void end_task_stats(struct Batch_Context *context, struct Solver_Stats *task_stats, struct Solver_Stats *previous) {
+	stats_activate(previous);
+	if (context->stats != NULL) {
+		pthread_mutex_lock(&context->lock);
+		stats_merge(context->stats, task_stats);
+		pthread_mutex_unlock(&context->lock);
+	}
+
+}
+
+static void record_failures(struct Batch_Context *context, size_t count) {
+	pthread_mutex_lock(&context->lock);
+	context->num_failed += count;
+	pthread_mutex_unlock(&context->lock);
+
+}
+
+// Manifest lines are whitespace-delimited; blank lines and lines starting with `#` are skipped
+int read_batch_manifest(FILE *manifest, struct Batch_Case **cases, size_t *num_cases) {
+	size_t capacity = 64;
+	size_t count = 0;
+	struct Batch_Case *array = malloc(capacity*sizeof(struct Batch_Case));
+	if (array == NULL) {
+		printf("Error allocating the batch case array.\n");
+		return 1;
+	}
+
+	char buffer[BATCH_LINE_LENGTH];
+	char field_path[BATCH_LINE_LENGTH];
+	int line_number = 0;
+	while (fgets(buffer, BATCH_LINE_LENGTH, manifest) != NULL) {
+		line_number++;
+
+		char *line = buffer + strspn(buffer, " \t");
+		if (*line == '#' || *line == '\n' || *line == '\r' || *line == '\0') {
+			continue;
+		}
+
+		struct Batch_Case c;
+		if (sscanf(line, "%lf %lf %lf %lf %s %lf %lf %d", &c.a, &c.b, &c.d1, &c.d2, field_path, &c.start, &c.end, &c.num_elements) != 8) {
+			printf("Manifest line %d is malformed; expected `A B d1 d2 field start end n`.\n", line_number);
+			free_batch_cases(array, count);
+			return 1;
+		}
+
+		if (count == capacity) {
+			capacity *= 2;
+			struct Batch_Case *larger = realloc(array, capacity*sizeof(struct Batch_Case));
+			if (larger == NULL) {
+				printf("Error allocating the batch case array.\n");
+				free_batch_cases(array, count);
+				return 1;
+			}
+			array = larger;
+		}
+
+		c.index = count;
+		c.field_path = strdup(field_path);
+		array[count++] = c;
+	}
+
+	*cases = array;
+	*num_cases = count;
+
+	return 0;
+
+}
+
+void free_batch_cases(struct Batch_Case *cases, size_t num_cases) {
+	for (size_t i = 0; i < num_cases; i++) {
+		free(cases[i].field_path);
+	}
+	free(cases);
+
+}
+
+// Field, then mesh, then coefficients; the manifest order breaks ties
+static int compare_cases(const void *first, const void *second) {
+	const struct Batch_Case *x = *(struct Batch_Case* const*) first;
+	const struct Batch_Case *y = *(struct Batch_Case* const*) second;
+
+	int field_order = strcmp(x->field_path, y->field_path);
+	if (field_order != 0) {
+		return field_order;
+	}
+
+	if (x->start != y->start) return (x->start < y->start) ? -1 : 1;
+	if (x->end != y->end) return (x->end < y->end) ? -1 : 1;
+	if (x->num_elements != y->num_elements) return (x->num_elements < y->num_elements) ? -1 : 1;
+	if (x->a != y->a) return (x->a < y->a) ? -1 : 1;
+	if (x->b != y->b) return (x->b < y->b) ? -1 : 1;
+
+	return (x->index < y->index) ? -1 : (x->index > y->index);
+
+}
+
+static bool same_group(const struct Batch_Case *x, const struct Batch_Case *y) {
+	return strcmp(x->field_path, y->field_path) == 0 && x->start == y->start && x->end == y->end && x->num_elements == y->num_elements;
+
+}
+
+static void finish_subgroup(struct Batch_Group *group) {
+	if (atomic_fetch_sub(&group->remaining_subgroups, 1) == 1) {
+		gsl_vector_free(group->F_const);
+		free_mesh_memory(&group->mesh);
+	}
+
+}
+
+static void solve_subgroup(void *args) {
+	struct Batch_Subgroup *subgroup = (struct Batch_Subgroup*) args;
+	struct Batch_Group *group = subgroup->group;
+	struct Batch_Context *context = group->context;
+	struct Batch_Case **cases = group->cases + subgroup->first_case;
+	TRACE_SPAN_START(subgroup_span);
+
+	struct Solver_Stats task_stats;
+	struct Solver_Stats *previous = begin_task_stats(context, &task_stats);
+
+	struct Band_Matrix K_lu;
+	if (factorize_ode_constant(&group->mesh, cases[0]->a, cases[0]->b, &K_lu)) {
+		record_failures(context, subgroup->num_cases);
+		end_task_stats(context, &task_stats, previous);
+		finish_subgroup(group);
+		free(subgroup);
+		return;
+	}
+
+	pthread_mutex_lock(&context->lock);
+	context->num_factorizations++;
+	pthread_mutex_unlock(&context->lock);
+
+	size_t failed = 0;
+	for (size_t i = 0; i < subgroup->num_cases; i++) {
+		gsl_vector *y = solve_ode_factorized(&group->mesh, &K_lu, group->F_const, cases[i]->d1, cases[i]->d2);
+
+		// Includes any wait on a full writer queue
+		STATS_TIMER_START(output_timer);
+		if (y == NULL || submit_solution_values(&context->writer, group->mesh.node_coordinates, y->data, group->mesh.num_nodes, cases[i]->index)) {
+			failed++;
+		}
+		STATS_TIMER_STOP(output_timer, STATS_OUTPUT);
+		if (y != NULL) {
+			gsl_vector_free(y);
+		}
+	}
+
+	if (failed > 0) {
+		record_failures(context, failed);
+	}
+
+	free_band_matrix(&K_lu);
+	end_task_stats(context, &task_stats, previous);
+	finish_subgroup(group);
+	free(subgroup);
+	TRACE_SPAN_STOP(subgroup_span, "subgroup", "batch");
+
+}
+
+// Builds the shared mesh and load vector, then hands each (a, b) subgroup to the pool
+static void solve_group(void *args) {
+	struct Batch_Group *group = (struct Batch_Group*) args;
+	struct Batch_Context *context = group->context;
+	struct Batch_Case *first = group->cases[0];
+	TRACE_SPAN_START(group_span);
+
+	struct Solver_Stats task_stats;
+	struct Solver_Stats *previous = begin_task_stats(context, &task_stats);
+
+	if (group->field == NULL || generate_uniform_mesh(&group->mesh, first->start, first->end, first->num_elements, LINEAR)) {
+		record_failures(context, group->num_cases);
+		end_task_stats(context, &task_stats, previous);
+		return;
+	}
+
+	group->F_const = assemble_constant_vector(&group->mesh, group->field);
+	end_task_stats(context, &task_stats, previous);
+	if (group->F_const == NULL) {
+		record_failures(context, group->num_cases);
+		free_mesh_memory(&group->mesh);
+		return;
+	}
+
+	// Count the subgroups first, so that none of them can free the mesh before the rest have been submitted
+	size_t num_subgroups = 1;
+	for (size_t i = 1; i < group->num_cases; i++) {
+		if (group->cases[i]->a != group->cases[i - 1]->a || group->cases[i]->b != group->cases[i - 1]->b) {
+			num_subgroups++;
+		}
+	}
+	atomic_store(&group->remaining_subgroups, num_subgroups);
+
+	size_t start = 0;
+	for (size_t i = 1; i <= group->num_cases; i++) {
+		if (i < group->num_cases && group->cases[i]->a == group->cases[start]->a && group->cases[i]->b == group->cases[start]->b) {
+			continue;
+		}
+
+		struct Batch_Subgroup *subgroup = malloc(sizeof(struct Batch_Subgroup));
+		if (subgroup == NULL) {
+			record_failures(context, i - start);
+			finish_subgroup(group);
+		}
+		else {
+			subgroup->group = group;
+			subgroup->first_case = start;
+			subgroup->num_cases = i - start;
+			if (submit_task(&context->pool, solve_subgroup, subgroup)) {
+				record_failures(context, i - start);
+				finish_subgroup(group);
+				free(subgroup);
+			}
+		}
+		start = i;
+	}
+	TRACE_SPAN_STOP(group_span, "group", "batch");
+
+}
+
+static struct Function_Field* load_field(const char *path) {
+	FILE *field_file = fopen(path, "r");
+	if (field_file == NULL) {
+		printf("Could not open the function field file %s.\n", path);
+		return NULL;
+	}
+
+	struct Function_Field *field = malloc(sizeof(struct Function_Field));
+	if (field == NULL || input_function_field(field, field_file)) {
+		free(field);
+		field = NULL;
+	}
+	fclose(field_file);
+
+	return field;
+
+}
+
+int run_batch(FILE *manifest, struct Batch_Options *options, struct Batch_Summary *summary) {
+	struct timespec begin, end;
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	memset(summary, 0, sizeof(struct Batch_Summary));
+
+	struct Batch_Case *cases;
+	size_t num_cases;
+	if (read_batch_manifest(manifest, &cases, &num_cases)) {
+		return 1;
+	}
+	summary->num_cases = num_cases;
+
+	struct Batch_Case **order = malloc(num_cases*sizeof(struct Batch_Case*));
+	struct Batch_Group *groups = malloc(num_cases*sizeof(struct Batch_Group));
+	struct Function_Field **fields = malloc(num_cases*sizeof(struct Function_Field*));
+	if (num_cases > 0 && (order == NULL || groups == NULL || fields == NULL)) {
+		printf("Error allocating the batch groups.\n");
+		free(order); free(groups); free(fields);
+		free_batch_cases(cases, num_cases);
+		return 1;
+	}
+
+	for (size_t i = 0; i < num_cases; i++) {
+		order[i] = &cases[i];
+	}
+	qsort(order, num_cases, sizeof(struct Batch_Case*), compare_cases);
+
+	struct Batch_Context context;
+	context.num_failed = 0;
+	context.num_factorizations = 0;
+	context.stats = options->stats;
+	if (open_solution_writer(&context.writer, options->output_path, options->format)) {
+		free(order); free(groups); free(fields);
+		free_batch_cases(cases, num_cases);
+		return 1;
+	}
+	if (create_thread_pool(&context.pool, options->num_threads)) {
+		close_solution_writer(&context.writer);
+		free(order); free(groups); free(fields);
+		free_batch_cases(cases, num_cases);
+		return 1;
+	}
+	pthread_mutex_init(&context.lock, NULL);
+
+	// Field files are read on this thread
+	struct Solver_Stats *previous = stats_activate(options->stats);
+
+	// Sorted by field first, so each field file is read once
+	size_t num_groups = 0, num_fields = 0;
+	for (size_t i = 0; i < num_cases; i++) {
+		if (i > 0 && same_group(order[i], order[i - 1])) {
+			groups[num_groups - 1].num_cases++;
+			continue;
+		}
+
+		if (i == 0 || strcmp(order[i]->field_path, order[i - 1]->field_path) != 0) {
+			fields[num_fields++] = load_field(order[i]->field_path);
+		}
+
+		struct Batch_Group *group = &groups[num_groups++];
+		group->context = &context;
+		group->cases = &order[i];
+		group->num_cases = 1;
+		group->field = fields[num_fields - 1];
+		group->F_const = NULL;
+	}
+
+	for (size_t g = 0; g < num_groups; g++) {
+		if (submit_task(&context.pool, solve_group, &groups[g])) {
+			record_failures(&context, groups[g].num_cases);
+		}
+	}
+
+	wait_thread_pool(&context.pool);
+	free_thread_pool(&context.pool);
+
+	STATS_TIMER_START(output_timer);
+	int status = close_solution_writer(&context.writer);
+	STATS_TIMER_STOP(output_timer, STATS_OUTPUT);
+	stats_activate(previous);
+
+	summary->num_groups = num_groups;
+	summary->num_factorizations = context.num_factorizations;
+	summary->num_failed = context.num_failed;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	summary->seconds = (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec)/1e9;
+
+	pthread_mutex_destroy(&context.lock);
+	for (size_t f = 0; f < num_fields; f++) {
+		if (fields[f] != NULL) {
+			free_function_field(fields[f]);
+			free(fields[f]);
+		}
+	}
+	free(order);
+	free(groups);
+	free(fields);
+	free_batch_cases(cases, num_cases);
+
+	return (status || summary->num_failed > 0);
+
+}
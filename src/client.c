@@ -0,0 +1,299 @@
+/* Client for the solver server (see solver_server.h for the protocol)
+ *
+ *	solver_client.out [socket path] [request ...]
+ *		Sends each request (or each line of stdin when none are given) and prints the responses.
+ *	solver_client.out --bench [socket path] [function field file] [--requests N] [--elements N] [--clients N] [--no-values]
+ *		Times cold requests (a new mesh every time, so the mesh, load vector and factorization are built)
+ *		against repeated cached requests, and reports latency percentiles and throughput for both.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define CLIENT_LINE_LENGTH 4096
+
+struct Client_Connection {
+	FILE *input;
+	FILE *output;
+
+};
+
+struct Bench_Thread {
+	const char *socket_path;
+	const char *field_path;
+	bool cold;
+	bool values;
+	int base_elements;
+	size_t first_request, num_requests;
+	double *latencies; // Shared array; each thread fills its own range
+	int status;
+
+};
+
+static double now_seconds() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec + now.tv_nsec/1e9;
+
+}
+
+static int connect_server(const char *socket_path, struct Client_Connection *connection) {
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(struct sockaddr_un));
+	address.sun_family = AF_UNIX;
+	snprintf(address.sun_path, sizeof(address.sun_path), "%s", socket_path);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0 || connect(fd, (struct sockaddr*) &address, sizeof(struct sockaddr_un)) < 0) {
+		fprintf(stderr, "Could not connect to %s.\n", socket_path);
+		if (fd >= 0) {
+			close(fd);
+		}
+		return 1;
+	}
+
+	connection->input = fdopen(fd, "r");
+	connection->output = fdopen(dup(fd), "w");
+	if (connection->input == NULL || connection->output == NULL) {
+		fprintf(stderr, "Could not open the connection streams.\n");
+		return 1;
+	}
+
+	return 0;
+
+}
+
+static void close_connection(struct Client_Connection *connection) {
+	fclose(connection->output);
+	fclose(connection->input);
+
+}
+
+// Sends one request and reads the whole response; the lines are echoed to `echo` if it is not NULL
+static int send_request(struct Client_Connection *connection, const char *request, FILE *echo) {
+	fprintf(connection->output, "%s\n", request);
+	fflush(connection->output);
+
+	char line[CLIENT_LINE_LENGTH];
+	if (fgets(line, CLIENT_LINE_LENGTH, connection->input) == NULL) {
+		fprintf(stderr, "The server closed the connection.\n");
+		return 1;
+	}
+	if (echo != NULL) {
+		fputs(line, echo);
+	}
+
+	if (strncmp(line, "OK", 2) != 0) {
+		return 1;
+	}
+
+	// A solve is followed by its node values, unless they were turned off
+	char *nodes = strstr(line, " nodes=");
+	if (nodes == NULL || strstr(request, "values=0") != NULL) {
+		return 0;
+	}
+
+	long num_nodes = strtol(nodes + 7, NULL, 10);
+	for (long i = 0; i < num_nodes; i++) {
+		if (fgets(line, CLIENT_LINE_LENGTH, connection->input) == NULL) {
+			return 1;
+		}
+		if (echo != NULL) {
+			fputs(line, echo);
+		}
+	}
+
+	return 0;
+
+}
+
+static int run_requests(const char *socket_path, int num_requests, char **requests) {
+	struct Client_Connection connection;
+	if (connect_server(socket_path, &connection)) {
+		return 1;
+	}
+
+	int status = 0;
+	if (num_requests > 0) {
+		for (int i = 0; i < num_requests; i++) {
+			status |= send_request(&connection, requests[i], stdout);
+		}
+	}
+	else {
+		char line[CLIENT_LINE_LENGTH];
+		while (fgets(line, CLIENT_LINE_LENGTH, stdin) != NULL) {
+			line[strcspn(line, "\n")] = '\0';
+			if (line[0] != '\0') {
+				status |= send_request(&connection, line, stdout);
+			}
+		}
+	}
+
+	close_connection(&connection);
+
+	return status;
+
+}
+
+static void* bench_thread(void *args) {
+	struct Bench_Thread *bench = (struct Bench_Thread*) args;
+
+	struct Client_Connection connection;
+	if (connect_server(bench->socket_path, &connection)) {
+		bench->status = 1;
+		return NULL;
+	}
+
+	char request[CLIENT_LINE_LENGTH];
+	for (size_t i = bench->first_request; i < bench->first_request + bench->num_requests; i++) {
+		// Cold requests get a mesh that has not been seen before
+		int num_elements = bench->cold ? bench->base_elements + 1 + (int) i : bench->base_elements;
+		snprintf(request, CLIENT_LINE_LENGTH, "SOLVE id=%zu a=-1 b=-5 d1=-1 d2=1 field=%s start=0 end=1 elements=%d values=%d",
+				 i, bench->field_path, num_elements, bench->values ? 1 : 0);
+
+		double begin = now_seconds();
+		if (send_request(&connection, request, NULL)) {
+			bench->status = 1;
+			break;
+		}
+		bench->latencies[i] = now_seconds() - begin;
+	}
+
+	close_connection(&connection);
+
+	return NULL;
+
+}
+
+static int compare_doubles(const void *a, const void *b) {
+	double x = *(const double*) a, y = *(const double*) b;
+
+	return (x > y) - (x < y);
+
+}
+
+static int run_bench_phase(const char *label, struct Bench_Thread *settings, size_t num_requests, size_t num_clients) {
+	double *latencies = calloc(num_requests, sizeof(double));
+	pthread_t *threads = malloc(num_clients*sizeof(pthread_t));
+	struct Bench_Thread *benches = malloc(num_clients*sizeof(struct Bench_Thread));
+	if (latencies == NULL || threads == NULL || benches == NULL) {
+		free(latencies); free(threads); free(benches);
+		return 1;
+	}
+
+	double begin = now_seconds();
+	for (size_t c = 0; c < num_clients; c++) {
+		benches[c] = *settings;
+		benches[c].first_request = c*num_requests/num_clients;
+		benches[c].num_requests = (c + 1)*num_requests/num_clients - benches[c].first_request;
+		benches[c].latencies = latencies;
+		benches[c].status = 0;
+		pthread_create(&threads[c], NULL, bench_thread, &benches[c]);
+	}
+
+	int status = 0;
+	for (size_t c = 0; c < num_clients; c++) {
+		pthread_join(threads[c], NULL);
+		status |= benches[c].status;
+	}
+	double total = now_seconds() - begin;
+
+	qsort(latencies, num_requests, sizeof(double), compare_doubles);
+	double mean = 0;
+	for (size_t i = 0; i < num_requests; i++) {
+		mean += latencies[i]/num_requests;
+	}
+
+	printf("%-7s requests=%zu clients=%zu p50_us=%.1f p99_us=%.1f mean_us=%.1f throughput_per_s=%.1f\n",
+		   label, num_requests, num_clients,
+		   latencies[num_requests/2]*1e6, latencies[(num_requests*99)/100]*1e6, mean*1e6,
+		   num_requests/total);
+
+	free(latencies);
+	free(threads);
+	free(benches);
+
+	return status;
+
+}
+
+static int run_bench(int argc, char **argv) {
+	if (argc < 4) {
+		fprintf(stderr, "Usage: solver_client.out --bench [socket path] [function field file] [--requests N] [--elements N] [--clients N] [--no-values]\n");
+		return 1;
+	}
+
+	struct Bench_Thread settings = {0};
+	settings.socket_path = argv[2];
+	settings.field_path = argv[3];
+	settings.values = true;
+	settings.base_elements = 1000;
+	size_t num_requests = 1000;
+	size_t num_clients = 1;
+
+	for (int i = 4; i < argc; i++) {
+		if (strcmp(argv[i], "--requests") == 0 && i + 1 < argc) {
+			num_requests = strtoul(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "--elements") == 0 && i + 1 < argc) {
+			settings.base_elements = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--clients") == 0 && i + 1 < argc) {
+			num_clients = strtoul(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "--no-values") == 0) {
+			settings.values = false;
+		}
+		else {
+			fprintf(stderr, "Unknown option %s.\n", argv[i]);
+			return 1;
+		}
+	}
+
+	if (num_requests == 0 || num_clients == 0 || num_clients > num_requests) {
+		fprintf(stderr, "Need at least one request and one client, and no more clients than requests.\n");
+		return 1;
+	}
+
+	// Warm the field and the cached mesh once, outside of the timings
+	struct Client_Connection connection;
+	if (connect_server(settings.socket_path, &connection)) {
+		return 1;
+	}
+	char request[CLIENT_LINE_LENGTH];
+	snprintf(request, CLIENT_LINE_LENGTH, "SOLVE a=-1 b=-5 d1=-1 d2=1 field=%s start=0 end=1 elements=%d values=0", settings.field_path, settings.base_elements);
+	int status = send_request(&connection, request, stderr);
+	close_connection(&connection);
+	if (status) {
+		return 1;
+	}
+
+	settings.cold = true;
+	status |= run_bench_phase("cold", &settings, num_requests, num_clients);
+	settings.cold = false;
+	status |= run_bench_phase("cached", &settings, num_requests, num_clients);
+
+	return status;
+
+}
+
+int main(int argc, char **argv) {
+	if (argc >= 2 && strcmp(argv[1], "--bench") == 0) {
+		return run_bench(argc, argv);
+	}
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: solver_client.out [socket path] [request ...]\n");
+		return 1;
+	}
+
+	return run_requests(argv[1], argc - 2, argv + 2);
+
+}
@@ -1,4 +1,16 @@
 #include "fe_section.h"
+#include "band_matrix.h"
+#include "solution_writer.h"
+#include "post_processing.h"
+#include "solver_stats.h"
+#include "trace.h"
+#include "cpu_dispatch.h"
+#include "streaming_solver.h"
+#include "static_condensation.h"
+#include "matrix_free.h"
+
+#include <pthread.h>
+#include <string.h>
 
 #include "shape_functions.c"
 #include "composition_functions.c"
@@ -22,12 +34,14 @@ void free_element_memory(struct Element_Linear* ele) {
 void free_mesh_memory(struct Mesh* input_mesh) {
 	free(input_mesh->connectivity_grid);
 	// Free the memory of the individual element first, then the element pointer itself
-	for (int e = 0; e < input_mesh->num_elements; e++) {
+	for (uint32_t e = 0; e < input_mesh->num_elements; e++) {
 		free_element_memory(&input_mesh->elements[e]);
 	}
 
 	free(input_mesh->elements);
 	free(input_mesh->node_coordinates);
+	free(input_mesh->element_region);
+	free(input_mesh->regions);
 
 }
 
@@ -42,6 +56,15 @@ void free_solution_memory(struct ODE_Solution* solution) {
 		gsl_vector_free(solution->const_vector_global);
 	}
 
+	if (solution->qoi != NULL) {
+		free_qoi_result(solution->qoi);
+		free(solution->qoi);
+	}
+
+	free(solution->stats);
+	free(solution->refinement);
+	free(solution->iterative);
+
 }
 
 void create_element_L2(struct Element_Linear* e, double node1, double node2) {
@@ -61,6 +84,7 @@ void create_element_L2(struct Element_Linear* e, double node1, double node2) {
 	// Jacobian assembly into GSL function
 	struct L2_N_P p = {node1, node2};
 	struct L2_N_P* p_perpetual = malloc(sizeof(struct L2_N_P));
+	STATS_ALLOC(sizeof(struct L2_N_P));
 	*p_perpetual = p; // Copy p here to avoid the out-of-scope errors gotten earlier
 	gsl_function j;
 	j.function = &J_L2;
@@ -75,6 +99,7 @@ void create_element_L2(struct Element_Linear* e, double node1, double node2) {
 		e->element.L2.shape_func
 	};
 	struct Iso_Phy_Funcs* p1_perpetual = malloc(sizeof(struct Iso_Phy_Funcs));
+	STATS_ALLOC(sizeof(struct Iso_Phy_Funcs));
 	*p1_perpetual = p1; // Storing object on heap-allocated object, as was done above-> 
 
 	gsl_function iso;
@@ -104,6 +129,7 @@ void create_element_L3(struct Element_Linear* e, double node1, double node2, dou
 	// Jacobian assembly into GSL function
 	struct L3_N_P p = {node1, node2, node3};
 	struct L3_N_P* p_perpetual = malloc(sizeof(struct L3_N_P));
+	STATS_ALLOC(sizeof(struct L3_N_P));
 	*p_perpetual = p; // Copy p here to avoid the out-of-scope errors gotten earlier
 	gsl_function j;
 	j.function = &J_L3;
@@ -118,6 +144,7 @@ void create_element_L3(struct Element_Linear* e, double node1, double node2, dou
 		e->element.L3.shape_func
 	};
 	struct Iso_Phy_Funcs* p1_perpetual = malloc(sizeof(struct Iso_Phy_Funcs));
+	STATS_ALLOC(sizeof(struct Iso_Phy_Funcs));
 	*p1_perpetual = p1; // Storing object on heap-allocated object, as was done above
 
 	gsl_function iso;
@@ -128,9 +155,97 @@ void create_element_L3(struct Element_Linear* e, double node1, double node2, dou
 
 }
 
+// The optional region table after the nodes of a mesh file: a "regions N" line, then "a b" for each region
+static int parse_region_table(FILE* input_stream, int num_nodes, struct Mesh_Region** regions, uint32_t* num_regions) {
+	char buffer[100];
+	if (fgets(buffer, 100, input_stream) == NULL) {
+		return 0;
+	}
+
+	// Without the keyword the line is one node too many, as in a plain mesh file
+	if (strncmp(buffer, "regions", 7) != 0 || (buffer[7] != ' ' && buffer[7] != '\t')) {
+		printf("CRITICAL ERROR: Mesh file is malformed; there are more than %d nodes in the mesh file. Please check.\n", num_nodes);
+		return 1;
+	}
+
+	buffer[strcspn(buffer, "\r\n")] = '\0';
+	char* end;
+	long count = strtol(buffer + 7, &end, 10);
+	end += strspn(end, " \t");
+	if (end == buffer + 7 || *end != '\0' || count < 1 || count > UINT32_MAX) {
+		printf("CRITICAL ERROR: Mesh file is malformed; the region table gives an invalid region count (%s).\n", buffer + 8);
+		return 1;
+	}
+
+	*regions = malloc(count*sizeof(struct Mesh_Region));
+	if (*regions == NULL) {
+		printf("Error allocating the table of %ld regions.\n", count);
+		return 1;
+	}
+	STATS_ALLOC(count*sizeof(struct Mesh_Region));
+
+	for (long r = 0; r < count; r++) {
+		if (fgets(buffer, 100, input_stream) == NULL || sscanf(buffer, "%lf %lf", &(*regions)[r].a, &(*regions)[r].b) != 2) {
+			printf("CRITICAL ERROR: Mesh file is malformed; region %ld of %ld does not give A and B.\n", r, count);
+			free(*regions);
+			*regions = NULL;
+			return 1;
+		}
+	}
+
+	if (fgets(buffer, 100, input_stream) != NULL) {
+		printf("CRITICAL ERROR: Mesh file is malformed; there are lines after the table of %ld regions.\n", count);
+		free(*regions);
+		*regions = NULL;
+		return 1;
+	}
+	*num_regions = (uint32_t) count;
+
+	return 0;
+
+}
+
+// Each element takes the region tag of its first node; the mesh takes ownership of the region table
+static int assign_element_regions(struct Mesh* mesh_object, const uint32_t* node_region, struct Mesh_Region* regions, uint32_t num_regions) {
+	if (node_region == NULL && regions == NULL) {
+		return 0;
+	}
+	if (regions == NULL) {
+		printf("CRITICAL ERROR: Mesh file is malformed; it gives element regions but no region table.\n");
+		free_mesh_memory(mesh_object);
+		return 1;
+	}
+
+	mesh_object->element_region = calloc(mesh_object->num_elements, sizeof(uint32_t));
+	mesh_object->regions = regions;
+	mesh_object->num_regions = num_regions;
+	if (mesh_object->element_region == NULL) {
+		printf("Error allocating the regions of %u elements.\n", mesh_object->num_elements);
+		free_mesh_memory(mesh_object);
+		return 1;
+	}
+	STATS_ALLOC(mesh_object->num_elements*sizeof(uint32_t));
+
+	for (uint32_t e = 0; node_region != NULL && e < mesh_object->num_elements; e++) {
+		const struct Element_Conn* conn = &mesh_object->connectivity_grid[e];
+		int first = (conn->kind == QUAD) ? conn->node_list.L3.node_id[0] : conn->node_list.L2.node_id[0];
+		if (node_region[first] >= num_regions) {
+			printf("CRITICAL ERROR: Mesh file is malformed; element %u is in region %u of %u.\n", e, node_region[first], num_regions);
+			free_mesh_memory(mesh_object);
+			return 1;
+		}
+		mesh_object->element_region[e] = node_region[first];
+	}
+
+	return 0;
+
+}
+
 int parse_input_file(FILE* input_stream, struct Mesh* mesh_object, Element_2D_Type mesh_kind) {
 	// Read each line from the input file.
 	// Note that first line should be parsed as an unsinged integer; it gives node count
+	STATS_TIMER_START(parse_timer);
+	TRACE_SPAN_START(parse_span);
 	char buffer[100];
 
 	if (fgets(buffer, 100, input_stream) == NULL) {
@@ -140,7 +255,6 @@ int parse_input_file(FILE* input_stream, struct Mesh* mesh_object, Element_2D_Ty
 
 	// Convert to an integer
 	int num_nodes = strtol(buffer, NULL, 10);
-	mesh_object->num_nodes = num_nodes;
 
 	// Allocate an array
 	// TODO: Please rename
@@ -149,17 +263,35 @@ int parse_input_file(FILE* input_stream, struct Mesh* mesh_object, Element_2D_Ty
 		printf("Error in allocating node coordinate array of length %d.\nAborting...", num_nodes);
 		return 1;
 	}
+	STATS_ALLOC(num_nodes*sizeof(double));
+
+	// Region of the element that starts at each node, if the file gives them after the coordinates
+	uint32_t* node_region = NULL;
 
 	// Parse the remaining as floats and produce the node array
 	int counter = 0;
 	double prev_node_coord; // Nodes must be organized in ascending sequential order. 
-	while (fgets(buffer, 100, input_stream) != NULL) {
-		double coord = strtof(buffer, NULL);
-		// Checks if there are more nodes than what was indicated.
-		if (counter == num_nodes) {
-			printf("CRITICAL ERROR: Mesh file is malformed; there are more than %d nodes in the mesh file. Please check.\n", num_nodes);
-			free(node_coors);
-			return 1;
+	while (counter < num_nodes && fgets(buffer, 100, input_stream) != NULL) {
+		char* end;
+		double coord = strtof(buffer, &end);
+		char* tag_end;
+		long region = strtol(end, &tag_end, 10);
+		if (tag_end != end) {
+			if (node_region == NULL) {
+				node_region = calloc(num_nodes, sizeof(uint32_t));
+				if (node_region == NULL) {
+					printf("Error allocating the region tags of %d nodes.\n", num_nodes);
+					free(node_coors);
+					return 1;
+				}
+			}
+			if (region < 0 || region > UINT32_MAX) {
+				printf("CRITICAL ERROR: Mesh file is malformed; node %d has the region %ld.\n", counter + 1, region);
+				free(node_coors);
+				free(node_region);
+				return 1;
+			}
+			node_region[counter] = (uint32_t) region;
 		}
 
 		node_coors[counter++] = coord;
@@ -172,6 +304,7 @@ int parse_input_file(FILE* input_stream, struct Mesh* mesh_object, Element_2D_Ty
 			if (coord <= prev_node_coord) {
 					printf("CRITICAL ERROR: Mesh file is malformed; coordinate of node %d (%f) is equal or less than the previous node %d (%f).\n", counter, coord, counter - 1, prev_node_coord);
 					free(node_coors);
+					free(node_region);
 					return 1;
 			}
 			prev_node_coord = coord;
@@ -185,10 +318,52 @@ int parse_input_file(FILE* input_stream, struct Mesh* mesh_object, Element_2D_Ty
 	if (counter != num_nodes) {
 		printf("CRITICAL ERROR: Mesh file is malformed; number of nodes reported (%d) is not equal to the number of nodes scanned (%d).\n", num_nodes, counter);
 		free(node_coors);
+		free(node_region);
+		return 1;
+	}
+
+	// Anything after the nodes is the region table
+	struct Mesh_Region* regions = NULL;
+	uint32_t num_regions = 0;
+	if (parse_region_table(input_stream, num_nodes, &regions, &num_regions)) {
+		free(node_coors);
+		free(node_region);
 		return 1;
 	}
 
+	STATS_TIMER_STOP(parse_timer, STATS_PARSE);
+	TRACE_SPAN_STOP(parse_span, "parse mesh", "solver");
+
 	// Now, determine the number of elements and produce them
+	if (build_mesh_from_nodes(mesh_object, node_coors, num_nodes, mesh_kind)) {
+		free(node_region);
+		free(regions);
+		return 1;
+	}
+
+	int status = assign_element_regions(mesh_object, node_region, regions, num_regions);
+	free(node_region);
+
+	return status;
+
+}
+
+// Builds the elements and connectivity grid of a mesh from an ascending node coordinate array.
+// The mesh takes ownership of the coordinate array.
+int build_mesh_from_nodes(struct Mesh* mesh_object, double* node_coors, int num_nodes, Element_2D_Type mesh_kind) {
+	if (num_nodes < 2 || num_nodes > MESH_MAX_NODES) {
+		printf("A mesh needs between 2 and %d nodes; %d were given.\n", MESH_MAX_NODES, num_nodes);
+		free(node_coors);
+		return 1;
+	}
+
+	mesh_object->num_nodes = num_nodes;
+	mesh_object->element_region = NULL;
+	mesh_object->regions = NULL;
+	mesh_object->num_regions = 0;
+	STATS_TIMER_START(build_timer);
+	TRACE_SPAN_START(build_span);
+
 	switch (mesh_kind) {
 		case LINEAR: {
 			mesh_object->num_elements = num_nodes - 1;
@@ -201,6 +376,8 @@ int parse_input_file(FILE* input_stream, struct Mesh* mesh_object, Element_2D_Ty
 				printf("Error allocating array for elements of length %d. Please check.\nAborting...", num_nodes - 1);
 				return 1;
 			}
+			STATS_ALLOC(mesh_object->num_elements*sizeof(struct Element_Linear));
+			STATS_ALLOC(mesh_object->num_elements*sizeof(struct Element_Conn));
 
 			for (int i = 1; i < num_nodes; i++) {
 				struct Element_Linear ele;
@@ -237,6 +414,8 @@ int parse_input_file(FILE* input_stream, struct Mesh* mesh_object, Element_2D_Ty
 				printf("Error allocating array for elements of length %d. Please check.\nAborting...", num_nodes - 1);
 				return 1;
 			}
+			STATS_ALLOC(mesh_object->num_elements*sizeof(struct Element_Linear));
+			STATS_ALLOC(mesh_object->num_elements*sizeof(struct Element_Conn));
 
 			for (int i = 2; i < num_nodes; i += 2) {
 				struct Element_Linear ele;
@@ -263,318 +442,1235 @@ int parse_input_file(FILE* input_stream, struct Mesh* mesh_object, Element_2D_Ty
 		}
 	}
 
+	STATS_TIMER_STOP(build_timer, STATS_ELEMENT_BUILD);
+	TRACE_SPAN_STOP(build_span, "element build", "solver");
+
 	return 0;
 
 }
 
-gsl_vector* output_constant_vector(struct Element_Linear* element, struct Function_Field *function_field) {
-// Check element type. This will determine iteration length
-	switch (element->kind) {
-		case LINEAR: { // Two nodes
-					   // Create the vector
-						 gsl_vector* v = gsl_vector_alloc(2);
-
-						 for (int n = 0; n < 2; n++) {
-							 gsl_function constant_vector;
-
-							 struct Constant_Vector_Funcs p = {
-								 function_field,
-								 element->element.L2.shape_func[n],
-								 &element->element.L2.jacobian,
-								 &element->element.L2.iso_conversion,
-
-							 };
-
-							 constant_vector.function = &constant_vector_composition;
-							 constant_vector.params = &p;
-
-							 // The crux of this operation.
-							 // Perform Gauss quadrature and add to the n-th entry
-							 // Make the workspace first
-							 gsl_integration_fixed_workspace* w = gsl_integration_fixed_alloc(gsl_integration_fixed_legendre,
-									 9,
-									 -1,
-									 1,
-									 0, // Ignored
-									 0 // Ignored
-									 );
-							 // Finally integrate.
-							 double f_i1;
-							 gsl_integration_fixed(&constant_vector, &f_i1, w);
-							 gsl_vector_set(v, n, f_i1);
-							 gsl_integration_fixed_free(w);
-						 }
-
-						 return v;
-						 break;
-					 }
-		case QUAD: { // Three nodes
-					 // Create the vector
-					   gsl_vector* v = gsl_vector_alloc(3);
-
-					   for (int n = 0; n < 3; n++) {
-						   gsl_function constant_vector;
-
-						   struct Constant_Vector_Funcs p = {
-							   function_field,
-							   element->element.L3.shape_func[n],
-							   &element->element.L3.jacobian,
-							   &element->element.L3.iso_conversion,
-						   };
-
-						   constant_vector.function = &constant_vector_composition;
-						   constant_vector.params = &p;
-
-						   // The crux of this operation.
-						   // Perform Gauss quadrature and add to the n-th entry
-						   // Make the workspace first
-						   gsl_integration_fixed_workspace* w = gsl_integration_fixed_alloc(gsl_integration_fixed_legendre,
-								   10,
-								   -1,
-								   1,
-								   0, // Ignored
-								   0 // Ignored
-								   );
-						   // Finally integrate.
-						   double f_i1;
-						   gsl_integration_fixed(&constant_vector, &f_i1, w);
-						   gsl_vector_set(v, n, f_i1);
-						   gsl_integration_fixed_free(w);
-					   }
-
-					   return v;
-					   break;
-				   }
+// Simple mesh generator: evenly spaced nodes over [start, end].
+// L3 elements get a centered middle node, so the mesh has 2*num_elements + 1 nodes.
+int generate_uniform_mesh(struct Mesh* mesh_object, double start, double end, int num_elements, Element_2D_Type mesh_kind) {
+	if (end <= start || num_elements < 1) {
+		printf("Cannot generate a mesh of %d elements over [%f, %f].\n", num_elements, start, end);
+		return 1;
+	}
+
+	int nodes_per_element = (mesh_kind == QUAD) ? 2 : 1;
+	if (num_elements > (MESH_MAX_NODES - 1)/nodes_per_element) {
+		printf("Cannot generate a mesh of %d elements; a mesh holds at most %d nodes.\n", num_elements, MESH_MAX_NODES);
+		return 1;
+	}
+	int num_nodes = num_elements*nodes_per_element + 1;
+
+	double* node_coors = (double*) malloc(num_nodes*sizeof(double));
+	if (node_coors == NULL) {
+		printf("Error in allocating node coordinate array of length %d.\nAborting...", num_nodes);
+		return 1;
+	}
+
+	double step = (end - start)/(num_nodes - 1);
+	for (int i = 0; i < num_nodes - 1; i++) {
+		node_coors[i] = start + i*step;
 	}
+	node_coors[num_nodes - 1] = end;
+
+	return build_mesh_from_nodes(mesh_object, node_coors, num_nodes, mesh_kind);
 
 }
 
-gsl_matrix* output_coefficient_matrix(struct Element_Linear* element, double a, double b) {
-	switch (element->kind) {
-		case LINEAR: {
-						 gsl_matrix* m = gsl_matrix_alloc(2, 2);
-
-						 for (int i = 0; i < 2; i++) {
-							 for (int j = 0; j < 2; j++) {
-								 gsl_function coefficient_matrix;
-
-								 struct Coefficient_Matrix_Funcs p = {
-									 a, b,
-									 element->element.L2.shape_func[i],
-									 element->element.L2.shape_func[j],
-									 element->element.L2.shape_derv[i],
-									 element->element.L2.shape_derv[j],
-									 &element->element.L2.jacobian
-								 };
-
-								 coefficient_matrix.function = &coefficient_matrix_composition;
-								 coefficient_matrix.params = &p;
-
-								 // The crux of this operation.
-								 // Perform Gauss quadrature and add to the n-th entry
-								 // Make the workspace first
-								 gsl_integration_fixed_workspace* w = gsl_integration_fixed_alloc(gsl_integration_fixed_legendre,
-										 9,
-										 -1,
-										 1,
-										 0, // Ignored
-										 0 // Ignored
-										 );
-								 // Finally integrate.
-								 double k_ij;
-								 gsl_integration_fixed(&coefficient_matrix, &k_ij, w);
-								 gsl_matrix_set(m, i, j, k_ij);
-								 gsl_integration_fixed_free(w);
-							 }
-						 }
-
-						 return m;
-						 break;
-					 }
-		case QUAD: {
-						 gsl_matrix* m = gsl_matrix_alloc(3, 3);
-
-						 for (int i = 0; i < 3; i++) {
-							 for (int j = 0; j < 3; j++) {
-								 gsl_function coefficient_matrix;
-
-								 struct Coefficient_Matrix_Funcs p = {
-									 a, b,
-									 element->element.L3.shape_func[i],
-									 element->element.L3.shape_func[j],
-									 element->element.L3.shape_derv[i],
-									 element->element.L3.shape_derv[j],
-									 &element->element.L3.jacobian
-								 };
-
-								 coefficient_matrix.function = &coefficient_matrix_composition;
-								 coefficient_matrix.params = &p;
-
-								 // The crux of this operation.
-								 // Perform Gauss quadrature and add to the n-th entry
-								 // Make the workspace first
-								 gsl_integration_fixed_workspace* w = gsl_integration_fixed_alloc(gsl_integration_fixed_legendre,
-										 10,
-										 -1,
-										 1,
-										 0, // Ignored
-										 0 // Ignored
-										 );
-								 // Finally integrate.
-								 double k_ij;
-								 gsl_integration_fixed(&coefficient_matrix, &k_ij, w);
-								 gsl_matrix_set(m, i, j, k_ij);
-								 gsl_integration_fixed_free(w);
-							 }
-						 }
-
-						 return m;
-						 break;
-					 }
+// Number of sub- and super-diagonals of the global coefficient matrix
+int mesh_bandwidth(struct Mesh* input_mesh) {
+	int bandwidth = 0;
+	for (uint32_t e = 0; e < input_mesh->num_elements; e++) {
+		int span = (input_mesh->connectivity_grid[e].kind == QUAD) ? 2 : 1;
+		if (span > bandwidth) {
+			bandwidth = span;
+		}
 	}
 
+	return bandwidth;
+
 }
 
-int solve_ode_constant(struct Mesh* input_mesh, struct ODE_Solution* solution, double a, double b, double d1, double d2, struct Function_Field *function_field, bool output_global_arrays) {
-	// First, check if the input mesh has valid node and element arrays
-	if (input_mesh->connectivity_grid == NULL || input_mesh->elements == NULL) {
-		printf("ERROR: Provided mesh is not properly loaded with element and node information.\nPlease ensure that the `parse_input_file` function has been called to populate the object, or check for other errors.\n");
-		return 1;
+// Start node and size of an element's block in the global arrays
+static int element_block(struct Mesh* input_mesh, uint32_t e, int* starting_point, int* size) {
+	switch (input_mesh->elements[e].kind) {
+		case LINEAR:
+			*starting_point = input_mesh->connectivity_grid[e].node_list.L2.node_id[0];
+			*size = 2;
+			return 0;
+		case QUAD:
+			*starting_point = input_mesh->connectivity_grid[e].node_list.L3.node_id[0];
+			*size = 3;
+			return 0;
 	}
 
-	// Initialize the constant vector and coefficient matrix with zeros
-	// Coeffcient matrix size : (num_nodes, num_nodes)
-	// Constant vector size : (num_nodes, 1)
-	gsl_matrix* K_coeff = gsl_matrix_calloc(input_mesh->num_nodes, input_mesh->num_nodes);
-	gsl_vector* F_const = gsl_vector_calloc(input_mesh->num_nodes);
+	printf("Unknown element type; please check.\n");
+	return 1;
 
-	// Now, iterate through the elements and solve for the local coefficient matrix and constant vectors 
-	for (int e = 0; e < input_mesh->num_elements; e++) {
-		// Calculate the constant vector
-		gsl_vector* constant_local = output_constant_vector(&input_mesh->elements[e], function_field);
-
-		// Calculate the coefficient matrix
-		gsl_matrix* coefficient_local = output_coefficient_matrix(&input_mesh->elements[e], a, b);
-
-		// Add to their respective entries in the global matrices
-		int starting_point, size;
-		switch (input_mesh->elements[e].kind) {
-			case LINEAR: 
-				starting_point = input_mesh->connectivity_grid[e].node_list.L2.node_id[0];
-				size = 2;
-				break;
-			case QUAD: 
-				starting_point = input_mesh->connectivity_grid[e].node_list.L3.node_id[0];
-				size = 3;
-				break;
-			default:
-				printf("Unknown element type; please check.\n");
-				return 1;
-				break;
+}
+
+/* Tabulated quadrature kernels
+ *
+ * The shape functions and their derivatives are tabulated once at the Gauss-Legendre points of GSL's fixed rules (9 points for L2, 10 for L3),
+ * and the local arrays of a block of elements of the same kind are computed together, with the element as the innermost loop so that it vectorizes.
+ * Each entry is summed over the points in the same order, and with the same operations, as integrating the composition functions with gsl_integration_fixed().
+ */
+#define MAX_QUAD_POINTS 10
+
+struct Quadrature_Table {
+	int num_points;
+	int num_nodes;
+	double weights[MAX_QUAD_POINTS];
+	double N[MAX_ELEMENT_NODES][MAX_QUAD_POINTS]; // Shape functions at the points
+	double dN[MAX_ELEMENT_NODES][MAX_QUAD_POINTS]; // Their derivatives
+	double d2N[MAX_ELEMENT_NODES]; // Their second derivatives, constant for L2 and L3 elements (for the SUPG residual)
+
+};
+
+static struct Quadrature_Table quadrature_tables[2]; // Indexed by Element_2D_Type
+static pthread_once_t quadrature_once = PTHREAD_ONCE_INIT;
+
+static void tabulate_element(struct Quadrature_Table* table, int num_points, int num_nodes, double (**shape) (double), double (**derv) (double), const double* second_derv) {
+	gsl_integration_fixed_workspace* w = gsl_integration_fixed_alloc(gsl_integration_fixed_legendre, num_points, -1, 1, 0, 0);
+	if (w == NULL) {
+		printf("Error allocating the %d point quadrature rule.\n", num_points);
+		table->num_points = 0;
+		return;
+	}
+
+	const double* nodes = gsl_integration_fixed_nodes(w);
+	const double* weights = gsl_integration_fixed_weights(w);
+	for (int i = 0; i < num_nodes; i++) {
+		table->d2N[i] = second_derv[i];
+	}
+	for (int q = 0; q < num_points; q++) {
+		table->weights[q] = weights[q];
+		for (int i = 0; i < num_nodes; i++) {
+			table->N[i][q] = shape[i](nodes[q]);
+			table->dN[i][q] = derv[i](nodes[q]);
 		}
+	}
+	table->num_points = num_points;
+	table->num_nodes = num_nodes;
+	gsl_integration_fixed_free(w);
+
+}
 
-		gsl_matrix_view submatrix = gsl_matrix_submatrix(K_coeff, starting_point, starting_point, size, size);
-		gsl_vector_view subvector = gsl_vector_subvector(F_const, starting_point, size);
+static void build_quadrature_tables() {
+	double (*L2_shape[2]) (double) = {L2_N0, L2_N1};
+	double (*L2_derv[2]) (double) = {L2_N0_D, L2_N1_D};
+	double (*L3_shape[3]) (double) = {L3_N0, L3_N1, L3_N2};
+	double (*L3_derv[3]) (double) = {L3_N0_D, L3_N1_D, L3_N2_D};
+	double L2_second[2] = {0, 0};
+	double L3_second[3] = {1, -2, 1};
 
-		// Add the local matrices to the views
-		gsl_matrix_add(&submatrix.matrix, coefficient_local);
-		gsl_vector_add(&subvector.vector, constant_local);
+	tabulate_element(&quadrature_tables[LINEAR], 9, 2, L2_shape, L2_derv, L2_second);
+	tabulate_element(&quadrature_tables[QUAD], 10, 3, L3_shape, L3_derv, L3_second);
 
-		// Free up the element-wise arrays
-		gsl_matrix_free(coefficient_local);
-		gsl_vector_free(constant_local);
+}
+
+// NULL if the rule could not be built
+static const struct Quadrature_Table* quadrature_table(Element_2D_Type kind) {
+	pthread_once(&quadrature_once, build_quadrature_tables);
+
+	return (quadrature_tables[kind].num_points > 0) ? &quadrature_tables[kind] : NULL;
+
+}
+
+static const double* element_node_coords(struct Element_Linear* element) {
+	return (element->kind == QUAD) ? element->element.L3.node_coord : element->element.L2.node_coord;
+
+}
 
+// Jacobian at point q of each element in the block
+static inline void block_jacobian(const struct Quadrature_Table* t, int q, int count, const double (*restrict x)[ELEMENT_BLOCK], double* restrict J) {
+	for (int e = 0; e < count; e++) {
+		J[e] = 0;
+	}
+	for (int i = 0; i < t->num_nodes; i++) {
+		for (int e = 0; e < count; e++) {
+			J[e] += t->dN[i][q]*x[i][e];
+		}
 	}
 
+}
 
-	// Option of whether to output the global matrix and vector
-	// Placed here *before* teh K_coeff matrix is edited in-place by the LU decomposition function
-	if (output_global_arrays) {
-		// Copy the arrays first
-		gsl_matrix* K_coeff_copy = gsl_matrix_calloc(input_mesh->num_nodes, input_mesh->num_nodes);
-		gsl_vector* F_const_copy = gsl_vector_calloc(input_mesh->num_nodes);
+// k[i*num_nodes + j][e] is entry (i, j) of element e's coefficient matrix
+ODE_DISPATCH static void coefficient_kernel(const struct Quadrature_Table* t, int count, const double (*restrict x)[ELEMENT_BLOCK], double a, double b, double (*restrict k)[ELEMENT_BLOCK]) {
+	int n = t->num_nodes;
+	for (int ij = 0; ij < n*n; ij++) {
+		for (int e = 0; e < count; e++) {
+			k[ij][e] = 0;
+		}
+	}
 
-		gsl_vector_memcpy(F_const_copy, F_const);
-		gsl_matrix_memcpy(K_coeff_copy, K_coeff);
+	double J[ELEMENT_BLOCK], inverse_J[ELEMENT_BLOCK];
+	for (int q = 0; q < t->num_points; q++) {
+		block_jacobian(t, q, count, x, J);
+		for (int e = 0; e < count; e++) {
+			inverse_J[e] = 1/J[e];
+		}
 
-		solution->coeff_matrix_global = K_coeff_copy;
-		solution->const_vector_global = F_const_copy;
+		for (int i = 0; i < n; i++) {
+			for (int j = 0; j < n; j++) {
+				// The three terms of coefficient_matrix_composition()
+				double c1 = -1*t->dN[i][q]*t->dN[j][q];
+				double c2 = a*t->N[i][q]*t->dN[j][q];
+				double c3 = b*t->N[i][q]*t->N[j][q];
+				double w = t->weights[q];
+
+				double* restrict k_ij = k[i*n + j];
+				for (int e = 0; e < count; e++) {
+					k_ij[e] += w*(c1*inverse_J[e] + c2 + c3*J[e]);
+				}
+			}
+		}
 	}
-	else {
-		solution->coeff_matrix_global = NULL;
-		solution->const_vector_global = NULL;
+
+}
+
+// The three terms of coefficient_kernel() kept apart, so that k = stiffness + a*convection + b*mass for any constant A and B
+ODE_DISPATCH static void operator_kernel(const struct Quadrature_Table* t, int count, const double (*restrict x)[ELEMENT_BLOCK],
+										 double (*restrict stiffness)[ELEMENT_BLOCK], double (*restrict convection)[ELEMENT_BLOCK], double (*restrict mass)[ELEMENT_BLOCK]) {
+	int n = t->num_nodes;
+	for (int ij = 0; ij < n*n; ij++) {
+		for (int e = 0; e < count; e++) {
+			stiffness[ij][e] = 0;
+			convection[ij][e] = 0;
+			mass[ij][e] = 0;
+		}
 	}
 
-	// Now, prepare the arrays for solving.
-	// Set up the boundary conditions
-	// Constant Vector
-	gsl_vector_set(F_const, 0, d1);
-	gsl_vector_set(F_const, input_mesh->num_nodes - 1, d2);
+	double J[ELEMENT_BLOCK], inverse_J[ELEMENT_BLOCK];
+	for (int q = 0; q < t->num_points; q++) {
+		block_jacobian(t, q, count, x, J);
+		for (int e = 0; e < count; e++) {
+			inverse_J[e] = 1/J[e];
+		}
+
+		for (int i = 0; i < n; i++) {
+			for (int j = 0; j < n; j++) {
+				double w = t->weights[q];
+				double c1 = -1*w*t->dN[i][q]*t->dN[j][q];
+				double c2 = w*t->N[i][q]*t->dN[j][q];
+				double c3 = w*t->N[i][q]*t->N[j][q];
+
+				double* restrict s_ij = stiffness[i*n + j];
+				double* restrict c_ij = convection[i*n + j];
+				double* restrict m_ij = mass[i*n + j];
+				for (int e = 0; e < count; e++) {
+					s_ij[e] += c1*inverse_J[e];
+					c_ij[e] += c2;
+					m_ij[e] += c3*J[e];
+				}
+			}
+		}
+	}
 
-	// Coefficient Matrix
-	gsl_vector_view first_row = gsl_matrix_row(K_coeff, 0);
-	gsl_vector_view last_row = gsl_matrix_row(K_coeff, input_mesh->num_nodes - 1);
-	gsl_vector_set_zero(&first_row.vector);
-	gsl_vector_set_zero(&last_row.vector);
+}
 
-	gsl_matrix_set(K_coeff, 0, 0, 1);
-	gsl_matrix_set(K_coeff, input_mesh->num_nodes - 1, input_mesh->num_nodes - 1, 1);
+// coefficient_kernel() with A and B given at each quadrature point, aq[q*count + e] and bq[q*count + e]
+ODE_DISPATCH static void variable_coefficient_kernel(const struct Quadrature_Table* t, int count, const double (*restrict x)[ELEMENT_BLOCK], const double* restrict aq, const double* restrict bq,
+													 double (*restrict k)[ELEMENT_BLOCK]) {
+	int n = t->num_nodes;
+	for (int ij = 0; ij < n*n; ij++) {
+		for (int e = 0; e < count; e++) {
+			k[ij][e] = 0;
+		}
+	}
 
+	double J[ELEMENT_BLOCK], inverse_J[ELEMENT_BLOCK];
+	for (int q = 0; q < t->num_points; q++) {
+		block_jacobian(t, q, count, x, J);
+		for (int e = 0; e < count; e++) {
+			inverse_J[e] = 1/J[e];
+		}
+		const double* restrict a_row = &aq[q*count];
+		const double* restrict b_row = &bq[q*count];
+
+		for (int i = 0; i < n; i++) {
+			for (int j = 0; j < n; j++) {
+				double w = t->weights[q];
+				double c1 = -1*w*t->dN[i][q]*t->dN[j][q];
+				double c2 = w*t->N[i][q]*t->dN[j][q];
+				double c3 = w*t->N[i][q]*t->N[j][q];
+
+				double* restrict k_ij = k[i*n + j];
+				for (int e = 0; e < count; e++) {
+					k_ij[e] += c1*inverse_J[e] + c2*a_row[e] + c3*b_row[e]*J[e];
+				}
+			}
+		}
+	}
 
-	// With prepared matrix and vector, solve the linear equation [K][y] = [F]
-	// Uisng the LU decomp solver
-	gsl_permutation* perm = gsl_permutation_alloc(input_mesh->num_nodes);
-	gsl_permutation_init(perm);
-	int signum;
-	gsl_linalg_LU_decomp(K_coeff, perm, &signum);
+}
 
-	// Initialize solution vector here
-	gsl_vector* variable_vector = gsl_vector_alloc(input_mesh->num_nodes);
+// y[i][e] = sum over j of k_ij*u[j][e] for element e's coefficient matrix; u and its derivative are interpolated at each point instead of forming k
+ODE_DISPATCH static void apply_kernel(const struct Quadrature_Table* t, int count, const double (*restrict x)[ELEMENT_BLOCK], double a, double b, const double (*restrict u)[ELEMENT_BLOCK], double (*restrict y)[ELEMENT_BLOCK]) {
+	int n = t->num_nodes;
+	for (int i = 0; i < n; i++) {
+		for (int e = 0; e < count; e++) {
+			y[i][e] = 0;
+		}
+	}
 
-	// Solve.
-	gsl_linalg_LU_solve(K_coeff, perm, F_const, variable_vector);
+	double J[ELEMENT_BLOCK], u_q[ELEMENT_BLOCK], du_q[ELEMENT_BLOCK];
+	for (int q = 0; q < t->num_points; q++) {
+		block_jacobian(t, q, count, x, J);
+		for (int e = 0; e < count; e++) {
+			u_q[e] = 0;
+			du_q[e] = 0;
+		}
+		for (int j = 0; j < n; j++) {
+			for (int e = 0; e < count; e++) {
+				u_q[e] += t->N[j][q]*u[j][e];
+				du_q[e] += t->dN[j][q]*u[j][e];
+			}
+		}
 
-	// Pass the now solved variable vector pointer to the Solution output.
-	solution->solution_coeff = variable_vector;
+		for (int i = 0; i < n; i++) {
+			// The three terms of coefficient_matrix_composition(), weighted
+			double c1 = -1*t->weights[q]*t->dN[i][q];
+			double c2 = a*t->weights[q]*t->N[i][q];
+			double c3 = b*t->weights[q]*t->N[i][q];
 
-	gsl_permutation_free(perm);
-	gsl_matrix_free(K_coeff);
-	gsl_vector_free(F_const);
+			double* restrict y_i = y[i];
+			for (int e = 0; e < count; e++) {
+				y_i[e] += c1*du_q[e]/J[e] + c2*du_q[e] + c3*u_q[e]*J[e];
+			}
+		}
+	}
 
+}
+
+/* SUPG stabilization
+ *
+ * Galerkin elements oscillate once the cell Péclet number Pe = |A| h/2 (h the node spacing) is above 1.
+ * Streamline-upwind Petrov-Galerkin adds the element residual y'' + A y' + B y - f, tested against -tau*A*w', to each element's equations:
+ * the A^2 part is diffusion along the flow that removes the oscillations, and because the residual of the exact solution vanishes the scheme stays consistent.
+ * With tau = h/(2|A|)(coth Pe - 1/Pe) the nodal values of L2 elements are exact for y'' + A y' = 0.
+ */
+static inline double supg_tau(double a, double h) {
+	double abs_a = fabs(a);
+	double pe = abs_a*h/2;
+	if (pe < 1e-3) {
+		// coth Pe - 1/Pe = Pe/3 - Pe^3/45 + ..., which the direct form loses to cancellation
+		return h*h/12*(1 - pe*pe/15);
+	}
+
+	return h/(2*abs_a)*(1/tanh(pe) - 1/pe);
+
+}
+
+// Per-element factors -tau*A of the stabilizing terms
+static inline void block_supg_factors(const struct Quadrature_Table* t, int count, const double (*restrict x)[ELEMENT_BLOCK], double a, double* restrict s) {
+	int n = t->num_nodes;
+	for (int e = 0; e < count; e++) {
+		s[e] = -a*supg_tau(a, (x[n - 1][e] - x[0][e])/(n - 1));
+	}
+
+}
+
+// Adds the SUPG terms of y'' + A y' + B y to the coefficient matrices k[i*num_nodes + j][e] from coefficient_kernel()
+ODE_DISPATCH static void supg_kernel(const struct Quadrature_Table* t, int count, const double (*restrict x)[ELEMENT_BLOCK], double a, double b, double (*restrict k)[ELEMENT_BLOCK]) {
+	int n = t->num_nodes;
+	double s[ELEMENT_BLOCK], dJ[ELEMENT_BLOCK];
+	block_supg_factors(t, count, x, a, s);
+	// The Jacobian of an L3 element is linear when its middle node is off center
+	for (int e = 0; e < count; e++) {
+		dJ[e] = 0;
+	}
+	for (int i = 0; i < n; i++) {
+		for (int e = 0; e < count; e++) {
+			dJ[e] += t->d2N[i]*x[i][e];
+		}
+	}
+
+	double J[ELEMENT_BLOCK];
+	for (int q = 0; q < t->num_points; q++) {
+		block_jacobian(t, q, count, x, J);
+
+		for (int i = 0; i < n; i++) {
+			for (int j = 0; j < n; j++) {
+				// Residual of shape function j (y'' in physical coordinates, A y', B y) against dN_i; the 1/J of dN_i/dx cancels dx = J dzeta
+				double w = t->weights[q]*t->dN[i][q];
+				double d2 = t->d2N[j];
+				double d1 = t->dN[j][q];
+				double c3 = b*t->N[j][q];
+
+				double* restrict k_ij = k[i*n + j];
+				for (int e = 0; e < count; e++) {
+					double inverse_J = 1/J[e];
+					k_ij[e] += s[e]*w*((d2 - dJ[e]*d1*inverse_J)*inverse_J*inverse_J + a*d1*inverse_J + c3);
+				}
+			}
+		}
+	}
+
+}
+
+// Adds the SUPG terms of f to the constant vectors F[i][e] from load_kernel()
+ODE_DISPATCH static void supg_load_kernel(const struct Quadrature_Table* t, int count, const double (*restrict x)[ELEMENT_BLOCK], double a, const double* restrict fq, double (*restrict F)[ELEMENT_BLOCK]) {
+	double s[ELEMENT_BLOCK];
+	block_supg_factors(t, count, x, a, s);
+
+	for (int q = 0; q < t->num_points; q++) {
+		const double* restrict f_row = &fq[q*count];
+		for (int i = 0; i < t->num_nodes; i++) {
+			double w = t->weights[q]*t->dN[i][q];
+			for (int e = 0; e < count; e++) {
+				F[i][e] += s[e]*w*f_row[e];
+			}
+		}
+	}
+
+}
+
+// Physical coordinates of the quadrature points, xq[q*count + e], for one f_eval_batch() call per block
+ODE_DISPATCH static void load_points_kernel(const struct Quadrature_Table* t, int count, const double (*restrict x)[ELEMENT_BLOCK], double* restrict xq) {
+	for (int q = 0; q < t->num_points; q++) {
+		double* restrict row = &xq[q*count];
+		for (int e = 0; e < count; e++) {
+			row[e] = 0;
+		}
+		for (int i = 0; i < t->num_nodes; i++) {
+			for (int e = 0; e < count; e++) {
+				row[e] += x[i][e]*t->N[i][q];
+			}
+		}
+	}
+
+}
+
+// F[i][e] is entry i of element e's constant vector, from f at the quadrature points
+ODE_DISPATCH static void load_kernel(const struct Quadrature_Table* t, int count, const double (*restrict x)[ELEMENT_BLOCK], const double* restrict fq, double (*restrict F)[ELEMENT_BLOCK]) {
+	for (int i = 0; i < t->num_nodes; i++) {
+		for (int e = 0; e < count; e++) {
+			F[i][e] = 0;
+		}
+	}
+
+	double J[ELEMENT_BLOCK];
+	for (int q = 0; q < t->num_points; q++) {
+		block_jacobian(t, q, count, x, J);
+		const double* restrict f_row = &fq[q*count];
+
+		for (int i = 0; i < t->num_nodes; i++) {
+			double N = t->N[i][q];
+			double w = t->weights[q];
+			for (int e = 0; e < count; e++) {
+				F[i][e] += w*(f_row[e]*N*J[e]);
+			}
+		}
+	}
+
+}
+
+// Gathers up to ELEMENT_BLOCK elements of the same kind starting at `first`; returns how many were taken (0 on error)
+static int gather_block(struct Mesh* input_mesh, uint32_t first, double (*x)[ELEMENT_BLOCK], int* starting_points, int* size) {
+	Element_2D_Type kind = input_mesh->elements[first].kind;
+
+	int count = 0;
+	while (count < ELEMENT_BLOCK && first + count < input_mesh->num_elements && input_mesh->elements[first + count].kind == kind) {
+		if (element_block(input_mesh, first + count, &starting_points[count], size)) {
+			return 0;
+		}
+
+		const double* nodes = element_node_coords(&input_mesh->elements[first + count]);
+		for (int i = 0; i < *size; i++) {
+			x[i][count] = nodes[i];
+		}
+		count++;
+	}
+
+	return count;
+
+}
+
+// Block kernel for the load vector of `count` gathered elements, with the SUPG terms for convection A if `supg` is set.
+// Fails if a quadrature point is outside of the field; every caller stops at the first failing block, so the message is printed once
+static int block_constant_vectors(const struct Quadrature_Table* t, int count, const double (*x)[ELEMENT_BLOCK], struct Function_Field *function_field, bool supg, double a, double (*F)[ELEMENT_BLOCK]) {
+	double xq[MAX_QUAD_POINTS*ELEMENT_BLOCK], fq[MAX_QUAD_POINTS*ELEMENT_BLOCK];
+
+	load_points_kernel(t, count, x, xq);
+	int status = f_eval_batch(function_field, xq, t->num_points*count, fq);
+	if (status) {
+		printf("Some of the quadrature points are outside of the range given by the field.\n");
+		return 1;
+	}
+	load_kernel(t, count, x, fq, F);
+	if (supg) {
+		supg_load_kernel(t, count, x, a, fq, F);
+	}
+	STATS_COUNT(STATS_QUAD_EVALS, count*t->num_nodes*t->num_points);
+
+	return status;
+
+}
+
+// Coefficient matrices (k[i*nodes + j][e]) and constant vectors (F[i][e]) of `count` elements of the same kind, given their node coordinates (x[i][e])
+int output_element_block(Element_2D_Type kind, int count, const double (*x)[ELEMENT_BLOCK], double a, double b, struct Function_Field *function_field, double (*k)[ELEMENT_BLOCK], double (*F)[ELEMENT_BLOCK]) {
+	const struct Quadrature_Table* t = quadrature_table(kind);
+	if (t == NULL || count < 1 || count > ELEMENT_BLOCK) {
+		return 1;
+	}
+
+	coefficient_kernel(t, count, x, a, b, k);
+	STATS_COUNT(STATS_QUAD_EVALS, count*t->num_nodes*t->num_nodes*t->num_points);
+	if (block_constant_vectors(t, count, x, function_field, false, 0, F)) {
+		return 1;
+	}
+	STATS_COUNT(STATS_ELEMENTS, count);
 
-	// Done.
-	
 	return 0;
 
 }
 
-int output_solution_data(struct Mesh* input_mesh, struct ODE_Solution* input_solution) {
-	// Check if there are coordinates and solution values
-	if (input_mesh->node_coordinates == NULL || input_solution->solution_coeff == NULL) {
-		printf("Either the mesh or solution structure are not fully initialized.\n");
+// Coefficient matrices alone (k[i*nodes + j][e]) of `count` elements of the same kind
+int output_coefficient_block(Element_2D_Type kind, int count, const double (*x)[ELEMENT_BLOCK], double a, double b, double (*k)[ELEMENT_BLOCK]) {
+	const struct Quadrature_Table* t = quadrature_table(kind);
+	if (t == NULL || count < 1 || count > ELEMENT_BLOCK) {
 		return 1;
+	}
 
+	coefficient_kernel(t, count, x, a, b, k);
+	STATS_COUNT(STATS_QUAD_EVALS, count*t->num_nodes*t->num_nodes*t->num_points);
+
+	return 0;
+
+}
+
+// The stiffness, convection and mass parts of the coefficient matrices of `count` elements of the same kind (k = stiffness + a*convection + b*mass),
+// for callers that assemble the same elements with several A and B
+int output_operator_block(Element_2D_Type kind, int count, const double (*x)[ELEMENT_BLOCK], double (*stiffness)[ELEMENT_BLOCK], double (*convection)[ELEMENT_BLOCK], double (*mass)[ELEMENT_BLOCK]) {
+	const struct Quadrature_Table* t = quadrature_table(kind);
+	if (t == NULL || count < 1 || count > ELEMENT_BLOCK) {
+		return 1;
 	}
 
-	// Open the file and prepare to write to it. 
-	FILE *output_file = fopen("solution_output.dat", "w");
+	operator_kernel(t, count, x, stiffness, convection, mass);
+	STATS_COUNT(STATS_QUAD_EVALS, count*t->num_nodes*t->num_nodes*t->num_points);
+
+	return 0;
+
+}
 
-	if (output_file == NULL) {
-		printf("Error in opening the file. Please check.\n");
+// Products y[i][e] of `count` coefficient matrices with the local values u[i][e], integrated without forming the matrices (for matrix-free operators)
+int apply_element_block(Element_2D_Type kind, int count, const double (*x)[ELEMENT_BLOCK], double a, double b, const double (*u)[ELEMENT_BLOCK], double (*y)[ELEMENT_BLOCK]) {
+	const struct Quadrature_Table* t = quadrature_table(kind);
+	if (t == NULL || count < 1 || count > ELEMENT_BLOCK) {
 		return 1;
+	}
+
+	apply_kernel(t, count, x, a, b, u, y);
+	STATS_COUNT(STATS_QUAD_EVALS, count*t->num_nodes*t->num_points);
+
+	return 0;
+
+}
 
+// Quadrature points per element of the kind (0 if its rule could not be built); the per-point arrays of a block of `count` elements hold this many rows of `count`
+int element_quadrature_points(Element_2D_Type kind) {
+	const struct Quadrature_Table* t = quadrature_table(kind);
+
+	return (t != NULL) ? t->num_points : 0;
+
+}
+
+// Physical coordinates of the quadrature points, xq[q*count + e], of `count` elements of the same kind
+// (other nodal values in place of the coordinates are interpolated at the points the same way)
+int output_quadrature_point_block(Element_2D_Type kind, int count, const double (*x)[ELEMENT_BLOCK], double* xq) {
+	const struct Quadrature_Table* t = quadrature_table(kind);
+	if (t == NULL || count < 1 || count > ELEMENT_BLOCK) {
+		return 1;
 	}
 
-	// Print the header first
-	fprintf(output_file, "x\ty\n");
-	for (int i = 0; i < input_mesh->num_nodes; i++) {
-		fprintf(output_file, "%f\t%f\n", input_mesh->node_coordinates[i], gsl_vector_get(input_solution->solution_coeff, i));
+	load_points_kernel(t, count, x, xq);
+
+	return 0;
+
+}
+
+// Coefficient matrices (k[i*nodes + j][e]) of `count` elements of the same kind, with A and B given at their quadrature points (aq[q*count + e])
+int output_variable_coefficient_block(Element_2D_Type kind, int count, const double (*x)[ELEMENT_BLOCK], const double* aq, const double* bq, double (*k)[ELEMENT_BLOCK]) {
+	const struct Quadrature_Table* t = quadrature_table(kind);
+	if (t == NULL || count < 1 || count > ELEMENT_BLOCK) {
+		return 1;
 	}
 
-	fclose(output_file);
+	variable_coefficient_kernel(t, count, x, aq, bq, k);
+	STATS_COUNT(STATS_QUAD_EVALS, count*t->num_nodes*t->num_nodes*t->num_points);
 
 	return 0;
 
 }
 
+// Constant vectors (F[i][e]) of `count` elements of the same kind, from f at their quadrature points (fq[q*count + e])
+int output_load_block(Element_2D_Type kind, int count, const double (*x)[ELEMENT_BLOCK], const double* fq, double (*F)[ELEMENT_BLOCK]) {
+	const struct Quadrature_Table* t = quadrature_table(kind);
+	if (t == NULL || count < 1 || count > ELEMENT_BLOCK) {
+		return 1;
+	}
+
+	load_kernel(t, count, x, fq, F);
+	STATS_COUNT(STATS_QUAD_EVALS, count*t->num_nodes*t->num_points);
+
+	return 0;
 
+}
+
+gsl_vector* output_constant_vector(struct Element_Linear* element, struct Function_Field *function_field) {
+	const struct Quadrature_Table* t = quadrature_table(element->kind);
+	if (t == NULL) {
+		return NULL;
+	}
+
+	double x[MAX_ELEMENT_NODES][ELEMENT_BLOCK], F[MAX_ELEMENT_NODES][ELEMENT_BLOCK];
+	const double* nodes = element_node_coords(element);
+	for (int i = 0; i < t->num_nodes; i++) {
+		x[i][0] = nodes[i];
+	}
+	if (block_constant_vectors(t, 1, (const double (*)[ELEMENT_BLOCK]) x, function_field, false, 0, F)) {
+		return NULL;
+	}
+
+	gsl_vector* v = gsl_vector_alloc(t->num_nodes);
+	STATS_ALLOC(t->num_nodes*sizeof(double));
+	for (int i = 0; i < t->num_nodes; i++) {
+		gsl_vector_set(v, i, F[i][0]);
+	}
+
+	return v;
+
+}
+
+gsl_matrix* output_coefficient_matrix(struct Element_Linear* element, double a, double b) {
+	const struct Quadrature_Table* t = quadrature_table(element->kind);
+	if (t == NULL) {
+		return NULL;
+	}
+
+	double x[MAX_ELEMENT_NODES][ELEMENT_BLOCK], k[MAX_ELEMENT_NODES*MAX_ELEMENT_NODES][ELEMENT_BLOCK];
+	const double* nodes = element_node_coords(element);
+	for (int i = 0; i < t->num_nodes; i++) {
+		x[i][0] = nodes[i];
+	}
+	coefficient_kernel(t, 1, (const double (*)[ELEMENT_BLOCK]) x, a, b, k);
+	STATS_COUNT(STATS_QUAD_EVALS, t->num_nodes*t->num_nodes*t->num_points);
+
+	int n = t->num_nodes;
+	gsl_matrix* m = gsl_matrix_alloc(n, n);
+	STATS_ALLOC(n*n*sizeof(double));
+	for (int i = 0; i < n; i++) {
+		for (int j = 0; j < n; j++) {
+			gsl_matrix_set(m, i, j, k[i*n + j][0]);
+		}
+	}
+
+	return m;
+
+}
+
+int solve_ode_constant(struct Mesh* input_mesh, struct ODE_Solution* solution, double a, double b, double d1, double d2, struct Function_Field *function_field, bool output_global_arrays) {
+	struct Solver_Options options = {0};
+	options.output_global_arrays = output_global_arrays;
+
+	return solve_ode_constant_opts(input_mesh, solution, a, b, d1, d2, function_field, &options);
+
+}
+
+// Band storage of the global coefficient matrix (created here), with the SUPG terms if `supg` is set
+static int assemble_band(struct Mesh* input_mesh, double a, double b, bool supg, struct Band_Matrix* K_coeff) {
+	int bandwidth = mesh_bandwidth(input_mesh);
+	if (create_band_matrix(K_coeff, input_mesh->num_nodes, bandwidth, bandwidth)) {
+		return 1;
+	}
+
+	TRACE_SPAN_START(assembly_span);
+	STATS_HW_START(element_loop);
+	uint32_t e = 0;
+	while (e < input_mesh->num_elements) {
+		double x[MAX_ELEMENT_NODES][ELEMENT_BLOCK], k[MAX_ELEMENT_NODES*MAX_ELEMENT_NODES][ELEMENT_BLOCK];
+		int starting_points[ELEMENT_BLOCK], size;
+		const struct Quadrature_Table* t = quadrature_table(input_mesh->elements[e].kind);
+		int count = gather_block(input_mesh, e, x, starting_points, &size);
+		if (t == NULL || count == 0) {
+			free_band_matrix(K_coeff);
+			return 1;
+		}
+
+		STATS_TIMER_START(kernel_timer);
+		coefficient_kernel(t, count, (const double (*)[ELEMENT_BLOCK]) x, a, b, k);
+		if (supg) {
+			supg_kernel(t, count, (const double (*)[ELEMENT_BLOCK]) x, a, b, k);
+		}
+		STATS_TIMER_STOP(kernel_timer, STATS_LOCAL_KERNELS);
+		STATS_COUNT(STATS_QUAD_EVALS, count*size*size*t->num_points);
+
+		STATS_TIMER_START(scatter_timer);
+		for (int c = 0; c < count; c++) {
+			for (int i = 0; i < size; i++) {
+				for (int j = 0; j < size; j++) {
+					band_matrix_add(K_coeff, starting_points[c] + i, starting_points[c] + j, k[i*size + j][c]);
+				}
+			}
+		}
+		STATS_TIMER_STOP(scatter_timer, STATS_SCATTER);
+
+		STATS_COUNT(STATS_ELEMENTS, count);
+		e += count;
+	}
+	STATS_HW_STOP(element_loop, HW_ELEMENT_LOOP);
+	TRACE_SPAN_STOP(assembly_span, "assemble matrix", "solver");
+
+	return 0;
+
+}
+
+// Global constant vector, with the SUPG terms for convection A if `supg` is set
+static gsl_vector* assemble_load(struct Mesh* input_mesh, struct Function_Field *function_field, bool supg, double a) {
+	gsl_vector* F_const = gsl_vector_calloc(input_mesh->num_nodes);
+	STATS_ALLOC(input_mesh->num_nodes*sizeof(double));
+
+	TRACE_SPAN_START(assembly_span);
+	STATS_HW_START(element_loop);
+	uint32_t e = 0;
+	while (e < input_mesh->num_elements) {
+		double x[MAX_ELEMENT_NODES][ELEMENT_BLOCK], F[MAX_ELEMENT_NODES][ELEMENT_BLOCK];
+		int starting_points[ELEMENT_BLOCK], size;
+		const struct Quadrature_Table* t = quadrature_table(input_mesh->elements[e].kind);
+		int count = gather_block(input_mesh, e, x, starting_points, &size);
+		if (t == NULL || count == 0) {
+			gsl_vector_free(F_const);
+			return NULL;
+		}
+
+		STATS_TIMER_START(kernel_timer);
+		int status = block_constant_vectors(t, count, (const double (*)[ELEMENT_BLOCK]) x, function_field, supg, a, F);
+		STATS_TIMER_STOP(kernel_timer, STATS_LOCAL_KERNELS);
+		if (status) {
+			gsl_vector_free(F_const);
+			return NULL;
+		}
+
+		STATS_TIMER_START(scatter_timer);
+		for (int c = 0; c < count; c++) {
+			for (int i = 0; i < size; i++) {
+				*gsl_vector_ptr(F_const, starting_points[c] + i) += F[i][c];
+			}
+		}
+		STATS_TIMER_STOP(scatter_timer, STATS_SCATTER);
+
+		e += count;
+	}
+	STATS_HW_STOP(element_loop, HW_ELEMENT_LOOP);
+	TRACE_SPAN_STOP(assembly_span, "assemble load vector", "solver");
+
+	return F_const;
+
+}
+
+// Assembles the global coefficient matrix into band storage (created here).
+// The matrix only depends on the mesh and the constants a and b, so it can be reused across field files and boundary values.
+int assemble_coefficient_matrix(struct Mesh* input_mesh, double a, double b, struct Band_Matrix* K_coeff) {
+	return assemble_band(input_mesh, a, b, false, K_coeff);
+
+}
+
+// Assembles the global constant vector; it only depends on the mesh and the function field.
+gsl_vector* assemble_constant_vector(struct Mesh* input_mesh, struct Function_Field *function_field) {
+	return assemble_load(input_mesh, function_field, false, 0);
+
+}
+
+struct Boundary_Spec dirichlet_boundary(double d1, double d2) {
+	struct Boundary_Spec boundary = {{BOUNDARY_DIRICHLET, d1, 0}, {BOUNDARY_DIRICHLET, d2, 0}};
+
+	return boundary;
+
+}
+
+// The weak form leaves -y'(start) in the first equation and +y'(end) in the last one. A Dirichlet end replaces its row with the identity row;
+// Neumann and Robin ends substitute y' = value - alpha*y, which adds alpha*y to the diagonal (and value to the constant vector) with the sign of the end.
+void apply_boundary_matrix(struct Band_Matrix* K_coeff, const struct Boundary_Spec* boundary) {
+	size_t last = K_coeff->size - 1;
+
+	if (boundary->start.type == BOUNDARY_DIRICHLET) {
+		band_matrix_set_row_identity(K_coeff, 0);
+	}
+	else if (boundary->start.type == BOUNDARY_ROBIN) {
+		*band_matrix_ptr(K_coeff, 0, 0) += boundary->start.alpha;
+	}
+
+	if (boundary->end.type == BOUNDARY_DIRICHLET) {
+		band_matrix_set_row_identity(K_coeff, last);
+	}
+	else if (boundary->end.type == BOUNDARY_ROBIN) {
+		*band_matrix_ptr(K_coeff, last, last) -= boundary->end.alpha;
+	}
+
+}
+
+void apply_boundary_vector(gsl_vector* F_const, const struct Boundary_Spec* boundary) {
+	size_t last = F_const->size - 1;
+
+	if (boundary->start.type == BOUNDARY_DIRICHLET) {
+		gsl_vector_set(F_const, 0, boundary->start.value);
+	}
+	else {
+		*gsl_vector_ptr(F_const, 0) += boundary->start.value;
+	}
+
+	if (boundary->end.type == BOUNDARY_DIRICHLET) {
+		gsl_vector_set(F_const, last, boundary->end.value);
+	}
+	else {
+		*gsl_vector_ptr(F_const, last) -= boundary->end.value;
+	}
+
+}
+
+// Assembles the coefficient matrix, replaces the first and last rows with the Dirichlet rows and decomposes it.
+// The result can be reused by solve_ode_factorized() for any constant vector and boundary values.
+int factorize_ode_constant(struct Mesh* input_mesh, double a, double b, struct Band_Matrix* K_lu) {
+	if (assemble_coefficient_matrix(input_mesh, a, b, K_lu)) {
+		return 1;
+	}
+
+	STATS_TIMER_START(bc_timer);
+	TRACE_SPAN_START(bc_span);
+	struct Boundary_Spec boundary = dirichlet_boundary(0, 0);
+	apply_boundary_matrix(K_lu, &boundary);
+	STATS_TIMER_STOP(bc_timer, STATS_BC);
+	TRACE_SPAN_STOP(bc_span, "boundary conditions", "solver");
+
+	if (band_lu_decomp(K_lu)) {
+		free_band_matrix(K_lu);
+		return 1;
+	}
+
+	return 0;
+
+}
+
+// Decomposes a copy of an assembled coefficient matrix with the matrix part of the boundary conditions applied, leaving the assembled matrix for other conditions.
+// The result can be reused by solve_ode_boundary() for any constant vector and any conditions of the same types (and Robin coefficients).
+int factorize_ode_boundary(const struct Band_Matrix* K_coeff, const struct Boundary_Spec* boundary, struct Band_Matrix* K_lu) {
+	if (copy_band_matrix(K_lu, K_coeff)) {
+		return 1;
+	}
+
+	STATS_TIMER_START(bc_timer);
+	TRACE_SPAN_START(bc_span);
+	apply_boundary_matrix(K_lu, boundary);
+	STATS_TIMER_STOP(bc_timer, STATS_BC);
+	TRACE_SPAN_STOP(bc_span, "boundary conditions", "solver");
+
+	if (band_lu_decomp(K_lu)) {
+		free_band_matrix(K_lu);
+		return 1;
+	}
+
+	return 0;
+
+}
+
+// Solves [K][y] = [F] with a matrix from factorize_ode_boundary() (or factorize_ode_constant() for Dirichlet conditions); the solution vector is allocated here.
+gsl_vector* solve_ode_boundary(const struct Band_Matrix* K_lu, const gsl_vector* F_const, const struct Boundary_Spec* boundary) {
+	gsl_vector* variable_vector = gsl_vector_alloc(K_lu->size);
+	STATS_ALLOC(K_lu->size*sizeof(double));
+
+	STATS_TIMER_START(bc_timer);
+	TRACE_SPAN_START(bc_span);
+	gsl_vector_memcpy(variable_vector, F_const);
+	apply_boundary_vector(variable_vector, boundary);
+	STATS_TIMER_STOP(bc_timer, STATS_BC);
+	TRACE_SPAN_STOP(bc_span, "boundary conditions", "solver");
+
+	if (band_lu_solve(K_lu, variable_vector, variable_vector)) {
+		gsl_vector_free(variable_vector);
+		return NULL;
+	}
+
+	return variable_vector;
+
+}
+
+// Solves [K][y] = [F] with a matrix from factorize_ode_constant(); the solution vector is allocated here.
+gsl_vector* solve_ode_factorized(struct Mesh* input_mesh, const struct Band_Matrix* K_lu, const gsl_vector* F_const, double d1, double d2) {
+	if (K_lu->size != input_mesh->num_nodes || F_const->size != input_mesh->num_nodes) {
+		printf("The factorized matrix (%zu) and constant vector (%zu) do not match the %u nodes of the mesh.\n", K_lu->size, F_const->size, input_mesh->num_nodes);
+		return NULL;
+	}
+
+	// Boundary values go in the Dirichlet rows
+	struct Boundary_Spec boundary = dirichlet_boundary(d1, d2);
+
+	return solve_ode_boundary(K_lu, F_const, &boundary);
+
+}
+
+// Solves the periodic problem: the last node is the first one again, so its rows and columns are added to those of node 0,
+// which wraps the band around the ends (see Cyclic_Band_Matrix). The returned vector repeats y(start) at the last node.
+static gsl_vector* solve_periodic(struct Mesh* input_mesh, double a, double b, bool supg, struct Function_Field *function_field) {
+	size_t n = input_mesh->num_nodes;
+	size_t m = n - 1;
+	struct Band_Matrix K_coeff;
+	if (assemble_band(input_mesh, a, b, supg, &K_coeff)) {
+		return NULL;
+	}
+	gsl_vector* F_const = assemble_load(input_mesh, function_field, supg, a);
+	struct Cyclic_Band_Matrix K_cyclic;
+	if (F_const == NULL || create_cyclic_band_matrix(&K_cyclic, m, K_coeff.lower)) {
+		free_band_matrix(&K_coeff);
+		if (F_const != NULL) {
+			gsl_vector_free(F_const);
+		}
+		return NULL;
+	}
+
+	STATS_TIMER_START(bc_timer);
+	TRACE_SPAN_START(bc_span);
+	for (size_t i = 0; i < n; i++) {
+		size_t first_col = (i > (size_t) K_coeff.lower) ? i - K_coeff.lower : 0;
+		size_t last_col = (i + K_coeff.upper < n - 1) ? i + K_coeff.upper : n - 1;
+		for (size_t j = first_col; j <= last_col; j++) {
+			cyclic_band_matrix_add(&K_cyclic, i % m, j % m, *band_matrix_ptr(&K_coeff, i, j));
+		}
+	}
+	*gsl_vector_ptr(F_const, 0) += gsl_vector_get(F_const, m);
+	STATS_TIMER_STOP(bc_timer, STATS_BC);
+	TRACE_SPAN_STOP(bc_span, "boundary conditions", "solver");
+	free_band_matrix(&K_coeff);
+
+	// The first m entries of F_const become the solution
+	gsl_vector_view y = gsl_vector_subvector(F_const, 0, m);
+	if (cyclic_lu_decomp(&K_cyclic) || cyclic_lu_solve(&K_cyclic, &y.vector, &y.vector)) {
+		free_cyclic_band_matrix(&K_cyclic);
+		gsl_vector_free(F_const);
+		return NULL;
+	}
+	gsl_vector_set(F_const, m, gsl_vector_get(F_const, 0));
+	free_cyclic_band_matrix(&K_cyclic);
+
+	return F_const;
+
+}
+
+// Scalar outputs, reduced in a single pass over the mesh and solution
+static int attach_qoi(struct Mesh* input_mesh, struct ODE_Solution* solution, struct Solver_Options* options) {
+	if (options->qoi != NULL) {
+		struct QoI_Result* qoi = malloc(sizeof(struct QoI_Result));
+		if (qoi == NULL || compute_qoi(input_mesh, solution, options->qoi, qoi)) {
+			printf("Error computing the requested quantities of interest.\n");
+			free(qoi);
+			return 1;
+		}
+		solution->qoi = qoi;
+	}
+
+	return 0;
+
+}
+
+// Solves [K][y] = [F] with one of the iterative solvers; F becomes the solution vector
+static int solve_band_iterative(struct Mesh* input_mesh, const struct Band_Matrix* K_coeff, gsl_vector* F_const, struct Solver_Options* options, struct Iterative_Report* report) {
+	size_t n = input_mesh->num_nodes;
+	double tolerance = (options->tolerance > 0) ? options->tolerance : ITERATIVE_DEFAULT_TOLERANCE;
+	double* x = calloc(n, sizeof(double));
+	if (x == NULL) {
+		printf("Error allocating the iterative solution of length %zu.\n", n);
+		return 1;
+	}
+	STATS_ALLOC(n*sizeof(double));
+
+	struct Multigrid mg;
+	bool use_multigrid = (options->linear_solver == SOLVER_MULTIGRID || options->multigrid_preconditioner);
+	if (use_multigrid && create_multigrid(&mg, input_mesh->node_coordinates, K_coeff, options->cycle)) {
+		free(x);
+		return 1;
+	}
+
+	int status;
+	if (options->linear_solver == SOLVER_MULTIGRID) {
+		status = multigrid_solve(&mg, F_const->data, x, tolerance, MULTIGRID_DEFAULT_MAX_CYCLES, report);
+	}
+	else {
+		status = bicgstab_solve(n, krylov_band_operator, (void*) K_coeff, band_matrix_norm_inf(K_coeff), use_multigrid ? multigrid_precondition : NULL, use_multigrid ? &mg : NULL,
+								F_const->data, x, tolerance, KRYLOV_DEFAULT_MAX_ITERATIONS, report);
+	}
+	if (use_multigrid) {
+		free_multigrid(&mg);
+	}
+
+	if (status == 0 && !report->converged) {
+		printf("The iterative solve stopped at a backward error of %.3e after %d iterations (tolerance %.1e).\n", report->residual, report->iterations, tolerance);
+		status = 1;
+	}
+	if (status == 0) {
+		memcpy(F_const->data, x, n*sizeof(double));
+	}
+	free(x);
+
+	return status;
+
+}
+
+// NULL if the options can be used together, or the reason they cannot (see struct Solver_Options)
+const char* validate_solver_options(const struct Solver_Options* options) {
+	bool iterative = (options->linear_solver != SOLVER_BAND_LU);
+	bool matrix_free = (options->linear_solver == SOLVER_MATRIX_FREE);
+
+	if (options->streaming) {
+		if (options->output_global_arrays) {
+			return "The global arrays cannot be output by a streaming solve.";
+		}
+		if (options->mixed_precision || iterative) {
+			return "A streaming solve does not keep the matrix for a mixed-precision or iterative solve.";
+		}
+		if (options->supg) {
+			return "A streaming solve assembles the Galerkin elements only; SUPG needs the assembled band.";
+		}
+		if (options->periodic) {
+			return "A streaming solve eliminates from the first node on; periodic meshes need the cyclic band.";
+		}
+		if (options->boundary != NULL) {
+			return "A streaming solve takes Dirichlet conditions only.";
+		}
+	}
+	if (options->mixed_precision && iterative) {
+		return "A mixed-precision solve uses the band LU; it cannot be combined with an iterative solver.";
+	}
+	if (options->periodic && (options->output_global_arrays || options->mixed_precision || iterative)) {
+		return "A periodic solve uses the cyclic band LU; it does not output the global arrays or combine with a mixed-precision or iterative solve.";
+	}
+	if (options->boundary != NULL) {
+		if (options->periodic) {
+			return "A periodic mesh has no ends for boundary conditions.";
+		}
+		if (matrix_free || options->linear_solver == SOLVER_MULTIGRID || options->multigrid_preconditioner) {
+			return "Neumann and Robin conditions need the assembled band; the matrix-free and multigrid solves only take Dirichlet rows.";
+		}
+	}
+	if (matrix_free && (options->output_global_arrays || options->mixed_precision || options->multigrid_preconditioner || options->supg)) {
+		return "A matrix-free solve does not form the global matrix for output, a mixed-precision solve, a multigrid preconditioner or SUPG.";
+	}
+
+	return NULL;
+
+}
+
+// Error exit of the banded solve once the global arrays may have been copied out
+static int fail_band_solve(struct ODE_Solution* solution, struct Band_Matrix* K_coeff, gsl_vector* F_const) {
+	if (solution->coeff_matrix_global != NULL) {
+		gsl_matrix_free(solution->coeff_matrix_global);
+		solution->coeff_matrix_global = NULL;
+	}
+	if (solution->const_vector_global != NULL) {
+		gsl_vector_free(solution->const_vector_global);
+		solution->const_vector_global = NULL;
+	}
+	free_band_matrix(K_coeff);
+	gsl_vector_free(F_const);
+
+	return 1;
+
+}
+
+static int solve_ode_constant_phases(struct Mesh* input_mesh, struct ODE_Solution* solution, double a, double b, double d1, double d2, struct Function_Field *function_field, struct Solver_Options* options) {
+	bool output_global_arrays = options->output_global_arrays;
+
+	// First, check if the input mesh has valid node and element arrays
+	if (input_mesh->connectivity_grid == NULL || input_mesh->elements == NULL) {
+		printf("ERROR: Provided mesh is not properly loaded with element and node information.\nPlease ensure that the `parse_input_file` function has been called to populate the object, or check for other errors.\n");
+		return 1;
+	}
+
+	const char* invalid = validate_solver_options(options);
+	if (invalid != NULL) {
+		printf("%s\n", invalid);
+		return 1;
+	}
+
+	if (options->streaming) {
+		// The global arrays are never formed
+		solution->coeff_matrix_global = NULL;
+		solution->const_vector_global = NULL;
+		solution->solution_coeff = solve_ode_streaming(input_mesh, a, b, d1, d2, function_field, options->scratch_path);
+		if (solution->solution_coeff == NULL) {
+			return 1;
+		}
+
+		return attach_qoi(input_mesh, solution, options);
+	}
+
+	if (options->periodic) {
+		solution->coeff_matrix_global = NULL;
+		solution->const_vector_global = NULL;
+
+		solution->solution_coeff = solve_periodic(input_mesh, a, b, options->supg, function_field);
+		if (solution->solution_coeff == NULL) {
+			return 1;
+		}
+
+		return attach_qoi(input_mesh, solution, options);
+	}
+
+	// L3 meshes: the middle nodes are eliminated element by element, leaving a tridiagonal system on the vertices
+	if (options->boundary == NULL && !options->no_condensation && !options->mixed_precision && !options->supg && options->linear_solver == SOLVER_BAND_LU && !output_global_arrays && mesh_condensable(input_mesh)) {
+		gsl_vector* condensed = NULL;
+		size_t num_threads = (options->num_threads > 0) ? options->num_threads : 1;
+		int status = solve_ode_condensed(input_mesh, &condensed, a, b, d1, d2, function_field, num_threads);
+		if (status != CONDENSE_FALLBACK) {
+			if (status) {
+				return 1;
+			}
+
+			solution->coeff_matrix_global = NULL;
+			solution->const_vector_global = NULL;
+			solution->solution_coeff = condensed;
+			return attach_qoi(input_mesh, solution, options);
+		}
+	}
+
+	// Matrix-free: only the constant vector is assembled
+	if (options->linear_solver == SOLVER_MATRIX_FREE) {
+		solution->coeff_matrix_global = NULL;
+		solution->const_vector_global = NULL;
+
+		double tolerance = (options->tolerance > 0) ? options->tolerance : ITERATIVE_DEFAULT_TOLERANCE;
+		struct Iterative_Report* report = malloc(sizeof(struct Iterative_Report));
+		if (report == NULL || solve_ode_matrix_free(input_mesh, &solution->solution_coeff, a, b, d1, d2, function_field, tolerance, report)) {
+			free(report);
+			return 1;
+		}
+		solution->iterative = report;
+
+		return attach_qoi(input_mesh, solution, options);
+	}
+
+	// Assemble the global coefficient matrix (banded) and constant vector
+	struct Band_Matrix K_coeff;
+	if (assemble_band(input_mesh, a, b, options->supg, &K_coeff)) {
+		return 1;
+	}
+
+	gsl_vector* F_const = assemble_load(input_mesh, function_field, options->supg, a);
+	if (F_const == NULL) {
+		free_band_matrix(&K_coeff);
+		return 1;
+	}
+
+	// Option of whether to output the global matrix and vector
+	// Placed here *before* the K_coeff matrix is edited in-place by the LU decomposition function
+	if (output_global_arrays) {
+		solution->coeff_matrix_global = band_matrix_to_dense(&K_coeff);
+		solution->const_vector_global = gsl_vector_calloc(input_mesh->num_nodes);
+		if (solution->coeff_matrix_global == NULL || solution->const_vector_global == NULL) {
+			printf("Error allocating the global arrays of %u nodes.\n", input_mesh->num_nodes);
+			return fail_band_solve(solution, &K_coeff, F_const);
+		}
+		gsl_vector_memcpy(solution->const_vector_global, F_const);
+	}
+	else {
+		solution->coeff_matrix_global = NULL;
+		solution->const_vector_global = NULL;
+	}
+
+	// Now, prepare the arrays for solving.
+	// Set up the boundary conditions; only the stored band of the two boundary rows and their constants are touched
+	STATS_TIMER_START(bc_timer);
+	TRACE_SPAN_START(bc_span);
+	struct Boundary_Spec boundary = (options->boundary != NULL) ? *options->boundary : dirichlet_boundary(d1, d2);
+	apply_boundary_vector(F_const, &boundary);
+	apply_boundary_matrix(&K_coeff, &boundary);
+	STATS_TIMER_STOP(bc_timer, STATS_BC);
+	TRACE_SPAN_STOP(bc_span, "boundary conditions", "solver");
+
+	// With prepared matrix and vector, solve the linear equation [K][y] = [F]
+	if (options->linear_solver != SOLVER_BAND_LU) {
+		struct Iterative_Report* report = malloc(sizeof(struct Iterative_Report));
+		if (report == NULL || solve_band_iterative(input_mesh, &K_coeff, F_const, options, report)) {
+			free(report);
+			return fail_band_solve(solution, &K_coeff, F_const);
+		}
+		solution->iterative = report;
+	}
+	else if (options->mixed_precision) {
+		// Single-precision factors, refined against K in double precision; the constant vector becomes the solution vector
+		struct Refinement_Report* report = malloc(sizeof(struct Refinement_Report));
+		if (report == NULL || band_mixed_solve(&K_coeff, F_const, F_const, report)) {
+			free(report);
+			return fail_band_solve(solution, &K_coeff, F_const);
+		}
+		solution->refinement = report;
+	}
+	else {
+		// Using the banded LU decomposition, then solving in place; the constant vector becomes the solution vector
+		if (band_lu_decomp(&K_coeff) || band_lu_solve(&K_coeff, F_const, F_const)) {
+			return fail_band_solve(solution, &K_coeff, F_const);
+		}
+	}
+
+	// Pass the now solved variable vector pointer to the Solution output.
+	solution->solution_coeff = F_const;
+	if (attach_qoi(input_mesh, solution, options)) {
+		solution->solution_coeff = NULL;
+		return fail_band_solve(solution, &K_coeff, F_const);
+	}
+
+	free_band_matrix(&K_coeff);
+
+	// Done.
+	
+	return 0;
+
+}
+
+int solve_ode_constant_opts(struct Mesh* input_mesh, struct ODE_Solution* solution, double a, double b, double d1, double d2, struct Function_Field *function_field, struct Solver_Options* options) {
+	solution->qoi = NULL;
+	solution->stats = NULL;
+	solution->refinement = NULL;
+	solution->iterative = NULL;
+
+	// The solve records into its own struct; a caller that is already collecting (e.g. parse and output times) gets it merged in as well
+	struct Solver_Stats* stats = NULL;
+	struct Solver_Stats* previous = NULL;
+	if (options->collect_stats) {
+		stats = calloc(1, sizeof(struct Solver_Stats));
+		if (stats == NULL) {
+			printf("Error allocating the solver statistics.\n");
+			return 1;
+		}
+		previous = stats_activate(stats);
+	}
+
+	int status = solve_ode_constant_phases(input_mesh, solution, a, b, d1, d2, function_field, options);
+
+	if (stats != NULL) {
+		stats_activate(previous);
+		if (previous != NULL) {
+			stats_merge(previous, stats);
+		}
+
+		if (status == 0) {
+			solution->stats = stats;
+		}
+		else {
+			free(stats);
+		}
+	}
+
+	return status;
+
+}
+
+int output_solution_data(struct Mesh* input_mesh, struct ODE_Solution* input_solution) {
+	// Kept for existing callers; writes the tab-delimited text format to the historical file name.
+	// See output_solution_file() and the Solution_Writer routines for other paths and formats.
+	return output_solution_file(input_mesh, input_solution, "solution_output.dat", WRITER_TEXT);
+
+}
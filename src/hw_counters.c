@@ -0,0 +1,412 @@
+/* Hardware performance counters for the hot regions of the solver
+ *
+ * Each thread opens one perf_event group (cycles, instructions, cache misses, branch misses) the first time it enters a region,
+ * and a region is measured as the difference between two readings of the group.
+ * Where the kernel allows it the counters are read with rdpmc through the mmapped event pages, otherwise with read(), which costs a system call.
+ * The cost of the readings themselves is calibrated when the group is opened and taken off each region and the regions enclosing it.
+ *
+ * When the counters cannot be opened (no PMU in a virtual machine, perf_event_paranoid, not Linux) every reading fails and the reason is reported instead.
+ */
+#include "hw_counters.h"
+
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#define CALIBRATION_RUNS 64
+
+bool hw_counters_requested = false;
+
+static const char* event_names[HW_NUM_EVENTS] = {
+	"cycles",
+	"instructions",
+	"cache_misses",
+	"branch_misses"
+};
+
+static const char* region_names[HW_NUM_REGIONS] = {
+	"element_loop",
+	"f_eval",
+	"factor"
+};
+
+static pthread_mutex_t status_lock = PTHREAD_MUTEX_INITIALIZER;
+static char unavailable_reason[200] = "";
+static bool events_open[HW_NUM_EVENTS] = {false};
+
+static void set_unavailable_reason(const char* reason) {
+	pthread_mutex_lock(&status_lock);
+	if (unavailable_reason[0] == '\0') {
+		snprintf(unavailable_reason, sizeof(unavailable_reason), "%s", reason);
+	}
+	pthread_mutex_unlock(&status_lock);
+
+}
+
+#ifdef __linux__
+
+enum { COUNTERS_UNOPENED, COUNTERS_OPEN, COUNTERS_FAILED };
+
+struct Thread_Counters {
+	int state;
+	int leader; // Group leader (the cycles event)
+	int fds[HW_NUM_EVENTS];
+	struct perf_event_mmap_page* pages[HW_NUM_EVENTS];
+	Hw_Event order[HW_NUM_EVENTS]; // Events in the order they were added to the group, which is the order read() returns them in
+	int num_open;
+	uint64_t self_cost[HW_NUM_EVENTS]; // Counts between the two readings of an empty region
+	uint64_t nested_cost[HW_NUM_EVENTS]; // Counts an empty region adds to the region enclosing it
+	uint64_t regions; // Regions completed by the thread
+
+};
+
+static const uint64_t event_configs[HW_NUM_EVENTS] = {
+	PERF_COUNT_HW_CPU_CYCLES,
+	PERF_COUNT_HW_INSTRUCTIONS,
+	PERF_COUNT_HW_CACHE_MISSES,
+	PERF_COUNT_HW_BRANCH_MISSES
+};
+
+static _Thread_local struct Thread_Counters thread_counters = {COUNTERS_UNOPENED};
+static pthread_key_t cleanup_key;
+static pthread_once_t cleanup_once = PTHREAD_ONCE_INIT;
+
+// Closes a thread's counters when it exits
+static void close_thread_counters(void* arg) {
+	struct Thread_Counters* tc = arg;
+	long page_size = sysconf(_SC_PAGESIZE);
+
+	for (int e = 0; e < HW_NUM_EVENTS; e++) {
+		if (tc->pages[e] != NULL) {
+			munmap(tc->pages[e], page_size);
+			tc->pages[e] = NULL;
+		}
+		if (tc->fds[e] >= 0) {
+			close(tc->fds[e]);
+			tc->fds[e] = -1;
+		}
+	}
+	tc->state = COUNTERS_FAILED;
+
+}
+
+static void create_cleanup_key() {
+	pthread_key_create(&cleanup_key, close_thread_counters);
+
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+static inline uint64_t read_pmc(uint32_t counter) {
+	uint32_t low, high;
+	__asm__ volatile("rdpmc" : "=a" (low), "=d" (high) : "c" (counter));
+
+	return low | ((uint64_t) high << 32);
+
+}
+
+// Reads the group from user space; fails if any event is not currently on a counter or the kernel does not allow rdpmc
+static bool read_user(const struct Thread_Counters* tc, uint64_t* values) {
+	for (int i = 0; i < tc->num_open; i++) {
+		Hw_Event e = tc->order[i];
+		volatile struct perf_event_mmap_page* page = tc->pages[e];
+		if (page == NULL) {
+			return false;
+		}
+
+		uint32_t sequence;
+		uint64_t count;
+		do {
+			sequence = page->lock;
+			__atomic_signal_fence(__ATOMIC_SEQ_CST);
+
+			uint32_t index = page->index;
+			if (!page->cap_user_rdpmc || index == 0 || page->pmc_width == 0) {
+				return false;
+			}
+
+			// The hardware counter is pmc_width bits wide and is sign-extended before adding the kernel's offset
+			int shift = 64 - page->pmc_width;
+			int64_t pmc = (int64_t) (read_pmc(index - 1) << shift) >> shift;
+			count = page->offset + pmc;
+
+			__atomic_signal_fence(__ATOMIC_SEQ_CST);
+		} while (page->lock != sequence);
+
+		values[e] = count;
+	}
+
+	return true;
+
+}
+#else
+static bool read_user(const struct Thread_Counters* tc, uint64_t* values) {
+	(void) tc;
+	(void) values;
+
+	return false;
+
+}
+#endif
+
+// Reads the group with a system call, scaling the counts if the group was multiplexed
+static bool read_group(const struct Thread_Counters* tc, uint64_t* values) {
+	uint64_t buffer[3 + HW_NUM_EVENTS];
+	ssize_t expected = (3 + tc->num_open)*sizeof(uint64_t);
+	if (read(tc->leader, buffer, sizeof(buffer)) < expected) {
+		return false;
+	}
+
+	uint64_t enabled = buffer[1];
+	uint64_t running = buffer[2];
+	if (running == 0) {
+		return false;
+	}
+
+	for (int i = 0; i < tc->num_open; i++) {
+		uint64_t value = buffer[3 + i];
+		if (running < enabled) {
+			value = (uint64_t) ((double) value*enabled/running);
+		}
+		values[tc->order[i]] = value;
+	}
+
+	return true;
+
+}
+
+static inline bool read_counters(const struct Thread_Counters* tc, uint64_t* values) {
+	return read_user(tc, values) || read_group(tc, values);
+
+}
+
+static int perf_event_open(struct perf_event_attr* attr, int group_fd) {
+	return syscall(SYS_perf_event_open, attr, 0, -1, group_fd, 0);
+
+}
+
+static void calibrate(struct Thread_Counters* tc) {
+	uint64_t outer_totals[HW_NUM_EVENTS], inner_totals[HW_NUM_EVENTS];
+
+	for (int e = 0; e < HW_NUM_EVENTS; e++) {
+		tc->self_cost[e] = 0;
+		tc->nested_cost[e] = 0;
+	}
+
+	// Minimum over a number of runs of an empty region, and of a region holding only an empty region
+	uint64_t self_cost[HW_NUM_EVENTS], outer_cost[HW_NUM_EVENTS];
+	for (int e = 0; e < HW_NUM_EVENTS; e++) {
+		self_cost[e] = UINT64_MAX;
+		outer_cost[e] = UINT64_MAX;
+	}
+
+	for (int run = 0; run < CALIBRATION_RUNS; run++) {
+		struct Hw_Snapshot outer, inner;
+		memset(outer_totals, 0, sizeof(outer_totals));
+		memset(inner_totals, 0, sizeof(inner_totals));
+
+		if (!hw_counters_read(&outer) || !hw_counters_read(&inner) ||
+		    !hw_counters_accumulate(&inner, inner_totals) || !hw_counters_accumulate(&outer, outer_totals)) {
+			break;
+		}
+
+		for (int e = 0; e < HW_NUM_EVENTS; e++) {
+			if (inner_totals[e] < self_cost[e]) {
+				self_cost[e] = inner_totals[e];
+			}
+			if (outer_totals[e] < outer_cost[e]) {
+				outer_cost[e] = outer_totals[e];
+			}
+		}
+	}
+
+	for (int e = 0; e < HW_NUM_EVENTS; e++) {
+		if (outer_cost[e] == UINT64_MAX) {
+			continue;
+		}
+		tc->self_cost[e] = self_cost[e];
+		tc->nested_cost[e] = (outer_cost[e] > self_cost[e]) ? outer_cost[e] - self_cost[e] : 0;
+	}
+	tc->regions = 0;
+
+}
+
+static int open_thread_counters(struct Thread_Counters* tc) {
+	tc->state = COUNTERS_FAILED;
+	tc->leader = -1;
+	tc->num_open = 0;
+	for (int e = 0; e < HW_NUM_EVENTS; e++) {
+		tc->fds[e] = -1;
+		tc->pages[e] = NULL;
+	}
+
+	long page_size = sysconf(_SC_PAGESIZE);
+	for (int e = 0; e < HW_NUM_EVENTS; e++) {
+		struct perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.size = sizeof(attr);
+		attr.config = event_configs[e];
+		attr.disabled = (tc->leader < 0);
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		int fd = perf_event_open(&attr, tc->leader);
+		if (fd < 0) {
+			if (tc->leader < 0) {
+				// Without cycles there is nothing to report
+				char reason[200];
+				snprintf(reason, sizeof(reason), "perf_event_open failed for %s: %s", event_names[e], strerror(errno));
+				set_unavailable_reason(reason);
+				return 1;
+			}
+			continue;
+		}
+
+		if (tc->leader < 0) {
+			tc->leader = fd;
+		}
+		tc->fds[e] = fd;
+		tc->order[tc->num_open++] = e;
+
+		void* page = mmap(NULL, page_size, PROT_READ, MAP_SHARED, fd, 0);
+		tc->pages[e] = (page == MAP_FAILED) ? NULL : page;
+	}
+
+	pthread_once(&cleanup_once, create_cleanup_key);
+	pthread_setspecific(cleanup_key, tc);
+
+	ioctl(tc->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	if (ioctl(tc->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) != 0) {
+		char reason[200];
+		snprintf(reason, sizeof(reason), "could not enable the counters: %s", strerror(errno));
+		set_unavailable_reason(reason);
+		close_thread_counters(tc);
+		return 1;
+	}
+
+	pthread_mutex_lock(&status_lock);
+	for (int i = 0; i < tc->num_open; i++) {
+		events_open[tc->order[i]] = true;
+	}
+	pthread_mutex_unlock(&status_lock);
+
+	tc->state = COUNTERS_OPEN;
+	calibrate(tc);
+
+	return 0;
+
+}
+
+static struct Thread_Counters* get_thread_counters() {
+	struct Thread_Counters* tc = &thread_counters;
+	if (tc->state == COUNTERS_UNOPENED) {
+		open_thread_counters(tc);
+	}
+
+	return (tc->state == COUNTERS_OPEN) ? tc : NULL;
+
+}
+
+bool hw_counters_read(struct Hw_Snapshot* snapshot) {
+	struct Thread_Counters* tc = get_thread_counters();
+	if (tc == NULL || !read_counters(tc, snapshot->values)) {
+		return false;
+	}
+	snapshot->nested = tc->regions;
+
+	return true;
+
+}
+
+// Adds the counts since `begin` to `totals`, less the cost of this region's readings and of the regions nested in it
+bool hw_counters_accumulate(const struct Hw_Snapshot* begin, uint64_t* totals) {
+	struct Thread_Counters* tc = get_thread_counters();
+	uint64_t now[HW_NUM_EVENTS];
+	if (tc == NULL || !read_counters(tc, now)) {
+		return false;
+	}
+
+	uint64_t nested = tc->regions - begin->nested;
+	for (int i = 0; i < tc->num_open; i++) {
+		Hw_Event e = tc->order[i];
+		uint64_t delta = now[e] - begin->values[e];
+		uint64_t cost = tc->self_cost[e] + nested*tc->nested_cost[e];
+		totals[e] += (delta > cost) ? delta - cost : 0;
+	}
+	tc->regions++;
+
+	return true;
+
+}
+
+#else
+
+bool hw_counters_read(struct Hw_Snapshot* snapshot) {
+	(void) snapshot;
+	set_unavailable_reason("perf_event_open is only available on Linux");
+
+	return false;
+
+}
+
+bool hw_counters_accumulate(const struct Hw_Snapshot* begin, uint64_t* totals) {
+	(void) begin;
+	(void) totals;
+
+	return false;
+
+}
+
+#endif
+
+// Turns the measurements on and opens the calling thread's counters; returns 1 (the solver still runs) if they are unavailable
+int hw_counters_enable() {
+	hw_counters_requested = true;
+
+	struct Hw_Snapshot snapshot;
+	return hw_counters_read(&snapshot) ? 0 : 1;
+
+}
+
+// NULL once the counters have been opened by some thread
+const char* hw_counters_unavailable_reason() {
+	bool any_open = false;
+	for (int e = 0; e < HW_NUM_EVENTS; e++) {
+		any_open = any_open || hw_event_available(e);
+	}
+
+	if (any_open) {
+		return NULL;
+	}
+
+	return (unavailable_reason[0] != '\0') ? unavailable_reason : "the hardware counters were not enabled";
+
+}
+
+bool hw_event_available(Hw_Event event) {
+	pthread_mutex_lock(&status_lock);
+	bool available = events_open[event];
+	pthread_mutex_unlock(&status_lock);
+
+	return available;
+
+}
+
+const char* hw_event_name(Hw_Event event) {
+	return event_names[event];
+
+}
+
+const char* hw_region_name(Hw_Region region) {
+	return region_names[region];
+
+}
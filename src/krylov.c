@@ -0,0 +1,149 @@
+/* Preconditioned BiCGSTAB
+ *
+ * The coefficient matrix is not symmetric once the equation has a first-derivative term, so CG does not apply.
+ * BiCGSTAB only needs the operator and the preconditioner as callbacks, so the same routine works on an assembled band matrix,
+ * a matrix-free operator, and with or without a multigrid cycle as the preconditioner.
+ * The preconditioner is applied on the right, so the residual that is checked is that of the original system.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "krylov.h"
+#include "band_matrix.h"
+#include "solver_stats.h"
+#include "trace.h"
+
+void krylov_band_operator(void* matrix, const double* x, double* y) {
+	band_matrix_apply((const struct Band_Matrix*) matrix, x, y);
+
+}
+
+static double dot(const double* x, const double* y, size_t n) {
+	double sum = 0;
+	for (size_t i = 0; i < n; i++) {
+		sum += x[i]*y[i];
+	}
+
+	return sum;
+
+}
+
+static double norm_inf(const double* x, size_t n) {
+	double norm = 0;
+	for (size_t i = 0; i < n; i++) {
+		norm = fmax(norm, fabs(x[i]));
+	}
+
+	return norm;
+
+}
+
+// ||r||/(||A||*||x|| + ||b||) for the residual r = b - A x; an operator_norm of 0 reduces it to ||r||/||b||
+double backward_error(const double* r, const double* x, const double* b, size_t n, double operator_norm) {
+	double scale = operator_norm*norm_inf(x, n) + norm_inf(b, n);
+
+	return norm_inf(r, n)/((scale > 0) ? scale : 1);
+
+}
+
+static void precondition_or_copy(Krylov_Preconditioner precondition, void* context, const double* r, double* z, size_t n) {
+	if (precondition != NULL) {
+		precondition(context, r, z);
+	}
+	else {
+		memcpy(z, r, n*sizeof(double));
+	}
+
+}
+
+// Solves A x = b starting from the x passed in; operator_norm is ||A|| (infinity norm) for the stopping test, or 0 if it is not known.
+// Returns 1 if the work vectors cannot be allocated; a solve that does not converge returns 0 with report->converged unset.
+int bicgstab_solve(size_t n, Krylov_Operator apply, void* operator_context, double operator_norm, Krylov_Preconditioner precondition, void* preconditioner_context,
+				   const double* b, double* x, double tolerance, int max_iterations, struct Iterative_Report* report) {
+	double* work = malloc(8*n*sizeof(double));
+	if (work == NULL) {
+		printf("Error allocating the BiCGSTAB vectors of length %zu.\n", n);
+		return 1;
+	}
+	STATS_ALLOC(8*n*sizeof(double));
+	double* r = work;
+	double* r_hat = work + n;
+	double* p = work + 2*n;
+	double* v = work + 3*n;
+	double* s = work + 4*n;
+	double* t = work + 5*n;
+	double* p_hat = work + 6*n;
+	double* s_hat = work + 7*n;
+
+	STATS_TIMER_START(solve_timer);
+	TRACE_SPAN_START(solve_span);
+
+	apply(operator_context, x, r);
+	for (size_t i = 0; i < n; i++) {
+		r[i] = b[i] - r[i];
+	}
+	memcpy(r_hat, r, n*sizeof(double));
+	memset(p, 0, n*sizeof(double));
+	memset(v, 0, n*sizeof(double));
+
+	double rho = 1, alpha = 1, omega = 1;
+
+	report->iterations = 0;
+	report->residual = backward_error(r, x, b, n, operator_norm);
+	report->converged = (report->residual <= tolerance);
+
+	while (!report->converged && report->iterations < max_iterations) {
+		double rho_next = dot(r_hat, r, n);
+		if (rho_next == 0 || omega == 0) {
+			// Breakdown; the residual is as good as it gets
+			break;
+		}
+
+		double beta = (rho_next/rho)*(alpha/omega);
+		for (size_t i = 0; i < n; i++) {
+			p[i] = r[i] + beta*(p[i] - omega*v[i]);
+		}
+		precondition_or_copy(precondition, preconditioner_context, p, p_hat, n);
+		apply(operator_context, p_hat, v);
+
+		alpha = rho_next/dot(r_hat, v, n);
+		for (size_t i = 0; i < n; i++) {
+			s[i] = r[i] - alpha*v[i];
+			t[i] = x[i] + alpha*p_hat[i];
+		}
+		report->iterations++;
+
+		// The half step may already be good enough
+		double half_step_error = backward_error(s, t, b, n, operator_norm);
+		if (half_step_error <= tolerance) {
+			memcpy(x, t, n*sizeof(double));
+			report->residual = half_step_error;
+			report->converged = true;
+			break;
+		}
+
+		precondition_or_copy(precondition, preconditioner_context, s, s_hat, n);
+		apply(operator_context, s_hat, t);
+		double t_t = dot(t, t, n);
+		omega = (t_t > 0) ? dot(t, s, n)/t_t : 0;
+
+		for (size_t i = 0; i < n; i++) {
+			x[i] += alpha*p_hat[i] + omega*s_hat[i];
+			r[i] = s[i] - omega*t[i];
+		}
+		rho = rho_next;
+
+		report->residual = backward_error(r, x, b, n, operator_norm);
+		report->converged = (report->residual <= tolerance);
+	}
+
+	STATS_COUNT(STATS_ITERATIONS, report->iterations);
+	STATS_TIMER_STOP(solve_timer, STATS_SOLVE);
+	TRACE_SPAN_STOP(solve_span, "bicgstab", "solver");
+	free(work);
+
+	return 0;
+
+}
@@ -0,0 +1,737 @@
+/* Command-line front end for the ODE solver
+ *
+ *	solver.out [A] [B] [d1] [d2] [function field file] [start] [end] [number of elements] [--streaming scratch file | - | --mixed-precision | --solver name | --adaptive tolerance | --order p] [--stats json [--hw-counters]]
+ *	solver.out --serve [socket path | -] [--threads N] [--cache-entries N]
+ *	solver.out --batch [manifest] [--threads N] [--output file] [--format binary|text|columnar] [--stats json [--hw-counters]]
+ *
+ * Any of them also takes `--trace [file]` to write a trace-event timeline of the run when it exits, and a single solve also takes `--supg` (stabilized elements for large A).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fe_section.h"
+#include "function_field.h"
+#include "solver_server.h"
+#include "batch.h"
+#include "trace.h"
+#include "streaming_solver.h"
+#include "solution_writer.h"
+#include "band_matrix.h"
+#include "adaptive.h"
+#include "variable_coefficients.h"
+#include "p_elements.h"
+
+static void print_usage() {
+	printf("Usage:\n");
+	printf("\tsolver.out [A] [B] [d1] [d2] [function field file] [start] [end] [number of elements] [--streaming scratch file | - | --mixed-precision | --solver name | --adaptive tolerance | --order p] [--stats json [--hw-counters]]\n");
+	printf("\tsolver.out --serve [socket path | -] [--threads N] [--cache-entries N]\n");
+	printf("\tsolver.out --batch [manifest] [--threads N] [--output file] [--format binary|text|columnar] [--stats json [--hw-counters]]\n");
+	printf("Add --trace [file] to any of these to write a Chrome/Perfetto timeline of the run to the file when it exits.\n");
+	printf("Add --a-field file and/or --b-field file to a single solve to read A(x) and B(x) from field files instead of the constants.\n");
+	printf("Add --supg to a single banded solve to stabilize it against the oscillations of convection-dominated A (cell Peclet number |A|h/2 above 1).\n");
+	printf("Add --periodic to a single banded solve to make y and y' periodic over [start, end] instead of taking d1 and d2.\n");
+	printf("Add --bc start end to a single banded solve to choose the condition at each end: dirichlet (y = d), neumann (y' = d) or robin:alpha (y' + alpha y = d), with d1 and d2 as the values.\n");
+	printf("Solvers for --solver: lu (the default), multigrid-v, multigrid-w, multigrid-f, bicgstab, bicgstab-mg and matrix-free.\n");
+	printf("--order p (1 to %d) solves with hierarchical p-elements of that order; --adaptive tolerance refines the mesh until the estimated error reaches it;\n"
+		   "both together start from elements of order p and raise orders or split elements (hp-refinement) until the error estimate reaches the tolerance.\n", P_MAX_ORDER);
+
+}
+
+// Mesh file in the format read by parse_input_file(); kept for debugging and tracking purposes
+static int output_mesh_file(struct Mesh* mesh, const char* path) {
+	FILE* mesh_file = fopen(path, "w");
+	if (mesh_file == NULL) {
+		printf("Could not open %s for writing.\n", path);
+		return 1;
+	}
+
+	fprintf(mesh_file, "%u\n", mesh->num_nodes);
+	for (uint32_t i = 0; i < mesh->num_nodes; i++) {
+		fprintf(mesh_file, "%.17g\n", mesh->node_coordinates[i]);
+	}
+	fclose(mesh_file);
+
+	return 0;
+
+}
+
+// Index of `name` in the arguments, or 0 if it is not there
+static int find_flag(int argc, char** argv, const char* name) {
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], name) == 0) {
+			return i;
+		}
+	}
+
+	return 0;
+
+}
+
+// Removes the `k` arguments starting at argv[i]
+static void remove_args(int* argc, char** argv, int i, int k) {
+	for (int j = i; j + k < *argc; j++) {
+		argv[j] = argv[j + k];
+	}
+	*argc -= k;
+
+}
+
+// Removes `--stats json [--hw-counters]` from anywhere in the arguments; returns 1 if it was there, 2 with the hardware counters and -1 if it was malformed
+static int extract_stats_flag(int* argc, char** argv) {
+	int i = find_flag(*argc, argv, "--stats");
+	if (i == 0) {
+		return 0;
+	}
+
+	if (i + 1 >= *argc || strcmp(argv[i + 1], "json") != 0) {
+		return -1;
+	}
+	bool hw_counters = (i + 2 < *argc && strcmp(argv[i + 2], "--hw-counters") == 0);
+	remove_args(argc, argv, i, hw_counters ? 3 : 2);
+
+	return hw_counters ? 2 : 1;
+
+}
+
+// Removes `--trace file` from anywhere in the arguments and starts tracing; returns -1 if the file is missing
+static int extract_trace_flag(int* argc, char** argv) {
+	int i = find_flag(*argc, argv, "--trace");
+	if (i == 0) {
+		return 0;
+	}
+
+	if (i + 1 >= *argc || trace_start(argv[i + 1], 0)) {
+		return -1;
+	}
+	remove_args(argc, argv, i, 2);
+
+	return 1;
+
+}
+
+// Removes `--streaming file` from anywhere in the arguments; `-` keeps the back-substitution data in memory
+static int extract_streaming_flag(int* argc, char** argv, const char** scratch_path) {
+	int i = find_flag(*argc, argv, "--streaming");
+	if (i == 0) {
+		return 0;
+	}
+
+	if (i + 1 >= *argc) {
+		return -1;
+	}
+	*scratch_path = (strcmp(argv[i + 1], "-") == 0) ? NULL : argv[i + 1];
+	remove_args(argc, argv, i, 2);
+
+	return 1;
+
+}
+
+// Removes `name path` (e.g. `--a-field file`) from anywhere in the arguments; returns -1 if the path is missing
+static int extract_path_flag(int* argc, char** argv, const char* name, const char** path) {
+	int i = find_flag(*argc, argv, name);
+	if (i == 0) {
+		return 0;
+	}
+
+	if (i + 1 >= *argc) {
+		return -1;
+	}
+	*path = argv[i + 1];
+	remove_args(argc, argv, i, 2);
+
+	return 1;
+
+}
+
+// dirichlet, neumann or robin:alpha
+static int parse_boundary_type(const char* text, struct Boundary_Condition* condition) {
+	condition->alpha = 0;
+	if (strcmp(text, "dirichlet") == 0) {
+		condition->type = BOUNDARY_DIRICHLET;
+	}
+	else if (strcmp(text, "neumann") == 0) {
+		condition->type = BOUNDARY_NEUMANN;
+	}
+	else if (strncmp(text, "robin:", 6) == 0 && text[6] != '\0') {
+		char* rest;
+		condition->type = BOUNDARY_ROBIN;
+		condition->alpha = strtod(&text[6], &rest);
+		if (*rest != '\0') {
+			return 1;
+		}
+	}
+	else {
+		return 1;
+	}
+
+	return 0;
+
+}
+
+// Removes `--bc start end` from anywhere in the arguments; the values are filled in from d1 and d2 later. Returns -1 if a type is missing or unknown
+static int extract_boundary_flag(int* argc, char** argv, struct Boundary_Spec* boundary) {
+	int i = find_flag(*argc, argv, "--bc");
+	if (i == 0) {
+		return 0;
+	}
+
+	if (i + 2 >= *argc || parse_boundary_type(argv[i + 1], &boundary->start) || parse_boundary_type(argv[i + 2], &boundary->end)) {
+		return -1;
+	}
+	remove_args(argc, argv, i, 3);
+
+	return 1;
+
+}
+
+// Removes `--adaptive tolerance` from anywhere in the arguments; returns -1 if the tolerance is missing or not positive
+static int extract_adaptive_flag(int* argc, char** argv, double* tolerance) {
+	int i = find_flag(*argc, argv, "--adaptive");
+	if (i == 0) {
+		return 0;
+	}
+
+	if (i + 1 >= *argc || (*tolerance = atof(argv[i + 1])) <= 0) {
+		return -1;
+	}
+	remove_args(argc, argv, i, 2);
+
+	return 1;
+
+}
+
+// Removes `--order p` from anywhere in the arguments; returns -1 if p is missing or out of range
+static int extract_order_flag(int* argc, char** argv, int* order) {
+	int i = find_flag(*argc, argv, "--order");
+	if (i == 0) {
+		return 0;
+	}
+
+	if (i + 1 >= *argc || (*order = atoi(argv[i + 1])) < 1 || *order > P_MAX_ORDER) {
+		return -1;
+	}
+	remove_args(argc, argv, i, 2);
+
+	return 1;
+
+}
+
+// Removes a switch such as `--mixed-precision` from anywhere in the arguments; returns whether it was there
+static int extract_switch(int* argc, char** argv, const char* name) {
+	int i = find_flag(*argc, argv, name);
+	if (i == 0) {
+		return 0;
+	}
+
+	remove_args(argc, argv, i, 1);
+
+	return 1;
+
+}
+
+// Removes `--solver name` from anywhere in the arguments and sets the iterative solver it names; returns -1 for an unknown name
+static int extract_solver_flag(int* argc, char** argv, struct Solver_Options* options) {
+	int i = find_flag(*argc, argv, "--solver");
+	if (i == 0) {
+		return 0;
+	}
+	if (i + 1 >= *argc) {
+		return -1;
+	}
+
+	const char* name = argv[i + 1];
+	if (strcmp(name, "lu") == 0) {
+		options->linear_solver = SOLVER_BAND_LU;
+	}
+	else if (strncmp(name, "multigrid-", 10) == 0 && strlen(name) == 11 && strchr("vwf", name[10]) != NULL) {
+		options->linear_solver = SOLVER_MULTIGRID;
+		options->cycle = (name[10] == 'v') ? MULTIGRID_V_CYCLE : (name[10] == 'w') ? MULTIGRID_W_CYCLE : MULTIGRID_F_CYCLE;
+	}
+	else if (strcmp(name, "bicgstab") == 0 || strcmp(name, "bicgstab-mg") == 0) {
+		options->linear_solver = SOLVER_BICGSTAB;
+		options->multigrid_preconditioner = (strcmp(name, "bicgstab-mg") == 0);
+	}
+	else if (strcmp(name, "matrix-free") == 0) {
+		options->linear_solver = SOLVER_MATRIX_FREE;
+	}
+	else {
+		return -1;
+	}
+	remove_args(argc, argv, i, 2);
+
+	return 1;
+
+}
+
+static int load_field_file(struct Function_Field* field, const char* path) {
+	FILE* field_file = fopen(path, "r");
+	if (field_file == NULL) {
+		printf("Could not open the function field file %s.\n", path);
+		return 1;
+	}
+
+	int status = input_function_field(field, field_file);
+	fclose(field_file);
+
+	return status;
+
+}
+
+// Rows handed to the solution writer at a time by a streaming solve
+#define STREAMING_OUTPUT_ROWS 65536
+
+// The uniform mesh of a single solve, without ever holding it in memory; the nodes are generated again for each pass
+static int run_streaming_solve(double a, double b, double d1, double d2, struct Function_Field* field, double start, double end, int num_elements, const char* scratch_path) {
+	struct Node_Stream nodes;
+	if (open_node_stream_uniform(&nodes, start, end, num_elements, LINEAR)) {
+		return 1;
+	}
+
+	FILE* mesh_file = fopen("input_mesh.in", "w");
+	if (mesh_file == NULL) {
+		printf("Could not open input_mesh.in for writing.\n");
+		return 1;
+	}
+	fprintf(mesh_file, "%u\n", nodes.num_nodes);
+	for (uint32_t i = 0; i < nodes.num_nodes; i++) {
+		double x;
+		next_node(&nodes, &x);
+		fprintf(mesh_file, "%.17g\n", x);
+	}
+	fclose(mesh_file);
+
+	open_node_stream_uniform(&nodes, start, end, num_elements, LINEAR);
+	gsl_vector* solution = solve_ode_streaming_nodes(&nodes, LINEAR, a, b, d1, d2, field, scratch_path);
+	if (solution == NULL) {
+		return 1;
+	}
+
+	STATS_TIMER_START(output_timer);
+	struct Solution_Writer writer;
+	if (open_solution_writer(&writer, "solution_output.dat", WRITER_TEXT)) {
+		gsl_vector_free(solution);
+		return 1;
+	}
+
+	open_node_stream_uniform(&nodes, start, end, num_elements, LINEAR);
+	double* x_values = malloc(STREAMING_OUTPUT_ROWS*sizeof(double));
+	int status = (x_values == NULL);
+	for (uint32_t first = 0; first < nodes.num_nodes && status == 0; first += STREAMING_OUTPUT_ROWS) {
+		size_t count = (nodes.num_nodes - first < STREAMING_OUTPUT_ROWS) ? nodes.num_nodes - first : STREAMING_OUTPUT_ROWS;
+		for (size_t i = 0; i < count; i++) {
+			next_node(&nodes, &x_values[i]);
+		}
+		status = submit_solution_values(&writer, x_values, &solution->data[first], count, WRITER_NO_INDEX);
+	}
+	if (close_solution_writer(&writer)) {
+		status = 1;
+	}
+	STATS_TIMER_STOP(output_timer, STATS_OUTPUT);
+
+	free(x_values);
+	gsl_vector_free(solution);
+
+	return status;
+
+}
+
+// Uniform mesh of elements of the given order, refined in h and p when adaptive_tolerance is positive; the solution is written at the element vertices,
+// where the bubbles vanish, and the mesh (with its element orders) to input_mesh.in in the format of parse_p_mesh_file()
+static int run_p_solve(double a, double b, double d1, double d2, struct Function_Field* field, double start, double end, int num_elements, int order, double adaptive_tolerance) {
+	struct P_Mesh mesh;
+	if (num_elements < 1 || generate_uniform_p_mesh(&mesh, start, end, num_elements, order)) {
+		return 1;
+	}
+
+	gsl_vector* solution = NULL;
+	if (adaptive_tolerance > 0) {
+		struct HP_Options hp = {0};
+		hp.tolerance = adaptive_tolerance;
+		struct HP_Report report;
+		if (solve_ode_hp(&mesh, &solution, a, b, d1, d2, field, &hp, &report)) {
+			free_p_mesh(&mesh);
+			return 1;
+		}
+		printf("hp-refinement (unknowns, estimated relative error, elements raised, elements split):\n");
+		for (int i = 0; i < report.num_steps; i++) {
+			printf("\t%zu\t%.3e\t%u\t%u\n", report.num_dofs[i], report.error_estimate[i], report.p_refined[i], report.h_refined[i]);
+		}
+		printf("%s the tolerance of %.1e with %u elements of orders up to %d, %zu unknowns.\n", report.converged ? "Reached" : "Stopped short of", adaptive_tolerance,
+			   mesh.num_elements, mesh.max_order, mesh.num_dofs);
+	}
+	else {
+		if (solve_ode_p(&mesh, &solution, a, b, d1, d2, field)) {
+			free_p_mesh(&mesh);
+			return 1;
+		}
+		printf("p-element solve: order %d, %zu unknowns.\n", order, mesh.num_dofs);
+	}
+
+	FILE* mesh_file = fopen("input_mesh.in", "w");
+	if (mesh_file == NULL) {
+		printf("Could not open input_mesh.in for writing.\n");
+	}
+	else {
+		output_p_mesh_file(&mesh, mesh_file);
+		fclose(mesh_file);
+	}
+
+	STATS_TIMER_START(output_timer);
+	struct Solution_Writer writer;
+	double* y_values = malloc((mesh.num_elements + 1)*sizeof(double));
+	int status = (y_values == NULL || open_solution_writer(&writer, "solution_output.dat", WRITER_TEXT));
+	if (status == 0) {
+		for (uint32_t e = 0; e <= mesh.num_elements; e++) {
+			y_values[e] = gsl_vector_get(solution, mesh.first_dof[e]);
+		}
+		status = submit_solution_values(&writer, mesh.vertices, y_values, mesh.num_elements + 1, WRITER_NO_INDEX);
+		if (close_solution_writer(&writer)) {
+			status = 1;
+		}
+	}
+	STATS_TIMER_STOP(output_timer, STATS_OUTPUT);
+
+	free(y_values);
+	gsl_vector_free(solution);
+	free_p_mesh(&mesh);
+
+	return status;
+
+}
+
+// Uniform L2 mesh with A and/or B read from field files (NULL paths keep the constants), evaluated once at the quadrature points
+static int run_variable_solve(struct Mesh* mesh, double a, double b, double d1, double d2, struct Function_Field* field, const char* a_path, const char* b_path) {
+	struct Function_Field a_field, b_field;
+	struct Coefficient_Function a_function = {NULL, NULL, NULL, a};
+	struct Coefficient_Function b_function = {NULL, NULL, NULL, b};
+	if (a_path != NULL) {
+		if (load_field_file(&a_field, a_path)) {
+			return 1;
+		}
+		a_function.field = &a_field;
+	}
+	if (b_path != NULL) {
+		if (load_field_file(&b_field, b_path)) {
+			if (a_path != NULL) {
+				free_function_field(&a_field);
+			}
+			return 1;
+		}
+		b_function.field = &b_field;
+	}
+
+	struct Coefficient_Table table;
+	struct ODE_Solution solution;
+	int status = create_coefficient_table(&table, mesh, &a_function, &b_function);
+	if (status == 0) {
+		status = solve_ode_variable(&table, &solution, d1, d2, field);
+		free_coefficient_table(&table);
+	}
+	if (status == 0) {
+		status = output_solution_data(mesh, &solution);
+		free_solution_memory(&solution);
+	}
+
+	if (a_path != NULL) {
+		free_function_field(&a_field);
+	}
+	if (b_path != NULL) {
+		free_function_field(&b_field);
+	}
+
+	return status;
+
+}
+
+// `flags` holds the solver choices made on the command line; a positive adaptive_tolerance refines the mesh until the estimated error reaches it,
+// and an order above 0 solves with p-elements of that order instead (refined in h and p with a positive adaptive_tolerance)
+// coefficient_paths[0] and [1], where not NULL, are field files that replace the constant A and B
+static int run_single_solve(char** argv, struct Solver_Stats* stats, bool streaming, const char* scratch_path, const struct Solver_Options* flags, double adaptive_tolerance, int order,
+							const char* const* coefficient_paths) {
+	double a = atof(argv[1]);
+	double b = atof(argv[2]);
+	double d1 = atof(argv[3]);
+	double d2 = atof(argv[4]);
+	const char* field_path = argv[5];
+	double start = atof(argv[6]);
+	double end = atof(argv[7]);
+	int num_elements = atoi(argv[8]);
+
+	// Parse, mesh and output times are recorded directly; the solve merges its own struct in
+	struct Solver_Stats* previous = stats_activate(stats);
+
+	if (streaming || order > 0) {
+		struct Function_Field field;
+		int status = load_field_file(&field, field_path);
+		if (status == 0) {
+			status = streaming ? run_streaming_solve(a, b, d1, d2, &field, start, end, num_elements, scratch_path) : run_p_solve(a, b, d1, d2, &field, start, end, num_elements, order, adaptive_tolerance);
+			free_function_field(&field);
+		}
+		stats_activate(previous);
+
+		return status;
+	}
+
+	struct Mesh mesh;
+	if (generate_uniform_mesh(&mesh, start, end, num_elements, LINEAR)) {
+		return 1;
+	}
+	output_mesh_file(&mesh, "input_mesh.in");
+
+	struct Function_Field field;
+	int status = load_field_file(&field, field_path);
+	if (status) {
+		free_mesh_memory(&mesh);
+		return 1;
+	}
+
+	if (coefficient_paths[0] != NULL || coefficient_paths[1] != NULL) {
+		status = run_variable_solve(&mesh, a, b, d1, d2, &field, coefficient_paths[0], coefficient_paths[1]);
+		free_function_field(&field);
+		free_mesh_memory(&mesh);
+		stats_activate(previous);
+
+		return status;
+	}
+
+	struct ODE_Solution solution;
+	struct Solver_Options options = *flags;
+	options.collect_stats = (stats != NULL);
+	struct Boundary_Spec boundary;
+	if (options.boundary != NULL) {
+		boundary = *options.boundary;
+		boundary.start.value = d1;
+		boundary.end.value = d2;
+		options.boundary = &boundary;
+	}
+	if (adaptive_tolerance > 0) {
+		struct Adaptive_Options adaptive = {0};
+		adaptive.tolerance = adaptive_tolerance;
+		struct Adaptive_Report report;
+		status = solve_ode_adaptive(&mesh, &solution, a, b, d1, d2, &field, &adaptive, &options, &report);
+		if (status == 0) {
+			printf("Adaptive refinement (nodes, estimated relative error):\n");
+			for (int i = 0; i < report.num_steps; i++) {
+				printf("\t%u\t%.3e\n", report.num_nodes[i], report.error_estimate[i]);
+			}
+			printf("%s the tolerance of %.1e with %u nodes.\n", report.converged ? "Reached" : "Stopped short of", adaptive_tolerance, mesh.num_nodes);
+			output_mesh_file(&mesh, "input_mesh.in");
+		}
+	}
+	else {
+		status = solve_ode_constant_opts(&mesh, &solution, a, b, d1, d2, &field, &options);
+	}
+	if (status == 0) {
+		if (solution.refinement != NULL) {
+			struct Refinement_Report* report = solution.refinement;
+			printf("Mixed-precision solve: %d refinement steps, residual %.3e (backward error %.3e)%s.\n", report->iterations, report->residual, report->backward_error,
+				   report->fallback ? "; refinement did not converge, solved in double precision" : "");
+		}
+		if (solution.iterative != NULL) {
+			printf("Iterative solve: %d iterations, backward error %.3e.\n", solution.iterative->iterations, solution.iterative->residual);
+		}
+		status = output_solution_data(&mesh, &solution);
+		free_solution_memory(&solution);
+	}
+
+	free_function_field(&field);
+	free_mesh_memory(&mesh);
+	stats_activate(previous);
+
+	return status;
+
+}
+
+static int run_server(int argc, char** argv) {
+	const char* socket_path = "-";
+	size_t num_threads = 0;
+	size_t cache_entries = SERVER_DEFAULT_CACHE_ENTRIES;
+
+	int i = 2;
+	if (i < argc && strncmp(argv[i], "--", 2) != 0) {
+		socket_path = argv[i++];
+	}
+	for (; i < argc; i++) {
+		if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			num_threads = strtoul(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "--cache-entries") == 0 && i + 1 < argc) {
+			cache_entries = strtoul(argv[++i], NULL, 10);
+		}
+		else {
+			print_usage();
+			return 1;
+		}
+	}
+
+	struct Solver_Server server;
+	if (create_solver_server(&server, num_threads, cache_entries)) {
+		return 1;
+	}
+
+	int status = run_solver_server(&server, socket_path);
+	free_solver_server(&server);
+
+	return status;
+
+}
+
+// Each manifest line holds the eight arguments of a single solve
+static int run_batch_manifest(int argc, char** argv, struct Solver_Stats* stats) {
+	if (argc < 3) {
+		print_usage();
+		return 1;
+	}
+
+	struct Batch_Options options = {0, BATCH_DEFAULT_OUTPUT, WRITER_BINARY, stats};
+	for (int i = 3; i < argc; i++) {
+		if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			options.num_threads = strtoul(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+			options.output_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+			i++;
+			if (strcmp(argv[i], "binary") == 0) {
+				options.format = WRITER_BINARY;
+			}
+			else if (strcmp(argv[i], "text") == 0) {
+				options.format = WRITER_TEXT;
+			}
+			else if (strcmp(argv[i], "columnar") == 0) {
+				options.format = WRITER_COLUMNAR;
+			}
+			else {
+				print_usage();
+				return 1;
+			}
+		}
+		else {
+			print_usage();
+			return 1;
+		}
+	}
+
+	FILE* manifest = fopen(argv[2], "r");
+	if (manifest == NULL) {
+		printf("Could not open the manifest %s.\n", argv[2]);
+		return 1;
+	}
+
+	struct Batch_Summary summary;
+	int status = run_batch(manifest, &options, &summary);
+	fclose(manifest);
+
+	printf("Solved %zu of %zu cases (%zu mesh/field groups, %zu factorizations) in %.3f s; results in %s.\n",
+		   summary.num_cases - summary.num_failed, summary.num_cases, summary.num_groups, summary.num_factorizations,
+		   summary.seconds, options.output_path);
+
+	return status;
+
+}
+
+// validate_solver_options(), and the rules of the solve paths that do not go through solve_ode_constant_opts(); NULL if the flags can be used together
+static const char* validate_cli_flags(const struct Solver_Options* options, bool adaptive, bool order, bool coefficients) {
+	const char* invalid = validate_solver_options(options);
+	if (invalid != NULL) {
+		return invalid;
+	}
+
+	bool other_solver = options->streaming || options->mixed_precision || options->linear_solver != SOLVER_BAND_LU;
+	bool other_boundary = options->periodic || options->boundary != NULL;
+	if (coefficients && (other_solver || other_boundary || options->supg || adaptive || order)) {
+		return "--a-field and --b-field solve with the band LU only, without --supg, --periodic, --bc, --adaptive or --order.";
+	}
+	if (order && (other_solver || other_boundary || options->supg)) {
+		return "--order solves p-elements with the band LU only, without --supg, --periodic or --bc.";
+	}
+	if (adaptive && (options->streaming || other_boundary)) {
+		return "--adaptive does not combine with --streaming, --periodic or --bc.";
+	}
+
+	return NULL;
+
+}
+
+int main(int argc, char** argv) {
+	if (extract_trace_flag(&argc, argv) < 0) {
+		print_usage();
+		return 1;
+	}
+
+	if (argc >= 2 && strcmp(argv[1], "--serve") == 0) {
+		return run_server(argc, argv);
+	}
+
+	int stats_flag = extract_stats_flag(&argc, argv);
+	if (stats_flag < 0) {
+		print_usage();
+		return 1;
+	}
+
+	const char* scratch_path = NULL;
+	int streaming_flag = extract_streaming_flag(&argc, argv, &scratch_path);
+	if (streaming_flag < 0) {
+		print_usage();
+		return 1;
+	}
+
+	struct Solver_Options solver_flags = {0};
+	solver_flags.mixed_precision = extract_switch(&argc, argv, "--mixed-precision");
+	solver_flags.supg = extract_switch(&argc, argv, "--supg");
+	solver_flags.periodic = extract_switch(&argc, argv, "--periodic");
+	int solver_flag = extract_solver_flag(&argc, argv, &solver_flags);
+	double adaptive_tolerance = 0;
+	int adaptive_flag = extract_adaptive_flag(&argc, argv, &adaptive_tolerance);
+	int order = 0;
+	int order_flag = extract_order_flag(&argc, argv, &order);
+	const char* coefficient_paths[2] = {NULL, NULL};
+	int coefficient_flag = extract_path_flag(&argc, argv, "--a-field", &coefficient_paths[0]);
+	int b_field_flag = extract_path_flag(&argc, argv, "--b-field", &coefficient_paths[1]);
+	coefficient_flag = (coefficient_flag < 0 || b_field_flag < 0) ? -1 : (coefficient_flag || b_field_flag);
+	struct Boundary_Spec boundary;
+	int boundary_flag = extract_boundary_flag(&argc, argv, &boundary);
+	if (boundary_flag == 1) {
+		solver_flags.boundary = &boundary;
+	}
+	if (solver_flag < 0 || adaptive_flag < 0 || order_flag < 0 || coefficient_flag < 0 || boundary_flag < 0) {
+		print_usage();
+		return 1;
+	}
+	// Only used to validate the flags; a streaming solve goes through run_streaming_solve()
+	solver_flags.streaming = (streaming_flag == 1);
+	const char* invalid = validate_cli_flags(&solver_flags, adaptive_flag, order_flag, coefficient_flag);
+	if (invalid != NULL) {
+		printf("%s\n", invalid);
+		print_usage();
+		return 1;
+	}
+
+	struct Solver_Stats stats = {0};
+	struct Solver_Stats* stats_ptr = (stats_flag >= 1) ? &stats : NULL;
+	if (stats_flag == 2) {
+		// The solve goes ahead without them; the JSON output says why they are missing
+		hw_counters_enable();
+	}
+
+	int status;
+	if (argc >= 2 && strcmp(argv[1], "--batch") == 0 && !streaming_flag && !solver_flags.mixed_precision && !solver_flags.supg && !solver_flags.periodic && !boundary_flag && !solver_flag && !adaptive_flag && !order_flag && !coefficient_flag) {
+		status = run_batch_manifest(argc, argv, stats_ptr);
+	}
+	else if (argc == 9) {
+		status = run_single_solve(argv, stats_ptr, streaming_flag == 1, scratch_path, &solver_flags, adaptive_tolerance, order, coefficient_paths);
+	}
+	else {
+		print_usage();
+		return 1;
+	}
+
+	if (stats_ptr != NULL) {
+		output_stats_json(stdout, stats_ptr);
+	}
+
+	return status;
+
+}
@@ -0,0 +1,196 @@
+/* Matrix-free coefficient operator
+ *
+ * y = K*x is computed element by element: the local values of x are gathered, multiplied by the element matrix at the quadrature points
+ * (apply_element_block(), which never forms the matrix) and added into y, so the only arrays of the size of the mesh are vectors.
+ * The first and last rows act as the Dirichlet rows of the assembled system, which are identity rows.
+ * The Jacobi preconditioner and the norm for the stopping test come from one pass over the element matrices when the operator is created.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "matrix_free.h"
+#include "solver_stats.h"
+#include "trace.h"
+
+// Gathers the node coordinates (x[i][e]) and global node numbers (nodes[i][e]) of up to ELEMENT_BLOCK elements of the same kind starting at `first`;
+// returns how many were taken
+static int gather_elements(const struct Mesh* input_mesh, uint32_t first, double (*x)[ELEMENT_BLOCK], uint32_t (*nodes)[ELEMENT_BLOCK], int* size) {
+	Element_2D_Type kind = input_mesh->connectivity_grid[first].kind;
+	*size = (kind == QUAD) ? 3 : 2;
+
+	int count = 0;
+	while (count < ELEMENT_BLOCK && first + count < input_mesh->num_elements && input_mesh->connectivity_grid[first + count].kind == kind) {
+		const struct Element_Conn* conn = &input_mesh->connectivity_grid[first + count];
+		const int* node_id = (kind == QUAD) ? conn->node_list.L3.node_id : conn->node_list.L2.node_id;
+		for (int i = 0; i < *size; i++) {
+			nodes[i][count] = node_id[i];
+			x[i][count] = input_mesh->node_coordinates[node_id[i]];
+		}
+		count++;
+	}
+
+	return count;
+
+}
+
+int create_matrix_free_operator(struct Matrix_Free_Operator* op, struct Mesh* input_mesh, double a, double b) {
+	size_t n = input_mesh->num_nodes;
+	op->mesh = input_mesh;
+	op->a = a;
+	op->b = b;
+	op->norm_inf = 1;
+
+	// Off-diagonal entries belong to a single element in 1D, so adding up their magnitudes per row gives the exact row sums
+	op->inverse_diagonal = calloc(n, sizeof(double));
+	double* off_diagonal = calloc(n, sizeof(double));
+	if (op->inverse_diagonal == NULL || off_diagonal == NULL) {
+		printf("Error allocating the matrix-free diagonal of length %zu.\n", n);
+		free(op->inverse_diagonal);
+		free(off_diagonal);
+		op->inverse_diagonal = NULL;
+		return 1;
+	}
+	STATS_ALLOC(2*n*sizeof(double));
+	double* diagonal = op->inverse_diagonal;
+
+	TRACE_SPAN_START(setup_span);
+	STATS_TIMER_START(kernel_timer);
+	uint32_t e = 0;
+	while (e < input_mesh->num_elements) {
+		double x[MAX_ELEMENT_NODES][ELEMENT_BLOCK], k[MAX_ELEMENT_NODES*MAX_ELEMENT_NODES][ELEMENT_BLOCK];
+		uint32_t nodes[MAX_ELEMENT_NODES][ELEMENT_BLOCK];
+		int size;
+		int count = gather_elements(input_mesh, e, x, nodes, &size);
+		if (output_coefficient_block(input_mesh->connectivity_grid[e].kind, count, (const double (*)[ELEMENT_BLOCK]) x, a, b, k)) {
+			free_matrix_free_operator(op);
+			free(off_diagonal);
+			return 1;
+		}
+
+		for (int c = 0; c < count; c++) {
+			for (int i = 0; i < size; i++) {
+				for (int j = 0; j < size; j++) {
+					if (i == j) {
+						diagonal[nodes[i][c]] += k[i*size + j][c];
+					}
+					else {
+						off_diagonal[nodes[i][c]] += fabs(k[i*size + j][c]);
+					}
+				}
+			}
+		}
+		STATS_COUNT(STATS_ELEMENTS, count);
+		e += count;
+	}
+
+	for (size_t i = 1; i + 1 < n; i++) {
+		op->norm_inf = fmax(op->norm_inf, fabs(diagonal[i]) + off_diagonal[i]);
+		diagonal[i] = (diagonal[i] != 0) ? 1/diagonal[i] : 1;
+	}
+	diagonal[0] = 1;
+	diagonal[n - 1] = 1;
+	STATS_TIMER_STOP(kernel_timer, STATS_LOCAL_KERNELS);
+	TRACE_SPAN_STOP(setup_span, "matrix-free setup", "solver");
+	free(off_diagonal);
+
+	return 0;
+
+}
+
+void free_matrix_free_operator(struct Matrix_Free_Operator* op) {
+	free(op->inverse_diagonal);
+	op->inverse_diagonal = NULL;
+
+}
+
+// Krylov_Operator: y = K*x, with the first and last rows as identity rows
+void matrix_free_apply(void* context, const double* x, double* y) {
+	const struct Matrix_Free_Operator* op = (const struct Matrix_Free_Operator*) context;
+	const struct Mesh* input_mesh = op->mesh;
+	size_t n = input_mesh->num_nodes;
+	memset(y, 0, n*sizeof(double));
+
+	uint32_t e = 0;
+	while (e < input_mesh->num_elements) {
+		double x_e[MAX_ELEMENT_NODES][ELEMENT_BLOCK], u[MAX_ELEMENT_NODES][ELEMENT_BLOCK], y_e[MAX_ELEMENT_NODES][ELEMENT_BLOCK];
+		uint32_t nodes[MAX_ELEMENT_NODES][ELEMENT_BLOCK];
+		int size;
+		int count = gather_elements(input_mesh, e, x_e, nodes, &size);
+		for (int i = 0; i < size; i++) {
+			for (int c = 0; c < count; c++) {
+				u[i][c] = x[nodes[i][c]];
+			}
+		}
+
+		// The element kind was already accepted by create_matrix_free_operator()
+		apply_element_block(input_mesh->connectivity_grid[e].kind, count, (const double (*)[ELEMENT_BLOCK]) x_e, op->a, op->b, (const double (*)[ELEMENT_BLOCK]) u, y_e);
+
+		for (int c = 0; c < count; c++) {
+			for (int i = 0; i < size; i++) {
+				y[nodes[i][c]] += y_e[i][c];
+			}
+		}
+		e += count;
+	}
+
+	y[0] = x[0];
+	y[n - 1] = x[n - 1];
+
+}
+
+// Krylov_Preconditioner: z = D^-1*r for the diagonal D of the operator
+void jacobi_precondition(void* context, const double* r, double* z) {
+	const struct Matrix_Free_Operator* op = (const struct Matrix_Free_Operator*) context;
+	for (size_t i = 0; i < op->mesh->num_nodes; i++) {
+		z[i] = op->inverse_diagonal[i]*r[i];
+	}
+
+}
+
+// Solves [K][y] = [F] with Jacobi-preconditioned BiCGSTAB on the matrix-free operator; only the constant vector is assembled.
+// A solve that does not reach the tolerance returns 1, with the report of where it stopped.
+int solve_ode_matrix_free(struct Mesh* input_mesh, gsl_vector** solution, double a, double b, double d1, double d2, struct Function_Field *function_field, double tolerance, struct Iterative_Report* report) {
+	size_t n = input_mesh->num_nodes;
+	if (n < 2) {
+		printf("The mesh needs at least two nodes for the boundary values.\n");
+		return 1;
+	}
+
+	struct Matrix_Free_Operator op;
+	if (create_matrix_free_operator(&op, input_mesh, a, b)) {
+		return 1;
+	}
+
+	gsl_vector* F_const = assemble_constant_vector(input_mesh, function_field);
+	if (F_const == NULL) {
+		free_matrix_free_operator(&op);
+		return 1;
+	}
+	gsl_vector_set(F_const, 0, d1);
+	gsl_vector_set(F_const, n - 1, d2);
+
+	// Starting from the boundary values, which the Dirichlet rows already satisfy
+	gsl_vector* x = gsl_vector_calloc(n);
+	STATS_ALLOC(n*sizeof(double));
+	gsl_vector_set(x, 0, d1);
+	gsl_vector_set(x, n - 1, d2);
+
+	int status = bicgstab_solve(n, matrix_free_apply, &op, op.norm_inf, jacobi_precondition, &op, F_const->data, x->data, tolerance, KRYLOV_DEFAULT_MAX_ITERATIONS, report);
+	free_matrix_free_operator(&op);
+	gsl_vector_free(F_const);
+
+	if (status == 0 && !report->converged) {
+		printf("The matrix-free solve stopped at a backward error of %.3e after %d iterations (tolerance %.1e).\n", report->residual, report->iterations, tolerance);
+		status = 1;
+	}
+	if (status) {
+		gsl_vector_free(x);
+		return 1;
+	}
+
+	*solution = x;
+	return 0;
+
+}
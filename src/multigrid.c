@@ -0,0 +1,372 @@
+/* Geometric multigrid on nested 1D meshes
+ *
+ * Each level keeps every other node of the one above it (and always the last node), so the levels are nested meshes.
+ * Corrections are interpolated linearly between the coarse nodes (P), residuals are restricted with R = P^T,
+ * and the coarse operators are the Galerkin products R A P, which keeps the hierarchy usable for any band matrix the solver assembles.
+ * Gauss-Seidel sweeps smooth the error on each level (forward before the correction, backward after it),
+ * and the coarsest level, at most MULTIGRID_COARSEST_NODES nodes, is solved with the band LU.
+ *
+ * The first and last rows are Dirichlet rows; corrections vanish there, so they are identity rows with a zero right-hand side on the coarse levels.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "multigrid.h"
+#include "solver_stats.h"
+#include "trace.h"
+
+// Adds the Galerkin product P^T A P of the fine level to the (created) coarse operator
+static void galerkin_product(const struct Multigrid_Level* fine, struct Band_Matrix* coarse) {
+	const struct Band_Matrix* A = fine->A;
+	size_t n = fine->size;
+
+	for (size_t i = 0; i < n; i++) {
+		size_t first_col = (i > (size_t) A->lower) ? i - A->lower : 0;
+		size_t last_col = (i + A->upper < n - 1) ? i + A->upper : n - 1;
+		size_t I[2] = {fine->parent[i], fine->parent[i] + 1};
+		double w_i[2] = {fine->weight[i], 1 - fine->weight[i]};
+
+		for (size_t j = first_col; j <= last_col; j++) {
+			double a = *band_matrix_ptr(A, i, j);
+			if (a == 0) {
+				continue;
+			}
+
+			size_t J[2] = {fine->parent[j], fine->parent[j] + 1};
+			double w_j[2] = {fine->weight[j], 1 - fine->weight[j]};
+			for (int p = 0; p < 2; p++) {
+				for (int q = 0; q < 2; q++) {
+					if (w_i[p] != 0 && w_j[q] != 0) {
+						band_matrix_add(coarse, I[p], J[q], w_i[p]*a*w_j[q]);
+					}
+				}
+			}
+		}
+	}
+
+}
+
+// Largest ratio of the off-diagonal sum to the diagonal over the interior rows
+static double dominance_ratio(const struct Band_Matrix* A) {
+	double worst = 0;
+
+	for (size_t i = 1; i + 1 < A->size; i++) {
+		size_t first_col = (i > (size_t) A->lower) ? i - A->lower : 0;
+		size_t last_col = (i + A->upper < A->size - 1) ? i + A->upper : A->size - 1;
+		double off_diagonal = 0;
+		for (size_t j = first_col; j <= last_col; j++) {
+			if (j != i) {
+				off_diagonal += fabs(*band_matrix_ptr(A, i, j));
+			}
+		}
+		worst = fmax(worst, off_diagonal/fabs(*band_matrix_ptr(A, i, i)));
+	}
+
+	return worst;
+
+}
+
+int create_multigrid(struct Multigrid* mg, const double* node_coordinates, const struct Band_Matrix* A, Multigrid_Cycle cycle) {
+	memset(mg, 0, sizeof(struct Multigrid));
+	mg->cycle = cycle;
+
+	STATS_TIMER_START(setup_timer);
+	TRACE_SPAN_START(setup_span);
+
+	size_t n = A->size;
+	double* coordinates = malloc(2*n*sizeof(double));
+	if (coordinates == NULL) {
+		printf("Error allocating the multigrid coordinates for %zu nodes.\n", n);
+		return 1;
+	}
+	STATS_ALLOC(2*n*sizeof(double));
+	memcpy(coordinates, node_coordinates, n*sizeof(double));
+	double* coarse_coordinates = coordinates + n;
+
+	mg->levels[0].size = n;
+	mg->levels[0].A = A;
+	mg->num_levels = 1;
+
+	while (mg->levels[mg->num_levels - 1].size > MULTIGRID_COARSEST_NODES && mg->num_levels < MULTIGRID_MAX_LEVELS) {
+		struct Multigrid_Level* fine = &mg->levels[mg->num_levels - 1];
+		struct Multigrid_Level* coarse = &mg->levels[mg->num_levels];
+		size_t n_fine = fine->size;
+		size_t n_coarse = (n_fine + 1)/2 + (n_fine % 2 == 0);
+
+		fine->parent = malloc(n_fine*sizeof(size_t));
+		fine->weight = malloc(n_fine*sizeof(double));
+		if (fine->parent == NULL || fine->weight == NULL) {
+			printf("Error allocating the multigrid interpolation for %zu nodes.\n", n_fine);
+			free(coordinates);
+			free_multigrid(mg);
+			return 1;
+		}
+		STATS_ALLOC(n_fine*(sizeof(size_t) + sizeof(double)));
+
+		for (size_t j = 0; j < n_fine; j++) {
+			if (j % 2 == 0 || j == n_fine - 1) {
+				// Kept on the coarse level
+				fine->parent[j] = (j + 1)/2;
+				fine->weight[j] = 1;
+				coarse_coordinates[(j + 1)/2] = coordinates[j];
+			}
+			else {
+				fine->parent[j] = j/2;
+				fine->weight[j] = (coordinates[j + 1] - coordinates[j])/(coordinates[j + 1] - coordinates[j - 1]);
+			}
+		}
+		memcpy(coordinates, coarse_coordinates, n_coarse*sizeof(double));
+
+		// A band of width b on the fine level couples coarse nodes at most (b + 2)/2 apart
+		if (create_band_matrix(&coarse->coarse, n_coarse, (fine->A->lower + 2)/2, (fine->A->upper + 2)/2)) {
+			free(coordinates);
+			free_multigrid(mg);
+			return 1;
+		}
+		mg->num_levels++;
+		coarse->size = n_coarse;
+		coarse->A = &coarse->coarse;
+
+		galerkin_product(fine, &coarse->coarse);
+		band_matrix_set_row_identity(&coarse->coarse, 0);
+		band_matrix_set_row_identity(&coarse->coarse, n_coarse - 1);
+
+		if (!(dominance_ratio(&coarse->coarse) <= MULTIGRID_MAX_DOMINANCE_RATIO)) {
+			// Gauss-Seidel would not smooth on this level, so the level above it becomes the coarsest one
+			free_band_matrix(&coarse->coarse);
+			free(fine->parent);
+			free(fine->weight);
+			fine->parent = NULL;
+			fine->weight = NULL;
+			mg->num_levels--;
+			break;
+		}
+	}
+	free(coordinates);
+
+	for (int l = 0; l < mg->num_levels; l++) {
+		struct Multigrid_Level* level = &mg->levels[l];
+		size_t vectors = (l == 0) ? 1 : 3;
+		level->storage = malloc(vectors*level->size*sizeof(double));
+		if (level->storage == NULL) {
+			printf("Error allocating the multigrid vectors for %zu nodes.\n", level->size);
+			free_multigrid(mg);
+			return 1;
+		}
+		STATS_ALLOC(vectors*level->size*sizeof(double));
+
+		level->r = level->storage;
+		if (l > 0) {
+			level->x = level->storage + level->size;
+			level->b = level->storage + 2*level->size;
+		}
+	}
+	STATS_TIMER_STOP(setup_timer, STATS_FACTOR);
+
+	const struct Band_Matrix* coarsest = mg->levels[mg->num_levels - 1].A;
+	if (copy_band_matrix(&mg->coarsest_lu, coarsest) || band_lu_decomp(&mg->coarsest_lu)) {
+		free_multigrid(mg);
+		return 1;
+	}
+	TRACE_SPAN_STOP(setup_span, "multigrid setup", "solver");
+
+	return 0;
+
+}
+
+void free_multigrid(struct Multigrid* mg) {
+	for (int l = 0; l < mg->num_levels; l++) {
+		struct Multigrid_Level* level = &mg->levels[l];
+		free(level->parent);
+		free(level->weight);
+		free(level->storage);
+		if (l > 0) {
+			free_band_matrix(&level->coarse);
+		}
+	}
+	free_band_matrix(&mg->coarsest_lu);
+	mg->num_levels = 0;
+
+}
+
+static void gauss_seidel(const struct Band_Matrix* A, const double* b, double* x, bool forward) {
+	size_t n = A->size;
+
+	for (size_t k = 0; k < n; k++) {
+		size_t i = forward ? k : n - 1 - k;
+		size_t first_col = (i > (size_t) A->lower) ? i - A->lower : 0;
+		size_t last_col = (i + A->upper < n - 1) ? i + A->upper : n - 1;
+		const double* row_i = band_matrix_ptr(A, i, first_col);
+
+		double sum = b[i];
+		for (size_t j = first_col; j <= last_col; j++) {
+			if (j != i) {
+				sum -= row_i[j - first_col]*x[j];
+			}
+		}
+
+		double diagonal = row_i[i - first_col];
+		if (diagonal != 0) {
+			x[i] = sum/diagonal;
+		}
+	}
+
+}
+
+static void residual(const struct Multigrid_Level* level) {
+	band_matrix_apply(level->A, level->x, level->r);
+	for (size_t i = 0; i < level->size; i++) {
+		level->r[i] = level->b[i] - level->r[i];
+	}
+
+}
+
+// coarse = P^T fine; the Dirichlet entries are kept (for a right-hand side) or zeroed (for a residual)
+static void restrict_vector(const struct Multigrid_Level* fine, const double* v, double* coarse, size_t n_coarse, bool keep_boundary) {
+	memset(coarse, 0, n_coarse*sizeof(double));
+	for (size_t j = 0; j < fine->size; j++) {
+		coarse[fine->parent[j]] += fine->weight[j]*v[j];
+		if (fine->weight[j] != 1) {
+			coarse[fine->parent[j] + 1] += (1 - fine->weight[j])*v[j];
+		}
+	}
+
+	coarse[0] = keep_boundary ? v[0] : 0;
+	coarse[n_coarse - 1] = keep_boundary ? v[fine->size - 1] : 0;
+
+}
+
+// fine = P coarse (or fine += P coarse)
+static void interpolate(const struct Multigrid_Level* fine, const double* coarse, double* v, bool add) {
+	for (size_t j = 0; j < fine->size; j++) {
+		double value = fine->weight[j]*coarse[fine->parent[j]];
+		if (fine->weight[j] != 1) {
+			value += (1 - fine->weight[j])*coarse[fine->parent[j] + 1];
+		}
+		v[j] = add ? v[j] + value : value;
+	}
+
+}
+
+static void coarsest_solve(struct Multigrid* mg) {
+	struct Multigrid_Level* level = &mg->levels[mg->num_levels - 1];
+	memcpy(level->x, level->b, level->size*sizeof(double));
+	band_lu_substitute(&mg->coarsest_lu, level->x, 1);
+
+}
+
+// One cycle on level l, improving levels[l].x for the right-hand side levels[l].b
+static void cycle_level(struct Multigrid* mg, int l, Multigrid_Cycle cycle) {
+	if (l == mg->num_levels - 1) {
+		coarsest_solve(mg);
+		return;
+	}
+
+	struct Multigrid_Level* level = &mg->levels[l];
+	struct Multigrid_Level* coarse = &mg->levels[l + 1];
+
+	for (int s = 0; s < MULTIGRID_SMOOTHING_STEPS; s++) {
+		gauss_seidel(level->A, level->b, level->x, true);
+	}
+
+	residual(level);
+	restrict_vector(level, level->r, (double*) coarse->b, coarse->size, false);
+	memset(coarse->x, 0, coarse->size*sizeof(double));
+
+	switch (cycle) {
+		case MULTIGRID_V_CYCLE:
+			cycle_level(mg, l + 1, MULTIGRID_V_CYCLE);
+			break;
+		case MULTIGRID_W_CYCLE:
+			cycle_level(mg, l + 1, MULTIGRID_W_CYCLE);
+			cycle_level(mg, l + 1, MULTIGRID_W_CYCLE);
+			break;
+		case MULTIGRID_F_CYCLE:
+			// An F-cycle on the coarse level followed by a V-cycle
+			cycle_level(mg, l + 1, MULTIGRID_F_CYCLE);
+			cycle_level(mg, l + 1, MULTIGRID_V_CYCLE);
+			break;
+	}
+
+	interpolate(level, coarse->x, level->x, true);
+
+	for (int s = 0; s < MULTIGRID_SMOOTHING_STEPS; s++) {
+		gauss_seidel(level->A, level->b, level->x, false);
+	}
+
+}
+
+// One cycle of the configured kind on A x = b, improving x in place
+void multigrid_cycle(struct Multigrid* mg, const double* b, double* x) {
+	mg->levels[0].b = b;
+	mg->levels[0].x = x;
+	cycle_level(mg, 0, mg->cycle);
+
+}
+
+// Full multigrid: the problem is solved on the coarsest level first, and each solution is interpolated up as the starting point of a cycle on the next finer level
+void multigrid_fmg(struct Multigrid* mg, const double* b, double* x) {
+	mg->levels[0].b = b;
+	mg->levels[0].x = x;
+
+	for (int l = 0; l < mg->num_levels - 1; l++) {
+		restrict_vector(&mg->levels[l], mg->levels[l].b, (double*) mg->levels[l + 1].b, mg->levels[l + 1].size, true);
+	}
+	coarsest_solve(mg);
+
+	for (int l = mg->num_levels - 2; l >= 0; l--) {
+		interpolate(&mg->levels[l], mg->levels[l + 1].x, mg->levels[l].x, false);
+		cycle_level(mg, l, mg->cycle);
+	}
+
+}
+
+// Full multigrid followed by cycles until the backward error is at most the tolerance (see krylov.h).
+// Returns 1 only for invalid arguments; a solve that does not converge in max_cycles returns 0 with report->converged unset.
+int multigrid_solve(struct Multigrid* mg, const double* b, double* x, double tolerance, int max_cycles, struct Iterative_Report* report) {
+	if (mg->num_levels < 1) {
+		printf("The multigrid hierarchy has to be built with create_multigrid() before solving.\n");
+		return 1;
+	}
+
+	STATS_TIMER_START(solve_timer);
+	TRACE_SPAN_START(solve_span);
+	struct Multigrid_Level* finest = &mg->levels[0];
+	double norm_A = band_matrix_norm_inf(finest->A);
+
+	multigrid_fmg(mg, b, x);
+	residual(finest);
+	report->iterations = 0;
+	report->residual = backward_error(finest->r, x, b, finest->size, norm_A);
+
+	while (report->residual > tolerance && report->iterations < max_cycles) {
+		multigrid_cycle(mg, b, x);
+		report->iterations++;
+
+		double previous = report->residual;
+		residual(finest);
+		report->residual = backward_error(finest->r, x, b, finest->size, norm_A);
+		if (!(report->residual < previous)) {
+			// Stalled (or diverging); more cycles will not help
+			break;
+		}
+	}
+	report->converged = (report->residual <= tolerance);
+
+	STATS_COUNT(STATS_ITERATIONS, report->iterations);
+	STATS_TIMER_STOP(solve_timer, STATS_SOLVE);
+	TRACE_SPAN_STOP(solve_span, "multigrid solve", "solver");
+
+	return 0;
+
+}
+
+// Krylov_Preconditioner hook: one cycle from a zero guess
+void multigrid_precondition(void* mg, const double* r, double* z) {
+	struct Multigrid* grid = (struct Multigrid*) mg;
+	memset(z, 0, grid->levels[0].size*sizeof(double));
+	multigrid_cycle(grid, r, z);
+
+}
@@ -0,0 +1,302 @@
+/* Newton's method for y'' + A y' + g(y) = f
+ *
+ * The residual of the Galerkin equations is R(y) = K y + G(y) - F, with the linear part K (the coefficient matrices with B = 0),
+ * G_i = the integral of N_i g(y) and the constant vector F; its tangent is K plus the mass matrix weighted by dg/dy.
+ * Both are integrated by the element kernels from the values of y at the quadrature points, which (with the points) come from a Coefficient_Table,
+ * so the tangent is the variable-coefficient matrix with B(x) = dg/dy(y(x)).
+ *
+ * Full Newton decomposes the tangent at every step and converges quadratically near the solution.
+ * Modified Newton keeps the decomposition while the steps keep reducing the residual: each step is then a residual and two triangular solves,
+ * which is worth more steps when the decomposition dominates the cost (large meshes, or tangents that change little).
+ * The line search halves a step until it reduces the residual, and continuation scales f up in steps, solving each from the previous solution,
+ * for problems whose solution is too far from the starting guess for Newton's method alone.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <stdbool.h>
+
+#include "nonlinear.h"
+#include "variable_coefficients.h"
+#include "band_matrix.h"
+#include "solver_stats.h"
+#include "trace.h"
+
+struct Newton_System {
+	struct Coefficient_Table table; // Quadrature points and the constant A; B is unused
+	double a;
+	const struct Nonlinear_Term* g;
+	gsl_vector* F;
+	double lambda; // Load parameter: the equations are solved with lambda*f
+	size_t n;
+	double* Gy; // n entries, next to the residual that holds K y
+	double* yq; // Per-point values of y, g and dg/dy of one block
+	double* gq;
+	double* dgq;
+
+};
+
+static double now_seconds() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec + now.tv_nsec/1e9;
+
+}
+
+static double norm_inf(const double* x, size_t n) {
+	double norm = 0;
+	for (size_t i = 0; i < n; i++) {
+		norm = fmax(norm, fabs(x[i]));
+	}
+
+	return norm;
+
+}
+
+// r = K y + G(y) - lambda F with zero Dirichlet rows; returns ||r||/(||K y|| + ||G(y)|| + ||lambda F||).
+// With a tangent J (of the mesh's bandwidth), also assembles it, with identity Dirichlet rows.
+static double newton_residual(struct Newton_System* s, const double* y, double* r, struct Band_Matrix* J) {
+	const struct Coefficient_Table* table = &s->table;
+	memset(r, 0, s->n*sizeof(double));
+	memset(s->Gy, 0, s->n*sizeof(double));
+	if (J != NULL) {
+		memset(J->data, 0, J->size*J->width*sizeof(double));
+		J->factored = false;
+	}
+
+	for (uint32_t k = 0; k < table->num_blocks; k++) {
+		const struct Coefficient_Block* block = &table->blocks[k];
+		const double (*x)[ELEMENT_BLOCK] = (const double (*)[ELEMENT_BLOCK]) block->x;
+		int size = block->size;
+		int count = block->count;
+		int num_values = block->num_points*count;
+		double u[MAX_ELEMENT_NODES][ELEMENT_BLOCK], Ku[MAX_ELEMENT_NODES][ELEMENT_BLOCK], G[MAX_ELEMENT_NODES][ELEMENT_BLOCK];
+
+		for (int i = 0; i < size; i++) {
+			for (int c = 0; c < count; c++) {
+				u[i][c] = y[block->nodes[i][c]];
+			}
+		}
+
+		// The shape functions interpolate y at the quadrature points as they do the coordinates
+		STATS_TIMER_START(kernel_timer);
+		output_quadrature_point_block(block->kind, count, (const double (*)[ELEMENT_BLOCK]) u, s->yq);
+		for (int q = 0; q < num_values; q++) {
+			s->gq[q] = s->g->g(s->yq[q], s->g->context);
+		}
+		apply_element_block(block->kind, count, x, s->a, 0, (const double (*)[ELEMENT_BLOCK]) u, Ku);
+		output_load_block(block->kind, count, x, s->gq, G);
+		STATS_TIMER_STOP(kernel_timer, STATS_LOCAL_KERNELS);
+
+		STATS_TIMER_START(scatter_timer);
+		for (int i = 0; i < size; i++) {
+			for (int c = 0; c < count; c++) {
+				r[block->nodes[i][c]] += Ku[i][c];
+				s->Gy[block->nodes[i][c]] += G[i][c];
+			}
+		}
+		STATS_TIMER_STOP(scatter_timer, STATS_SCATTER);
+
+		if (J != NULL) {
+			double k_e[MAX_ELEMENT_NODES*MAX_ELEMENT_NODES][ELEMENT_BLOCK];
+			for (int q = 0; q < num_values; q++) {
+				s->dgq[q] = s->g->dg(s->yq[q], s->g->context);
+			}
+
+			STATS_TIMER_START(tangent_timer);
+			output_variable_coefficient_block(block->kind, count, x, &table->a[block->offset], s->dgq, k_e);
+			STATS_TIMER_STOP(tangent_timer, STATS_LOCAL_KERNELS);
+
+			STATS_TIMER_START(tangent_scatter_timer);
+			for (int i = 0; i < size; i++) {
+				for (int j = 0; j < size; j++) {
+					for (int c = 0; c < count; c++) {
+						band_matrix_add(J, block->nodes[i][c], block->nodes[j][c], k_e[i*size + j][c]);
+					}
+				}
+			}
+			STATS_TIMER_STOP(tangent_scatter_timer, STATS_SCATTER);
+		}
+	}
+
+	double scale = norm_inf(r, s->n) + norm_inf(s->Gy, s->n) + fabs(s->lambda)*norm_inf(s->F->data, s->n);
+	for (size_t i = 0; i < s->n; i++) {
+		r[i] += s->Gy[i] - s->lambda*gsl_vector_get(s->F, i);
+	}
+	r[0] = 0;
+	r[s->n - 1] = 0;
+	if (J != NULL) {
+		band_matrix_set_row_identity(J, 0);
+		band_matrix_set_row_identity(J, s->n - 1);
+	}
+
+	return norm_inf(r, s->n)/((scale > 0) ? scale : 1);
+
+}
+
+// Assembles the tangent at y (and the residual there, as *relative) and decomposes it; returns 1 if the tangent is singular
+static int newton_tangent(struct Newton_System* s, const double* y, double* r, struct Band_Matrix* J, double* relative, struct Newton_Report* report) {
+	double begin = now_seconds();
+	*relative = newton_residual(s, y, r, J);
+	report->residual_evaluations++;
+	report->factorizations++;
+	int status = band_lu_decomp(J);
+	report->factor_seconds += now_seconds() - begin;
+
+	return status;
+
+}
+
+static int newton_iterate(struct Newton_System* s, double* y, const struct Newton_Options* options, struct Band_Matrix* J, double* work, struct Newton_Report* report) {
+	size_t n = s->n;
+	double* r = work;
+	double* step = work + n;
+	double* trial = work + 2*n;
+	double tolerance = (options->tolerance > 0) ? options->tolerance : NEWTON_DEFAULT_TOLERANCE;
+	int max_iterations = (options->max_iterations > 0) ? options->max_iterations : NEWTON_DEFAULT_MAX_ITERATIONS;
+	gsl_vector_view step_view = gsl_vector_view_array(step, n);
+
+	// Every step of a continuation starts with a new tangent
+	double relative;
+	if (newton_tangent(s, y, r, J, &relative, report)) {
+		return 1;
+	}
+	for (int iteration = 0; ; iteration++) {
+		report->residual = relative;
+		if (relative <= tolerance) {
+			return 0;
+		}
+		if (iteration == max_iterations || !isfinite(relative)) {
+			return 0;
+		}
+
+		// J step = -r; the Dirichlet rows of r are zero, so the step keeps the boundary values
+		for (size_t i = 0; i < n; i++) {
+			step[i] = -r[i];
+		}
+		band_lu_solve(J, &step_view.vector, &step_view.vector);
+		report->iterations++;
+
+		double alpha = 1;
+		double next;
+		for (int backtrack = 0; ; backtrack++) {
+			for (size_t i = 0; i < n; i++) {
+				trial[i] = y[i] + alpha*step[i];
+			}
+			next = newton_residual(s, trial, r, NULL);
+			report->residual_evaluations++;
+			if (!options->line_search || backtrack == NEWTON_MAX_BACKTRACKS || (isfinite(next) && next <= (1 - 1e-4*alpha)*relative)) {
+				break;
+			}
+			alpha /= 2;
+			report->backtracks++;
+		}
+		memcpy(y, trial, n*sizeof(double));
+
+		// A converged iterate needs no new tangent
+		bool refactor = isfinite(next) && next > tolerance && (options->method == NEWTON_FULL || next > NEWTON_MODIFIED_MAX_RATIO*relative);
+		relative = next;
+		if (refactor && newton_tangent(s, y, r, J, &relative, report)) {
+			return 1;
+		}
+	}
+
+}
+
+// Solves y'' + A y' + g(y) = f with y = d1 and d2 at the ends of the mesh. A solve that does not converge returns 0 with report->converged unset
+// and the last iterate as the solution; 1 means an allocation failed or a tangent was singular.
+int solve_ode_nonlinear(struct Mesh* input_mesh, struct ODE_Solution* solution, double a, const struct Nonlinear_Term* g, double d1, double d2, struct Function_Field *function_field,
+						const struct Newton_Options* options, struct Newton_Report* report) {
+	memset(solution, 0, sizeof(struct ODE_Solution));
+	memset(report, 0, sizeof(struct Newton_Report));
+	double begin = now_seconds();
+	size_t n = input_mesh->num_nodes;
+	if (options->initial_guess != NULL && options->initial_guess->size != n) {
+		printf("The initial guess has %zu values for a mesh of %zu nodes.\n", options->initial_guess->size, n);
+		return 1;
+	}
+
+	struct Newton_System s = {0};
+	s.a = a;
+	s.g = g;
+	s.n = n;
+	struct Coefficient_Function a_function = {NULL, NULL, NULL, a};
+	struct Coefficient_Function b_function = {NULL, NULL, NULL, 0};
+	if (create_coefficient_table(&s.table, input_mesh, &a_function, &b_function)) {
+		return 1;
+	}
+
+	int max_points = 0;
+	for (uint32_t k = 0; k < s.table.num_blocks; k++) {
+		max_points = (s.table.blocks[k].num_points > max_points) ? s.table.blocks[k].num_points : max_points;
+	}
+	struct Band_Matrix J;
+	int bandwidth = mesh_bandwidth(input_mesh);
+	s.F = assemble_variable_vector(&s.table, function_field);
+	solution->solution_coeff = gsl_vector_alloc(n);
+	double* work = malloc((4*n + 3*(size_t) max_points*ELEMENT_BLOCK)*sizeof(double));
+	if (s.F == NULL || solution->solution_coeff == NULL || work == NULL || create_band_matrix(&J, n, bandwidth, bandwidth)) {
+		printf("Error allocating the Newton solve of %zu nodes.\n", n);
+		if (s.F != NULL) {
+			gsl_vector_free(s.F);
+		}
+		if (solution->solution_coeff != NULL) {
+			gsl_vector_free(solution->solution_coeff);
+			solution->solution_coeff = NULL;
+		}
+		free(work);
+		free_coefficient_table(&s.table);
+		return 1;
+	}
+	STATS_ALLOC((4*n + 3*(size_t) max_points*ELEMENT_BLOCK)*sizeof(double));
+	s.Gy = work + 3*n;
+	s.yq = work + 4*n;
+	s.gq = s.yq + max_points*ELEMENT_BLOCK;
+	s.dgq = s.gq + max_points*ELEMENT_BLOCK;
+
+	double* y = solution->solution_coeff->data;
+	if (options->initial_guess != NULL) {
+		gsl_vector_memcpy(solution->solution_coeff, options->initial_guess);
+	}
+	else {
+		const double* x = input_mesh->node_coordinates;
+		for (size_t i = 0; i < n; i++) {
+			y[i] = d1 + (d2 - d1)*(x[i] - x[0])/(x[n - 1] - x[0]);
+		}
+	}
+	y[0] = d1;
+	y[n - 1] = d2;
+
+	TRACE_SPAN_START(newton_span);
+	int steps = (options->continuation_steps > 1) ? options->continuation_steps : 1;
+	int status = 0;
+	for (int step = 1; step <= steps && status == 0; step++) {
+		s.lambda = (double) step/steps;
+		report->continuation_steps++;
+		status = newton_iterate(&s, y, options, &J, work, report);
+		report->converged = (status == 0 && report->residual <= ((options->tolerance > 0) ? options->tolerance : NEWTON_DEFAULT_TOLERANCE));
+		if (!report->converged) {
+			break;
+		}
+	}
+	TRACE_SPAN_STOP(newton_span, "newton", "solver");
+
+	report->seconds = now_seconds() - begin;
+	report->seconds_per_iteration = (report->iterations > 0) ? report->seconds/report->iterations : 0;
+	STATS_COUNT(STATS_ITERATIONS, report->iterations);
+
+	free(work);
+	free_band_matrix(&J);
+	gsl_vector_free(s.F);
+	free_coefficient_table(&s.table);
+	if (status) {
+		gsl_vector_free(solution->solution_coeff);
+		solution->solution_coeff = NULL;
+	}
+
+	return status;
+
+}
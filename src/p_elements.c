@@ -0,0 +1,417 @@
+/* Arbitrary-order (p) elements
+ *
+ * The shape functions of an element of order p are hierarchical: the two linear vertex functions and the Lobatto bubbles
+ *	phi_k(zeta) = (P_k(zeta) - P_k-2(zeta))/sqrt(2(2k - 1)),	k = 2..p
+ * of the Legendre polynomials P_k, whose derivatives are the orthogonal sqrt((2k - 1)/2) P_k-1.
+ * Raising p only adds functions, so an element's lower-order unknowns keep their meaning (which is what order elevation relies on),
+ * and the element matrices of the bubbles stay well conditioned up to P_MAX_ORDER.
+ * The elements are straight, so the Jacobian is constant, and each order has its own Gauss-Legendre table of P_QUADRATURE_POINTS(p) points.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <gsl/gsl_integration.h>
+
+#include "p_elements.h"
+#include "band_matrix.h"
+#include "solver_stats.h"
+#include "trace.h"
+
+#define P_MAX_POINTS P_QUADRATURE_POINTS(P_MAX_ORDER)
+
+// Shape functions of an element of order p at its quadrature points, in the local order of its unknowns (left vertex, bubbles, right vertex)
+struct P_Quadrature_Table {
+	int num_points;
+	double weights[P_MAX_POINTS];
+	double points[P_MAX_POINTS];
+	double N[P_MAX_ORDER + 1][P_MAX_POINTS];
+	double dN[P_MAX_ORDER + 1][P_MAX_POINTS];
+
+};
+
+static struct P_Quadrature_Table p_tables[P_MAX_ORDER + 1]; // Indexed by order
+static pthread_once_t p_tables_once = PTHREAD_ONCE_INIT;
+
+static double legendre(int k, double zeta) {
+	if (k == 0) {
+		return 1;
+	}
+
+	double previous = 1, current = zeta;
+	for (int n = 1; n < k; n++) {
+		double next = ((2*n + 1)*zeta*current - n*previous)/(n + 1);
+		previous = current;
+		current = next;
+	}
+
+	return current;
+
+}
+
+// k = 0 and 1 are the left and right vertex functions, k >= 2 the bubbles
+double lobatto_shape(int k, double zeta) {
+	switch (k) {
+		case 0:
+			return (1 - zeta)/2;
+		case 1:
+			return (1 + zeta)/2;
+	}
+
+	return (legendre(k, zeta) - legendre(k - 2, zeta))/sqrt(2.0*(2*k - 1));
+
+}
+
+double lobatto_derivative(int k, double zeta) {
+	switch (k) {
+		case 0:
+			return -0.5;
+		case 1:
+			return 0.5;
+	}
+
+	return sqrt((2*k - 1)/2.0)*legendre(k - 1, zeta);
+
+}
+
+// Lobatto function of the i-th local unknown of an element of order p
+static int local_function(int i, int p) {
+	if (i == 0) {
+		return 0;
+	}
+
+	return (i == p) ? 1 : i + 1;
+
+}
+
+static void build_p_tables() {
+	for (int p = 1; p <= P_MAX_ORDER; p++) {
+		struct P_Quadrature_Table* t = &p_tables[p];
+		int num_points = P_QUADRATURE_POINTS(p);
+		gsl_integration_fixed_workspace* w = gsl_integration_fixed_alloc(gsl_integration_fixed_legendre, num_points, -1, 1, 0, 0);
+		if (w == NULL) {
+			printf("Error allocating the %d point quadrature rule.\n", num_points);
+			t->num_points = 0;
+			continue;
+		}
+
+		const double* nodes = gsl_integration_fixed_nodes(w);
+		const double* weights = gsl_integration_fixed_weights(w);
+		for (int q = 0; q < num_points; q++) {
+			t->points[q] = nodes[q];
+			t->weights[q] = weights[q];
+			for (int i = 0; i <= p; i++) {
+				t->N[i][q] = lobatto_shape(local_function(i, p), nodes[q]);
+				t->dN[i][q] = lobatto_derivative(local_function(i, p), nodes[q]);
+			}
+		}
+		t->num_points = num_points;
+		gsl_integration_fixed_free(w);
+	}
+
+}
+
+// NULL if the order is out of range or its rule could not be built
+static const struct P_Quadrature_Table* p_table(int p) {
+	if (p < 1 || p > P_MAX_ORDER) {
+		return NULL;
+	}
+	pthread_once(&p_tables_once, build_p_tables);
+
+	return (p_tables[p].num_points > 0) ? &p_tables[p] : NULL;
+
+}
+
+// Copies the vertices (num_elements + 1, increasing) and the element orders
+int create_p_mesh(struct P_Mesh* mesh, const double* vertices, uint32_t num_elements, const int* order) {
+	if (num_elements < 1) {
+		printf("A p-element mesh needs at least one element.\n");
+		return 1;
+	}
+	for (uint32_t e = 0; e < num_elements; e++) {
+		if (order[e] < 1 || order[e] > P_MAX_ORDER || !(vertices[e + 1] > vertices[e])) {
+			printf("Element %u needs an order between 1 and %d and increasing vertices.\n", e, P_MAX_ORDER);
+			return 1;
+		}
+	}
+
+	mesh->num_elements = num_elements;
+	mesh->vertices = malloc((num_elements + 1)*sizeof(double));
+	mesh->order = malloc(num_elements*sizeof(int));
+	mesh->first_dof = malloc((num_elements + 1)*sizeof(size_t));
+	if (mesh->vertices == NULL || mesh->order == NULL || mesh->first_dof == NULL) {
+		printf("Error allocating a p-element mesh of %u elements.\n", num_elements);
+		free_p_mesh(mesh);
+		return 1;
+	}
+	STATS_ALLOC((num_elements + 1)*(sizeof(double) + sizeof(size_t)) + num_elements*sizeof(int));
+
+	memcpy(mesh->vertices, vertices, (num_elements + 1)*sizeof(double));
+	memcpy(mesh->order, order, num_elements*sizeof(int));
+	mesh->first_dof[0] = 0;
+	mesh->max_order = 1;
+	for (uint32_t e = 0; e < num_elements; e++) {
+		mesh->first_dof[e + 1] = mesh->first_dof[e] + order[e];
+		if (order[e] > mesh->max_order) {
+			mesh->max_order = order[e];
+		}
+	}
+	mesh->num_dofs = mesh->first_dof[num_elements] + 1;
+
+	return 0;
+
+}
+
+int generate_uniform_p_mesh(struct P_Mesh* mesh, double start, double end, uint32_t num_elements, int order) {
+	if (end <= start || num_elements < 1) {
+		printf("Cannot generate a mesh of %u elements over [%f, %f].\n", num_elements, start, end);
+		return 1;
+	}
+
+	double* vertices = malloc((num_elements + 1)*sizeof(double));
+	int* orders = malloc(num_elements*sizeof(int));
+	if (vertices == NULL || orders == NULL) {
+		printf("Error allocating a p-element mesh of %u elements.\n", num_elements);
+		free(vertices);
+		free(orders);
+		return 1;
+	}
+
+	double h = (end - start)/num_elements;
+	for (uint32_t e = 0; e < num_elements; e++) {
+		vertices[e] = start + e*h;
+		orders[e] = order;
+	}
+	vertices[num_elements] = end;
+
+	int status = create_p_mesh(mesh, vertices, num_elements, orders);
+	free(vertices);
+	free(orders);
+
+	return status;
+
+}
+
+// The mesh file gives the element count, a line "x order" for the left vertex and order of each element, and a last line with the right end,
+// so meshes mixing element orders (the output of solve_ode_hp()) can be written and read back
+int parse_p_mesh_file(FILE* input_stream, struct P_Mesh* mesh) {
+	unsigned int num_elements;
+	if (fscanf(input_stream, "%u", &num_elements) != 1 || num_elements < 1) {
+		printf("The p-element mesh file does not start with an element count.\n");
+		return 1;
+	}
+
+	double* vertices = malloc((num_elements + 1)*sizeof(double));
+	int* orders = malloc(num_elements*sizeof(int));
+	if (vertices == NULL || orders == NULL) {
+		printf("Error allocating a p-element mesh of %u elements.\n", num_elements);
+		free(vertices);
+		free(orders);
+		return 1;
+	}
+
+	int status = 0;
+	for (uint32_t e = 0; e < num_elements && status == 0; e++) {
+		if (fscanf(input_stream, "%lf %d", &vertices[e], &orders[e]) != 2) {
+			printf("The p-element mesh file is malformed at element %u.\n", e);
+			status = 1;
+		}
+	}
+	if (status == 0 && fscanf(input_stream, "%lf", &vertices[num_elements]) != 1) {
+		printf("The p-element mesh file is missing the right end of the mesh.\n");
+		status = 1;
+	}
+	if (status == 0) {
+		status = create_p_mesh(mesh, vertices, num_elements, orders);
+	}
+	free(vertices);
+	free(orders);
+
+	return status;
+
+}
+
+int output_p_mesh_file(const struct P_Mesh* mesh, FILE* output_stream) {
+	fprintf(output_stream, "%u\n", mesh->num_elements);
+	for (uint32_t e = 0; e < mesh->num_elements; e++) {
+		fprintf(output_stream, "%.17g %d\n", mesh->vertices[e], mesh->order[e]);
+	}
+	fprintf(output_stream, "%.17g\n", mesh->vertices[mesh->num_elements]);
+
+	return ferror(output_stream) ? 1 : 0;
+
+}
+
+void free_p_mesh(struct P_Mesh* mesh) {
+	free(mesh->vertices);
+	free(mesh->order);
+	free(mesh->first_dof);
+	mesh->vertices = NULL;
+	mesh->order = NULL;
+	mesh->first_dof = NULL;
+
+}
+
+// Element matrix k[i][j] and load vector F[i] of element e
+static int p_element_arrays(struct P_Mesh* mesh, uint32_t e, double a, double b, struct Function_Field *function_field,
+							double k[P_MAX_ORDER + 1][P_MAX_ORDER + 1], double F[P_MAX_ORDER + 1]) {
+	int p = mesh->order[e];
+	const struct P_Quadrature_Table* t = p_table(p);
+	if (t == NULL) {
+		return 1;
+	}
+
+	double x0 = mesh->vertices[e];
+	double J = (mesh->vertices[e + 1] - x0)/2;
+	double xq[P_MAX_POINTS], fq[P_MAX_POINTS];
+	for (int q = 0; q < t->num_points; q++) {
+		xq[q] = x0 + (t->points[q] + 1)*J;
+	}
+	int status = f_eval_batch(function_field, xq, t->num_points, fq);
+
+	for (int i = 0; i <= p; i++) {
+		F[i] = 0;
+		for (int j = 0; j <= p; j++) {
+			k[i][j] = 0;
+		}
+	}
+	for (int q = 0; q < t->num_points; q++) {
+		double w = t->weights[q];
+		for (int i = 0; i <= p; i++) {
+			// The three terms of coefficient_matrix_composition()
+			for (int j = 0; j <= p; j++) {
+				k[i][j] += w*(-1*t->dN[i][q]*t->dN[j][q]/J + a*t->N[i][q]*t->dN[j][q] + b*t->N[i][q]*t->N[j][q]*J);
+			}
+			F[i] += w*fq[q]*t->N[i][q]*J;
+		}
+	}
+	STATS_COUNT(STATS_QUAD_EVALS, (p + 1)*(p + 2)*t->num_points);
+
+	return status;
+
+}
+
+// Assembles the band coefficient matrix (created here) and the constant vector; neither has the boundary rows applied
+int assemble_p_system(struct P_Mesh* mesh, double a, double b, struct Function_Field *function_field, struct Band_Matrix* K_coeff, gsl_vector** F_const) {
+	if (create_band_matrix(K_coeff, mesh->num_dofs, mesh->max_order, mesh->max_order)) {
+		return 1;
+	}
+	gsl_vector* F = gsl_vector_calloc(mesh->num_dofs);
+	if (F == NULL) {
+		printf("Error allocating the constant vector of %zu degrees of freedom.\n", mesh->num_dofs);
+		free_band_matrix(K_coeff);
+		return 1;
+	}
+	STATS_ALLOC(mesh->num_dofs*sizeof(double));
+
+	TRACE_SPAN_START(assembly_span);
+	for (uint32_t e = 0; e < mesh->num_elements; e++) {
+		double k[P_MAX_ORDER + 1][P_MAX_ORDER + 1], F_e[P_MAX_ORDER + 1];
+
+		STATS_TIMER_START(kernel_timer);
+		int status = p_element_arrays(mesh, e, a, b, function_field, k, F_e);
+		STATS_TIMER_STOP(kernel_timer, STATS_LOCAL_KERNELS);
+		if (status) {
+			printf("Error computing the arrays of element %u (order %d).\n", e, mesh->order[e]);
+			free_band_matrix(K_coeff);
+			gsl_vector_free(F);
+			return 1;
+		}
+
+		STATS_TIMER_START(scatter_timer);
+		size_t first = mesh->first_dof[e];
+		for (int i = 0; i <= mesh->order[e]; i++) {
+			for (int j = 0; j <= mesh->order[e]; j++) {
+				band_matrix_add(K_coeff, first + i, first + j, k[i][j]);
+			}
+			*gsl_vector_ptr(F, first + i) += F_e[i];
+		}
+		STATS_TIMER_STOP(scatter_timer, STATS_SCATTER);
+	}
+	STATS_COUNT(STATS_ELEMENTS, mesh->num_elements);
+	TRACE_SPAN_STOP(assembly_span, "assemble p-elements", "solver");
+
+	*F_const = F;
+	return 0;
+
+}
+
+// Solves with the banded LU; the solution holds the num_dofs coefficients (see struct P_Mesh)
+int solve_ode_p(struct P_Mesh* mesh, gsl_vector** solution, double a, double b, double d1, double d2, struct Function_Field *function_field) {
+	struct Band_Matrix K_coeff;
+	gsl_vector* F_const;
+	if (assemble_p_system(mesh, a, b, function_field, &K_coeff, &F_const)) {
+		return 1;
+	}
+
+	// The first and last unknowns are the end vertices
+	STATS_TIMER_START(bc_timer);
+	band_matrix_set_row_identity(&K_coeff, 0);
+	band_matrix_set_row_identity(&K_coeff, mesh->num_dofs - 1);
+	gsl_vector_set(F_const, 0, d1);
+	gsl_vector_set(F_const, mesh->num_dofs - 1, d2);
+	STATS_TIMER_STOP(bc_timer, STATS_BC);
+
+	if (band_lu_decomp(&K_coeff) || band_lu_solve(&K_coeff, F_const, F_const)) {
+		free_band_matrix(&K_coeff);
+		gsl_vector_free(F_const);
+		return 1;
+	}
+	free_band_matrix(&K_coeff);
+
+	*solution = F_const;
+	return 0;
+
+}
+
+// y (and dy/dx unless dydx_out is NULL) at points within the mesh, in any order
+int evaluate_p_solution(struct P_Mesh* mesh, const gsl_vector* solution, const double* x_query, size_t num_points, double* y_out, double* dydx_out) {
+	const double* v = mesh->vertices;
+	for (size_t n = 0; n < num_points; n++) {
+		double x = x_query[n];
+		if (x < v[0] || x > v[mesh->num_elements]) {
+			printf("The point %f is outside of the mesh.\n", x);
+			return 1;
+		}
+
+		// The last element whose left vertex is at or before x
+		uint32_t low = 0, high = mesh->num_elements - 1;
+		while (low < high) {
+			uint32_t mid = low + (high - low + 1)/2;
+			if (v[mid] <= x) {
+				low = mid;
+			}
+			else {
+				high = mid - 1;
+			}
+		}
+
+		int p = mesh->order[low];
+		double J = (v[low + 1] - v[low])/2;
+		double zeta = (x - v[low])/J - 1;
+
+		// One recurrence gives every Legendre polynomial the bubbles need
+		double P[P_MAX_ORDER + 1];
+		P[0] = 1;
+		P[1] = zeta;
+		for (int k = 1; k < p; k++) {
+			P[k + 1] = ((2*k + 1)*zeta*P[k] - k*P[k - 1])/(k + 1);
+		}
+
+		const double* c = &solution->data[mesh->first_dof[low]];
+		double y = c[0]*(1 - zeta)/2 + c[p]*(1 + zeta)/2;
+		double dy = (c[p] - c[0])/2;
+		for (int k = 2; k <= p; k++) {
+			y += c[k - 1]*(P[k] - P[k - 2])/sqrt(2.0*(2*k - 1));
+			dy += c[k - 1]*sqrt((2*k - 1)/2.0)*P[k - 1];
+		}
+		y_out[n] = y;
+		if (dydx_out != NULL) {
+			dydx_out[n] = dy/J;
+		}
+	}
+
+	return 0;
+
+}
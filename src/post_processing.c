@@ -0,0 +1,333 @@
+/* Post-processing routines that work on a solved mesh
+ *
+ */
+#include "post_processing.h"
+
+// Node IDs at either end of an element, from the connectivity grid
+static int element_first_node(struct Mesh* input_mesh, size_t e) {
+	switch (input_mesh->connectivity_grid[e].kind) {
+		case LINEAR:
+			return input_mesh->connectivity_grid[e].node_list.L2.node_id[0];
+		case QUAD:
+			return input_mesh->connectivity_grid[e].node_list.L3.node_id[0];
+	}
+
+	return -1;
+
+}
+
+static int element_last_node(struct Mesh* input_mesh, size_t e) {
+	switch (input_mesh->connectivity_grid[e].kind) {
+		case LINEAR:
+			return input_mesh->connectivity_grid[e].node_list.L2.node_id[1];
+		case QUAD:
+			return input_mesh->connectivity_grid[e].node_list.L3.node_id[2];
+	}
+
+	return -1;
+
+}
+
+// Finds the first element, at or after `start`, whose right end is at or beyond x.
+// Sorted queries usually land in the same or the next element, so walk a few elements before falling back to a binary search.
+static size_t locate_element(struct Mesh* input_mesh, size_t start, double x) {
+	size_t last = input_mesh->num_elements - 1;
+
+	for (int step = 0; step < 4 && start < last; step++, start++) {
+		if (x <= input_mesh->node_coordinates[element_last_node(input_mesh, start)]) {
+			return start;
+		}
+	}
+
+	size_t low = start, high = last;
+	while (low < high) {
+		size_t mid = low + (high - low)/2;
+		if (input_mesh->node_coordinates[element_last_node(input_mesh, mid)] < x) {
+			low = mid + 1;
+		}
+		else {
+			high = mid;
+		}
+	}
+
+	return low;
+
+}
+
+// Evaluates a batch of points that all lie within element e.
+// The points are first mapped to isoparametric coordinates, then the shape functions are applied over the whole batch.
+static void evaluate_element_batch(struct Mesh* input_mesh, struct ODE_Solution* input_solution, size_t e, const double* x, size_t count, double* y, double* dydx) {
+	double zeta[EVALUATION_BATCH];
+	struct Element_Linear* element = &input_mesh->elements[e];
+	int first_node = element_first_node(input_mesh, e);
+
+	switch (element->kind) {
+		case LINEAR: {
+			double x1 = element->element.L2.node_coord[0];
+			double x2 = element->element.L2.node_coord[1];
+			double y1 = gsl_vector_get(input_solution->solution_coeff, first_node);
+			double y2 = gsl_vector_get(input_solution->solution_coeff, first_node + 1);
+
+			// The L2 mapping is affine, so it inverts directly
+			for (size_t k = 0; k < count; k++) {
+				zeta[k] = (2*x[k] - x1 - x2)/(x2 - x1);
+			}
+
+			for (size_t k = 0; k < count; k++) {
+				y[k] = y1*L2_N0(zeta[k]) + y2*L2_N1(zeta[k]);
+			}
+
+			if (dydx != NULL) {
+				double jacobian = (x2 - x1)/2;
+				for (size_t k = 0; k < count; k++) {
+					dydx[k] = (y1*L2_N0_D(zeta[k]) + y2*L2_N1_D(zeta[k]))/jacobian;
+				}
+			}
+			break;
+		}
+		case QUAD: {
+			double x1 = element->element.L3.node_coord[0];
+			double x2 = element->element.L3.node_coord[1];
+			double x3 = element->element.L3.node_coord[2];
+			double y1 = gsl_vector_get(input_solution->solution_coeff, first_node);
+			double y2 = gsl_vector_get(input_solution->solution_coeff, first_node + 1);
+			double y3 = gsl_vector_get(input_solution->solution_coeff, first_node + 2);
+			// The L3 mapping x(zeta) = c + b*zeta + a*zeta^2 is quadratic unless the middle node is centered.
+			// Invert it in closed form, taking the root inside the element (the one nearest the affine guess if there are two).
+			double a = (x1 - 2*x2 + x3)/2;
+			double b = (x3 - x1)/2;
+			for (size_t k = 0; k < count; k++) {
+				double c = x2 - x[k];
+				double z = (2*x[k] - x1 - x3)/(x3 - x1);
+
+				if (fabs(a) > 1e-12*fabs(b)) {
+					double discriminant = fmax(0, b*b - 4*a*c);
+					double q = -0.5*(b + copysign(sqrt(discriminant), b));
+					double root1 = q/a;
+					double root2 = (q != 0) ? c/q : root1;
+					bool root1_inside = fabs(root1) <= 1 + 1e-12;
+					bool root2_inside = fabs(root2) <= 1 + 1e-12;
+
+					if (root1_inside && (!root2_inside || fabs(root1 - z) < fabs(root2 - z))) {
+						z = root1;
+					}
+					else {
+						z = root2;
+					}
+				}
+				zeta[k] = fmin(1, fmax(-1, z));
+			}
+
+			for (size_t k = 0; k < count; k++) {
+				y[k] = y1*L3_N0(zeta[k]) + y2*L3_N1(zeta[k]) + y3*L3_N2(zeta[k]);
+			}
+
+			if (dydx != NULL) {
+				for (size_t k = 0; k < count; k++) {
+					double jacobian = x1*L3_N0_D(zeta[k]) + x2*L3_N1_D(zeta[k]) + x3*L3_N2_D(zeta[k]);
+					dydx[k] = (y1*L3_N0_D(zeta[k]) + y2*L3_N1_D(zeta[k]) + y3*L3_N2_D(zeta[k]))/jacobian;
+				}
+			}
+			break;
+		}
+	}
+
+}
+
+// Checks that the points are ascending and within the mesh domain
+static int check_query_points(struct Mesh* input_mesh, const double* x_query, size_t num_points) {
+	if (num_points == 0) {
+		return 0;
+	}
+
+	double x_start = input_mesh->node_coordinates[0];
+	double x_end = input_mesh->node_coordinates[input_mesh->num_nodes - 1];
+	if (x_query[0] < x_start || x_query[num_points - 1] > x_end) {
+		printf("Query points must lie within the mesh domain [%f, %f].\n", x_start, x_end);
+		return 1;
+	}
+
+	// The element search only moves forward
+	for (size_t i = 1; i < num_points; i++) {
+		if (x_query[i] < x_query[i - 1]) {
+			printf("Query points must be sorted in ascending order; point %zu (%f) is less than point %zu (%f).\n", i, x_query[i], i - 1, x_query[i - 1]);
+			return 1;
+		}
+	}
+
+	return 0;
+
+}
+
+int evaluate_solution(struct Mesh* input_mesh, struct ODE_Solution* input_solution, const double* x_query, size_t num_points, double* y_out, double* dydx_out) {
+	if (input_mesh->node_coordinates == NULL || input_mesh->connectivity_grid == NULL || input_solution->solution_coeff == NULL) {
+		printf("Either the mesh or solution structure are not fully initialized.\n");
+		return 1;
+	}
+
+	if (check_query_points(input_mesh, x_query, num_points)) {
+		return 1;
+	}
+
+	size_t e = 0;
+	size_t p = 0;
+	while (p < num_points) {
+		e = locate_element(input_mesh, e, x_query[p]);
+		double x_right = input_mesh->node_coordinates[element_last_node(input_mesh, e)];
+
+		// Gather the run of points that fall within this element
+		size_t end = p + 1;
+		while (end < num_points && x_query[end] <= x_right && end - p < EVALUATION_BATCH) {
+			end++;
+		}
+
+		evaluate_element_batch(input_mesh, input_solution, e, x_query + p, end - p, y_out + p, dydx_out == NULL ? NULL : dydx_out + p);
+		p = end;
+	}
+
+	return 0;
+
+}
+
+int compute_qoi(struct Mesh* input_mesh, struct ODE_Solution* input_solution, struct QoI_Request* request, struct QoI_Result* result) {
+	memset(result, 0, sizeof(struct QoI_Result));
+
+	if (input_mesh->node_coordinates == NULL || input_mesh->connectivity_grid == NULL || input_solution->solution_coeff == NULL) {
+		printf("Either the mesh or solution structure are not fully initialized.\n");
+		return 1;
+	}
+
+	unsigned int flags = request->flags;
+	size_t num_probes = (flags & QOI_PROBES) ? request->num_probes : 0;
+	if (check_query_points(input_mesh, request->probe_points, num_probes)) {
+		return 1;
+	}
+
+	if (num_probes > 0) {
+		result->probe_values = malloc(num_probes*sizeof(double));
+		if (result->probe_values == NULL) {
+			printf("Error allocating %zu probe values.\n", num_probes);
+			return 1;
+		}
+	}
+	result->num_probes = num_probes;
+
+	// Quadrature rule for the integral; the same Gauss-Legendre rule as the element routines
+	gsl_integration_fixed_workspace* w = NULL;
+	const double* quad_nodes = NULL;
+	const double* quad_weights = NULL;
+	if (flags & QOI_INTEGRAL) {
+		w = gsl_integration_fixed_alloc(gsl_integration_fixed_legendre,
+				QOI_QUADRATURE_POINTS,
+				-1,
+				1,
+				0, // Ignored
+				0 // Ignored
+				);
+		if (w == NULL) {
+			printf("Error allocating the %d point quadrature rule.\n", QOI_QUADRATURE_POINTS);
+			free(result->probe_values);
+			result->probe_values = NULL;
+			result->num_probes = 0;
+			return 1;
+		}
+		quad_nodes = gsl_integration_fixed_nodes(w);
+		quad_weights = gsl_integration_fixed_weights(w);
+	}
+
+	gsl_vector* y = input_solution->solution_coeff;
+	double integral = 0;
+	double max_abs = -1;
+	double max_abs_location = 0;
+	size_t probe = 0;
+
+	// Single pass over the elements
+	for (size_t e = 0; e < input_mesh->num_elements; e++) {
+		struct Element_Linear* element = &input_mesh->elements[e];
+		int first_node = element_first_node(input_mesh, e);
+		int last_node = element_last_node(input_mesh, e);
+
+		if (flags & QOI_INTEGRAL) {
+			double element_integral = 0;
+			switch (element->kind) {
+				case LINEAR: {
+					double jacobian = (element->element.L2.node_coord[1] - element->element.L2.node_coord[0])/2;
+					double y1 = gsl_vector_get(y, first_node);
+					double y2 = gsl_vector_get(y, first_node + 1);
+					for (int q = 0; q < QOI_QUADRATURE_POINTS; q++) {
+						double z = quad_nodes[q];
+						element_integral += quad_weights[q]*(y1*L2_N0(z) + y2*L2_N1(z))*jacobian;
+					}
+					break;
+				}
+				case QUAD: {
+					double* x = element->element.L3.node_coord;
+					double y1 = gsl_vector_get(y, first_node);
+					double y2 = gsl_vector_get(y, first_node + 1);
+					double y3 = gsl_vector_get(y, first_node + 2);
+					for (int q = 0; q < QOI_QUADRATURE_POINTS; q++) {
+						double z = quad_nodes[q];
+						double jacobian = x[0]*L3_N0_D(z) + x[1]*L3_N1_D(z) + x[2]*L3_N2_D(z);
+						element_integral += quad_weights[q]*(y1*L3_N0(z) + y2*L3_N1(z) + y3*L3_N2(z))*jacobian;
+					}
+					break;
+				}
+			}
+			integral += element_integral;
+		}
+
+		if (flags & QOI_MAX_ABS) {
+			// Shared end nodes are visited twice, which does not change the maximum
+			for (int n = first_node; n <= last_node; n++) {
+				double value = fabs(gsl_vector_get(y, n));
+				if (value > max_abs) {
+					max_abs = value;
+					max_abs_location = input_mesh->node_coordinates[n];
+				}
+			}
+		}
+
+		// Probes that fall within this element, in batches
+		double x_right = input_mesh->node_coordinates[last_node];
+		while (probe < num_probes && request->probe_points[probe] <= x_right) {
+			size_t end = probe + 1;
+			while (end < num_probes && request->probe_points[end] <= x_right && end - probe < EVALUATION_BATCH) {
+				end++;
+			}
+			evaluate_element_batch(input_mesh, input_solution, e, request->probe_points + probe, end - probe, result->probe_values + probe, NULL);
+			probe = end;
+		}
+	}
+
+	if (w != NULL) {
+		gsl_integration_fixed_free(w);
+	}
+
+	if (flags & (QOI_FLUX_START | QOI_FLUX_END)) {
+		double y_unused;
+		double x_start = input_mesh->node_coordinates[0];
+		double x_end = input_mesh->node_coordinates[input_mesh->num_nodes - 1];
+
+		if (flags & QOI_FLUX_START) {
+			evaluate_element_batch(input_mesh, input_solution, 0, &x_start, 1, &y_unused, &result->flux_start);
+		}
+
+		if (flags & QOI_FLUX_END) {
+			evaluate_element_batch(input_mesh, input_solution, input_mesh->num_elements - 1, &x_end, 1, &y_unused, &result->flux_end);
+		}
+	}
+
+	result->flags = flags;
+	result->integral = integral;
+	result->max_abs = max_abs;
+	result->max_abs_location = max_abs_location;
+
+	return 0;
+
+}
+
+void free_qoi_result(struct QoI_Result* result) {
+	free(result->probe_values);
+	result->probe_values = NULL;
+
+}
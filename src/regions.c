@@ -0,0 +1,417 @@
+/* Region (material) meshes
+ *
+ * Layered media have a constant A and B in each layer, and studies of them change one layer at a time.
+ * The element matrices are linear in A and B, so each element's stiffness, convection and mass parts are integrated once and kept, grouped by region.
+ * Changing a region then only reassembles the band rows of its nodes, from its own elements and the elements of other regions that share its end nodes,
+ * which changes no row before the region's first node; the decomposition keeps its factors of the columns before that row and only eliminates the rest again (band_lu_refactor()).
+ * The rows are summed again from the cached operators rather than corrected by the change in A and B, so thousands of updates do not accumulate rounding errors.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "regions.h"
+#include "solver_stats.h"
+#include "trace.h"
+
+// Gives a mesh its regions (copies of the arrays), replacing any it had
+int assign_mesh_regions(struct Mesh* input_mesh, const uint32_t* element_region, const struct Mesh_Region* regions, uint32_t num_regions) {
+	for (uint32_t e = 0; e < input_mesh->num_elements; e++) {
+		if (element_region[e] >= num_regions) {
+			printf("Element %u is in region %u, but the mesh has %u regions.\n", e, element_region[e], num_regions);
+			return 1;
+		}
+	}
+
+	uint32_t* element_copy = malloc(input_mesh->num_elements*sizeof(uint32_t));
+	struct Mesh_Region* region_copy = malloc(num_regions*sizeof(struct Mesh_Region));
+	if (element_copy == NULL || region_copy == NULL) {
+		printf("Error allocating the %u regions of a mesh of %u elements.\n", num_regions, input_mesh->num_elements);
+		free(element_copy);
+		free(region_copy);
+		return 1;
+	}
+	STATS_ALLOC(input_mesh->num_elements*sizeof(uint32_t) + num_regions*sizeof(struct Mesh_Region));
+	memcpy(element_copy, element_region, input_mesh->num_elements*sizeof(uint32_t));
+	memcpy(region_copy, regions, num_regions*sizeof(struct Mesh_Region));
+
+	free(input_mesh->element_region);
+	free(input_mesh->regions);
+	input_mesh->element_region = element_copy;
+	input_mesh->regions = region_copy;
+	input_mesh->num_regions = num_regions;
+
+	return 0;
+
+}
+
+// Elements in region order (counting sort), so that each region's blocks are contiguous
+static uint32_t* order_by_region(const struct Mesh* input_mesh, size_t* region_start) {
+	uint32_t* order = malloc(input_mesh->num_elements*sizeof(uint32_t));
+	if (order == NULL) {
+		return NULL;
+	}
+
+	memset(region_start, 0, (input_mesh->num_regions + 1)*sizeof(size_t));
+	for (uint32_t e = 0; e < input_mesh->num_elements; e++) {
+		region_start[input_mesh->element_region[e] + 1]++;
+	}
+	for (uint32_t r = 0; r < input_mesh->num_regions; r++) {
+		region_start[r + 1] += region_start[r];
+	}
+
+	size_t* next = malloc(input_mesh->num_regions*sizeof(size_t));
+	if (next == NULL) {
+		free(order);
+		return NULL;
+	}
+	memcpy(next, region_start, input_mesh->num_regions*sizeof(size_t));
+	for (uint32_t e = 0; e < input_mesh->num_elements; e++) {
+		order[next[input_mesh->element_region[e]]++] = e;
+	}
+	free(next);
+
+	return order;
+
+}
+
+// Gathers the elements order[first...] of the same kind (at most last - first) into a block and integrates their operators; returns how many were taken
+static int gather_region_block(const struct Mesh* input_mesh, const uint32_t* order, size_t first, size_t last, struct Region_Block* block) {
+	Element_2D_Type kind = input_mesh->connectivity_grid[order[first]].kind;
+	block->kind = kind;
+	block->size = (kind == QUAD) ? 3 : 2;
+
+	double x[MAX_ELEMENT_NODES][ELEMENT_BLOCK];
+	int count = 0;
+	while (count < ELEMENT_BLOCK && first + count < last && input_mesh->connectivity_grid[order[first + count]].kind == kind) {
+		const struct Element_Conn* conn = &input_mesh->connectivity_grid[order[first + count]];
+		const int* node_id = (kind == QUAD) ? conn->node_list.L3.node_id : conn->node_list.L2.node_id;
+		for (int i = 0; i < block->size; i++) {
+			block->nodes[i][count] = node_id[i];
+			x[i][count] = input_mesh->node_coordinates[node_id[i]];
+		}
+		count++;
+	}
+	block->count = count;
+
+	if (output_operator_block(kind, count, (const double (*)[ELEMENT_BLOCK]) x, block->stiffness, block->convection, block->mass)) {
+		return 0;
+	}
+
+	return count;
+
+}
+
+// Adjacent elements share a node
+static bool elements_adjacent(const struct Mesh* input_mesh, uint32_t e, uint32_t f) {
+	const struct Element_Conn* left = &input_mesh->connectivity_grid[(e < f) ? e : f];
+	const struct Element_Conn* right = &input_mesh->connectivity_grid[(e < f) ? f : e];
+	int left_last = (left->kind == QUAD) ? left->node_list.L3.node_id[2] : left->node_list.L2.node_id[1];
+	int right_first = (right->kind == QUAD) ? right->node_list.L3.node_id[0] : right->node_list.L2.node_id[0];
+
+	return left_last == right_first;
+
+}
+
+// Lists the elements of other regions next to each region; `location` holds each element's place in the blocks
+static int find_region_neighbors(struct Region_Operator* op, const uint32_t* order, const size_t* region_start, const uint32_t* location) {
+	struct Mesh* input_mesh = op->mesh;
+	op->neighbors = malloc(2*input_mesh->num_elements*sizeof(uint32_t));
+	uint32_t* listed_for = malloc(input_mesh->num_elements*sizeof(uint32_t)); // The last region that listed the element
+	if (op->neighbors == NULL || listed_for == NULL) {
+		printf("Error allocating the region neighbors of %u elements.\n", input_mesh->num_elements);
+		free(listed_for);
+		return 1;
+	}
+	STATS_ALLOC(2*input_mesh->num_elements*sizeof(uint32_t));
+	memset(listed_for, 0xff, input_mesh->num_elements*sizeof(uint32_t));
+
+	uint32_t count = 0;
+	for (uint32_t r = 0; r < input_mesh->num_regions; r++) {
+		op->regions[r].first_neighbor = count;
+		for (size_t k = region_start[r]; k < region_start[r + 1]; k++) {
+			uint32_t e = order[k];
+			uint32_t candidates[2] = {e - 1, e + 1};
+			for (int side = 0; side < 2; side++) {
+				uint32_t f = candidates[side];
+				if ((side == 0 && e == 0) || f >= input_mesh->num_elements || input_mesh->element_region[f] == r || listed_for[f] == r || !elements_adjacent(input_mesh, e, f)) {
+					continue;
+				}
+				listed_for[f] = r;
+				op->neighbors[count++] = location[f];
+			}
+		}
+		op->regions[r].num_neighbors = count - op->regions[r].first_neighbor;
+	}
+	free(listed_for);
+
+	return 0;
+
+}
+
+static int build_region_blocks(struct Region_Operator* op) {
+	struct Mesh* input_mesh = op->mesh;
+	size_t* region_start = malloc((input_mesh->num_regions + 1)*sizeof(size_t));
+	uint32_t* order = (region_start != NULL) ? order_by_region(input_mesh, region_start) : NULL;
+	uint32_t* location = malloc(input_mesh->num_elements*sizeof(uint32_t));
+	// One block per ELEMENT_BLOCK elements, and one more at each region or kind change
+	size_t max_blocks = input_mesh->num_elements/ELEMENT_BLOCK + input_mesh->num_regions;
+	for (uint32_t e = 1; order != NULL && e < input_mesh->num_elements; e++) {
+		max_blocks += (input_mesh->connectivity_grid[order[e]].kind != input_mesh->connectivity_grid[order[e - 1]].kind);
+	}
+	op->blocks = (order != NULL) ? malloc(max_blocks*sizeof(struct Region_Block)) : NULL;
+	if (op->blocks == NULL || location == NULL) {
+		printf("Error allocating the element operators of %u elements.\n", input_mesh->num_elements);
+		free(region_start);
+		free(order);
+		free(location);
+		return 1;
+	}
+
+	TRACE_SPAN_START(operator_span);
+	STATS_TIMER_START(kernel_timer);
+	op->num_blocks = 0;
+	for (uint32_t r = 0; r < input_mesh->num_regions; r++) {
+		struct Region_Cache* region = &op->regions[r];
+		region->first_block = op->num_blocks;
+		region->num_blocks = 0;
+		region->first_row = SIZE_MAX;
+
+		size_t e = region_start[r];
+		while (e < region_start[r + 1]) {
+			struct Region_Block* block = &op->blocks[op->num_blocks];
+			int count = gather_region_block(input_mesh, order, e, region_start[r + 1], block);
+			if (count == 0) {
+				free(region_start);
+				free(order);
+				free(location);
+				return 1;
+			}
+			block->region = r;
+			for (int c = 0; c < count; c++) {
+				location[order[e + c]] = op->num_blocks*ELEMENT_BLOCK + c;
+				if (block->nodes[0][c] < region->first_row) {
+					region->first_row = block->nodes[0][c];
+				}
+			}
+			op->num_blocks++;
+			region->num_blocks++;
+			e += count;
+		}
+	}
+	STATS_TIMER_STOP(kernel_timer, STATS_LOCAL_KERNELS);
+	STATS_COUNT(STATS_ELEMENTS, input_mesh->num_elements);
+	TRACE_SPAN_STOP(operator_span, "element operators", "solver");
+	STATS_ALLOC(op->num_blocks*sizeof(struct Region_Block));
+
+	// Only as many blocks as were used are kept
+	struct Region_Block* blocks = realloc(op->blocks, op->num_blocks*sizeof(struct Region_Block));
+	if (blocks != NULL) {
+		op->blocks = blocks;
+	}
+
+	int status = find_region_neighbors(op, order, region_start, location);
+	free(region_start);
+	free(order);
+	free(location);
+
+	return status;
+
+}
+
+// Adds the coefficient matrix of element c of a block, with the A and B of its region, to the rows of K that are marked (all of them without marks);
+// the Dirichlet rows are left alone
+static void add_element(struct Region_Operator* op, const struct Region_Block* block, int c, const unsigned char* marks) {
+	size_t last = op->mesh->num_nodes - 1;
+	double a = op->mesh->regions[block->region].a;
+	double b = op->mesh->regions[block->region].b;
+	int size = block->size;
+
+	for (int i = 0; i < size; i++) {
+		size_t row = block->nodes[i][c];
+		if (row == 0 || row == last || (marks != NULL && !marks[row])) {
+			continue;
+		}
+		for (int j = 0; j < size; j++) {
+			int ij = i*size + j;
+			*band_matrix_ptr(&op->K, row, block->nodes[j][c]) += block->stiffness[ij][c] + a*block->convection[ij][c] + b*block->mass[ij][c];
+		}
+	}
+
+}
+
+// Sums the band rows of the region's nodes again, from its elements and the neighbors that share its end nodes
+static void reassemble_region(struct Region_Operator* op, uint32_t r) {
+	const struct Region_Cache* region = &op->regions[r];
+	const struct Region_Block* blocks = &op->blocks[region->first_block];
+	size_t last = op->mesh->num_nodes - 1;
+
+	STATS_TIMER_START(scatter_timer);
+	for (uint32_t k = 0; k < region->num_blocks; k++) {
+		for (int c = 0; c < blocks[k].count; c++) {
+			for (int i = 0; i < blocks[k].size; i++) {
+				size_t row = blocks[k].nodes[i][c];
+				if (!op->row_marks[row] && row != 0 && row != last) {
+					memset(&op->K.data[row*op->K.width], 0, op->K.width*sizeof(double));
+				}
+				op->row_marks[row] = 1;
+			}
+		}
+	}
+
+	for (uint32_t k = 0; k < region->num_blocks; k++) {
+		for (int c = 0; c < blocks[k].count; c++) {
+			add_element(op, &blocks[k], c, NULL);
+		}
+	}
+	for (uint32_t k = 0; k < region->num_neighbors; k++) {
+		uint32_t location = op->neighbors[region->first_neighbor + k];
+		add_element(op, &op->blocks[location/ELEMENT_BLOCK], location % ELEMENT_BLOCK, op->row_marks);
+	}
+
+	for (uint32_t k = 0; k < region->num_blocks; k++) {
+		for (int c = 0; c < blocks[k].count; c++) {
+			for (int i = 0; i < blocks[k].size; i++) {
+				op->row_marks[blocks[k].nodes[i][c]] = 0;
+			}
+		}
+	}
+	STATS_TIMER_STOP(scatter_timer, STATS_SCATTER);
+
+}
+
+// Integrates and groups the element operators of a mesh with regions, assembles the band with its Dirichlet rows and decomposes it
+int create_region_operator(struct Region_Operator* op, struct Mesh* input_mesh) {
+	memset(op, 0, sizeof(struct Region_Operator));
+	op->mesh = input_mesh;
+	op->first_changed_row = SIZE_MAX;
+	if (input_mesh->num_regions == 0 || input_mesh->element_region == NULL) {
+		printf("A region operator needs a mesh with regions.\n");
+		return 1;
+	}
+
+	op->regions = malloc(input_mesh->num_regions*sizeof(struct Region_Cache));
+	op->row_marks = calloc(input_mesh->num_nodes, 1);
+	if (op->regions == NULL || op->row_marks == NULL) {
+		printf("Error allocating %u regions.\n", input_mesh->num_regions);
+		free_region_operator(op);
+		return 1;
+	}
+	if (build_region_blocks(op)) {
+		free_region_operator(op);
+		return 1;
+	}
+
+	int bandwidth = mesh_bandwidth(input_mesh);
+	if (create_band_matrix(&op->K, input_mesh->num_nodes, bandwidth, bandwidth)) {
+		free_region_operator(op);
+		return 1;
+	}
+	TRACE_SPAN_START(assembly_span);
+	STATS_TIMER_START(scatter_timer);
+	for (uint32_t k = 0; k < op->num_blocks; k++) {
+		for (int c = 0; c < op->blocks[k].count; c++) {
+			add_element(op, &op->blocks[k], c, NULL);
+		}
+	}
+	STATS_TIMER_STOP(scatter_timer, STATS_SCATTER);
+	band_matrix_set_row_identity(&op->K, 0);
+	band_matrix_set_row_identity(&op->K, input_mesh->num_nodes - 1);
+	TRACE_SPAN_STOP(assembly_span, "assemble matrix", "solver");
+
+	if (copy_band_matrix(&op->K_lu, &op->K) || band_lu_decomp_checkpointed(&op->K_lu, &op->checkpoints, 0)) {
+		free_region_operator(op);
+		return 1;
+	}
+
+	return 0;
+
+}
+
+// Gives a region new coefficients; the band is updated at once, and decomposed again (from the region's first row) by the next factorization or solve
+int set_region_coefficients(struct Region_Operator* op, uint32_t region, double a, double b) {
+	if (region >= op->mesh->num_regions) {
+		printf("The mesh has no region %u; it has %u.\n", region, op->mesh->num_regions);
+		return 1;
+	}
+
+	struct Mesh_Region* coefficients = &op->mesh->regions[region];
+	if (a == coefficients->a && b == coefficients->b) {
+		return 0;
+	}
+
+	coefficients->a = a;
+	coefficients->b = b;
+	TRACE_SPAN_START(assembly_span);
+	reassemble_region(op, region);
+	TRACE_SPAN_STOP(assembly_span, "reassemble region", "solver");
+	if (op->regions[region].first_row < op->first_changed_row) {
+		op->first_changed_row = op->regions[region].first_row;
+	}
+
+	return 0;
+
+}
+
+// Brings the decomposition up to date with the regions changed since the last one
+int factorize_region_operator(struct Region_Operator* op) {
+	if (op->first_changed_row == SIZE_MAX) {
+		return 0;
+	}
+
+	int status;
+	if (op->K_lu.factored && op->checkpoints.rows != NULL) {
+		status = band_lu_refactor(&op->K_lu, &op->K, &op->checkpoints, op->first_changed_row);
+	}
+	else {
+		// An earlier decomposition failed part of the way
+		memcpy(op->K_lu.data, op->K.data, op->K.size*op->K.width*sizeof(double));
+		free_band_checkpoints(&op->checkpoints);
+		status = band_lu_decomp_checkpointed(&op->K_lu, &op->checkpoints, 0);
+	}
+
+	if (status) {
+		op->K_lu.factored = false;
+		return 1;
+	}
+	op->first_changed_row = SIZE_MAX;
+
+	return 0;
+
+}
+
+// Solves y'' + A y' + B y = f, with the A and B of each region, for y = d1 and d2 at the ends of the mesh
+int solve_ode_regions(struct Region_Operator* op, struct ODE_Solution* solution, double d1, double d2, struct Function_Field *function_field) {
+	memset(solution, 0, sizeof(struct ODE_Solution));
+	if (factorize_region_operator(op)) {
+		return 1;
+	}
+
+	gsl_vector* F_const = assemble_constant_vector(op->mesh, function_field);
+	if (F_const == NULL) {
+		return 1;
+	}
+
+	solution->solution_coeff = solve_ode_factorized(op->mesh, &op->K_lu, F_const, d1, d2);
+	gsl_vector_free(F_const);
+
+	return (solution->solution_coeff == NULL) ? 1 : 0;
+
+}
+
+void free_region_operator(struct Region_Operator* op) {
+	free(op->regions);
+	free(op->blocks);
+	free(op->neighbors);
+	free(op->row_marks);
+	free_band_matrix(&op->K);
+	free_band_matrix(&op->K_lu);
+	free_band_checkpoints(&op->checkpoints);
+	op->regions = NULL;
+	op->blocks = NULL;
+	op->neighbors = NULL;
+	op->row_marks = NULL;
+
+}
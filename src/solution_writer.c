@@ -0,0 +1,383 @@
+/* Buffered solution writer
+ *
+ * Submitted solutions are copied and queued; a background thread formats them into a large buffer that is handed to fwrite in one go.
+ * This lets the caller move on to the next solve while the previous solution is still being written.
+ *
+ * WRITER_BINARY layout (native endianness):
+ *	char magic[8] = "ODESOL01"
+ *	Then, per record:
+ *		uint64_t index (UINT64_MAX if WRITER_NO_INDEX)
+ *		uint64_t num_nodes
+ *		double x[num_nodes]
+ *		double y[num_nodes]
+ */
+#include "solution_writer.h"
+#include "trace.h"
+
+#include <inttypes.h>
+
+// The writer thread formats and flushes outside of the lock, but submit_solution_values() reads the status under it
+static void writer_fail(struct Solution_Writer *writer) {
+	pthread_mutex_lock(&writer->lock);
+	writer->status = 1;
+	pthread_mutex_unlock(&writer->lock);
+
+}
+
+static void writer_flush(struct Solution_Writer *writer) {
+	if (writer->buffer_used == 0) {
+		return;
+	}
+
+	TRACE_SPAN_START(flush_span);
+	if (fwrite(writer->buffer, 1, writer->buffer_used, writer->output_file) != writer->buffer_used) {
+		writer_fail(writer);
+	}
+	TRACE_SPAN_STOP(flush_span, "flush", "writer");
+
+	writer->buffer_used = 0;
+
+}
+
+// Makes sure that there are at least `length` free bytes in the formatting buffer
+static void writer_reserve(struct Solution_Writer *writer, size_t length) {
+	if (writer->buffer_used + length > WRITER_BUFFER_SIZE) {
+		writer_flush(writer);
+	}
+
+}
+
+// Round-trip precision for a double is 17 significant digits; 32 bytes covers the sign, exponent and delimiter.
+static void writer_put_double(struct Solution_Writer *writer, double value, char delimiter) {
+	writer_reserve(writer, 32);
+	int length = snprintf(writer->buffer + writer->buffer_used, 32, "%.17g%c", value, delimiter);
+	writer->buffer_used += length;
+
+}
+
+static void writer_put_string(struct Solution_Writer *writer, const char *string) {
+	size_t length = strlen(string);
+	writer_reserve(writer, length);
+	memcpy(writer->buffer + writer->buffer_used, string, length);
+	writer->buffer_used += length;
+
+}
+
+static void writer_put_raw(struct Solution_Writer *writer, const void *data, size_t length) {
+	// Large arrays skip the buffer entirely
+	if (length > WRITER_BUFFER_SIZE/2) {
+		writer_flush(writer);
+		if (fwrite(data, 1, length, writer->output_file) != length) {
+			writer_fail(writer);
+		}
+		return;
+	}
+
+	writer_reserve(writer, length);
+	memcpy(writer->buffer + writer->buffer_used, data, length);
+	writer->buffer_used += length;
+
+}
+
+static void free_writer_record(struct Writer_Record *record) {
+	free(record->x_values);
+	free(record->y_values);
+	free(record);
+
+}
+
+static void format_record(struct Solution_Writer *writer, struct Writer_Record *record) {
+	switch (writer->format) {
+		case WRITER_TEXT: {
+			if (record->index != WRITER_NO_INDEX) {
+				char marker[48];
+				snprintf(marker, 48, "# case %zu\n", record->index);
+				writer_put_string(writer, marker);
+			}
+
+			for (size_t i = 0; i < record->num_nodes; i++) {
+				writer_put_double(writer, record->x_values[i], '\t');
+				writer_put_double(writer, record->y_values[i], '\n');
+			}
+			break;
+		}
+		case WRITER_BINARY: {
+			uint64_t header[2] = {
+				record->index == WRITER_NO_INDEX ? UINT64_MAX : (uint64_t) record->index,
+				(uint64_t) record->num_nodes
+			};
+
+			writer_put_raw(writer, header, sizeof(header));
+			writer_put_raw(writer, record->x_values, record->num_nodes*sizeof(double));
+			writer_put_raw(writer, record->y_values, record->num_nodes*sizeof(double));
+			break;
+		}
+		case WRITER_COLUMNAR:
+			// Handled in format_columns() once all of the columns have arrived
+			break;
+	}
+
+}
+
+static void format_columns(struct Solution_Writer *writer) {
+	if (writer->columns_head == NULL) {
+		return;
+	}
+
+	size_t num_rows = writer->columns_head->num_nodes;
+
+	// Header: `x` followed by one column per solution
+	writer_put_string(writer, "x");
+	size_t column = 0;
+	for (struct Writer_Record *r = writer->columns_head; r != NULL; r = r->next, column++) {
+		char name[48];
+		snprintf(name, 48, "\ty_%zu", r->index == WRITER_NO_INDEX ? column : r->index);
+		writer_put_string(writer, name);
+
+		if (r->num_nodes != num_rows) {
+			fprintf(stderr, "Columnar output requires every solution to share the same mesh; column %zu has %zu nodes instead of %zu.\n", column, r->num_nodes, num_rows);
+			writer_fail(writer);
+			return;
+		}
+	}
+	writer_put_string(writer, "\n");
+
+	for (size_t i = 0; i < num_rows; i++) {
+		writer_put_double(writer, writer->columns_head->x_values[i], '\t');
+		for (struct Writer_Record *r = writer->columns_head; r != NULL; r = r->next) {
+			writer_put_double(writer, r->y_values[i], r->next == NULL ? '\n' : '\t');
+		}
+	}
+
+}
+
+static void* writer_thread(void *args) {
+	struct Solution_Writer *writer = (struct Solution_Writer*) args;
+	trace_set_thread_name("writer");
+
+	pthread_mutex_lock(&writer->lock);
+	while (true) {
+		while (writer->queue_head == NULL && !writer->closing) {
+			pthread_cond_wait(&writer->not_empty, &writer->lock);
+		}
+
+		if (writer->queue_head == NULL) {
+			// Closing, and nothing is left in the queue
+			break;
+		}
+
+		struct Writer_Record *record = writer->queue_head;
+		writer->queue_head = record->next;
+		if (writer->queue_head == NULL) {
+			writer->queue_tail = NULL;
+		}
+		writer->queued_records--;
+		TRACE_COUNTER("writer queue", "writer", writer->queued_records);
+		pthread_cond_signal(&writer->not_full);
+		pthread_mutex_unlock(&writer->lock);
+
+		// Format outside of the lock so that submitters are not held up
+		record->next = NULL;
+		if (writer->format == WRITER_COLUMNAR) {
+			if (writer->columns_tail == NULL) {
+				writer->columns_head = record;
+			}
+			else {
+				writer->columns_tail->next = record;
+			}
+			writer->columns_tail = record;
+			writer->num_columns++;
+		}
+		else {
+			TRACE_SPAN_START(format_span);
+			format_record(writer, record);
+			free_writer_record(record);
+			TRACE_SPAN_STOP(format_span, "format", "writer");
+		}
+
+		pthread_mutex_lock(&writer->lock);
+	}
+	pthread_mutex_unlock(&writer->lock);
+
+	if (writer->format == WRITER_COLUMNAR) {
+		format_columns(writer);
+	}
+
+	writer_flush(writer);
+
+	return NULL;
+
+}
+
+int open_solution_writer(struct Solution_Writer *writer, const char *path, Writer_Format format) {
+	memset(writer, 0, sizeof(struct Solution_Writer));
+	writer->format = format;
+
+	writer->output_file = fopen(path, format == WRITER_BINARY ? "wb" : "w");
+	if (writer->output_file == NULL) {
+		printf("Could not open the output file %s; please check.\n", path);
+		return 1;
+	}
+
+	writer->buffer = malloc(WRITER_BUFFER_SIZE);
+	if (writer->buffer == NULL) {
+		printf("Error allocating the writer buffer of %d bytes.\nAborting...", WRITER_BUFFER_SIZE);
+		fclose(writer->output_file);
+		return 1;
+	}
+
+	// Headers that do not depend on the submitted solutions
+	switch (format) {
+		case WRITER_TEXT:
+			writer_put_string(writer, "x\ty\n");
+			break;
+		case WRITER_BINARY:
+			writer_put_raw(writer, WRITER_BINARY_MAGIC, 8);
+			break;
+		case WRITER_COLUMNAR:
+			break;
+	}
+
+	pthread_mutex_init(&writer->lock, NULL);
+	pthread_cond_init(&writer->not_empty, NULL);
+	pthread_cond_init(&writer->not_full, NULL);
+
+	if (pthread_create(&writer->thread, NULL, writer_thread, writer) != 0) {
+		printf("Error starting the writer thread.\n");
+		pthread_mutex_destroy(&writer->lock);
+		pthread_cond_destroy(&writer->not_empty);
+		pthread_cond_destroy(&writer->not_full);
+		free(writer->buffer);
+		fclose(writer->output_file);
+		return 1;
+	}
+
+	return 0;
+
+}
+
+int submit_solution_values(struct Solution_Writer *writer, const double *x_values, const double *y_values, size_t num_nodes, size_t index) {
+	// Copy the data so that the caller can free or reuse its arrays immediately
+	struct Writer_Record *record = malloc(sizeof(struct Writer_Record));
+	if (record == NULL) {
+		return 1;
+	}
+
+	record->x_values = malloc(num_nodes*sizeof(double));
+	record->y_values = malloc(num_nodes*sizeof(double));
+	if (record->x_values == NULL || record->y_values == NULL) {
+		printf("Error allocating a writer record of %zu nodes.\n", num_nodes);
+		free_writer_record(record);
+		return 1;
+	}
+
+	memcpy(record->x_values, x_values, num_nodes*sizeof(double));
+	memcpy(record->y_values, y_values, num_nodes*sizeof(double));
+	record->num_nodes = num_nodes;
+	record->index = index;
+	record->next = NULL;
+
+	pthread_mutex_lock(&writer->lock);
+	// Backpressure: do not let the queue grow without bound if the disk is slower than the solver
+	if (writer->queued_records >= WRITER_MAX_QUEUED) {
+		TRACE_SPAN_START(backpressure_span);
+		while (writer->queued_records >= WRITER_MAX_QUEUED) {
+			pthread_cond_wait(&writer->not_full, &writer->lock);
+		}
+		TRACE_SPAN_STOP(backpressure_span, "writer backpressure", "writer");
+	}
+
+	if (writer->queue_tail == NULL) {
+		writer->queue_head = record;
+	}
+	else {
+		writer->queue_tail->next = record;
+	}
+	writer->queue_tail = record;
+	writer->queued_records++;
+	TRACE_COUNTER("writer queue", "writer", writer->queued_records);
+
+	int status = writer->status;
+	pthread_cond_signal(&writer->not_empty);
+	pthread_mutex_unlock(&writer->lock);
+
+	return status;
+
+}
+
+int submit_solution(struct Solution_Writer *writer, struct Mesh *mesh, struct ODE_Solution *solution, size_t index) {
+	if (mesh->node_coordinates == NULL || solution->solution_coeff == NULL) {
+		printf("Either the mesh or solution structure are not fully initialized.\n");
+		return 1;
+	}
+
+	size_t num_nodes = mesh->num_nodes;
+	if (solution->solution_coeff->stride == 1) {
+		return submit_solution_values(writer, mesh->node_coordinates, solution->solution_coeff->data, num_nodes, index);
+	}
+
+	// Strided vectors (views) are gathered first
+	double *y_values = malloc(num_nodes*sizeof(double));
+	if (y_values == NULL) {
+		return 1;
+	}
+
+	for (size_t i = 0; i < num_nodes; i++) {
+		y_values[i] = gsl_vector_get(solution->solution_coeff, i);
+	}
+
+	int status = submit_solution_values(writer, mesh->node_coordinates, y_values, num_nodes, index);
+	free(y_values);
+
+	return status;
+
+}
+
+int close_solution_writer(struct Solution_Writer *writer) {
+	pthread_mutex_lock(&writer->lock);
+	writer->closing = true;
+	pthread_cond_signal(&writer->not_empty);
+	pthread_mutex_unlock(&writer->lock);
+
+	pthread_join(writer->thread, NULL);
+
+	// Columnar records are only freed here, after they have been formatted
+	struct Writer_Record *record = writer->columns_head;
+	while (record != NULL) {
+		struct Writer_Record *next = record->next;
+		free_writer_record(record);
+		record = next;
+	}
+
+	if (fclose(writer->output_file) != 0) {
+		writer->status = 1;
+	}
+
+	pthread_mutex_destroy(&writer->lock);
+	pthread_cond_destroy(&writer->not_empty);
+	pthread_cond_destroy(&writer->not_full);
+	free(writer->buffer);
+
+	if (writer->status) {
+		printf("Error writing the solution output; please check.\n");
+	}
+
+	return writer->status;
+
+}
+
+int output_solution_file(struct Mesh *input_mesh, struct ODE_Solution *input_solution, const char *path, Writer_Format format) {
+	struct Solution_Writer writer;
+	STATS_TIMER_START(output_timer);
+
+	if (open_solution_writer(&writer, path, format)) {
+		return 1;
+	}
+
+	int status = submit_solution(&writer, input_mesh, input_solution, WRITER_NO_INDEX);
+	status |= close_solution_writer(&writer);
+	STATS_TIMER_STOP(output_timer, STATS_OUTPUT);
+
+	return status;
+
+}
@@ -0,0 +1,209 @@
+/* Least-recently-used cache of solver objects (function fields, meshes, load vectors and factorizations)
+ *
+ * Keys are 64-bit FNV-1a hashes of the content that produced the object, so two requests that name the same data share the entry.
+ * Capacities are small (tens of entries), so lookups walk the recency list instead of keeping a separate hash table.
+ */
+#include "solver_cache.h"
+#include "trace.h"
+
+uint64_t hash_bytes(uint64_t hash, const void *data, size_t length) {
+	const unsigned char *bytes = (const unsigned char*) data;
+	for (size_t i = 0; i < length; i++) {
+		hash ^= bytes[i];
+		hash *= FNV_PRIME;
+	}
+
+	return hash;
+
+}
+
+// -0.0 and 0.0 hash the same, as they give the same solution
+uint64_t hash_double(uint64_t hash, double value) {
+	if (value == 0) {
+		value = 0;
+	}
+
+	return hash_bytes(hash, &value, sizeof(double));
+
+}
+
+static void unlink_entry(struct Solver_Cache *cache, struct Cache_Entry *entry) {
+	if (entry->prev != NULL) {
+		entry->prev->next = entry->next;
+	}
+	else {
+		cache->head = entry->next;
+	}
+
+	if (entry->next != NULL) {
+		entry->next->prev = entry->prev;
+	}
+	else {
+		cache->tail = entry->prev;
+	}
+
+	entry->prev = NULL;
+	entry->next = NULL;
+
+}
+
+static void push_front(struct Solver_Cache *cache, struct Cache_Entry *entry) {
+	entry->prev = NULL;
+	entry->next = cache->head;
+	if (cache->head != NULL) {
+		cache->head->prev = entry;
+	}
+	cache->head = entry;
+	if (cache->tail == NULL) {
+		cache->tail = entry;
+	}
+
+}
+
+static void free_entry(struct Cache_Entry *entry) {
+	if (entry->free_value != NULL) {
+		entry->free_value(entry->value);
+	}
+	free(entry);
+
+}
+
+// Drops least recently used entries until the cache fits its capacity; the caller holds the lock
+static void evict_entries(struct Solver_Cache *cache) {
+	struct Cache_Entry *entry = cache->tail;
+	while (cache->num_entries > cache->capacity && entry != NULL) {
+		struct Cache_Entry *prev = entry->prev;
+
+		unlink_entry(cache, entry);
+		cache->num_entries--;
+		cache->evictions++;
+		TRACE_INSTANT("cache eviction", "cache");
+
+		if (entry->references == 0) {
+			free_entry(entry);
+		}
+		else {
+			// Freed by the last cache_release()
+			entry->evicted = true;
+		}
+
+		entry = prev;
+	}
+
+}
+
+int create_solver_cache(struct Solver_Cache *cache, size_t capacity) {
+	if (capacity == 0) {
+		printf("The solver cache needs room for at least one entry.\n");
+		return 1;
+	}
+
+	memset(cache, 0, sizeof(struct Solver_Cache));
+	cache->capacity = capacity;
+	pthread_mutex_init(&cache->lock, NULL);
+
+	return 0;
+
+}
+
+// Looks up `key` and takes a reference to it; returns NULL on a miss
+struct Cache_Entry* cache_acquire(struct Solver_Cache *cache, uint64_t key) {
+	pthread_mutex_lock(&cache->lock);
+
+	struct Cache_Entry *entry = cache->head;
+	while (entry != NULL && entry->key != key) {
+		entry = entry->next;
+	}
+
+	if (entry != NULL) {
+		unlink_entry(cache, entry);
+		push_front(cache, entry);
+		entry->references++;
+		cache->hits++;
+	}
+	else {
+		cache->misses++;
+	}
+
+	pthread_mutex_unlock(&cache->lock);
+
+	return entry;
+
+}
+
+// Adds `value` under `key` and returns a referenced entry.
+// If another thread inserted the same key in the meantime, `value` is freed and the existing entry is returned instead.
+struct Cache_Entry* cache_insert(struct Solver_Cache *cache, uint64_t key, void *value, void (*free_value) (void *)) {
+	struct Cache_Entry *new_entry = malloc(sizeof(struct Cache_Entry));
+	if (new_entry == NULL) {
+		printf("Error allocating a cache entry.\n");
+		if (free_value != NULL) {
+			free_value(value);
+		}
+		return NULL;
+	}
+
+	new_entry->key = key;
+	new_entry->value = value;
+	new_entry->free_value = free_value;
+	new_entry->references = 1;
+	new_entry->evicted = false;
+
+	pthread_mutex_lock(&cache->lock);
+
+	struct Cache_Entry *entry = cache->head;
+	while (entry != NULL && entry->key != key) {
+		entry = entry->next;
+	}
+
+	if (entry != NULL) {
+		unlink_entry(cache, entry);
+		push_front(cache, entry);
+		entry->references++;
+		pthread_mutex_unlock(&cache->lock);
+
+		free_entry(new_entry);
+		return entry;
+	}
+
+	push_front(cache, new_entry);
+	cache->num_entries++;
+	evict_entries(cache);
+
+	pthread_mutex_unlock(&cache->lock);
+
+	return new_entry;
+
+}
+
+void cache_release(struct Solver_Cache *cache, struct Cache_Entry *entry) {
+	if (entry == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	entry->references--;
+	bool free_now = (entry->references == 0 && entry->evicted);
+	pthread_mutex_unlock(&cache->lock);
+
+	if (free_now) {
+		free_entry(entry);
+	}
+
+}
+
+// All references must have been released
+void free_solver_cache(struct Solver_Cache *cache) {
+	struct Cache_Entry *entry = cache->head;
+	while (entry != NULL) {
+		struct Cache_Entry *next = entry->next;
+		free_entry(entry);
+		entry = next;
+	}
+
+	cache->head = NULL;
+	cache->tail = NULL;
+	cache->num_entries = 0;
+	pthread_mutex_destroy(&cache->lock);
+
+}
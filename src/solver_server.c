@@ -0,0 +1,744 @@
+/* Persistent solver server
+ *
+ * Keeps function fields, meshes, load vectors and factorizations in a content-hashed LRU cache across requests:
+ *	field:  hash of the field file contents
+ *	mesh:   hash of the mesh file contents (or of the uniform mesh parameters) and the element kind
+ *	load:   mesh and field keys; the assembled constant vector
+ *	factor: mesh key, a and b; the LU-decomposed coefficient matrix with the Dirichlet rows in place
+ * A repeated problem therefore only pays for the boundary values and the triangular solves.
+ *
+ * Requests arrive over a Unix domain socket or over stdin/stdout, with one worker per request. The socket loop polls every connection itself,
+ * so idle clients hold no worker; a connection's next line is only read once its previous request has been answered, keeping its answers in order.
+ */
+#include "solver_server.h"
+#include "band_matrix.h"
+#include "trace.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+// A client of the socket server; only the accept loop touches it while no request of it is running
+struct Server_Connection {
+	int fd;
+	char buffer[SERVER_LINE_LENGTH];
+	size_t length;
+	bool busy; // A request is with a worker
+	bool hung_up;
+
+};
+
+// Per-line work handed to the thread pool
+struct Server_Task {
+	struct Solver_Server *server;
+	struct Server_Connection *connection; // NULL for a pipe line
+	char *line;
+
+};
+
+static double elapsed_us(struct timespec *begin) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - begin->tv_sec)*1e6 + (now.tv_nsec - begin->tv_nsec)/1e3;
+
+}
+
+static int write_all(int fd, const char *data, size_t length) {
+	while (length > 0) {
+		ssize_t written = write(fd, data, length);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return 1;
+		}
+		data += written;
+		length -= written;
+	}
+
+	return 0;
+
+}
+
+// Reads a whole file into memory; the caller frees the buffer
+static char* read_file_contents(const char *path, size_t *length) {
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) {
+		return NULL;
+	}
+
+	size_t capacity = 1 << 16;
+	size_t used = 0;
+	char *buffer = malloc(capacity);
+	while (buffer != NULL) {
+		used += fread(buffer + used, 1, capacity - used, file);
+		if (used < capacity) {
+			break;
+		}
+
+		capacity *= 2;
+		char *larger = realloc(buffer, capacity);
+		if (larger == NULL) {
+			free(buffer);
+		}
+		buffer = larger;
+	}
+
+	fclose(file);
+	*length = used;
+
+	return buffer;
+
+}
+
+static void free_field_value(void *value) {
+	free_function_field((struct Function_Field*) value);
+	free(value);
+
+}
+
+static void free_mesh_value(void *value) {
+	free_mesh_memory((struct Mesh*) value);
+	free(value);
+
+}
+
+static void free_vector_value(void *value) {
+	gsl_vector_free((gsl_vector*) value);
+
+}
+
+static void free_band_value(void *value) {
+	free_band_matrix((struct Band_Matrix*) value);
+	free(value);
+
+}
+
+int parse_solve_request(char *line, struct Solve_Request *request) {
+	memset(request, 0, sizeof(struct Solve_Request));
+	request->kind = LINEAR;
+	request->send_values = true;
+	strcpy(request->id, "-");
+
+	unsigned required = 0;
+	char *saveptr;
+	char *token = strtok_r(line, " \t\r\n", &saveptr);
+	if (token == NULL || strcmp(token, "SOLVE") != 0) {
+		return 1;
+	}
+
+	while ((token = strtok_r(NULL, " \t\r\n", &saveptr)) != NULL) {
+		char *value = strchr(token, '=');
+		if (value == NULL) {
+			return 1;
+		}
+		*value++ = '\0';
+
+		if (strcmp(token, "a") == 0) { request->a = atof(value); required |= 1; }
+		else if (strcmp(token, "b") == 0) { request->b = atof(value); required |= 2; }
+		else if (strcmp(token, "d1") == 0) { request->d1 = atof(value); required |= 4; }
+		else if (strcmp(token, "d2") == 0) { request->d2 = atof(value); required |= 8; }
+		else if (strcmp(token, "field") == 0) { snprintf(request->field_path, SERVER_PATH_LENGTH, "%s", value); required |= 16; }
+		else if (strcmp(token, "mesh") == 0) { snprintf(request->mesh_path, SERVER_PATH_LENGTH, "%s", value); required |= 32; }
+		else if (strcmp(token, "start") == 0) { request->start = atof(value); required |= 64; }
+		else if (strcmp(token, "end") == 0) { request->end = atof(value); required |= 128; }
+		else if (strcmp(token, "elements") == 0) { request->num_elements = atoi(value); required |= 256; }
+		else if (strcmp(token, "id") == 0) { snprintf(request->id, SERVER_ID_LENGTH, "%s", value); }
+		else if (strcmp(token, "values") == 0) { request->send_values = atoi(value) != 0; }
+		else if (strcmp(token, "kind") == 0) {
+			if (strcmp(value, "L2") == 0) {
+				request->kind = LINEAR;
+			}
+			else if (strcmp(value, "L3") == 0) {
+				request->kind = QUAD;
+			}
+			else {
+				return 1;
+			}
+		}
+		else {
+			return 1;
+		}
+	}
+
+	// The coefficients, boundary values and field are always needed, plus one of the two mesh forms
+	bool has_mesh_file = (required & 32) != 0;
+	bool has_uniform_mesh = (required & (64 | 128 | 256)) == (64 | 128 | 256);
+	if ((required & 31) != 31 || has_mesh_file == has_uniform_mesh) {
+		return 1;
+	}
+
+	return 0;
+
+}
+
+static struct Cache_Entry* acquire_field(struct Solver_Server *server, const char *path, uint64_t *key, bool *hit) {
+	size_t length;
+	char *contents = read_file_contents(path, &length);
+	if (contents == NULL) {
+		return NULL;
+	}
+
+	*key = hash_bytes(hash_bytes(FNV_OFFSET_BASIS, "field", 5), contents, length);
+	struct Cache_Entry *entry = cache_acquire(&server->cache, *key);
+	*hit = (entry != NULL);
+
+	if (entry == NULL) {
+		TRACE_SPAN_START(miss_span);
+		struct Function_Field *field = malloc(sizeof(struct Function_Field));
+		FILE *stream = fmemopen(contents, length, "r");
+		if (field == NULL || stream == NULL || input_function_field(field, stream)) {
+			free(field);
+			if (stream != NULL) {
+				fclose(stream);
+			}
+			free(contents);
+			return NULL;
+		}
+		fclose(stream);
+
+		entry = cache_insert(&server->cache, *key, field, free_field_value);
+		TRACE_SPAN_STOP(miss_span, "field cache miss", "cache");
+	}
+
+	free(contents);
+
+	return entry;
+
+}
+
+static struct Cache_Entry* acquire_mesh(struct Solver_Server *server, struct Solve_Request *request, uint64_t *key, bool *hit) {
+	char *contents = NULL;
+	size_t length = 0;
+
+	uint64_t hash = hash_bytes(FNV_OFFSET_BASIS, "mesh", 4);
+	hash = hash_bytes(hash, &request->kind, sizeof(Element_2D_Type));
+	if (request->mesh_path[0] != '\0') {
+		contents = read_file_contents(request->mesh_path, &length);
+		if (contents == NULL) {
+			return NULL;
+		}
+		hash = hash_bytes(hash, contents, length);
+	}
+	else {
+		hash = hash_double(hash, request->start);
+		hash = hash_double(hash, request->end);
+		hash = hash_bytes(hash, &request->num_elements, sizeof(int));
+	}
+
+	*key = hash;
+	struct Cache_Entry *entry = cache_acquire(&server->cache, hash);
+	*hit = (entry != NULL);
+
+	if (entry == NULL) {
+		TRACE_SPAN_START(miss_span);
+		struct Mesh *mesh = malloc(sizeof(struct Mesh));
+		int status = 1;
+		if (mesh != NULL && contents != NULL) {
+			FILE *stream = fmemopen(contents, length, "r");
+			if (stream != NULL) {
+				status = parse_input_file(stream, mesh, request->kind);
+				fclose(stream);
+			}
+		}
+		else if (mesh != NULL) {
+			status = generate_uniform_mesh(mesh, request->start, request->end, request->num_elements, request->kind);
+		}
+
+		if (status) {
+			free(mesh);
+			free(contents);
+			return NULL;
+		}
+
+		entry = cache_insert(&server->cache, hash, mesh, free_mesh_value);
+		TRACE_SPAN_STOP(miss_span, "mesh cache miss", "cache");
+	}
+
+	free(contents);
+
+	return entry;
+
+}
+
+static struct Cache_Entry* acquire_load_vector(struct Solver_Server *server, uint64_t mesh_key, struct Mesh *mesh, uint64_t field_key, struct Function_Field *field, bool *hit) {
+	uint64_t key = hash_bytes(FNV_OFFSET_BASIS, "load", 4);
+	key = hash_bytes(key, &mesh_key, sizeof(uint64_t));
+	key = hash_bytes(key, &field_key, sizeof(uint64_t));
+
+	struct Cache_Entry *entry = cache_acquire(&server->cache, key);
+	*hit = (entry != NULL);
+
+	if (entry == NULL) {
+		TRACE_SPAN_START(miss_span);
+		gsl_vector *F_const = assemble_constant_vector(mesh, field);
+		if (F_const == NULL) {
+			return NULL;
+		}
+		entry = cache_insert(&server->cache, key, F_const, free_vector_value);
+		TRACE_SPAN_STOP(miss_span, "load vector cache miss", "cache");
+	}
+
+	return entry;
+
+}
+
+static struct Cache_Entry* acquire_factorization(struct Solver_Server *server, uint64_t mesh_key, struct Mesh *mesh, double a, double b, bool *hit) {
+	uint64_t key = hash_bytes(FNV_OFFSET_BASIS, "factor", 6);
+	key = hash_bytes(key, &mesh_key, sizeof(uint64_t));
+	key = hash_double(key, a);
+	key = hash_double(key, b);
+
+	struct Cache_Entry *entry = cache_acquire(&server->cache, key);
+	*hit = (entry != NULL);
+
+	if (entry == NULL) {
+		TRACE_SPAN_START(miss_span);
+		struct Band_Matrix *K_lu = malloc(sizeof(struct Band_Matrix));
+		if (K_lu == NULL || factorize_ode_constant(mesh, a, b, K_lu)) {
+			free(K_lu);
+			return NULL;
+		}
+		entry = cache_insert(&server->cache, key, K_lu, free_band_value);
+		TRACE_SPAN_STOP(miss_span, "factorization cache miss", "cache");
+	}
+
+	return entry;
+
+}
+
+// Runs one solve and writes the response (success or error) to `response`
+static int serve_solve(struct Solver_Server *server, struct Solve_Request *request, FILE *response) {
+	struct timespec begin;
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	TRACE_SPAN_START(request_span);
+
+	struct Cache_Entry *field_entry = NULL, *mesh_entry = NULL, *load_entry = NULL, *factor_entry = NULL;
+	uint64_t field_key, mesh_key;
+	bool field_hit = false, mesh_hit = false, load_hit = false, factor_hit = false;
+	const char *error = NULL;
+
+	field_entry = acquire_field(server, request->field_path, &field_key, &field_hit);
+	if (field_entry == NULL) {
+		error = "could not read the function field";
+		goto done;
+	}
+
+	mesh_entry = acquire_mesh(server, request, &mesh_key, &mesh_hit);
+	if (mesh_entry == NULL) {
+		error = "could not load the mesh";
+		goto done;
+	}
+
+	struct Mesh *mesh = (struct Mesh*) mesh_entry->value;
+	struct Function_Field *field = (struct Function_Field*) field_entry->value;
+
+	load_entry = acquire_load_vector(server, mesh_key, mesh, field_key, field, &load_hit);
+	factor_entry = acquire_factorization(server, mesh_key, mesh, request->a, request->b, &factor_hit);
+	if (load_entry == NULL || factor_entry == NULL) {
+		error = "assembly or factorization failed";
+		goto done;
+	}
+
+	gsl_vector *solution = solve_ode_factorized(mesh, (struct Band_Matrix*) factor_entry->value, (gsl_vector*) load_entry->value, request->d1, request->d2);
+	if (solution == NULL) {
+		error = "the linear solve failed";
+		goto done;
+	}
+
+	fprintf(response, "OK id=%s nodes=%u field=%s mesh=%s load=%s factor=%s time_us=%.1f\n",
+			request->id, mesh->num_nodes,
+			field_hit ? "hit" : "miss", mesh_hit ? "hit" : "miss",
+			load_hit ? "hit" : "miss", factor_hit ? "hit" : "miss",
+			elapsed_us(&begin));
+
+	if (request->send_values) {
+		for (uint32_t i = 0; i < mesh->num_nodes; i++) {
+			fprintf(response, "%.17g\t%.17g\n", mesh->node_coordinates[i], gsl_vector_get(solution, i));
+		}
+	}
+
+	gsl_vector_free(solution);
+
+done:
+	if (error != NULL) {
+		fprintf(response, "ERROR id=%s %s\n", request->id, error);
+	}
+
+	cache_release(&server->cache, factor_entry);
+	cache_release(&server->cache, load_entry);
+	cache_release(&server->cache, mesh_entry);
+	cache_release(&server->cache, field_entry);
+
+	pthread_mutex_lock(&server->stats_lock);
+	if (error != NULL) {
+		server->requests_failed++;
+	}
+	else {
+		server->requests_served++;
+	}
+	pthread_mutex_unlock(&server->stats_lock);
+	TRACE_SPAN_STOP(request_span, "SOLVE", "server");
+
+	return error != NULL;
+
+}
+
+// Handles one protocol line; SHUTDOWN sets `shutting_down` for the caller to act on
+int handle_server_line(struct Solver_Server *server, char *line, FILE *response) {
+	if (strncmp(line, "SOLVE", 5) == 0) {
+		struct Solve_Request request;
+		if (parse_solve_request(line, &request)) {
+			fprintf(response, "ERROR id=- malformed SOLVE request\n");
+			return 1;
+		}
+		return serve_solve(server, &request, response);
+	}
+
+	if (strncmp(line, "STATS", 5) == 0) {
+		pthread_mutex_lock(&server->cache.lock);
+		size_t hits = server->cache.hits, misses = server->cache.misses;
+		size_t evictions = server->cache.evictions, entries = server->cache.num_entries;
+		pthread_mutex_unlock(&server->cache.lock);
+
+		pthread_mutex_lock(&server->stats_lock);
+		fprintf(response, "OK served=%zu failed=%zu hits=%zu misses=%zu evictions=%zu entries=%zu\n",
+				server->requests_served, server->requests_failed, hits, misses, evictions, entries);
+		pthread_mutex_unlock(&server->stats_lock);
+		return 0;
+	}
+
+	if (strncmp(line, "SHUTDOWN", 8) == 0) {
+		pthread_mutex_lock(&server->stats_lock);
+		server->shutting_down = true;
+		pthread_mutex_unlock(&server->stats_lock);
+		fprintf(response, "OK shutdown\n");
+		return 0;
+	}
+
+	fprintf(response, "ERROR id=- unknown command\n");
+
+	return 1;
+
+}
+
+// Formats the response in memory so that it goes out in one piece
+static void respond(struct Solver_Server *server, char *line, int fd) {
+	char *buffer = NULL;
+	size_t length = 0;
+	FILE *response = open_memstream(&buffer, &length);
+	if (response == NULL) {
+		return;
+	}
+
+	handle_server_line(server, line, response);
+	fclose(response);
+
+	if (fd < 0) {
+		pthread_mutex_lock(&server->output_lock);
+		write_all(server->output_fd, buffer, length);
+		pthread_mutex_unlock(&server->output_lock);
+	}
+	else {
+		write_all(fd, buffer, length);
+	}
+
+	free(buffer);
+
+}
+
+static bool server_stopping(struct Solver_Server *server) {
+	pthread_mutex_lock(&server->stats_lock);
+	bool stopping = server->shutting_down;
+	pthread_mutex_unlock(&server->stats_lock);
+
+	return stopping;
+
+}
+
+static void serve_pipe_line(void *args) {
+	struct Server_Task *task = (struct Server_Task*) args;
+	respond(task->server, task->line, -1);
+	free(task->line);
+	free(task);
+
+}
+
+// Answers one line of a connection and hands the connection back to the accept loop through the wake-up pipe
+static void serve_connection_line(void *args) {
+	struct Server_Task *task = (struct Server_Task*) args;
+	struct Solver_Server *server = task->server;
+	respond(server, task->line, task->connection->fd);
+
+	write_all(server->wake_fds[1], (const char*) &task->connection, sizeof(struct Server_Connection*));
+	free(task->line);
+	free(task);
+
+}
+
+// Submits the next buffered line of an idle connection: a whole line, a full buffer, or what is left once the client has hung up
+static void dispatch_connection(struct Solver_Server *server, struct Server_Connection *connection) {
+	char *newline = memchr(connection->buffer, '\n', connection->length);
+	size_t line_length = (newline != NULL) ? (size_t) (newline - connection->buffer) + 1 : connection->length;
+	if (connection->busy || line_length == 0 || (newline == NULL && connection->length < SERVER_LINE_LENGTH - 1 && !connection->hung_up)) {
+		return;
+	}
+
+	struct Server_Task *task = malloc(sizeof(struct Server_Task));
+	char *line = malloc(line_length + 1);
+	if (task == NULL || line == NULL) {
+		free(task);
+		free(line);
+		return;
+	}
+	memcpy(line, connection->buffer, line_length);
+	line[line_length] = '\0';
+	connection->length -= line_length;
+	memmove(connection->buffer, connection->buffer + line_length, connection->length);
+
+	task->server = server;
+	task->connection = connection;
+	task->line = line;
+	connection->busy = true;
+	if (submit_task(&server->pool, serve_connection_line, task)) {
+		connection->busy = false;
+		free(line);
+		free(task);
+	}
+
+}
+
+static int run_pipe_server(struct Solver_Server *server) {
+	// Library routines report errors on stdout, so the protocol gets its own copy of the descriptor and stdout goes to stderr
+	fflush(stdout);
+	server->output_fd = dup(STDOUT_FILENO);
+	if (server->output_fd < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+		fprintf(stderr, "Could not set up the protocol output.\n");
+		return 1;
+	}
+
+	char line[SERVER_LINE_LENGTH];
+	while (!server_stopping(server) && fgets(line, SERVER_LINE_LENGTH, stdin) != NULL) {
+		if (strncmp(line, "SHUTDOWN", 8) == 0) {
+			// Let the outstanding requests answer first
+			wait_thread_pool(&server->pool);
+			respond(server, line, -1);
+			break;
+		}
+
+		struct Server_Task *task = malloc(sizeof(struct Server_Task));
+		char *copy = strdup(line);
+		if (task == NULL || copy == NULL) {
+			free(task);
+			free(copy);
+			continue;
+		}
+		task->server = server;
+		task->connection = NULL;
+		task->line = copy;
+
+		if (submit_task(&server->pool, serve_pipe_line, task)) {
+			free(task->line);
+			free(task);
+		}
+	}
+
+	wait_thread_pool(&server->pool);
+	close(server->output_fd);
+
+	return 0;
+
+}
+
+static int run_socket_server(struct Solver_Server *server, const char *socket_path) {
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(struct sockaddr_un));
+	address.sun_family = AF_UNIX;
+	if (strlen(socket_path) >= sizeof(address.sun_path)) {
+		printf("The socket path %s is too long.\n", socket_path);
+		return 1;
+	}
+	strcpy(address.sun_path, socket_path);
+
+	server->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (server->listen_fd < 0) {
+		printf("Could not create the server socket.\n");
+		return 1;
+	}
+
+	// Only a stale socket is replaced; any other file at the path is left alone
+	struct stat existing;
+	if (lstat(socket_path, &existing) == 0) {
+		if (!S_ISSOCK(existing.st_mode)) {
+			printf("%s exists and is not a socket; not replacing it.\n", socket_path);
+			close(server->listen_fd);
+			return 1;
+		}
+		unlink(socket_path);
+	}
+	if (bind(server->listen_fd, (struct sockaddr*) &address, sizeof(struct sockaddr_un)) < 0 || listen(server->listen_fd, 64) < 0) {
+		printf("Could not listen on %s: %s\n", socket_path, strerror(errno));
+		close(server->listen_fd);
+		return 1;
+	}
+	if (pipe(server->wake_fds) < 0) {
+		printf("Could not create the server wake-up pipe.\n");
+		close(server->listen_fd);
+		unlink(socket_path);
+		return 1;
+	}
+
+	printf("Listening on %s with %zu workers.\n", socket_path, server->pool.num_threads);
+	fflush(stdout);
+
+	struct Server_Connection **connections = NULL;
+	struct pollfd *polled = NULL;
+	size_t num_connections = 0, capacity = 0;
+	while (!server_stopping(server)) {
+		// The listening socket, the wake-up pipe and every idle connection that can take another line
+		if (capacity < num_connections + 2) {
+			size_t new_capacity = 2*(num_connections + 2);
+			struct Server_Connection **grown = realloc(connections, new_capacity*sizeof(struct Server_Connection*));
+			if (grown != NULL) {
+				connections = grown;
+			}
+			struct pollfd *grown_polled = realloc(polled, new_capacity*sizeof(struct pollfd));
+			if (grown_polled != NULL) {
+				polled = grown_polled;
+			}
+			if (grown == NULL || grown_polled == NULL) {
+				printf("Error allocating the server connections.\n");
+				break;
+			}
+			capacity = new_capacity;
+		}
+		polled[0] = (struct pollfd) {server->listen_fd, POLLIN, 0};
+		polled[1] = (struct pollfd) {server->wake_fds[0], POLLIN, 0};
+		for (size_t c = 0; c < num_connections; c++) {
+			bool waiting = !connections[c]->busy && !connections[c]->hung_up;
+			polled[c + 2] = (struct pollfd) {waiting ? connections[c]->fd : -1, POLLIN, 0};
+		}
+
+		if (poll(polled, num_connections + 2, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+
+		// Answered requests free their connections
+		if (polled[1].revents & POLLIN) {
+			struct Server_Connection *done;
+			if (read(server->wake_fds[0], &done, sizeof(struct Server_Connection*)) == sizeof(struct Server_Connection*)) {
+				done->busy = false;
+			}
+		}
+
+		for (size_t c = 0; c < num_connections; c++) {
+			struct Server_Connection *connection = connections[c];
+			if (polled[c + 2].revents & (POLLIN | POLLHUP | POLLERR)) {
+				ssize_t received = read(connection->fd, connection->buffer + connection->length, SERVER_LINE_LENGTH - 1 - connection->length);
+				if (received > 0) {
+					connection->length += received;
+				}
+				else if (received == 0 || errno != EINTR) {
+					connection->hung_up = true;
+				}
+			}
+			dispatch_connection(server, connection);
+		}
+
+		// Connections are closed once they have hung up with nothing left to answer
+		size_t kept = 0;
+		for (size_t c = 0; c < num_connections; c++) {
+			struct Server_Connection *connection = connections[c];
+			if (connection->hung_up && !connection->busy && connection->length == 0) {
+				close(connection->fd);
+				free(connection);
+			}
+			else {
+				connections[kept++] = connection;
+			}
+		}
+		num_connections = kept;
+
+		if (polled[0].revents & POLLIN) {
+			int fd = accept(server->listen_fd, NULL, NULL);
+			struct Server_Connection *connection = (fd >= 0) ? calloc(1, sizeof(struct Server_Connection)) : NULL;
+			if (connection == NULL) {
+				if (fd >= 0) {
+					close(fd);
+				}
+				continue;
+			}
+			connection->fd = fd;
+			connections[num_connections++] = connection;
+		}
+	}
+
+	// Requests that are already with a worker are answered; idle connections are closed without waiting for their clients
+	wait_thread_pool(&server->pool);
+	for (size_t c = 0; c < num_connections; c++) {
+		close(connections[c]->fd);
+		free(connections[c]);
+	}
+	free(connections);
+	free(polled);
+	close(server->wake_fds[0]);
+	close(server->wake_fds[1]);
+	close(server->listen_fd);
+	unlink(socket_path);
+
+	return 0;
+
+}
+
+int create_solver_server(struct Solver_Server *server, size_t num_threads, size_t cache_entries) {
+	memset(server, 0, sizeof(struct Solver_Server));
+	server->listen_fd = -1;
+	server->output_fd = -1;
+	server->wake_fds[0] = -1;
+	server->wake_fds[1] = -1;
+
+	if (create_solver_cache(&server->cache, cache_entries)) {
+		return 1;
+	}
+
+	if (create_thread_pool(&server->pool, num_threads)) {
+		free_solver_cache(&server->cache);
+		return 1;
+	}
+
+	pthread_mutex_init(&server->output_lock, NULL);
+	pthread_mutex_init(&server->stats_lock, NULL);
+
+	return 0;
+
+}
+
+// Serves until SHUTDOWN (or end of input for a pipe); `socket_path` of "-" serves stdin/stdout
+int run_solver_server(struct Solver_Server *server, const char *socket_path) {
+	// A client hanging up mid-response should not take the server down
+	signal(SIGPIPE, SIG_IGN);
+
+	if (strcmp(socket_path, "-") == 0) {
+		return run_pipe_server(server);
+	}
+
+	return run_socket_server(server, socket_path);
+
+}
+
+void free_solver_server(struct Solver_Server *server) {
+	free_thread_pool(&server->pool);
+	free_solver_cache(&server->cache);
+	pthread_mutex_destroy(&server->output_lock);
+	pthread_mutex_destroy(&server->stats_lock);
+
+}
@@ -0,0 +1,130 @@
+/* Per-phase solver statistics
+ *
+ * Each thread records into its own active Solver_Stats, so no locking is needed on the hot paths.
+ * Callers that spread a job over several threads activate one struct per task and merge them afterwards.
+ */
+#include "solver_stats.h"
+
+_Thread_local struct Solver_Stats* active_stats = NULL;
+
+static const char* phase_names[STATS_NUM_PHASES] = {
+	"parse",
+	"element_build",
+	"local_kernels",
+	"scatter",
+	"bc",
+	"factor",
+	"solve",
+	"output"
+};
+
+static const char* counter_names[STATS_NUM_COUNTERS] = {
+	"elements",
+	"quadrature_evaluations",
+	"f_evals",
+	"allocations",
+	"bytes",
+	"refinement_steps",
+	"iterations",
+	"refactored_rows"
+};
+
+// Makes `stats` (or nothing, for NULL) the calling thread's active struct and returns the previous one
+struct Solver_Stats* stats_activate(struct Solver_Stats* stats) {
+	struct Solver_Stats* previous = active_stats;
+	active_stats = stats;
+
+	return previous;
+
+}
+
+void stats_merge(struct Solver_Stats* dest, const struct Solver_Stats* src) {
+	for (int p = 0; p < STATS_NUM_PHASES; p++) {
+		dest->phase_seconds[p] += src->phase_seconds[p];
+	}
+	for (int c = 0; c < STATS_NUM_COUNTERS; c++) {
+		dest->counters[c] += src->counters[c];
+	}
+	for (int r = 0; r < HW_NUM_REGIONS; r++) {
+		for (int e = 0; e < HW_NUM_EVENTS; e++) {
+			dest->hw_counts[r][e] += src->hw_counts[r][e];
+		}
+		dest->hw_entries[r] += src->hw_entries[r];
+	}
+
+}
+
+const char* stats_phase_name(Stats_Phase phase) {
+	return phase_names[phase];
+
+}
+
+const char* stats_counter_name(Stats_Counter counter) {
+	return counter_names[counter];
+
+}
+
+// Per-element ratios use the elements assembled, so the regions can be compared with each other and across runs
+static void output_hw_counters_json(FILE* output, const struct Solver_Stats* stats) {
+	const char* reason = hw_counters_unavailable_reason();
+	if (reason != NULL) {
+		fprintf(output, ", \"hw_counters\": {\"available\": false, \"reason\": \"%s\"}", reason);
+		return;
+	}
+
+	uint64_t elements = stats->counters[STATS_ELEMENTS];
+	fprintf(output, ", \"hw_counters\": {\"available\": true");
+	for (int r = 0; r < HW_NUM_REGIONS; r++) {
+		const uint64_t* counts = stats->hw_counts[r];
+		fprintf(output, ", \"%s\": {\"entries\": %llu", hw_region_name(r), (unsigned long long) stats->hw_entries[r]);
+
+		for (int e = 0; e < HW_NUM_EVENTS; e++) {
+			if (hw_event_available(e)) {
+				fprintf(output, ", \"%s\": %llu", hw_event_name(e), (unsigned long long) counts[e]);
+			}
+			else {
+				fprintf(output, ", \"%s\": null", hw_event_name(e));
+			}
+		}
+
+		if (counts[HW_CYCLES] > 0 && hw_event_available(HW_INSTRUCTIONS)) {
+			fprintf(output, ", \"ipc\": %.3f", (double) counts[HW_INSTRUCTIONS]/counts[HW_CYCLES]);
+		}
+		else {
+			fprintf(output, ", \"ipc\": null");
+		}
+
+		for (int e = 0; e < HW_NUM_EVENTS; e++) {
+			if (elements > 0 && hw_event_available(e)) {
+				fprintf(output, ", \"%s_per_element\": %.3f", hw_event_name(e), (double) counts[e]/elements);
+			}
+			else {
+				fprintf(output, ", \"%s_per_element\": null", hw_event_name(e));
+			}
+		}
+		fprintf(output, "}");
+	}
+	fprintf(output, "}");
+
+}
+
+int output_stats_json(FILE* output, const struct Solver_Stats* stats) {
+	fprintf(output, "{\"phase_seconds\": {");
+	for (int p = 0; p < STATS_NUM_PHASES; p++) {
+		fprintf(output, "%s\"%s\": %.9f", p == 0 ? "" : ", ", phase_names[p], stats->phase_seconds[p]);
+	}
+
+	fprintf(output, "}, \"counters\": {");
+	for (int c = 0; c < STATS_NUM_COUNTERS; c++) {
+		fprintf(output, "%s\"%s\": %llu", c == 0 ? "" : ", ", counter_names[c], (unsigned long long) stats->counters[c]);
+	}
+	fprintf(output, "}");
+
+	if (hw_counters_requested) {
+		output_hw_counters_json(output, stats);
+	}
+	fprintf(output, "}\n");
+
+	return ferror(output) != 0;
+
+}
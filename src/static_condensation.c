@@ -0,0 +1,205 @@
+/* Static condensation of the L3 middle nodes
+ *
+ * The middle node of an L3 element only couples to the two vertices of its own element, so its row can be eliminated element by element:
+ *	K' = K_vv - K_vm K_mm^-1 K_mv,	F' = F_v - K_vm K_mm^-1 F_m
+ * which leaves a tridiagonal system on the vertices (half of the unknowns, and one band on either side of the diagonal instead of two).
+ * Once the vertices are solved, each middle value is recovered from its own row.
+ * Both the condensation and the recovery only touch their own element, so they are split over threads with parallel_for().
+ */
+#include "static_condensation.h"
+#include "band_matrix.h"
+#include "thread_pool.h"
+#include "solver_stats.h"
+#include "trace.h"
+
+struct Condense_Args {
+	struct Mesh* mesh;
+	double a, b;
+	struct Function_Field* field;
+	struct Condensed_Element* elements;
+	const double* vertices; // Vertex solution, for the recovery
+	double* solution;
+
+};
+
+// Only meshes of L3 elements numbered in order (element e has nodes 2e, 2e + 1 and 2e + 2) covering every node are condensed
+bool mesh_condensable(struct Mesh* input_mesh) {
+	if (input_mesh->num_elements == 0 || input_mesh->connectivity_grid == NULL || input_mesh->node_coordinates == NULL) {
+		return false;
+	}
+	if (input_mesh->num_nodes != 2*(size_t) input_mesh->num_elements + 1) {
+		return false;
+	}
+
+	for (uint32_t e = 0; e < input_mesh->num_elements; e++) {
+		struct Element_Conn* conn = &input_mesh->connectivity_grid[e];
+		if (conn->kind != QUAD || conn->node_list.L3.node_id[0] != 2*(int64_t) e) {
+			return false;
+		}
+	}
+
+	return true;
+
+}
+
+static int condense_chunk(void* args, size_t first, size_t last) {
+	struct Condense_Args* c = (struct Condense_Args*) args;
+
+	for (size_t e = first; e < last; e += ELEMENT_BLOCK) {
+		int count = (last - e < ELEMENT_BLOCK) ? last - e : ELEMENT_BLOCK;
+		double x[MAX_ELEMENT_NODES][ELEMENT_BLOCK], k[MAX_ELEMENT_NODES*MAX_ELEMENT_NODES][ELEMENT_BLOCK], F[MAX_ELEMENT_NODES][ELEMENT_BLOCK];
+		for (int j = 0; j < count; j++) {
+			for (int i = 0; i < 3; i++) {
+				x[i][j] = c->mesh->node_coordinates[2*(e + j) + i];
+			}
+		}
+
+		STATS_TIMER_START(kernel_timer);
+		if (output_element_block(QUAD, count, (const double (*)[ELEMENT_BLOCK]) x, c->a, c->b, c->field, k, F)) {
+			return 1;
+		}
+
+		for (int j = 0; j < count; j++) {
+			struct Condensed_Element* ce = &c->elements[e + j];
+			ce->k_m0 = k[3][j];
+			ce->k_mm = k[4][j];
+			ce->k_m2 = k[5][j];
+			ce->f_m = F[1][j];
+
+			// Local nodes 0 and 2 are the vertices
+			for (int v = 0; v < 2; v++) {
+				int i = 2*v;
+				double ratio = k[3*i + 1][j]/ce->k_mm;
+				ce->k[v][0] = k[3*i][j] - ratio*ce->k_m0;
+				ce->k[v][1] = k[3*i + 2][j] - ratio*ce->k_m2;
+				ce->f[v] = F[i][j] - ratio*ce->f_m;
+			}
+		}
+		STATS_TIMER_STOP(kernel_timer, STATS_LOCAL_KERNELS);
+	}
+
+	return 0;
+
+}
+
+static int recover_chunk(void* args, size_t first, size_t last) {
+	struct Condense_Args* c = (struct Condense_Args*) args;
+	const double* v = c->vertices;
+	double* y = c->solution;
+
+	STATS_TIMER_START(recover_timer);
+	for (size_t e = first; e < last; e++) {
+		const struct Condensed_Element* ce = &c->elements[e];
+		y[2*e] = v[e];
+		y[2*e + 1] = (ce->f_m - ce->k_m0*v[e] - ce->k_m2*v[e + 1])/ce->k_mm;
+	}
+	if (last == c->mesh->num_elements) {
+		y[2*last] = v[last];
+	}
+	STATS_TIMER_STOP(recover_timer, STATS_SOLVE);
+
+	return 0;
+
+}
+
+// Solves an L3 mesh accepted by mesh_condensable() through its vertex system.
+// Returns CONDENSE_FALLBACK if a middle node cannot be eliminated safely, in which case the full system has to be solved instead.
+int solve_ode_condensed(struct Mesh* input_mesh, gsl_vector** solution, double a, double b, double d1, double d2, struct Function_Field *function_field, size_t num_threads) {
+	size_t num_elements = input_mesh->num_elements;
+	size_t num_vertices = num_elements + 1;
+
+	struct Condensed_Element* elements = malloc(num_elements*sizeof(struct Condensed_Element));
+	if (elements == NULL) {
+		printf("Error allocating the condensed arrays of %zu elements.\n", num_elements);
+		return 1;
+	}
+	STATS_ALLOC(num_elements*sizeof(struct Condensed_Element));
+
+	struct Condense_Args args = {input_mesh, a, b, function_field, elements, NULL, NULL};
+
+	TRACE_SPAN_START(condense_span);
+	STATS_HW_START(element_loop);
+	int status = parallel_for(num_elements, num_threads, CONDENSE_MIN_CHUNK, condense_chunk, &args);
+	STATS_HW_STOP(element_loop, HW_ELEMENT_LOOP);
+	TRACE_SPAN_STOP(condense_span, "static condensation", "solver");
+	if (status) {
+		free(elements);
+		return 1;
+	}
+
+	struct Band_Matrix K_vertex;
+	if (create_band_matrix(&K_vertex, num_vertices, 1, 1)) {
+		free(elements);
+		return 1;
+	}
+	gsl_vector* F_vertex = gsl_vector_calloc(num_vertices);
+	if (F_vertex == NULL) {
+		printf("Error allocating the vertex constant vector of %zu vertices.\n", num_vertices);
+		free_band_matrix(&K_vertex);
+		free(elements);
+		return 1;
+	}
+	STATS_ALLOC(num_vertices*sizeof(double));
+
+	TRACE_SPAN_START(assembly_span);
+	STATS_TIMER_START(scatter_timer);
+	for (size_t e = 0; e < num_elements; e++) {
+		const struct Condensed_Element* ce = &elements[e];
+		// The elimination does not pivot, so the middle diagonal has to dominate its row (this also catches NaNs)
+		if (!(fabs(ce->k_mm) > CONDENSE_PIVOT_TOLERANCE*(fabs(ce->k_m0) + fabs(ce->k_mm) + fabs(ce->k_m2)))) {
+			free_band_matrix(&K_vertex);
+			gsl_vector_free(F_vertex);
+			free(elements);
+			return CONDENSE_FALLBACK;
+		}
+
+		for (int i = 0; i < 2; i++) {
+			for (int j = 0; j < 2; j++) {
+				band_matrix_add(&K_vertex, e + i, e + j, ce->k[i][j]);
+			}
+			*gsl_vector_ptr(F_vertex, e + i) += ce->f[i];
+		}
+	}
+	STATS_TIMER_STOP(scatter_timer, STATS_SCATTER);
+	TRACE_SPAN_STOP(assembly_span, "assemble vertex system", "solver");
+
+	STATS_TIMER_START(bc_timer);
+	TRACE_SPAN_START(bc_span);
+	gsl_vector_set(F_vertex, 0, d1);
+	gsl_vector_set(F_vertex, num_vertices - 1, d2);
+	band_matrix_set_row_identity(&K_vertex, 0);
+	band_matrix_set_row_identity(&K_vertex, num_vertices - 1);
+	STATS_TIMER_STOP(bc_timer, STATS_BC);
+	TRACE_SPAN_STOP(bc_span, "boundary conditions", "solver");
+
+	if (band_lu_decomp(&K_vertex)) {
+		free_band_matrix(&K_vertex);
+		gsl_vector_free(F_vertex);
+		free(elements);
+		return 1;
+	}
+	band_lu_solve(&K_vertex, F_vertex, F_vertex);
+	free_band_matrix(&K_vertex);
+
+	gsl_vector* y = gsl_vector_alloc(input_mesh->num_nodes);
+	if (y == NULL) {
+		printf("Error allocating the solution of %u nodes.\n", input_mesh->num_nodes);
+		gsl_vector_free(F_vertex);
+		free(elements);
+		return 1;
+	}
+	STATS_ALLOC(input_mesh->num_nodes*sizeof(double));
+	args.vertices = F_vertex->data;
+	args.solution = y->data;
+
+	TRACE_SPAN_START(recover_span);
+	parallel_for(num_elements, num_threads, CONDENSE_MIN_CHUNK, recover_chunk, &args);
+	TRACE_SPAN_STOP(recover_span, "recover middle nodes", "solver");
+
+	gsl_vector_free(F_vertex);
+	free(elements);
+	*solution = y;
+
+	return 0;
+
+}
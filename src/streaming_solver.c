@@ -0,0 +1,482 @@
+/* Streaming solve: the element loop fused with the forward elimination
+ *
+ * A row of the global matrix of a 1D mesh is complete as soon as the elements on either side of its node have been assembled,
+ * so the banded LU decomposition can eliminate column k once the `lower` rows below it are complete.
+ * Only a window of a few rows is held while the elements stream past; as each row of U is finished it is written, together with its
+ * right-hand side entry, to a compact buffer of (lower + upper + 2) doubles per node, which the back substitution then reads in reverse.
+ * The buffer is either in memory or a scratch file mapped with mmap(), so apart from the solution the working memory does not grow with the mesh.
+ *
+ * The pivoting and the order of every operation are those of assemble_coefficient_matrix(), band_lu_decomp() and band_lu_solve(),
+ * so the solution is identical to that of solve_ode_constant().
+ */
+#include "streaming_solver.h"
+#include "solver_stats.h"
+#include "trace.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define STREAM_WINDOW 8 // Rows held at once; at most lower + 3 are in use
+#define STREAM_MAX_LOWER 2
+#define STREAM_MAX_WIDTH (3*STREAM_MAX_LOWER + 1)
+#define STREAM_PREFETCH_ROWS 65536 // Rows of back-substitution data requested ahead of the (reverse) back substitution
+
+struct Stream_State {
+	size_t n;
+	int lower, upper;
+	double d1, d2;
+
+	// Row i is window[i % STREAM_WINDOW], in the layout of a Band_Matrix row (columns i - lower through i + lower + upper)
+	double window[STREAM_WINDOW][STREAM_MAX_WIDTH];
+	double rhs[STREAM_WINDOW];
+	size_t next_row; // Rows started so far
+	size_t complete_rows; // Rows with every element contribution and boundary condition added
+	size_t next_column; // Next column to eliminate
+
+	// Per row: U from the diagonal (lower + upper + 1 entries), then the eliminated right-hand side
+	double* records;
+	size_t record_length;
+	size_t records_bytes;
+	int scratch_fd; // -1 when the records are in memory
+
+};
+
+static inline double* window_ptr(struct Stream_State* s, size_t i, size_t j) {
+	return &s->window[i % STREAM_WINDOW][(ptrdiff_t) j - (ptrdiff_t) i + s->lower];
+}
+
+static int open_records(struct Stream_State* s, const char* scratch_path) {
+	s->record_length = s->lower + s->upper + 2;
+	s->records_bytes = s->n*s->record_length*sizeof(double);
+	s->scratch_fd = -1;
+
+	if (scratch_path == NULL) {
+		s->records = malloc(s->records_bytes);
+		if (s->records == NULL) {
+			printf("Error allocating %zu bytes of back-substitution data; pass a scratch file instead.\n", s->records_bytes);
+			return 1;
+		}
+		STATS_ALLOC(s->records_bytes);
+		return 0;
+	}
+
+	int fd = open(scratch_path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0) {
+		printf("Could not open the scratch file %s.\n", scratch_path);
+		return 1;
+	}
+	// Unlinked straight away, so the space is given back when the solve ends (or the process dies)
+	unlink(scratch_path);
+
+	if (ftruncate(fd, s->records_bytes) != 0) {
+		printf("Could not extend the scratch file %s to %zu bytes.\n", scratch_path, s->records_bytes);
+		close(fd);
+		return 1;
+	}
+
+	void* map = mmap(NULL, s->records_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		printf("Could not map the scratch file %s.\n", scratch_path);
+		close(fd);
+		return 1;
+	}
+	madvise(map, s->records_bytes, MADV_SEQUENTIAL);
+
+	s->records = map;
+	s->scratch_fd = fd;
+
+	return 0;
+
+}
+
+static void close_records(struct Stream_State* s) {
+	if (s->scratch_fd >= 0) {
+		munmap(s->records, s->records_bytes);
+		close(s->scratch_fd);
+	}
+	else {
+		free(s->records);
+	}
+	s->records = NULL;
+
+}
+
+static int create_stream_state(struct Stream_State* s, size_t n, int bandwidth, double d1, double d2, const char* scratch_path) {
+	memset(s, 0, sizeof(struct Stream_State));
+	s->n = n;
+	s->lower = bandwidth;
+	s->upper = bandwidth;
+	s->d1 = d1;
+	s->d2 = d2;
+
+	return open_records(s, scratch_path);
+
+}
+
+// Rows up to `last` get an empty window row
+static void start_rows(struct Stream_State* s, size_t last) {
+	for (; s->next_row <= last; s->next_row++) {
+		memset(s->window[s->next_row % STREAM_WINDOW], 0, sizeof(s->window[0]));
+		s->rhs[s->next_row % STREAM_WINDOW] = 0;
+	}
+
+}
+
+// Column k of band_lu_decomp() and band_lu_solve()'s forward substitution; row k of U is final afterwards
+static int eliminate_column(struct Stream_State* s, size_t k) {
+	size_t n = s->n;
+	size_t last_row = (k + s->lower < n - 1) ? k + s->lower : n - 1;
+	size_t last_col = (k + s->lower + s->upper < n - 1) ? k + s->lower + s->upper : n - 1;
+
+	size_t p = k;
+	double max = fabs(*window_ptr(s, k, k));
+	for (size_t i = k + 1; i <= last_row; i++) {
+		double value = fabs(*window_ptr(s, i, k));
+		if (value > max) {
+			max = value;
+			p = i;
+		}
+	}
+
+	if (max == 0) {
+		printf("The band matrix is singular; no pivot found for column %zu.\n", k);
+		return 1;
+	}
+
+	if (p != k) {
+		double* row_k = window_ptr(s, k, k);
+		double* row_p = window_ptr(s, p, k);
+		for (size_t j = 0; j <= last_col - k; j++) {
+			double temp = row_k[j];
+			row_k[j] = row_p[j];
+			row_p[j] = temp;
+		}
+
+		double temp = s->rhs[k % STREAM_WINDOW];
+		s->rhs[k % STREAM_WINDOW] = s->rhs[p % STREAM_WINDOW];
+		s->rhs[p % STREAM_WINDOW] = temp;
+	}
+
+	double pivot = *window_ptr(s, k, k);
+	double* row_k = window_ptr(s, k, k + 1);
+	double y_k = s->rhs[k % STREAM_WINDOW];
+	for (size_t i = k + 1; i <= last_row; i++) {
+		double* a_ik = window_ptr(s, i, k);
+		double l = *a_ik/pivot;
+		s->rhs[i % STREAM_WINDOW] -= l*y_k;
+
+		if (l == 0) {
+			continue;
+		}
+
+		double* row_i = a_ik + 1;
+		for (size_t j = 0; j < last_col - k; j++) {
+			row_i[j] -= l*row_k[j];
+		}
+	}
+
+	double* record = &s->records[k*s->record_length];
+	memcpy(record, window_ptr(s, k, k), (s->record_length - 1)*sizeof(double));
+	record[s->record_length - 1] = y_k;
+
+	return 0;
+
+}
+
+// Marks the rows below `count` as complete (adding the Dirichlet rows) and eliminates every column whose rows are all complete
+static int complete_rows(struct Stream_State* s, size_t count) {
+	for (; s->complete_rows < count; s->complete_rows++) {
+		size_t r = s->complete_rows;
+		if (r == 0 || r == s->n - 1) {
+			memset(s->window[r % STREAM_WINDOW], 0, sizeof(s->window[0]));
+			*window_ptr(s, r, r) = 1;
+			s->rhs[r % STREAM_WINDOW] = (r == 0) ? s->d1 : s->d2;
+		}
+	}
+
+	for (; s->next_column < s->n; s->next_column++) {
+		size_t k = s->next_column;
+		size_t last_row = (k + s->lower < s->n - 1) ? k + s->lower : s->n - 1;
+		if (last_row >= s->complete_rows) {
+			break;
+		}
+		if (eliminate_column(s, k)) {
+			return 1;
+		}
+	}
+
+	return 0;
+
+}
+
+// Local arrays of a block of elements, each added to the window and followed by the columns it completes
+static int stream_block(struct Stream_State* s, Element_2D_Type kind, int count, const double (*x)[ELEMENT_BLOCK], const size_t* starting_points, double a, double b, struct Function_Field *function_field) {
+	double k[MAX_ELEMENT_NODES*MAX_ELEMENT_NODES][ELEMENT_BLOCK], F[MAX_ELEMENT_NODES][ELEMENT_BLOCK];
+	int size = (kind == QUAD) ? 3 : 2;
+
+	STATS_TIMER_START(kernel_timer);
+	if (output_element_block(kind, count, x, a, b, function_field, k, F)) {
+		return 1;
+	}
+	STATS_TIMER_STOP(kernel_timer, STATS_LOCAL_KERNELS);
+
+	// The scatter is part of the elimination here, so both are recorded as the factorization
+	STATS_TIMER_START(factor_timer);
+	for (int c = 0; c < count; c++) {
+		size_t first = starting_points[c];
+		size_t last = first + size - 1;
+		if (size - 1 > s->lower || last >= s->n || first + 1 != (s->next_row > 0 ? s->next_row : 1)) {
+			printf("The streaming solve needs the elements in node order, each starting at the last node of the one before.\n");
+			return 1;
+		}
+
+		start_rows(s, last);
+		for (int i = 0; i < size; i++) {
+			for (int j = 0; j < size; j++) {
+				*window_ptr(s, first + i, first + j) += k[i*size + j][c];
+			}
+		}
+		for (int i = 0; i < size; i++) {
+			s->rhs[(first + i) % STREAM_WINDOW] += F[i][c];
+		}
+
+		// No later element touches the rows before this element's last node
+		if (complete_rows(s, last)) {
+			return 1;
+		}
+	}
+	STATS_TIMER_STOP(factor_timer, STATS_FACTOR);
+
+	return 0;
+
+}
+
+// Completes the remaining rows and back-substitutes into a new solution vector
+static gsl_vector* finish_stream(struct Stream_State* s) {
+	STATS_TIMER_START(factor_timer);
+	start_rows(s, s->n - 1);
+	if (complete_rows(s, s->n)) {
+		return NULL;
+	}
+	STATS_TIMER_STOP(factor_timer, STATS_FACTOR);
+
+	gsl_vector* solution = gsl_vector_alloc(s->n);
+	if (solution == NULL) {
+		return NULL;
+	}
+	STATS_ALLOC(s->n*sizeof(double));
+
+	STATS_TIMER_START(solve_timer);
+	TRACE_SPAN_START(solve_span);
+	double* y = solution->data;
+	size_t n = s->n;
+	for (size_t i = n; i-- > 0;) {
+		if (s->scratch_fd >= 0 && i % STREAM_PREFETCH_ROWS == 0 && i > 0) {
+			// The kernel only reads ahead forwards, so ask for the next stretch below explicitly
+			size_t first = (i > STREAM_PREFETCH_ROWS) ? i - STREAM_PREFETCH_ROWS : 0;
+			size_t page = sysconf(_SC_PAGESIZE);
+			uintptr_t begin = (uintptr_t) &s->records[first*s->record_length] & ~(uintptr_t) (page - 1);
+			madvise((void*) begin, (uintptr_t) &s->records[i*s->record_length] - begin, MADV_WILLNEED);
+		}
+
+		size_t last_col = (i + s->lower + s->upper < n - 1) ? i + s->lower + s->upper : n - 1;
+		const double* record = &s->records[i*s->record_length];
+		double sum = record[s->record_length - 1];
+		for (size_t j = i + 1; j <= last_col; j++) {
+			sum -= record[j - i]*y[j];
+		}
+		y[i] = sum/record[0];
+	}
+	STATS_TIMER_STOP(solve_timer, STATS_SOLVE);
+	TRACE_SPAN_STOP(solve_span, "back substitution", "solver");
+
+	return solution;
+
+}
+
+gsl_vector* solve_ode_streaming(struct Mesh* input_mesh, double a, double b, double d1, double d2, struct Function_Field *function_field, const char* scratch_path) {
+	if (input_mesh->connectivity_grid == NULL || input_mesh->node_coordinates == NULL || input_mesh->num_nodes < 2) {
+		printf("ERROR: Provided mesh is not properly loaded with element and node information.\n");
+		return NULL;
+	}
+
+	struct Stream_State s;
+	if (create_stream_state(&s, input_mesh->num_nodes, mesh_bandwidth(input_mesh), d1, d2, scratch_path)) {
+		return NULL;
+	}
+
+	TRACE_SPAN_START(stream_span);
+	STATS_HW_START(element_loop);
+	uint32_t e = 0;
+	while (e < input_mesh->num_elements) {
+		Element_2D_Type kind = input_mesh->connectivity_grid[e].kind;
+		int size = (kind == QUAD) ? 3 : 2;
+
+		double x[MAX_ELEMENT_NODES][ELEMENT_BLOCK];
+		size_t starting_points[ELEMENT_BLOCK];
+		int count = 0;
+		for (; count < ELEMENT_BLOCK && e + count < input_mesh->num_elements && input_mesh->connectivity_grid[e + count].kind == kind; count++) {
+			struct Element_Conn* conn = &input_mesh->connectivity_grid[e + count];
+			starting_points[count] = (kind == QUAD) ? conn->node_list.L3.node_id[0] : conn->node_list.L2.node_id[0];
+			for (int i = 0; i < size; i++) {
+				x[i][count] = input_mesh->node_coordinates[starting_points[count] + i];
+			}
+		}
+
+		if (stream_block(&s, kind, count, (const double (*)[ELEMENT_BLOCK]) x, starting_points, a, b, function_field)) {
+			close_records(&s);
+			return NULL;
+		}
+		e += count;
+	}
+	STATS_HW_STOP(element_loop, HW_ELEMENT_LOOP);
+	TRACE_SPAN_STOP(stream_span, "assemble and eliminate", "solver");
+
+	gsl_vector* solution = finish_stream(&s);
+	close_records(&s);
+
+	return solution;
+
+}
+
+gsl_vector* solve_ode_streaming_nodes(struct Node_Stream* nodes, Element_2D_Type mesh_kind, double a, double b, double d1, double d2, struct Function_Field *function_field, const char* scratch_path) {
+	int size = (mesh_kind == QUAD) ? 3 : 2;
+	uint32_t num_elements = (nodes->num_nodes - 1)/(size - 1);
+
+	struct Stream_State s;
+	if (create_stream_state(&s, nodes->num_nodes, size - 1, d1, d2, scratch_path)) {
+		return NULL;
+	}
+
+	double last_node;
+	if (next_node(nodes, &last_node)) {
+		close_records(&s);
+		return NULL;
+	}
+
+	TRACE_SPAN_START(stream_span);
+	STATS_HW_START(element_loop);
+	uint32_t e = 0;
+	while (e < num_elements) {
+		double x[MAX_ELEMENT_NODES][ELEMENT_BLOCK];
+		size_t starting_points[ELEMENT_BLOCK];
+		int count = (num_elements - e < ELEMENT_BLOCK) ? num_elements - e : ELEMENT_BLOCK;
+
+		for (int c = 0; c < count; c++) {
+			starting_points[c] = (size_t) (e + c)*(size - 1);
+			x[0][c] = last_node;
+			for (int i = 1; i < size; i++) {
+				if (next_node(nodes, &x[i][c])) {
+					close_records(&s);
+					return NULL;
+				}
+			}
+			last_node = x[size - 1][c];
+		}
+
+		if (stream_block(&s, mesh_kind, count, (const double (*)[ELEMENT_BLOCK]) x, starting_points, a, b, function_field)) {
+			close_records(&s);
+			return NULL;
+		}
+		e += count;
+	}
+	STATS_HW_STOP(element_loop, HW_ELEMENT_LOOP);
+	TRACE_SPAN_STOP(stream_span, "assemble and eliminate", "solver");
+
+	// An L3 mesh with an even node count leaves the last node outside of the elements, as build_mesh_from_nodes() does
+	while (nodes->next_index < nodes->num_nodes) {
+		if (next_node(nodes, &last_node)) {
+			close_records(&s);
+			return NULL;
+		}
+	}
+
+	gsl_vector* solution = finish_stream(&s);
+	close_records(&s);
+
+	return solution;
+
+}
+
+/* Node streams */
+
+int open_node_stream_file(struct Node_Stream* nodes, FILE* mesh_stream) {
+	char buffer[100];
+	if (fgets(buffer, 100, mesh_stream) == NULL) {
+		printf("Error opening file, or file is empty or invalid. Please check.\n");
+		return 1;
+	}
+
+	long num_nodes = strtol(buffer, NULL, 10);
+	if (num_nodes < 2 || num_nodes > MESH_MAX_NODES) {
+		printf("A mesh needs between 2 and %d nodes; %ld were given.\n", MESH_MAX_NODES, num_nodes);
+		return 1;
+	}
+
+	memset(nodes, 0, sizeof(struct Node_Stream));
+	nodes->num_nodes = num_nodes;
+	nodes->file = mesh_stream;
+
+	return 0;
+
+}
+
+// The same nodes as generate_uniform_mesh()
+int open_node_stream_uniform(struct Node_Stream* nodes, double start, double end, int num_elements, Element_2D_Type mesh_kind) {
+	if (end <= start || num_elements < 1) {
+		printf("Cannot generate a mesh of %d elements over [%f, %f].\n", num_elements, start, end);
+		return 1;
+	}
+
+	int nodes_per_element = (mesh_kind == QUAD) ? 2 : 1;
+	if (num_elements > (MESH_MAX_NODES - 1)/nodes_per_element) {
+		printf("Cannot generate a mesh of %d elements; a mesh holds at most %d nodes.\n", num_elements, MESH_MAX_NODES);
+		return 1;
+	}
+
+	memset(nodes, 0, sizeof(struct Node_Stream));
+	nodes->num_nodes = num_elements*nodes_per_element + 1;
+	nodes->start = start;
+	nodes->end = end;
+	nodes->step = (end - start)/(nodes->num_nodes - 1);
+
+	return 0;
+
+}
+
+// Checks the file as parse_input_file() does: ascending nodes, and exactly as many as the first line says
+int next_node(struct Node_Stream* nodes, double* x) {
+	if (nodes->next_index == nodes->num_nodes) {
+		printf("All %u nodes of the mesh have already been read.\n", nodes->num_nodes);
+		return 1;
+	}
+
+	if (nodes->file == NULL) {
+		uint32_t i = nodes->next_index++;
+		*x = (i < nodes->num_nodes - 1) ? nodes->start + i*nodes->step : nodes->end;
+		return 0;
+	}
+
+	char buffer[100];
+	if (fgets(buffer, 100, nodes->file) == NULL) {
+		printf("CRITICAL ERROR: Mesh file is malformed; number of nodes reported (%u) is not equal to the number of nodes scanned (%u).\n", nodes->num_nodes, nodes->next_index);
+		return 1;
+	}
+
+	double coord = strtof(buffer, NULL);
+	if (nodes->next_index > 0 && coord <= nodes->previous) {
+		printf("CRITICAL ERROR: Mesh file is malformed; coordinate of node %u (%f) is equal or less than the previous node %u (%f).\n", nodes->next_index + 1, coord, nodes->next_index, nodes->previous);
+		return 1;
+	}
+	nodes->previous = coord;
+	*x = coord;
+
+	if (++nodes->next_index == nodes->num_nodes && fgets(buffer, 100, nodes->file) != NULL) {
+		printf("CRITICAL ERROR: Mesh file is malformed; there are more than %u nodes in the mesh file. Please check.\n", nodes->num_nodes);
+		return 1;
+	}
+
+	return 0;
+
+}
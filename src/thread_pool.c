@@ -0,0 +1,239 @@
+/* Fixed-size worker thread pool
+ *
+ * Tasks are plain function/argument pairs run in submission order by whichever worker is free.
+ * The pool does not own the task arguments; the submitter keeps them alive until the task has run.
+ */
+#include "thread_pool.h"
+#include "solver_stats.h"
+#include "trace.h"
+
+#include <unistd.h>
+#include <string.h>
+
+static void* worker_thread(void *args) {
+	struct Thread_Pool *pool = (struct Thread_Pool*) args;
+	trace_set_thread_name("worker");
+
+	pthread_mutex_lock(&pool->lock);
+	while (true) {
+		while (pool->queue_head == NULL && !pool->shutting_down) {
+			pthread_cond_wait(&pool->work_available, &pool->lock);
+		}
+
+		if (pool->queue_head == NULL) {
+			// Shutting down, and nothing is left in the queue
+			break;
+		}
+
+		struct Thread_Task *task = pool->queue_head;
+		pool->queue_head = task->next;
+		if (pool->queue_head == NULL) {
+			pool->queue_tail = NULL;
+		}
+		pthread_mutex_unlock(&pool->lock);
+
+		TRACE_SPAN_START(task_span);
+		task->function(task->args);
+		TRACE_SPAN_STOP(task_span, "task", "pool");
+		free(task);
+
+		pthread_mutex_lock(&pool->lock);
+		pool->pending_tasks--;
+		if (pool->pending_tasks == 0) {
+			pthread_cond_broadcast(&pool->work_done);
+		}
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+
+}
+
+// One worker per online processor
+size_t default_thread_count() {
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return (count > 0) ? (size_t) count : 1;
+
+}
+
+int create_thread_pool(struct Thread_Pool *pool, size_t num_threads) {
+	if (num_threads == 0) {
+		num_threads = default_thread_count();
+	}
+
+	pool->queue_head = NULL;
+	pool->queue_tail = NULL;
+	pool->pending_tasks = 0;
+	pool->shutting_down = false;
+	pool->num_threads = 0;
+
+	pool->threads = malloc(num_threads*sizeof(pthread_t));
+	if (pool->threads == NULL) {
+		printf("Error allocating a thread pool of %zu threads.\n", num_threads);
+		return 1;
+	}
+
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->work_available, NULL);
+	pthread_cond_init(&pool->work_done, NULL);
+
+	for (size_t i = 0; i < num_threads; i++) {
+		if (pthread_create(&pool->threads[i], NULL, worker_thread, pool) != 0) {
+			printf("Error starting worker thread %zu.\n", i);
+			free_thread_pool(pool);
+			return 1;
+		}
+		pool->num_threads++;
+	}
+
+	return 0;
+
+}
+
+int submit_task(struct Thread_Pool *pool, void (*function) (void *), void *args) {
+	struct Thread_Task *task = malloc(sizeof(struct Thread_Task));
+	if (task == NULL) {
+		printf("Error allocating a thread pool task.\n");
+		return 1;
+	}
+
+	task->function = function;
+	task->args = args;
+	task->next = NULL;
+
+	pthread_mutex_lock(&pool->lock);
+	if (pool->queue_tail == NULL) {
+		pool->queue_head = task;
+	}
+	else {
+		pool->queue_tail->next = task;
+	}
+	pool->queue_tail = task;
+	pool->pending_tasks++;
+
+	pthread_cond_signal(&pool->work_available);
+	pthread_mutex_unlock(&pool->lock);
+
+	return 0;
+
+}
+
+// Blocks until every submitted task has finished running
+void wait_thread_pool(struct Thread_Pool *pool) {
+	pthread_mutex_lock(&pool->lock);
+	while (pool->pending_tasks > 0) {
+		pthread_cond_wait(&pool->work_done, &pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+}
+
+// Runs the remaining queued tasks, then stops and joins the workers
+void free_thread_pool(struct Thread_Pool *pool) {
+	pthread_mutex_lock(&pool->lock);
+	pool->shutting_down = true;
+	pthread_cond_broadcast(&pool->work_available);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (size_t i = 0; i < pool->num_threads; i++) {
+		pthread_join(pool->threads[i], NULL);
+	}
+
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->work_available);
+	pthread_cond_destroy(&pool->work_done);
+	free(pool->threads);
+	pool->threads = NULL;
+	pool->num_threads = 0;
+
+}
+
+/* Fork-join loops
+ *
+ * For splitting the element work of a single solve, which may itself be running on a pool worker (where waiting on the pool would deadlock).
+ * Short-lived threads are started for each loop, so the loops should be long enough to pay for them (see `min_chunk`).
+ */
+
+#define PARALLEL_MAX_THREADS 256
+
+struct Parallel_Chunk {
+	int (*body) (void *, size_t, size_t);
+	void *args;
+	size_t first, last;
+	struct Solver_Stats stats; // Merged into the caller's active statistics after the join
+	bool collect_stats;
+	int status;
+
+};
+
+static void* parallel_chunk_thread(void *args) {
+	struct Parallel_Chunk *chunk = (struct Parallel_Chunk*) args;
+	if (chunk->collect_stats) {
+		stats_activate(&chunk->stats);
+	}
+
+	chunk->status = chunk->body(chunk->args, chunk->first, chunk->last);
+
+	return NULL;
+
+}
+
+// Runs body(args, first, last) over [0, count) in contiguous chunks of at least `min_chunk` items, on up to `num_threads` threads
+// (0 for one per core), the calling thread included; returns non-zero if any chunk did
+int parallel_for(size_t count, size_t num_threads, size_t min_chunk, int (*body) (void *, size_t, size_t), void *args) {
+	if (num_threads == 0) {
+		num_threads = default_thread_count();
+	}
+	if (min_chunk == 0) {
+		min_chunk = 1;
+	}
+
+	size_t num_chunks = count/min_chunk;
+	if (num_chunks > num_threads) {
+		num_chunks = num_threads;
+	}
+	if (num_chunks > PARALLEL_MAX_THREADS) {
+		num_chunks = PARALLEL_MAX_THREADS;
+	}
+	if (num_chunks <= 1) {
+		return (count > 0) ? body(args, 0, count) : 0;
+	}
+
+	struct Parallel_Chunk chunks[PARALLEL_MAX_THREADS];
+	pthread_t threads[PARALLEL_MAX_THREADS];
+	bool started[PARALLEL_MAX_THREADS] = {false};
+	struct Solver_Stats* caller_stats = active_stats;
+
+	for (size_t c = 0; c < num_chunks; c++) {
+		chunks[c].body = body;
+		chunks[c].args = args;
+		chunks[c].first = count*c/num_chunks;
+		chunks[c].last = count*(c + 1)/num_chunks;
+		memset(&chunks[c].stats, 0, sizeof(struct Solver_Stats));
+		chunks[c].collect_stats = (caller_stats != NULL);
+		chunks[c].status = 0;
+	}
+
+	// A chunk whose thread cannot be started runs on the calling thread instead
+	for (size_t c = 1; c < num_chunks; c++) {
+		started[c] = (pthread_create(&threads[c], NULL, parallel_chunk_thread, &chunks[c]) == 0);
+	}
+
+	int status = body(args, chunks[0].first, chunks[0].last);
+	for (size_t c = 1; c < num_chunks; c++) {
+		if (started[c]) {
+			pthread_join(threads[c], NULL);
+			if (caller_stats != NULL) {
+				stats_merge(caller_stats, &chunks[c].stats);
+			}
+		}
+		else {
+			chunks[c].status = body(args, chunks[c].first, chunks[c].last);
+		}
+		status |= chunks[c].status;
+	}
+
+	return status;
+
+}
@@ -0,0 +1,301 @@
+/* Implicit time integration of u_t = u_xx + A u_x + B u + f(x, t)
+ *
+ * The Galerkin equations in space are M u' = K u + F(t), with the mass matrix M, the coefficient matrix K of the steady solves
+ * and the load vector F of f at time t. Each scheme takes steps of the form
+ *	(c M - theta dt K) u_(n+1) = R v + dt (w_new F(t_(n+1)) + w_old F(t_n))
+ *	backward Euler:  c = 1,   theta = 1,   R = M,            v = u_n,                    w_new = 1,   w_old = 0
+ *	Crank-Nicolson:  c = 1,   theta = 1/2, R = M + dt/2 K,   v = u_n,                    w_new = 1/2, w_old = 1/2
+ *	BDF2:            c = 3/2, theta = 1,   R = M,            v = 2 u_n - u_(n-1)/2,      w_new = 1,   w_old = 0
+ * so with a fixed step the matrix on the left is assembled and decomposed once, and a step costs a band product, a load vector and two triangular solves.
+ * The element stiffness, convection and mass matrices come from the operator kernel, and f is evaluated at the quadrature points of a Coefficient_Table.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "time_stepping.h"
+#include "variable_coefficients.h"
+#include "solver_stats.h"
+#include "trace.h"
+
+struct Time_System {
+	struct Coefficient_Table table; // Quadrature points of the load vectors
+	const struct Time_Problem* problem;
+	struct Band_Matrix M, K;
+	double* fq; // Per-point values of f
+
+};
+
+static double now_seconds() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec + now.tv_nsec/1e9;
+
+}
+
+// M and K, from the element operators of the table's blocks
+static int assemble_time_matrices(struct Time_System* s) {
+	const struct Coefficient_Table* table = &s->table;
+	int bandwidth = mesh_bandwidth(table->mesh);
+	if (create_band_matrix(&s->M, table->mesh->num_nodes, bandwidth, bandwidth)) {
+		return 1;
+	}
+	if (create_band_matrix(&s->K, table->mesh->num_nodes, bandwidth, bandwidth)) {
+		free_band_matrix(&s->M);
+		return 1;
+	}
+
+	TRACE_SPAN_START(assembly_span);
+	for (uint32_t k = 0; k < table->num_blocks; k++) {
+		const struct Coefficient_Block* block = &table->blocks[k];
+		double stiffness[MAX_ELEMENT_NODES*MAX_ELEMENT_NODES][ELEMENT_BLOCK];
+		double convection[MAX_ELEMENT_NODES*MAX_ELEMENT_NODES][ELEMENT_BLOCK];
+		double mass[MAX_ELEMENT_NODES*MAX_ELEMENT_NODES][ELEMENT_BLOCK];
+
+		STATS_TIMER_START(kernel_timer);
+		output_operator_block(block->kind, block->count, (const double (*)[ELEMENT_BLOCK]) block->x, stiffness, convection, mass);
+		STATS_TIMER_STOP(kernel_timer, STATS_LOCAL_KERNELS);
+
+		STATS_TIMER_START(scatter_timer);
+		int size = block->size;
+		for (int c = 0; c < block->count; c++) {
+			for (int i = 0; i < size; i++) {
+				for (int j = 0; j < size; j++) {
+					int ij = i*size + j;
+					band_matrix_add(&s->M, block->nodes[i][c], block->nodes[j][c], mass[ij][c]);
+					band_matrix_add(&s->K, block->nodes[i][c], block->nodes[j][c], stiffness[ij][c] + s->problem->a*convection[ij][c] + s->problem->b*mass[ij][c]);
+				}
+			}
+		}
+		STATS_TIMER_STOP(scatter_timer, STATS_SCATTER);
+		STATS_COUNT(STATS_ELEMENTS, block->count);
+	}
+	TRACE_SPAN_STOP(assembly_span, "assemble matrix", "solver");
+
+	return 0;
+
+}
+
+// dest = c M + d K, entry by entry (the three bands share their layout)
+static void combine_time_matrices(const struct Time_System* s, struct Band_Matrix* dest, double c, double d) {
+	size_t entries = s->M.size*s->M.width;
+	for (size_t i = 0; i < entries; i++) {
+		dest->data[i] = c*s->M.data[i] + d*s->K.data[i];
+	}
+	dest->factored = false;
+
+}
+
+// The step matrix c M - theta dt K with identity Dirichlet rows, decomposed
+static int factorize_step_matrix(const struct Time_System* s, struct Band_Matrix* A, double c, double theta_dt, struct Time_Report* report) {
+	combine_time_matrices(s, A, c, -theta_dt);
+	band_matrix_set_row_identity(A, 0);
+	band_matrix_set_row_identity(A, A->size - 1);
+	report->factorizations++;
+
+	return band_lu_decomp(A);
+
+}
+
+// F(t) into F; zero without a source
+static void assemble_time_load(struct Time_System* s, double t, double* F) {
+	const struct Coefficient_Table* table = &s->table;
+	memset(F, 0, table->mesh->num_nodes*sizeof(double));
+	if (s->problem->f == NULL) {
+		return;
+	}
+
+	for (size_t q = 0; q < table->num_values; q++) {
+		s->fq[q] = s->problem->f(table->xq[q], t, s->problem->context);
+	}
+	for (uint32_t k = 0; k < table->num_blocks; k++) {
+		const struct Coefficient_Block* block = &table->blocks[k];
+		double F_e[MAX_ELEMENT_NODES][ELEMENT_BLOCK];
+
+		STATS_TIMER_START(kernel_timer);
+		output_load_block(block->kind, block->count, (const double (*)[ELEMENT_BLOCK]) block->x, &s->fq[block->offset], F_e);
+		STATS_TIMER_STOP(kernel_timer, STATS_LOCAL_KERNELS);
+
+		for (int i = 0; i < block->size; i++) {
+			for (int c = 0; c < block->count; c++) {
+				F[block->nodes[i][c]] += F_e[i][c];
+			}
+		}
+	}
+
+}
+
+// Solves u_t = u_xx + A u_x + B u + f(x, t) from t0 to t0 + num_steps*dt; the solution holds u at the final time
+int solve_ode_transient(struct Mesh* input_mesh, struct ODE_Solution* solution, const struct Time_Problem* problem, const struct Time_Options* options, struct Time_Report* report) {
+	memset(solution, 0, sizeof(struct ODE_Solution));
+	memset(report, 0, sizeof(struct Time_Report));
+	double begin = now_seconds();
+	size_t n = input_mesh->num_nodes;
+	if (!(options->dt > 0)) {
+		printf("The time step has to be positive, not %g.\n", options->dt);
+		return 1;
+	}
+	if (problem->initial != NULL && problem->initial->size != n) {
+		printf("The initial values have %zu entries for a mesh of %zu nodes.\n", problem->initial->size, n);
+		return 1;
+	}
+
+	struct Time_System s = {0};
+	s.problem = problem;
+	struct Coefficient_Function a_function = {NULL, NULL, NULL, problem->a};
+	struct Coefficient_Function b_function = {NULL, NULL, NULL, problem->b};
+	if (create_coefficient_table(&s.table, input_mesh, &a_function, &b_function)) {
+		return 1;
+	}
+	if (assemble_time_matrices(&s)) {
+		free_coefficient_table(&s.table);
+		return 1;
+	}
+
+	Time_Scheme scheme = options->scheme;
+	double dt = options->dt;
+	double c = (scheme == TIME_BDF2) ? 1.5 : 1;
+	double theta = (scheme == TIME_CRANK_NICOLSON) ? 0.5 : 1;
+	double w_new = theta;
+	double w_old = 1 - theta;
+
+	struct Band_Matrix A, A_start;
+	A_start.data = NULL;
+	A_start.pivots = NULL;
+	solution->solution_coeff = gsl_vector_alloc(n);
+	double* work = calloc(4*n + s.table.num_values, sizeof(double));
+	int status = (solution->solution_coeff == NULL || work == NULL || copy_band_matrix(&A, &s.M));
+	if (status) {
+		printf("Error allocating the time steps of %zu nodes.\n", n);
+		if (solution->solution_coeff != NULL) {
+			gsl_vector_free(solution->solution_coeff);
+			solution->solution_coeff = NULL;
+		}
+		free(work);
+		free_band_matrix(&s.M);
+		free_band_matrix(&s.K);
+		free_coefficient_table(&s.table);
+		return 1;
+	}
+	STATS_ALLOC((4*n + s.table.num_values)*sizeof(double));
+	double* u = solution->solution_coeff->data;
+	double* u_old = work; // u_(n-1), for BDF2
+	double* rhs = work + n;
+	double* F_new = work + 2*n;
+	double* F_old = work + 3*n;
+	s.fq = work + 4*n;
+
+	// The decompositions are done up front; BDF2 starts with a backward Euler step, of the same M and K
+	status = factorize_step_matrix(&s, &A, c, theta*dt, report);
+	if (status == 0 && scheme == TIME_BDF2 && options->num_steps > 0) {
+		status = copy_band_matrix(&A_start, &s.M) || factorize_step_matrix(&s, &A_start, 1, dt, report);
+	}
+	// R is M, or K overwritten with M + dt/2 K for Crank-Nicolson
+	struct Band_Matrix* R = &s.M;
+	if (scheme == TIME_CRANK_NICOLSON) {
+		combine_time_matrices(&s, &s.K, 1, dt/2);
+		R = &s.K;
+	}
+
+	if (problem->initial != NULL) {
+		memcpy(u, problem->initial->data, n*sizeof(double));
+	}
+	else {
+		memset(u, 0, n*sizeof(double));
+	}
+	u[0] = problem->d1;
+	u[n - 1] = problem->d2;
+	memcpy(u_old, u, n*sizeof(double));
+	// A steady source is assembled once and weighted by 1 (w_new + w_old) at every step
+	bool steady = (problem->f == NULL || problem->steady_source);
+	if (steady || w_old != 0) {
+		assemble_time_load(&s, options->t0, F_old);
+	}
+	report->factor_seconds = now_seconds() - begin;
+	double steps_begin = now_seconds();
+
+	size_t interval = options->snapshot_interval;
+	bool snapshots = (options->writer != NULL);
+	if (status == 0 && snapshots && interval > 0) {
+		status = submit_solution_values(options->writer, input_mesh->node_coordinates, u, n, 0);
+		report->snapshots += (status == 0);
+	}
+
+	TRACE_SPAN_START(steps_span);
+	for (size_t step = 1; step <= options->num_steps && status == 0; step++) {
+		double t = options->t0 + step*dt;
+		bool start = (scheme == TIME_BDF2 && step == 1);
+
+		// rhs = R v, with v in F_new (free until the load is assembled) for BDF2; u_old is u_0 at the start step
+		if (scheme == TIME_BDF2 && !start) {
+			for (size_t i = 0; i < n; i++) {
+				double v = 2*u[i] - 0.5*u_old[i];
+				u_old[i] = u[i];
+				F_new[i] = v;
+			}
+			band_matrix_apply(R, F_new, rhs);
+		}
+		else {
+			band_matrix_apply(R, u, rhs);
+		}
+
+		if (steady) {
+			for (size_t i = 0; i < n; i++) {
+				rhs[i] += dt*F_old[i];
+			}
+		}
+		else {
+			// F_old is only assembled for Crank-Nicolson
+			assemble_time_load(&s, t, F_new);
+			if (w_old != 0) {
+				for (size_t i = 0; i < n; i++) {
+					rhs[i] += dt*(w_new*F_new[i] + w_old*F_old[i]);
+				}
+			}
+			else {
+				for (size_t i = 0; i < n; i++) {
+					rhs[i] += dt*F_new[i];
+				}
+			}
+			double* swap = F_old;
+			F_old = F_new;
+			F_new = swap;
+		}
+		rhs[0] = problem->d1;
+		rhs[n - 1] = problem->d2;
+
+		STATS_TIMER_START(solve_timer);
+		band_lu_substitute(start ? &A_start : &A, rhs, 1);
+		STATS_TIMER_STOP(solve_timer, STATS_SOLVE);
+		memcpy(u, rhs, n*sizeof(double));
+		report->steps++;
+
+		if (snapshots && ((interval > 0 && step % interval == 0) || (step == options->num_steps && (interval == 0 || step % interval != 0)))) {
+			status = submit_solution_values(options->writer, input_mesh->node_coordinates, u, n, step);
+			report->snapshots += (status == 0);
+		}
+	}
+	TRACE_SPAN_STOP(steps_span, "time steps", "solver");
+
+	report->seconds = now_seconds() - begin;
+	report->seconds_per_step = (report->steps > 0) ? (now_seconds() - steps_begin)/report->steps : 0;
+
+	free(work);
+	free_band_matrix(&A);
+	if (A_start.data != NULL) {
+		free_band_matrix(&A_start);
+	}
+	free_band_matrix(&s.M);
+	free_band_matrix(&s.K);
+	free_coefficient_table(&s.table);
+	if (status) {
+		gsl_vector_free(solution->solution_coeff);
+		solution->solution_coeff = NULL;
+	}
+
+	return status;
+
+}
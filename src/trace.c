@@ -0,0 +1,209 @@
+/* Trace-event timeline of the solver's phases and tasks
+ *
+ * Every thread records into its own ring buffer, so recording is a clock read and a few stores with no locks.
+ * Spans are recorded as complete events (beginning and duration) when they end.
+ * The buffers are linked into a list (with a compare-and-swap) the first time each thread records an event, and
+ * outlive their threads so that the timeline can be written out at exit, in the trace-event JSON format read by
+ * chrome://tracing and https://ui.perfetto.dev.
+ */
+#include "trace.h"
+
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdatomic.h>
+
+struct Trace_Buffer {
+	struct Trace_Event* events;
+	size_t capacity;
+	_Atomic uint64_t written; // Events recorded so far; the newest `capacity` of them are in `events`
+	uint32_t thread_id;
+	char thread_name[32];
+	struct Trace_Buffer* next;
+
+};
+
+bool trace_enabled = false;
+
+static char* trace_path = NULL;
+static size_t buffer_capacity = TRACE_DEFAULT_EVENTS;
+static struct timespec trace_origin;
+static _Atomic(struct Trace_Buffer*) buffers = NULL;
+static atomic_uint next_thread_id = 1;
+
+static _Thread_local struct Trace_Buffer* thread_buffer = NULL;
+static _Thread_local bool thread_buffer_failed = false;
+
+static struct Trace_Buffer* get_thread_buffer() {
+	if (thread_buffer != NULL || thread_buffer_failed) {
+		return thread_buffer;
+	}
+
+	struct Trace_Buffer* buffer = calloc(1, sizeof(struct Trace_Buffer));
+	if (buffer != NULL) {
+		buffer->events = malloc(buffer_capacity*sizeof(struct Trace_Event));
+	}
+	if (buffer == NULL || buffer->events == NULL) {
+		// Leave this thread out of the trace rather than failing the solve
+		free(buffer);
+		thread_buffer_failed = true;
+		return NULL;
+	}
+
+	buffer->capacity = buffer_capacity;
+	atomic_init(&buffer->written, 0);
+	buffer->thread_id = atomic_fetch_add(&next_thread_id, 1);
+	snprintf(buffer->thread_name, sizeof(buffer->thread_name), "thread %u", buffer->thread_id);
+
+	buffer->next = atomic_load(&buffers);
+	while (!atomic_compare_exchange_weak(&buffers, &buffer->next, buffer));
+
+	thread_buffer = buffer;
+
+	return buffer;
+
+}
+
+static void trace_at_exit() {
+	trace_dump();
+
+}
+
+// Starts recording (events_per_thread = 0 for the default); the trace is written to `path` when the process exits
+int trace_start(const char* path, size_t events_per_thread) {
+	if (trace_enabled) {
+		printf("Tracing has already been started.\n");
+		return 1;
+	}
+
+	trace_path = strdup(path);
+	if (trace_path == NULL) {
+		return 1;
+	}
+
+	buffer_capacity = (events_per_thread > 0) ? events_per_thread : TRACE_DEFAULT_EVENTS;
+	clock_gettime(CLOCK_MONOTONIC, &trace_origin);
+	atexit(trace_at_exit);
+
+	trace_enabled = true;
+	trace_set_thread_name("main");
+
+	return 0;
+
+}
+
+void trace_set_thread_name(const char* name) {
+	if (!trace_enabled) {
+		return;
+	}
+
+	struct Trace_Buffer* buffer = get_thread_buffer();
+	if (buffer != NULL) {
+		snprintf(buffer->thread_name, sizeof(buffer->thread_name), "%s", name);
+	}
+
+}
+
+uint64_t trace_now() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - trace_origin.tv_sec)*1000000000ULL + now.tv_nsec - trace_origin.tv_nsec;
+
+}
+
+void trace_record(char phase, const char* name, const char* category, uint64_t timestamp_ns, int64_t value) {
+	struct Trace_Buffer* buffer = get_thread_buffer();
+	if (buffer == NULL) {
+		return;
+	}
+
+	// Only this thread writes to its buffer; the release store publishes the event to a concurrent dump
+	uint64_t n = atomic_load_explicit(&buffer->written, memory_order_relaxed);
+	struct Trace_Event* event = &buffer->events[n % buffer->capacity];
+	event->name = name;
+	event->category = category;
+	event->timestamp_ns = timestamp_ns;
+	event->value = value;
+	event->phase = phase;
+	atomic_store_explicit(&buffer->written, n + 1, memory_order_release);
+
+}
+
+static void output_event(FILE* output, const struct Trace_Event* event, int pid, uint32_t tid) {
+	fprintf(output, ",\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"%c\", \"ts\": %.3f, \"pid\": %d, \"tid\": %u",
+	        event->name, event->category, event->phase, event->timestamp_ns/1e3, pid, tid);
+
+	if (event->phase == 'X') {
+		fprintf(output, ", \"dur\": %.3f", event->value/1e3);
+	}
+	else if (event->phase == 'C') {
+		fprintf(output, ", \"args\": {\"value\": %lld}", (long long) event->value);
+	}
+	else if (event->phase == 'i') {
+		fprintf(output, ", \"s\": \"t\"");
+	}
+	fprintf(output, "}");
+
+}
+
+// Writes the recorded events; threads may still be recording, in which case events they overwrite during the dump are left out
+int output_trace_json(FILE* output) {
+	int pid = getpid();
+	uint64_t dropped = 0;
+
+	fprintf(output, "{\"traceEvents\": [\n{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": 0, \"args\": {\"name\": \"ODE solver\"}}", pid);
+
+	for (struct Trace_Buffer* buffer = atomic_load(&buffers); buffer != NULL; buffer = buffer->next) {
+		fprintf(output, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %u, \"args\": {\"name\": \"%s\"}}",
+		        pid, buffer->thread_id, buffer->thread_name);
+
+		uint64_t written = atomic_load_explicit(&buffer->written, memory_order_acquire);
+		uint64_t first = (written > buffer->capacity) ? written - buffer->capacity : 0;
+		size_t count = written - first;
+
+		struct Trace_Event* copy = malloc(count*sizeof(struct Trace_Event));
+		if (copy == NULL && count > 0) {
+			dropped += count;
+			continue;
+		}
+		for (uint64_t n = first; n < written; n++) {
+			copy[n - first] = buffer->events[n % buffer->capacity];
+		}
+
+		// Anything overwritten while copying is discarded
+		uint64_t after = atomic_load_explicit(&buffer->written, memory_order_acquire);
+		uint64_t valid = (after > buffer->capacity && after - buffer->capacity > first) ? after - buffer->capacity : first;
+		dropped += valid;
+
+		for (uint64_t n = valid; n < written; n++) {
+			output_event(output, &copy[n - first], pid, buffer->thread_id);
+		}
+		free(copy);
+	}
+
+	fprintf(output, "\n], \"displayTimeUnit\": \"ms\", \"otherData\": {\"dropped_events\": %llu}}\n", (unsigned long long) dropped);
+
+	return ferror(output) != 0;
+
+}
+
+int trace_dump() {
+	if (!trace_enabled) {
+		return 1;
+	}
+
+	FILE* output = fopen(trace_path, "w");
+	if (output == NULL) {
+		printf("Could not open %s for writing the trace.\n", trace_path);
+		return 1;
+	}
+
+	int status = output_trace_json(output);
+	if (fclose(output) != 0) {
+		status = 1;
+	}
+
+	return status;
+
+}
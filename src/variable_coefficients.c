@@ -0,0 +1,255 @@
+/* Variable coefficients
+ *
+ * For y'' + A(x) y' + B(x) y = f the element matrices need A and B at every quadrature point.
+ * Looking them up in a field (or calling back into the caller) is the expensive part of the element work, so the table evaluates them once,
+ * in the block layout of the element kernels, and keeps them with the gathered node coordinates and the quadrature points:
+ * the matrix of every later assembly is then pure arithmetic, and the load vector only evaluates f at the stored points.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "variable_coefficients.h"
+#include "band_matrix.h"
+#include "solver_stats.h"
+#include "trace.h"
+
+// Gathers the elements of the same kind starting at `first` into a block; returns how many were taken
+static int gather_coefficient_block(const struct Mesh* input_mesh, uint32_t first, struct Coefficient_Block* block) {
+	Element_2D_Type kind = input_mesh->connectivity_grid[first].kind;
+	block->kind = kind;
+	block->size = (kind == QUAD) ? 3 : 2;
+	block->num_points = element_quadrature_points(kind);
+
+	int count = 0;
+	while (count < ELEMENT_BLOCK && first + count < input_mesh->num_elements && input_mesh->connectivity_grid[first + count].kind == kind) {
+		const struct Element_Conn* conn = &input_mesh->connectivity_grid[first + count];
+		const int* node_id = (kind == QUAD) ? conn->node_list.L3.node_id : conn->node_list.L2.node_id;
+		for (int i = 0; i < block->size; i++) {
+			block->nodes[i][count] = node_id[i];
+			block->x[i][count] = input_mesh->node_coordinates[node_id[i]];
+		}
+		count++;
+	}
+	block->count = count;
+
+	return count;
+
+}
+
+static int evaluate_coefficient(const struct Coefficient_Function* c, const double* x, size_t n, double* values) {
+	if (c->field != NULL) {
+		if (f_eval_batch(c->field, x, n, values)) {
+			printf("Some of the quadrature points are outside of the range given by the coefficient field.\n");
+			return 1;
+		}
+		return 0;
+	}
+
+	for (size_t i = 0; i < n; i++) {
+		values[i] = (c->callback != NULL) ? c->callback(x[i], c->context) : c->constant;
+	}
+
+	return 0;
+
+}
+
+int create_coefficient_table(struct Coefficient_Table* table, struct Mesh* input_mesh, const struct Coefficient_Function* a, const struct Coefficient_Function* b) {
+	table->mesh = input_mesh;
+	table->blocks = NULL;
+	table->xq = NULL;
+	if (input_mesh->connectivity_grid == NULL || input_mesh->num_elements < 1) {
+		printf("A coefficient table needs a mesh with its elements.\n");
+		return 1;
+	}
+
+	// One block per ELEMENT_BLOCK elements, and one more at each change of kind
+	uint32_t max_blocks = input_mesh->num_elements/ELEMENT_BLOCK + 1;
+	for (uint32_t e = 1; e < input_mesh->num_elements; e++) {
+		max_blocks += (input_mesh->connectivity_grid[e].kind != input_mesh->connectivity_grid[e - 1].kind);
+	}
+	table->blocks = malloc(max_blocks*sizeof(struct Coefficient_Block));
+	if (table->blocks == NULL) {
+		printf("Error allocating the coefficient blocks of %u elements.\n", input_mesh->num_elements);
+		return 1;
+	}
+
+	table->num_blocks = 0;
+	table->num_values = 0;
+	uint32_t e = 0;
+	while (e < input_mesh->num_elements) {
+		struct Coefficient_Block* block = &table->blocks[table->num_blocks++];
+		int count = gather_coefficient_block(input_mesh, e, block);
+		if (block->num_points == 0) {
+			free_coefficient_table(table);
+			return 1;
+		}
+		block->offset = table->num_values;
+		table->num_values += (size_t) block->num_points*count;
+		e += count;
+	}
+
+	// Only as many blocks as were used are kept
+	struct Coefficient_Block* blocks = realloc(table->blocks, table->num_blocks*sizeof(struct Coefficient_Block));
+	if (blocks != NULL) {
+		table->blocks = blocks;
+	}
+
+	table->xq = malloc(3*table->num_values*sizeof(double));
+	if (table->xq == NULL) {
+		printf("Error allocating the coefficient table of %zu points.\n", table->num_values);
+		free_coefficient_table(table);
+		return 1;
+	}
+	STATS_ALLOC(table->num_blocks*sizeof(struct Coefficient_Block) + 3*table->num_values*sizeof(double));
+	table->a = table->xq + table->num_values;
+	table->b = table->a + table->num_values;
+
+	for (uint32_t k = 0; k < table->num_blocks; k++) {
+		struct Coefficient_Block* block = &table->blocks[k];
+		output_quadrature_point_block(block->kind, block->count, (const double (*)[ELEMENT_BLOCK]) block->x, &table->xq[block->offset]);
+	}
+
+	if (update_coefficient_table(table, a, b)) {
+		free_coefficient_table(table);
+		return 1;
+	}
+
+	return 0;
+
+}
+
+// Evaluates new coefficients at the stored points, for another A and B on the same mesh
+int update_coefficient_table(struct Coefficient_Table* table, const struct Coefficient_Function* a, const struct Coefficient_Function* b) {
+	TRACE_SPAN_START(coefficient_span);
+	int status = evaluate_coefficient(a, table->xq, table->num_values, table->a) || evaluate_coefficient(b, table->xq, table->num_values, table->b);
+	TRACE_SPAN_STOP(coefficient_span, "evaluate coefficients", "solver");
+
+	return status;
+
+}
+
+void free_coefficient_table(struct Coefficient_Table* table) {
+	free(table->blocks);
+	free(table->xq);
+	table->blocks = NULL;
+	table->xq = NULL;
+
+}
+
+int assemble_variable_matrix(const struct Coefficient_Table* table, struct Band_Matrix* K_coeff) {
+	int bandwidth = mesh_bandwidth(table->mesh);
+	if (create_band_matrix(K_coeff, table->mesh->num_nodes, bandwidth, bandwidth)) {
+		return 1;
+	}
+
+	TRACE_SPAN_START(assembly_span);
+	for (uint32_t k = 0; k < table->num_blocks; k++) {
+		const struct Coefficient_Block* block = &table->blocks[k];
+		double k_e[MAX_ELEMENT_NODES*MAX_ELEMENT_NODES][ELEMENT_BLOCK];
+
+		STATS_TIMER_START(kernel_timer);
+		output_variable_coefficient_block(block->kind, block->count, (const double (*)[ELEMENT_BLOCK]) block->x, &table->a[block->offset], &table->b[block->offset], k_e);
+		STATS_TIMER_STOP(kernel_timer, STATS_LOCAL_KERNELS);
+
+		STATS_TIMER_START(scatter_timer);
+		int size = block->size;
+		for (int c = 0; c < block->count; c++) {
+			for (int i = 0; i < size; i++) {
+				for (int j = 0; j < size; j++) {
+					band_matrix_add(K_coeff, block->nodes[i][c], block->nodes[j][c], k_e[i*size + j][c]);
+				}
+			}
+		}
+		STATS_TIMER_STOP(scatter_timer, STATS_SCATTER);
+		STATS_COUNT(STATS_ELEMENTS, block->count);
+	}
+	TRACE_SPAN_STOP(assembly_span, "assemble matrix", "solver");
+
+	return 0;
+
+}
+
+// The constant vector, with f evaluated at the stored quadrature points
+gsl_vector* assemble_variable_vector(const struct Coefficient_Table* table, struct Function_Field *function_field) {
+	size_t n = table->mesh->num_nodes;
+	gsl_vector* F_const = gsl_vector_calloc(n);
+	double* fq = malloc(table->num_values*sizeof(double));
+	if (F_const == NULL || fq == NULL) {
+		printf("Error allocating the constant vector of %zu nodes.\n", n);
+		if (F_const != NULL) {
+			gsl_vector_free(F_const);
+		}
+		free(fq);
+		return NULL;
+	}
+	STATS_ALLOC(n*sizeof(double) + table->num_values*sizeof(double));
+
+	TRACE_SPAN_START(assembly_span);
+	int status = f_eval_batch(function_field, table->xq, table->num_values, fq);
+	for (uint32_t k = 0; k < table->num_blocks; k++) {
+		const struct Coefficient_Block* block = &table->blocks[k];
+		double F[MAX_ELEMENT_NODES][ELEMENT_BLOCK];
+
+		STATS_TIMER_START(kernel_timer);
+		output_load_block(block->kind, block->count, (const double (*)[ELEMENT_BLOCK]) block->x, &fq[block->offset], F);
+		STATS_TIMER_STOP(kernel_timer, STATS_LOCAL_KERNELS);
+
+		for (int c = 0; c < block->count; c++) {
+			for (int i = 0; i < block->size; i++) {
+				*gsl_vector_ptr(F_const, block->nodes[i][c]) += F[i][c];
+			}
+		}
+	}
+	TRACE_SPAN_STOP(assembly_span, "assemble load vector", "solver");
+	free(fq);
+
+	if (status) {
+		printf("Some of the quadrature points are outside of the range given by the field.\n");
+		gsl_vector_free(F_const);
+		return NULL;
+	}
+
+	return F_const;
+
+}
+
+// The decomposed matrix with its Dirichlet rows, for solve_ode_factorized() with any constant vector and boundary values
+int factorize_ode_variable(const struct Coefficient_Table* table, struct Band_Matrix* K_lu) {
+	if (assemble_variable_matrix(table, K_lu)) {
+		return 1;
+	}
+
+	band_matrix_set_row_identity(K_lu, 0);
+	band_matrix_set_row_identity(K_lu, table->mesh->num_nodes - 1);
+	if (band_lu_decomp(K_lu)) {
+		free_band_matrix(K_lu);
+		return 1;
+	}
+
+	return 0;
+
+}
+
+// Solves y'' + A(x) y' + B(x) y = f with y = d1 and d2 at the ends of the table's mesh, by banded LU
+int solve_ode_variable(const struct Coefficient_Table* table, struct ODE_Solution* solution, double d1, double d2, struct Function_Field *function_field) {
+	memset(solution, 0, sizeof(struct ODE_Solution));
+
+	struct Band_Matrix K_lu;
+	if (factorize_ode_variable(table, &K_lu)) {
+		return 1;
+	}
+
+	gsl_vector* F_const = assemble_variable_vector(table, function_field);
+	if (F_const == NULL) {
+		free_band_matrix(&K_lu);
+		return 1;
+	}
+
+	solution->solution_coeff = solve_ode_factorized(table->mesh, &K_lu, F_const, d1, d2);
+	gsl_vector_free(F_const);
+	free_band_matrix(&K_lu);
+
+	return (solution->solution_coeff == NULL) ? 1 : 0;
+
+}
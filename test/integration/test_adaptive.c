@@ -0,0 +1,384 @@
+#include <stdlib.h>
+#include <check.h>
+#include <math.h>
+
+#include "fe_section.h"
+#include "adaptive.h"
+#include "post_processing.h"
+
+struct Function_Field *field = NULL;
+
+double zero_func(double x) {
+	return 0;
+
+}
+
+static void setup_function_field() {
+	struct Function_Field *f_field_temp = malloc(sizeof(struct Function_Field));
+
+	create_function_field(f_field_temp, -1, 2, 301, zero_func);
+
+	field = f_field_temp;
+
+}
+
+static void teardown_function_field() {
+	free_function_field(field);
+	free(field);
+	field = NULL;
+
+}
+
+// y'' + A y' + B y = 0 on [0, 1] with y(0) = 0 and y(1) = 1 has the solution (e^(r1 x) - e^(r2 x))/(e^r1 - e^r2);
+// for large A it has a boundary layer of width about 1/A at x = 0
+static double exact_derivative(double a, double b, double x) {
+	double r1 = (-a + sqrt(a*a - 4*b))/2;
+	double r2 = (-a - sqrt(a*a - 4*b))/2;
+
+	return (r1*exp(r1*x) - r2*exp(r2*x))/(exp(r1) - exp(r2));
+
+}
+
+// Relative L2 error of the derivative, sampled at 20000 points
+static double derivative_error(struct Mesh* m, struct ODE_Solution* sol, double a, double b) {
+	size_t n = 20000;
+	double* x = malloc(n*sizeof(double));
+	double* y = malloc(n*sizeof(double));
+	double* dydx = malloc(n*sizeof(double));
+	for (size_t i = 0; i < n; i++) {
+		x[i] = (i + 0.5)/n;
+	}
+	ck_assert_int_eq(evaluate_solution(m, sol, x, n, y, dydx), 0);
+
+	double error = 0, norm = 0;
+	for (size_t i = 0; i < n; i++) {
+		double exact = exact_derivative(a, b, x[i]);
+		error += (dydx[i] - exact)*(dydx[i] - exact);
+		norm += exact*exact;
+	}
+	free(x);
+	free(y);
+	free(dydx);
+
+	return sqrt(error/norm);
+
+}
+
+static double uniform_error(Element_2D_Type kind, int num_elements, double a, double b) {
+	struct Mesh m;
+	struct ODE_Solution sol;
+	struct Solver_Options options = {0};
+	ck_assert_int_eq(generate_uniform_mesh(&m, 0, 1, num_elements, kind), 0);
+	ck_assert_int_eq(solve_ode_constant_opts(&m, &sol, a, b, 0, 1, field, &options), 0);
+	double error = derivative_error(&m, &sol, a, b);
+	free_solution_memory(&sol);
+	free_mesh_memory(&m);
+
+	return error;
+
+}
+
+START_TEST(boundary_layers) {
+	// L2 elements for A = 100, and L3 elements for README Homogenous Case 5 (A = 10)
+	Element_2D_Type kinds[2] = {LINEAR, QUAD};
+	double a[2] = {100, 10};
+	double tolerance[2] = {1e-2, 1e-4};
+
+	for (int k = 0; k < 2; k++) {
+		struct Mesh m;
+		struct ODE_Solution sol;
+		struct Solver_Options options = {0};
+		struct Adaptive_Options adaptive = {0};
+		struct Adaptive_Report report;
+		adaptive.tolerance = tolerance[k];
+		ck_assert_int_eq(generate_uniform_mesh(&m, 0, 1, 4, kinds[k]), 0);
+		ck_assert_int_eq(solve_ode_adaptive(&m, &sol, a[k], 7, 0, 1, field, &adaptive, &options, &report), 0);
+
+		ck_assert(report.converged);
+		ck_assert_uint_eq(report.num_nodes[report.num_steps - 1], m.num_nodes);
+		ck_assert_double_le(report.error_estimate[report.num_steps - 1], tolerance[k]);
+		for (int i = 1; i < report.num_steps; i++) {
+			ck_assert_uint_gt(report.num_nodes[i], report.num_nodes[i - 1]);
+		}
+
+		// The recovered derivative is accurate enough for the estimate to be within a factor of 4 of the true error
+		double error = derivative_error(&m, &sol, a[k], 7);
+		ck_assert_double_le(error, 4*tolerance[k]);
+		ck_assert_double_ge(error, tolerance[k]/4);
+
+		// A uniform mesh with as many nodes is much less accurate
+		int num_elements = (kinds[k] == QUAD) ? (m.num_nodes - 1)/2 : m.num_nodes - 1;
+		ck_assert_double_gt(uniform_error(kinds[k], num_elements, a[k], 7), 3*error);
+
+		free_solution_memory(&sol);
+		free_mesh_memory(&m);
+	}
+
+}
+END_TEST
+
+START_TEST(refinement) {
+	// Marked L2 elements gain their midpoint
+	struct Mesh m, refined;
+	ck_assert_int_eq(generate_uniform_mesh(&m, 0, 4, 4, LINEAR), 0);
+	bool marked_l2[4] = {true, false, false, true};
+	ck_assert_int_eq(refine_mesh(&m, marked_l2, &refined), 0);
+	double expected_l2[7] = {0, 0.5, 1, 2, 3, 3.5, 4};
+	ck_assert_uint_eq(refined.num_nodes, 7);
+	ck_assert_uint_eq(refined.num_elements, 6);
+	for (int i = 0; i < 7; i++) {
+		ck_assert_double_eq(refined.node_coordinates[i], expected_l2[i]);
+	}
+	free_mesh_memory(&m);
+	free_mesh_memory(&refined);
+
+	// Marked L3 elements are split at their middle node
+	ck_assert_int_eq(generate_uniform_mesh(&m, 0, 4, 2, QUAD), 0);
+	bool marked_l3[2] = {false, true};
+	ck_assert_int_eq(refine_mesh(&m, marked_l3, &refined), 0);
+	double expected_l3[7] = {0, 1, 2, 2.5, 3, 3.5, 4};
+	ck_assert_uint_eq(refined.num_nodes, 7);
+	ck_assert_uint_eq(refined.num_elements, 3);
+	for (int i = 0; i < 7; i++) {
+		ck_assert_double_eq(refined.node_coordinates[i], expected_l3[i]);
+	}
+	ck_assert(mesh_refinable(&refined));
+	free_mesh_memory(&m);
+	free_mesh_memory(&refined);
+
+	// An L3 mesh with a node left over is not refined
+	FILE* mesh_file = fopen("adaptive_even.in", "w");
+	fprintf(mesh_file, "6\n0\n1\n2.5\n3\n4\n5.5\n");
+	fclose(mesh_file);
+	mesh_file = fopen("adaptive_even.in", "r");
+	ck_assert_int_eq(parse_input_file(mesh_file, &m, QUAD), 0);
+	fclose(mesh_file);
+	remove("adaptive_even.in");
+	ck_assert(!mesh_refinable(&m));
+	ck_assert_int_eq(refine_mesh(&m, marked_l3, &refined), 1);
+	free_mesh_memory(&m);
+
+}
+END_TEST
+
+START_TEST(exact_solutions) {
+	// y'' = 0 is solved exactly, so there is nothing to refine
+	struct Mesh m;
+	struct ODE_Solution sol;
+	struct Solver_Options options = {0};
+	struct Adaptive_Options adaptive = {0};
+	struct Adaptive_Report report;
+	adaptive.tolerance = 1e-10;
+	ck_assert_int_eq(generate_uniform_mesh(&m, 0, 1, 5, LINEAR), 0);
+	ck_assert_int_eq(solve_ode_adaptive(&m, &sol, 0, 0, 0, 1, field, &adaptive, &options, &report), 0);
+	ck_assert(report.converged);
+	ck_assert_int_eq(report.num_steps, 1);
+	ck_assert_uint_eq(m.num_nodes, 6);
+	free_solution_memory(&sol);
+
+	// The node limit stops the refinement with the last solve
+	adaptive.tolerance = 1e-6;
+	adaptive.max_nodes = 50;
+	ck_assert_int_eq(solve_ode_adaptive(&m, &sol, 100, 7, 0, 1, field, &adaptive, &options, &report), 0);
+	ck_assert(!report.converged);
+	ck_assert_uint_le(m.num_nodes, 50);
+	ck_assert_uint_eq(report.num_nodes[report.num_steps - 1], m.num_nodes);
+	free_solution_memory(&sol);
+	free_mesh_memory(&m);
+
+}
+END_TEST
+
+// Relative L2 error of the derivative of a p-element solution, sampled as in derivative_error()
+static double p_derivative_error(struct P_Mesh* m, const gsl_vector* sol, double a, double b) {
+	size_t n = 20000;
+	double* x = malloc(n*sizeof(double));
+	double* y = malloc(n*sizeof(double));
+	double* dydx = malloc(n*sizeof(double));
+	for (size_t i = 0; i < n; i++) {
+		x[i] = (i + 0.5)/n;
+	}
+	ck_assert_int_eq(evaluate_p_solution(m, sol, x, n, y, dydx), 0);
+
+	double error = 0, norm = 0;
+	for (size_t i = 0; i < n; i++) {
+		double exact = exact_derivative(a, b, x[i]);
+		error += (dydx[i] - exact)*(dydx[i] - exact);
+		norm += exact*exact;
+	}
+	free(x);
+	free(y);
+	free(dydx);
+
+	return sqrt(error/norm);
+
+}
+
+START_TEST(hp_refinement) {
+	// The A = 100 boundary layer, from four quadratic elements
+	double tolerance = 1e-4;
+	struct P_Mesh m;
+	gsl_vector* sol;
+	struct HP_Options hp = {0};
+	struct HP_Report report;
+	hp.tolerance = tolerance;
+	ck_assert_int_eq(generate_uniform_p_mesh(&m, 0, 1, 4, 2), 0);
+	ck_assert_int_eq(solve_ode_hp(&m, &sol, 100, 7, 0, 1, field, &hp, &report), 0);
+
+	ck_assert(report.converged);
+	ck_assert_uint_eq(report.num_dofs[report.num_steps - 1], m.num_dofs);
+	ck_assert_double_le(report.error_estimate[report.num_steps - 1], tolerance);
+	uint32_t raised = 0, split = 0;
+	for (int i = 0; i < report.num_steps - 1; i++) {
+		raised += report.p_refined[i];
+		split += report.h_refined[i];
+	}
+	ck_assert_uint_gt(raised, 0);
+	ck_assert_uint_gt(split, 0);
+
+	// The highest-mode estimate is conservative, and the elements are smallest and of the highest order in the layer
+	double error = p_derivative_error(&m, sol, 100, 7);
+	ck_assert_double_le(error, tolerance);
+	ck_assert_double_lt(m.vertices[1] - m.vertices[0], 0.05);
+	ck_assert_int_eq(m.order[0], m.max_order);
+
+	// h-refinement of L3 elements needs more unknowns for the same estimate, as does a uniform mesh of higher order
+	struct Mesh h_mesh;
+	struct ODE_Solution h_sol;
+	struct Solver_Options options = {0};
+	struct Adaptive_Options adaptive = {0};
+	struct Adaptive_Report h_report;
+	adaptive.tolerance = tolerance;
+	ck_assert_int_eq(generate_uniform_mesh(&h_mesh, 0, 1, 4, QUAD), 0);
+	ck_assert_int_eq(solve_ode_adaptive(&h_mesh, &h_sol, 100, 7, 0, 1, field, &adaptive, &options, &h_report), 0);
+	ck_assert(h_report.converged);
+	ck_assert_uint_gt(h_mesh.num_nodes, 2*m.num_dofs);
+	free_solution_memory(&h_sol);
+	free_mesh_memory(&h_mesh);
+
+	struct P_Mesh uniform;
+	gsl_vector* uniform_sol;
+	ck_assert_int_eq(generate_uniform_p_mesh(&uniform, 0, 1, (m.num_dofs - 1)/6, 6), 0);
+	ck_assert_uint_le(uniform.num_dofs, m.num_dofs);
+	ck_assert_int_eq(solve_ode_p(&uniform, &uniform_sol, 100, 7, 0, 1, field), 0);
+	ck_assert_double_gt(p_derivative_error(&uniform, uniform_sol, 100, 7), 10*error);
+	gsl_vector_free(uniform_sol);
+	free_p_mesh(&uniform);
+
+	// The refined mesh, with its mixed orders, survives a round trip through a mesh file
+	FILE* mesh_file = fopen("hp_mesh.in", "w");
+	ck_assert_int_eq(output_p_mesh_file(&m, mesh_file), 0);
+	fclose(mesh_file);
+	struct P_Mesh parsed;
+	mesh_file = fopen("hp_mesh.in", "r");
+	ck_assert_int_eq(parse_p_mesh_file(mesh_file, &parsed), 0);
+	fclose(mesh_file);
+	remove("hp_mesh.in");
+	ck_assert_uint_eq(parsed.num_elements, m.num_elements);
+	ck_assert_uint_eq(parsed.num_dofs, m.num_dofs);
+	for (uint32_t e = 0; e < m.num_elements; e++) {
+		ck_assert_int_eq(parsed.order[e], m.order[e]);
+		ck_assert_double_eq(parsed.vertices[e], m.vertices[e]);
+	}
+	ck_assert_double_eq(parsed.vertices[m.num_elements], 1);
+	free_p_mesh(&parsed);
+
+	gsl_vector_free(sol);
+	free_p_mesh(&m);
+
+}
+END_TEST
+
+START_TEST(hp_indicators) {
+	// Bubble coefficients of 2^-k decay at ln 2 per order, which is below the default threshold; 4^-k is above it
+	struct P_Mesh m;
+	int orders[2] = {6, 6};
+	double vertices[3] = {0, 1, 3};
+	ck_assert_int_eq(create_p_mesh(&m, vertices, 2, orders), 0);
+	gsl_vector* sol = gsl_vector_calloc(m.num_dofs);
+	for (int k = 2; k <= 6; k++) {
+		gsl_vector_set(sol, m.first_dof[0] + k - 1, pow(2, -k));
+		gsl_vector_set(sol, m.first_dof[1] + k - 1, pow(4, -k));
+	}
+	gsl_vector_set(sol, m.first_dof[1], 1);
+
+	double indicators[2], decay_rates[2], estimate;
+	ck_assert_int_eq(estimate_hp_errors(&m, sol, indicators, decay_rates, &estimate), 0);
+	ck_assert_double_eq_tol(decay_rates[0], log(2), 1e-12);
+	ck_assert_double_eq_tol(decay_rates[1], log(4), 1e-12);
+	ck_assert_double_lt(decay_rates[0], HP_DEFAULT_SMOOTHNESS);
+	ck_assert_double_gt(decay_rates[1], HP_DEFAULT_SMOOTHNESS);
+
+	// The highest coefficient squared over the Jacobian, against the H1 seminorm
+	ck_assert_double_eq_tol(indicators[0], pow(2, -12)/0.5, 1e-15);
+	ck_assert_double_eq_tol(indicators[1], pow(4, -12)/1, 1e-15);
+	double norm = 2*0.25/0.5 + 2*0.25/1;
+	for (int k = 2; k <= 6; k++) {
+		norm += pow(4, -k)/0.5 + pow(16, -k)/1;
+	}
+	ck_assert_double_eq_tol(estimate, sqrt((indicators[0] + indicators[1])/norm), 1e-12);
+
+	gsl_vector_free(sol);
+	free_p_mesh(&m);
+
+	// Malformed mixed-order mesh files are rejected
+	FILE* mesh_file = fopen("hp_bad.in", "w");
+	fprintf(mesh_file, "2\n0 4\n0.5 11\n1\n");
+	fclose(mesh_file);
+	mesh_file = fopen("hp_bad.in", "r");
+	ck_assert_int_eq(parse_p_mesh_file(mesh_file, &m), 1);
+	fclose(mesh_file);
+	mesh_file = fopen("hp_bad.in", "w");
+	fprintf(mesh_file, "2\n0 4\n0.5 3\n");
+	fclose(mesh_file);
+	mesh_file = fopen("hp_bad.in", "r");
+	ck_assert_int_eq(parse_p_mesh_file(mesh_file, &m), 1);
+	fclose(mesh_file);
+	remove("hp_bad.in");
+
+}
+END_TEST
+
+Suite* adaptive_suite() {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Adaptive Refinement Tests");
+
+	tc_core = tcase_create("Core");
+	tcase_add_checked_fixture(
+		tc_core,
+		setup_function_field,
+		teardown_function_field
+	);
+	tcase_set_timeout(tc_core, 60);
+
+	tcase_add_test(tc_core, boundary_layers);
+	tcase_add_test(tc_core, refinement);
+	tcase_add_test(tc_core, exact_solutions);
+	tcase_add_test(tc_core, hp_refinement);
+	tcase_add_test(tc_core, hp_indicators);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+
+}
+
+int main() {
+	int number_failed;
+	Suite *s_adaptive;
+	SRunner *sr_adaptive;
+
+	s_adaptive = adaptive_suite();
+	sr_adaptive = srunner_create(s_adaptive);
+
+	srunner_set_fork_status(sr_adaptive, CK_NOFORK);
+	srunner_run_all(sr_adaptive, CK_NORMAL);
+
+	number_failed = srunner_ntests_failed(sr_adaptive);
+
+	srunner_free(sr_adaptive);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
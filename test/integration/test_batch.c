@@ -0,0 +1,149 @@
+#include <stdlib.h>
+#include <check.h>
+#include <string.h>
+
+#include "fe_section.h"
+#include "batch.h"
+
+#define TOL 1e-12
+#define NUM_CASES 6
+
+// Cases 0, 2 and 5 share a mesh, field and coefficients; 3 shares only the mesh and field; 1 and 4 have meshes of their own
+static const char* manifest_lines[NUM_CASES] = {
+	"0 -4 -10 10 batch_field.dat 0 5 30",
+	"-1 -5 -1 1 batch_field.dat 0 5 60",
+	"0 -4 0 1 batch_field.dat 0 5 30",
+	"2 1 -10 10 batch_field.dat 0 5 30",
+	"0 -4 -10 10 batch_field.dat 1 5 30",
+	"0 -4 3 -3 batch_field.dat 0 5 30"
+};
+
+double linear_func(double x) {
+	return x;
+
+}
+
+START_TEST(batch_matches_single_solves) {
+	struct Function_Field field;
+	create_function_field(&field, 0, 6, 601, linear_func);
+	output_function_field(&field, "batch_field.dat");
+
+	FILE* manifest = tmpfile();
+	fprintf(manifest, "# A B d1 d2 field start end n\n");
+	for (int c = 0; c < NUM_CASES; c++) {
+		fprintf(manifest, "%s\n", manifest_lines[c]);
+	}
+	rewind(manifest);
+
+	struct Batch_Options options = {2, "batch_output.bin", WRITER_BINARY};
+	struct Batch_Summary summary;
+	ck_assert_int_eq(run_batch(manifest, &options, &summary), 0);
+	fclose(manifest);
+
+	ck_assert_uint_eq(summary.num_cases, NUM_CASES);
+	ck_assert_uint_eq(summary.num_groups, 3);
+	ck_assert_uint_eq(summary.num_factorizations, 4);
+	ck_assert_uint_eq(summary.num_failed, 0);
+
+	// Records arrive in completion order; each one must match a separate solve of its case
+	struct Function_Field read_field;
+	FILE* field_file = fopen("batch_field.dat", "r");
+	input_function_field(&read_field, field_file);
+	fclose(field_file);
+
+	FILE* output = fopen("batch_output.bin", "rb");
+	char magic[8];
+	ck_assert_uint_eq(fread(magic, 1, 8, output), 8);
+	ck_assert_int_eq(memcmp(magic, WRITER_BINARY_MAGIC, 8), 0);
+
+	bool seen[NUM_CASES] = {false};
+	uint64_t header[2];
+	while (fread(header, sizeof(uint64_t), 2, output) == 2) {
+		ck_assert_uint_lt(header[0], NUM_CASES);
+		ck_assert(!seen[header[0]]);
+		seen[header[0]] = true;
+
+		double a, b, d1, d2, start, end;
+		int n;
+		sscanf(manifest_lines[header[0]], "%lf %lf %lf %lf %*s %lf %lf %d", &a, &b, &d1, &d2, &start, &end, &n);
+
+		struct Mesh m;
+		struct ODE_Solution sol;
+		ck_assert_int_eq(generate_uniform_mesh(&m, start, end, n, LINEAR), 0);
+		ck_assert_int_eq(solve_ode_constant(&m, &sol, a, b, d1, d2, &read_field, false), 0);
+		ck_assert_uint_eq(header[1], m.num_nodes);
+
+		double* x = malloc(header[1]*sizeof(double));
+		double* y = malloc(header[1]*sizeof(double));
+		ck_assert_uint_eq(fread(x, sizeof(double), header[1], output), header[1]);
+		ck_assert_uint_eq(fread(y, sizeof(double), header[1], output), header[1]);
+		for (size_t i = 0; i < header[1]; i++) {
+			ck_assert_double_eq_tol(x[i], m.node_coordinates[i], TOL);
+			ck_assert_double_eq_tol(y[i], gsl_vector_get(sol.solution_coeff, i), TOL);
+		}
+
+		free(x);
+		free(y);
+		free_mesh_memory(&m);
+		free_solution_memory(&sol);
+	}
+
+	for (int c = 0; c < NUM_CASES; c++) {
+		ck_assert(seen[c]);
+	}
+
+	fclose(output);
+	free_function_field(&read_field);
+	free_function_field(&field);
+	remove("batch_output.bin");
+	remove("batch_field.dat");
+
+}
+END_TEST
+
+START_TEST(malformed_manifest) {
+	FILE* manifest = tmpfile();
+	fprintf(manifest, "0 -4 -10 10 batch_field.dat 0 5\n");
+	rewind(manifest);
+
+	struct Batch_Case* cases;
+	size_t num_cases;
+	ck_assert_int_eq(read_batch_manifest(manifest, &cases, &num_cases), 1);
+	fclose(manifest);
+
+}
+END_TEST
+
+Suite* batch_suite() {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Batch Manifest Tests");
+
+	tc_core = tcase_create("Core");
+	tcase_add_test(tc_core, batch_matches_single_solves);
+	tcase_add_test(tc_core, malformed_manifest);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+
+}
+
+int main() {
+	int number_failed;
+	Suite *s_batch;
+	SRunner *sr_batch;
+
+	s_batch = batch_suite();
+	sr_batch = srunner_create(s_batch);
+
+	srunner_set_fork_status(sr_batch, CK_NOFORK);
+	srunner_run_all(sr_batch, CK_NORMAL);
+
+	number_failed = srunner_ntests_failed(sr_batch);
+
+	srunner_free(sr_batch);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
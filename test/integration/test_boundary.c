@@ -0,0 +1,280 @@
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+#include <math.h>
+
+#include "fe_section.h"
+#include "band_matrix.h"
+
+struct Function_Field *field = NULL;
+
+// y = cos(2x) + x solves y'' + y' - 2y = f
+double exact(double x) {
+	return cos(2*x) + x;
+
+}
+
+double exact_derivative(double x) {
+	return -2*sin(2*x) + 1;
+
+}
+
+double driving_func(double x) {
+	return -6*cos(2*x) - 2*sin(2*x) + 1 - 2*x;
+
+}
+
+static void setup_function_field() {
+	struct Function_Field *f_field_temp = malloc(sizeof(struct Function_Field));
+
+	create_function_field(f_field_temp, -1, 2, 30001, driving_func);
+
+	field = f_field_temp;
+
+}
+
+static void teardown_function_field() {
+	free_function_field(field);
+	free(field);
+	field = NULL;
+
+}
+
+// The condition of the given type and Robin coefficient that the exact solution satisfies at x
+static struct Boundary_Condition exact_condition(Boundary_Type type, double alpha, double x) {
+	struct Boundary_Condition condition = {type, 0, alpha};
+	switch (type) {
+		case BOUNDARY_DIRICHLET:
+			condition.value = exact(x);
+			break;
+		case BOUNDARY_NEUMANN:
+			condition.value = exact_derivative(x);
+			break;
+		case BOUNDARY_ROBIN:
+			condition.value = exact_derivative(x) + alpha*exact(x);
+			break;
+	}
+
+	return condition;
+
+}
+
+#define NUM_SPECS 4
+static const Boundary_Type start_types[NUM_SPECS] = {BOUNDARY_NEUMANN, BOUNDARY_ROBIN, BOUNDARY_ROBIN, BOUNDARY_DIRICHLET};
+static const Boundary_Type end_types[NUM_SPECS] = {BOUNDARY_ROBIN, BOUNDARY_NEUMANN, BOUNDARY_ROBIN, BOUNDARY_NEUMANN};
+static const double start_alphas[NUM_SPECS] = {0, 3, 1, 0};
+static const double end_alphas[NUM_SPECS] = {2, 0, -0.5, 0};
+
+static struct Boundary_Spec exact_spec(int s) {
+	struct Boundary_Spec boundary = {exact_condition(start_types[s], start_alphas[s], 0), exact_condition(end_types[s], end_alphas[s], 1)};
+
+	return boundary;
+
+}
+
+static double nodal_error(struct Mesh* m, const gsl_vector* y) {
+	double error = 0;
+	for (uint32_t i = 0; i < m->num_nodes; i++) {
+		error = fmax(error, fabs(gsl_vector_get(y, i) - exact(m->node_coordinates[i])));
+	}
+
+	return error;
+
+}
+
+START_TEST(boundary_convergence) {
+	// For every combination of conditions the error drops by 4 per mesh halving on L2 meshes and by at least 8 on L3 meshes
+	Element_2D_Type kinds[2] = {LINEAR, QUAD};
+	double min_ratio[2] = {3.5, 7};
+	for (int s = 0; s < NUM_SPECS; s++) {
+		struct Boundary_Spec boundary = exact_spec(s);
+		for (int k = 0; k < 2; k++) {
+			double previous = 0;
+			for (uint32_t elements = 10; elements <= 40; elements *= 2) {
+				struct Mesh m;
+				ck_assert_int_eq(generate_uniform_mesh(&m, 0, 1, elements, kinds[k]), 0);
+
+				struct ODE_Solution solution;
+				struct Solver_Options options = {0};
+				options.boundary = &boundary;
+				ck_assert_int_eq(solve_ode_constant_opts(&m, &solution, 1, -2, 0, 0, field, &options), 0);
+
+				double error = nodal_error(&m, solution.solution_coeff);
+				if (previous > 0) {
+					ck_assert_double_ge(previous/error, min_ratio[k]);
+				}
+				previous = error;
+
+				free_solution_memory(&solution);
+				free_mesh_memory(&m);
+			}
+		}
+	}
+
+}
+END_TEST
+
+START_TEST(dirichlet_spec) {
+	// A spec with Dirichlet conditions at both ends is the default solve
+	Element_2D_Type kinds[2] = {LINEAR, QUAD};
+	for (int k = 0; k < 2; k++) {
+		struct Mesh m;
+		ck_assert_int_eq(generate_uniform_mesh(&m, 0, 1, 50, kinds[k]), 0);
+
+		struct ODE_Solution expected, solution;
+		struct Solver_Options options = {0};
+		options.no_condensation = true;
+		ck_assert_int_eq(solve_ode_constant_opts(&m, &expected, 1, -2, exact(0), exact(1), field, &options), 0);
+		struct Boundary_Spec boundary = dirichlet_boundary(exact(0), exact(1));
+		options.boundary = &boundary;
+		ck_assert_int_eq(solve_ode_constant_opts(&m, &solution, 1, -2, 0, 0, field, &options), 0);
+		ck_assert_int_eq(memcmp(solution.solution_coeff->data, expected.solution_coeff->data, m.num_nodes*sizeof(double)), 0);
+
+		free_solution_memory(&expected);
+		free_solution_memory(&solution);
+		free_mesh_memory(&m);
+	}
+
+}
+END_TEST
+
+START_TEST(repeated_conditions) {
+	// One assembled band and constant vector serve every spec: each factorization matches a fresh solve, and the assembled arrays are left as they were
+	struct Mesh m;
+	ck_assert_int_eq(generate_uniform_mesh(&m, 0, 1, 60, QUAD), 0);
+
+	struct Band_Matrix K_coeff;
+	ck_assert_int_eq(assemble_coefficient_matrix(&m, 1, -2, &K_coeff), 0);
+	gsl_vector* F_const = assemble_constant_vector(&m, field);
+	ck_assert_ptr_nonnull(F_const);
+	size_t band_bytes = K_coeff.size*K_coeff.width*sizeof(double);
+	double* assembled = malloc(band_bytes);
+	memcpy(assembled, K_coeff.data, band_bytes);
+	gsl_vector* assembled_load = gsl_vector_alloc(m.num_nodes);
+	gsl_vector_memcpy(assembled_load, F_const);
+
+	for (int s = 0; s < NUM_SPECS; s++) {
+		struct Boundary_Spec boundary = exact_spec(s);
+		struct Band_Matrix K_lu;
+		ck_assert_int_eq(factorize_ode_boundary(&K_coeff, &boundary, &K_lu), 0);
+		gsl_vector* y = solve_ode_boundary(&K_lu, F_const, &boundary);
+		ck_assert_ptr_nonnull(y);
+
+		struct ODE_Solution fresh;
+		struct Solver_Options options = {0};
+		options.boundary = &boundary;
+		ck_assert_int_eq(solve_ode_constant_opts(&m, &fresh, 1, -2, 0, 0, field, &options), 0);
+		ck_assert_int_eq(memcmp(y->data, fresh.solution_coeff->data, m.num_nodes*sizeof(double)), 0);
+		free_solution_memory(&fresh);
+		gsl_vector_free(y);
+
+		// New values for the same types reuse the factors
+		boundary.start.value += 1;
+		boundary.end.value -= 2;
+		y = solve_ode_boundary(&K_lu, F_const, &boundary);
+		ck_assert_ptr_nonnull(y);
+		ck_assert_int_eq(solve_ode_constant_opts(&m, &fresh, 1, -2, 0, 0, field, &options), 0);
+		ck_assert_int_eq(memcmp(y->data, fresh.solution_coeff->data, m.num_nodes*sizeof(double)), 0);
+		free_solution_memory(&fresh);
+		gsl_vector_free(y);
+
+		free_band_matrix(&K_lu);
+	}
+	ck_assert_int_eq(memcmp(K_coeff.data, assembled, band_bytes), 0);
+	ck_assert_int_eq(memcmp(F_const->data, assembled_load->data, m.num_nodes*sizeof(double)), 0);
+
+	free(assembled);
+	gsl_vector_free(assembled_load);
+	gsl_vector_free(F_const);
+	free_band_matrix(&K_coeff);
+	free_mesh_memory(&m);
+
+}
+END_TEST
+
+START_TEST(invalid_boundary_options) {
+	struct Mesh m;
+	ck_assert_int_eq(generate_uniform_mesh(&m, 0, 1, 20, LINEAR), 0);
+	struct Boundary_Spec boundary = exact_spec(0);
+	struct ODE_Solution solution;
+	struct Solver_Options options = {0};
+	options.boundary = &boundary;
+
+	// The library and the command line share the rules, each broken one with its own reason
+	struct Solver_Options defaults = {0};
+	ck_assert_ptr_null(validate_solver_options(&defaults));
+	ck_assert_ptr_null(validate_solver_options(&options));
+	options.periodic = true;
+	const char* periodic_reason = validate_solver_options(&options);
+	ck_assert_ptr_nonnull(periodic_reason);
+	options.periodic = false;
+	options.linear_solver = SOLVER_MULTIGRID;
+	ck_assert_ptr_nonnull(validate_solver_options(&options));
+	ck_assert_int_ne(strcmp(validate_solver_options(&options), periodic_reason), 0);
+	options.linear_solver = SOLVER_BAND_LU;
+
+	options.periodic = true;
+	ck_assert_int_eq(solve_ode_constant_opts(&m, &solution, 1, -2, 0, 0, field, &options), 1);
+	options.periodic = false;
+	options.streaming = true;
+	ck_assert_int_eq(solve_ode_constant_opts(&m, &solution, 1, -2, 0, 0, field, &options), 1);
+	options.streaming = false;
+	options.linear_solver = SOLVER_MATRIX_FREE;
+	ck_assert_int_eq(solve_ode_constant_opts(&m, &solution, 1, -2, 0, 0, field, &options), 1);
+	options.linear_solver = SOLVER_MULTIGRID;
+	ck_assert_int_eq(solve_ode_constant_opts(&m, &solution, 1, -2, 0, 0, field, &options), 1);
+	options.linear_solver = SOLVER_BICGSTAB;
+	options.multigrid_preconditioner = true;
+	ck_assert_int_eq(solve_ode_constant_opts(&m, &solution, 1, -2, 0, 0, field, &options), 1);
+
+	// BiCGSTAB on the band takes the conditions
+	options.multigrid_preconditioner = false;
+	ck_assert_int_eq(solve_ode_constant_opts(&m, &solution, 1, -2, 0, 0, field, &options), 0);
+	ck_assert_double_le(nodal_error(&m, solution.solution_coeff), 1e-3);
+	free_solution_memory(&solution);
+	free_mesh_memory(&m);
+
+}
+END_TEST
+
+Suite* boundary_suite() {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Boundary Condition Tests");
+
+	tc_core = tcase_create("Core");
+	tcase_add_checked_fixture(
+		tc_core,
+		setup_function_field,
+		teardown_function_field
+	);
+
+	tcase_add_test(tc_core, boundary_convergence);
+	tcase_add_test(tc_core, dirichlet_spec);
+	tcase_add_test(tc_core, repeated_conditions);
+	tcase_add_test(tc_core, invalid_boundary_options);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+
+}
+
+int main() {
+	int number_failed;
+	Suite *s_boundary;
+	SRunner *sr_boundary;
+
+	s_boundary = boundary_suite();
+	sr_boundary = srunner_create(s_boundary);
+
+	srunner_set_fork_status(sr_boundary, CK_NOFORK);
+	srunner_run_all(sr_boundary, CK_NORMAL);
+
+	number_failed = srunner_ntests_failed(sr_boundary);
+
+	srunner_free(sr_boundary);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
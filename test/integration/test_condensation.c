@@ -0,0 +1,192 @@
+#include <stdlib.h>
+#include <check.h>
+#include <math.h>
+
+#include "fe_section.h"
+#include "static_condensation.h"
+
+struct Function_Field *field = NULL;
+
+double driving_func(double x) {
+	return x*x + x + 3;
+
+}
+
+static void setup_function_field() {
+	struct Function_Field *f_field_temp = malloc(sizeof(struct Function_Field));
+
+	create_function_field(f_field_temp, 0, 15, 2001, driving_func);
+
+	field = f_field_temp;
+
+}
+
+static void teardown_function_field() {
+	free_function_field(field);
+	free(field);
+	field = NULL;
+
+}
+
+// The condensed solve eliminates in a different order, so the solutions agree to round-off (amplified by the conditioning of the larger meshes)
+static void assert_close_solution(const gsl_vector* condensed, const gsl_vector* full) {
+	ck_assert_uint_eq(condensed->size, full->size);
+
+	double scale = 0;
+	for (size_t i = 0; i < full->size; i++) {
+		scale = fmax(scale, fabs(gsl_vector_get(full, i)));
+	}
+	for (size_t i = 0; i < full->size; i++) {
+		ck_assert_double_eq_tol(gsl_vector_get(condensed, i), gsl_vector_get(full, i), 1e-8*scale);
+	}
+
+}
+
+static void solve_both(struct Mesh* m, double a, double b, size_t num_threads) {
+	struct ODE_Solution full, condensed;
+	struct Solver_Options options = {0};
+
+	options.no_condensation = true;
+	ck_assert_int_eq(solve_ode_constant_opts(m, &full, a, b, 0, 5, field, &options), 0);
+
+	options.no_condensation = false;
+	options.num_threads = num_threads;
+	ck_assert_int_eq(solve_ode_constant_opts(m, &condensed, a, b, 0, 5, field, &options), 0);
+	ck_assert_ptr_null(condensed.coeff_matrix_global);
+	ck_assert_ptr_null(condensed.const_vector_global);
+	assert_close_solution(condensed.solution_coeff, full.solution_coeff);
+
+	free_solution_memory(&full);
+	free_solution_memory(&condensed);
+
+}
+
+// Meshes that are not condensed are solved exactly as with no_condensation
+static void assert_full_solve(struct Mesh* m, double a, double b) {
+	struct ODE_Solution full, fallback;
+	struct Solver_Options options = {0};
+
+	ck_assert_int_eq(solve_ode_constant_opts(m, &fallback, a, b, 1, 4, field, &options), 0);
+	options.no_condensation = true;
+	ck_assert_int_eq(solve_ode_constant_opts(m, &full, a, b, 1, 4, field, &options), 0);
+	for (size_t i = 0; i < full.solution_coeff->size; i++) {
+		ck_assert_double_eq(gsl_vector_get(fallback.solution_coeff, i), gsl_vector_get(full.solution_coeff, i));
+	}
+
+	free_solution_memory(&fallback);
+	free_solution_memory(&full);
+
+}
+
+START_TEST(condensed_solutions) {
+	// Diffusion, reaction and convection dominated cases, on a mesh smaller than one thread's share and on one split over threads
+	double cases[4][2] = {{4, 4}, {-1, -5}, {60, -5}, {0, 0}};
+	uint32_t sizes[2] = {150, 3*CONDENSE_MIN_CHUNK + 17};
+
+	for (int s = 0; s < 2; s++) {
+		struct Mesh m;
+		ck_assert_int_eq(generate_uniform_mesh(&m, 0, 10, sizes[s], QUAD), 0);
+		ck_assert(mesh_condensable(&m));
+
+		for (int c = 0; c < 4; c++) {
+			solve_both(&m, cases[c][0], cases[c][1], 1);
+			solve_both(&m, cases[c][0], cases[c][1], 4);
+		}
+
+		free_mesh_memory(&m);
+	}
+
+}
+END_TEST
+
+START_TEST(condensable_meshes) {
+	// L2 meshes, and L3 meshes with a node left over, are solved as the full system
+	struct Mesh m;
+	ck_assert_int_eq(generate_uniform_mesh(&m, 0, 10, 100, LINEAR), 0);
+	ck_assert(!mesh_condensable(&m));
+	free_mesh_memory(&m);
+
+	FILE* mesh_file = fopen("condensation_even.in", "w");
+	fprintf(mesh_file, "6\n0\n1\n2.5\n3\n4\n5.5\n");
+	fclose(mesh_file);
+
+	mesh_file = fopen("condensation_even.in", "r");
+	ck_assert_int_eq(parse_input_file(mesh_file, &m, QUAD), 0);
+	fclose(mesh_file);
+	ck_assert(!mesh_condensable(&m));
+
+	assert_full_solve(&m, -2, 3);
+	free_mesh_memory(&m);
+	remove("condensation_even.in");
+
+	// Asking for the global arrays also skips the condensation
+	struct ODE_Solution sol;
+	ck_assert_int_eq(generate_uniform_mesh(&m, 0, 10, 100, QUAD), 0);
+	ck_assert_int_eq(solve_ode_constant(&m, &sol, -2, 3, 1, 4, field, true), 0);
+	ck_assert_ptr_nonnull(sol.coeff_matrix_global);
+	ck_assert_uint_eq(sol.coeff_matrix_global->size1, m.num_nodes);
+	free_solution_memory(&sol);
+	free_mesh_memory(&m);
+
+}
+END_TEST
+
+START_TEST(singular_middle_node) {
+	// The middle diagonal of an L3 element of length h is b*8h/15 - 16/(3h), which vanishes for b = 10/h^2;
+	// the condensation gives up and the solve falls back to the pivoting full system
+	struct Mesh m;
+	ck_assert_int_eq(generate_uniform_mesh(&m, 0, 10, 10, QUAD), 0);
+	double h = 1;
+	double b = 10/(h*h);
+
+	gsl_vector* condensed = NULL;
+	ck_assert_int_eq(solve_ode_condensed(&m, &condensed, 0, b, 0, 5, field, 1), CONDENSE_FALLBACK);
+	ck_assert_ptr_null(condensed);
+
+	assert_full_solve(&m, 0, b);
+	free_mesh_memory(&m);
+
+}
+END_TEST
+
+Suite* condensation_suite() {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Static Condensation Tests");
+
+	tc_core = tcase_create("Core");
+	tcase_add_checked_fixture(
+		tc_core,
+		setup_function_field,
+		teardown_function_field
+	);
+	tcase_set_timeout(tc_core, 60);
+
+	tcase_add_test(tc_core, condensed_solutions);
+	tcase_add_test(tc_core, condensable_meshes);
+	tcase_add_test(tc_core, singular_middle_node);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+
+}
+
+int main() {
+	int number_failed;
+	Suite *s_condensation;
+	SRunner *sr_condensation;
+
+	s_condensation = condensation_suite();
+	sr_condensation = srunner_create(s_condensation);
+
+	srunner_set_fork_status(sr_condensation, CK_NOFORK);
+	srunner_run_all(sr_condensation, CK_NORMAL);
+
+	number_failed = srunner_ntests_failed(sr_condensation);
+
+	srunner_free(sr_condensation);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
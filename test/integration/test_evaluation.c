@@ -0,0 +1,228 @@
+#include <stdlib.h>
+#include <check.h>
+#include <string.h>
+
+#include "fe_section.h"
+#include "post_processing.h"
+
+#define TOL 1e-6
+#define NUM_QUERY 1001
+
+struct Function_Field *field = NULL;
+
+// Directory where the input meshes are.
+char input_mesh_dir[250];
+
+double constant_two(double x) {
+	return 2;
+
+}
+
+static void setup_function_field() {
+	struct Function_Field *f_field_temp = malloc(sizeof(struct Function_Field));
+
+	create_function_field(f_field_temp, 0, 15, 1501, constant_two);
+
+	field = f_field_temp;
+
+}
+
+static void teardown_function_field() {
+	free_function_field(field);
+	free(field);
+	field = NULL;
+
+}
+
+START_TEST(L2_linear_solution) {
+	// y'' = 0 with y(0) = 1, y(10) = 6 has the solution y = x/2 + 1, which the L2 space reproduces exactly
+	struct Mesh m;
+	struct ODE_Solution sol;
+
+	char dir[250];
+	memcpy(dir, input_mesh_dir, 250);
+	strcat(dir, "test_reference_array/linear_mesh.in");
+
+	FILE* linear_mesh = fopen(dir, "r");
+	ck_assert_ptr_nonnull(linear_mesh);
+	ck_assert_int_eq(parse_input_file(linear_mesh, &m, LINEAR), 0);
+	fclose(linear_mesh);
+
+	struct Function_Field zero_field;
+	create_function_field(&zero_field, 0, 15, 1501, constant_two);
+	memset(zero_field.f_values, 0, zero_field.number_of_points*sizeof(double));
+
+	ck_assert_int_eq(solve_ode_constant(&m, &sol, 0, 0, 1, 6, &zero_field, false), 0);
+
+	double *x = malloc(NUM_QUERY*sizeof(double));
+	double *y = malloc(NUM_QUERY*sizeof(double));
+	double *dydx = malloc(NUM_QUERY*sizeof(double));
+	for (int i = 0; i < NUM_QUERY; i++) {
+		x[i] = 10.0*i/(NUM_QUERY - 1);
+	}
+
+	ck_assert_int_eq(evaluate_solution(&m, &sol, x, NUM_QUERY, y, dydx), 0);
+	for (int i = 0; i < NUM_QUERY; i++) {
+		ck_assert_double_eq_tol(y[i], x[i]/2 + 1, TOL);
+		ck_assert_double_eq_tol(dydx[i], 0.5, TOL);
+	}
+
+	free(x); free(y); free(dydx);
+	free_function_field(&zero_field);
+	free_mesh_memory(&m);
+	free_solution_memory(&sol);
+
+}
+END_TEST
+
+START_TEST(L3_quadratic_solution) {
+	// y'' = 2 with y(0) = 0, y(5) = 25 has the solution y = x^2, which the L3 space reproduces exactly for centered middle nodes
+	struct Mesh m;
+	struct ODE_Solution sol;
+
+	FILE* quad_mesh = tmpfile();
+	fprintf(quad_mesh, "5\n0\n1\n2\n3.5\n5\n");
+	rewind(quad_mesh);
+	ck_assert_int_eq(parse_input_file(quad_mesh, &m, QUAD), 0);
+	fclose(quad_mesh);
+
+	ck_assert_int_eq(solve_ode_constant(&m, &sol, 0, 0, 0, 25, field, false), 0);
+
+	double *x = malloc(NUM_QUERY*sizeof(double));
+	double *y = malloc(NUM_QUERY*sizeof(double));
+	double *dydx = malloc(NUM_QUERY*sizeof(double));
+	for (int i = 0; i < NUM_QUERY; i++) {
+		x[i] = 5.0*i/(NUM_QUERY - 1);
+	}
+
+	ck_assert_int_eq(evaluate_solution(&m, &sol, x, NUM_QUERY, y, dydx), 0);
+	for (int i = 0; i < NUM_QUERY; i++) {
+		ck_assert_double_eq_tol(y[i], x[i]*x[i], 1e-3);
+		ck_assert_double_eq_tol(dydx[i], 2*x[i], 1e-3);
+	}
+
+	free(x); free(y); free(dydx);
+	free_mesh_memory(&m);
+	free_solution_memory(&sol);
+
+}
+END_TEST
+
+START_TEST(L3_nodal_values) {
+	// The reference quadratic mesh has off-center middle nodes, so the isoparametric map is not affine.
+	// Evaluating at the nodes must give back the nodal values.
+	struct Mesh m;
+	struct ODE_Solution sol;
+
+	char dir[250];
+	memcpy(dir, input_mesh_dir, 250);
+	strcat(dir, "test_reference_array/quadratic_mesh.in");
+
+	FILE* quad_mesh = fopen(dir, "r");
+	ck_assert_ptr_nonnull(quad_mesh);
+	ck_assert_int_eq(parse_input_file(quad_mesh, &m, QUAD), 0);
+	fclose(quad_mesh);
+
+	ck_assert_int_eq(solve_ode_constant(&m, &sol, 4., 4., 0, 5, field, false), 0);
+
+	double y[9];
+	ck_assert_int_eq(evaluate_solution(&m, &sol, m.node_coordinates, m.num_nodes, y, NULL), 0);
+	for (int i = 0; i < m.num_nodes; i++) {
+		ck_assert_double_eq_tol(y[i], gsl_vector_get(sol.solution_coeff, i), TOL);
+	}
+
+	// Unsorted and out-of-range queries are rejected
+	double unsorted[3] = {1, 0.5, 2};
+	double outside[2] = {1, 11};
+	ck_assert_int_eq(evaluate_solution(&m, &sol, unsorted, 3, y, NULL), 1);
+	ck_assert_int_eq(evaluate_solution(&m, &sol, outside, 2, y, NULL), 1);
+
+	free_mesh_memory(&m);
+	free_solution_memory(&sol);
+
+}
+END_TEST
+
+START_TEST(qoi_quadratic_solution) {
+	// Same problem as above (y = x^2 on [0, 5]), reduced to scalars during the solve
+	struct Mesh m;
+	struct ODE_Solution sol;
+
+	FILE* quad_mesh = tmpfile();
+	fprintf(quad_mesh, "5\n0\n1\n2\n3.5\n5\n");
+	rewind(quad_mesh);
+	ck_assert_int_eq(parse_input_file(quad_mesh, &m, QUAD), 0);
+	fclose(quad_mesh);
+
+	double probes[3] = {0.5, 2.5, 4.9};
+	struct QoI_Request request = {
+		QOI_INTEGRAL | QOI_MAX_ABS | QOI_PROBES | QOI_FLUX_START | QOI_FLUX_END,
+		probes,
+		3
+	};
+	struct Solver_Options options = {0};
+	options.qoi = &request;
+
+	ck_assert_int_eq(solve_ode_constant_opts(&m, &sol, 0, 0, 0, 25, field, &options), 0);
+	ck_assert_ptr_nonnull(sol.qoi);
+
+	ck_assert_double_eq_tol(sol.qoi->integral, 125.0/3, 1e-3);
+	ck_assert_double_eq_tol(sol.qoi->max_abs, 25, 1e-3);
+	ck_assert_double_eq_tol(sol.qoi->max_abs_location, 5, TOL);
+	ck_assert_double_eq_tol(sol.qoi->probe_values[0], 0.25, 1e-3);
+	ck_assert_double_eq_tol(sol.qoi->probe_values[1], 6.25, 1e-3);
+	ck_assert_double_eq_tol(sol.qoi->probe_values[2], 24.01, 1e-3);
+	ck_assert_double_eq_tol(sol.qoi->flux_start, 0, 1e-3);
+	ck_assert_double_eq_tol(sol.qoi->flux_end, 10, 1e-3);
+
+	free_mesh_memory(&m);
+	free_solution_memory(&sol);
+
+}
+END_TEST
+
+Suite* evaluation_suite() {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Solution Evaluation Tests");
+
+	tc_core = tcase_create("Core");
+	tcase_add_checked_fixture(
+		tc_core,
+		setup_function_field,
+		teardown_function_field
+	);
+
+	tcase_add_test(tc_core, L2_linear_solution);
+	tcase_add_test(tc_core, L3_quadratic_solution);
+	tcase_add_test(tc_core, L3_nodal_values);
+	tcase_add_test(tc_core, qoi_quadratic_solution);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+
+}
+
+int main() {
+	// Assign directory here
+	const char *dir_name = "./integration/";
+	strcpy(input_mesh_dir, dir_name);
+
+	int number_failed;
+	Suite *s_evaluation;
+	SRunner *sr_evaluation;
+
+	s_evaluation = evaluation_suite();
+	sr_evaluation = srunner_create(s_evaluation);
+
+	srunner_set_fork_status(sr_evaluation, CK_NOFORK);
+	srunner_run_all(sr_evaluation, CK_NORMAL);
+
+	number_failed = srunner_ntests_failed(sr_evaluation);
+
+	srunner_free(sr_evaluation);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
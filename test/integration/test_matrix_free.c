@@ -0,0 +1,197 @@
+#include <stdlib.h>
+#include <check.h>
+#include <math.h>
+
+#include "fe_section.h"
+#include "band_matrix.h"
+#include "matrix_free.h"
+
+struct Function_Field *field = NULL;
+
+double driving_func(double x) {
+	return x*x + x + 3;
+
+}
+
+static void setup_function_field() {
+	struct Function_Field *f_field_temp = malloc(sizeof(struct Function_Field));
+
+	create_function_field(f_field_temp, 0, 15, 2001, driving_func);
+
+	field = f_field_temp;
+
+}
+
+static void teardown_function_field() {
+	free_function_field(field);
+	free(field);
+	field = NULL;
+
+}
+
+// Diffusion, reaction and convection dominated cases
+static double cases[3][2] = {{0, 0}, {-1, -5}, {60, -5}};
+
+// A graded mesh, so that every element has its own Jacobian
+static void graded_mesh(struct Mesh* m, int num_nodes, Element_2D_Type kind) {
+	double* nodes = malloc(num_nodes*sizeof(double));
+	for (int i = 0; i < num_nodes; i++) {
+		double s = (double) i/(num_nodes - 1);
+		nodes[i] = 10*s*s;
+	}
+	ck_assert_int_eq(build_mesh_from_nodes(m, nodes, num_nodes, kind), 0);
+
+}
+
+START_TEST(operator_apply) {
+	// The element-by-element product, diagonal and norm match those of the assembled matrix with its Dirichlet rows
+	Element_2D_Type kinds[2] = {LINEAR, QUAD};
+
+	for (int k = 0; k < 2; k++) {
+		struct Mesh m;
+		graded_mesh(&m, 301, kinds[k]);
+		size_t n = m.num_nodes;
+		double* x = malloc(n*sizeof(double));
+		double* y_band = malloc(n*sizeof(double));
+		double* y_free = malloc(n*sizeof(double));
+		for (size_t i = 0; i < n; i++) {
+			x[i] = sin(0.37*i) + 0.01*i;
+		}
+
+		for (int c = 0; c < 3; c++) {
+			struct Band_Matrix K;
+			ck_assert_int_eq(assemble_coefficient_matrix(&m, cases[c][0], cases[c][1], &K), 0);
+			band_matrix_set_row_identity(&K, 0);
+			band_matrix_set_row_identity(&K, n - 1);
+
+			struct Matrix_Free_Operator op;
+			ck_assert_int_eq(create_matrix_free_operator(&op, &m, cases[c][0], cases[c][1]), 0);
+
+			band_matrix_apply(&K, x, y_band);
+			matrix_free_apply(&op, x, y_free);
+			double norm = band_matrix_norm_inf(&K);
+			ck_assert_double_eq_tol(op.norm_inf, norm, 1e-12*norm);
+			for (size_t i = 0; i < n; i++) {
+				ck_assert_double_eq_tol(y_free[i], y_band[i], 1e-11*norm);
+				ck_assert_double_eq_tol(op.inverse_diagonal[i]*band_matrix_get(&K, i, i), 1, 1e-12);
+			}
+
+			free_matrix_free_operator(&op);
+			free_band_matrix(&K);
+		}
+
+		free(x);
+		free(y_band);
+		free(y_free);
+		free_mesh_memory(&m);
+	}
+
+}
+END_TEST
+
+START_TEST(matrix_free_solutions) {
+	Element_2D_Type kinds[2] = {LINEAR, QUAD};
+
+	for (int k = 0; k < 2; k++) {
+		struct Mesh m;
+		ck_assert_int_eq(generate_uniform_mesh(&m, 0, 10, 200, kinds[k]), 0);
+
+		for (int c = 0; c < 3; c++) {
+			struct ODE_Solution direct, matrix_free;
+			struct Solver_Options options = {0};
+			options.no_condensation = true;
+			ck_assert_int_eq(solve_ode_constant_opts(&m, &direct, cases[c][0], cases[c][1], 0, 5, field, &options), 0);
+
+			options.linear_solver = SOLVER_MATRIX_FREE;
+			options.collect_stats = true;
+			ck_assert_int_eq(solve_ode_constant_opts(&m, &matrix_free, cases[c][0], cases[c][1], 0, 5, field, &options), 0);
+			ck_assert_ptr_null(matrix_free.coeff_matrix_global);
+			ck_assert_ptr_nonnull(matrix_free.iterative);
+			ck_assert(matrix_free.iterative->converged);
+			ck_assert(matrix_free.iterative->residual <= ITERATIVE_DEFAULT_TOLERANCE);
+			ck_assert_uint_eq(matrix_free.stats->counters[STATS_ITERATIONS], matrix_free.iterative->iterations);
+
+			double scale = 0;
+			for (size_t i = 0; i < m.num_nodes; i++) {
+				scale = fmax(scale, fabs(gsl_vector_get(direct.solution_coeff, i)));
+			}
+			for (size_t i = 0; i < m.num_nodes; i++) {
+				ck_assert_double_eq_tol(gsl_vector_get(matrix_free.solution_coeff, i), gsl_vector_get(direct.solution_coeff, i), 1e-6*scale);
+			}
+
+			free_solution_memory(&direct);
+			free_solution_memory(&matrix_free);
+		}
+
+		free_mesh_memory(&m);
+	}
+
+}
+END_TEST
+
+START_TEST(rejected_options) {
+	// Everything that needs the assembled matrix
+	struct Mesh m;
+	ck_assert_int_eq(generate_uniform_mesh(&m, 0, 10, 20, LINEAR), 0);
+	struct ODE_Solution sol;
+	struct Solver_Options options = {0};
+	options.linear_solver = SOLVER_MATRIX_FREE;
+
+	options.output_global_arrays = true;
+	ck_assert_int_eq(solve_ode_constant_opts(&m, &sol, -1, -5, 0, 5, field, &options), 1);
+	options.output_global_arrays = false;
+	options.mixed_precision = true;
+	ck_assert_int_eq(solve_ode_constant_opts(&m, &sol, -1, -5, 0, 5, field, &options), 1);
+	options.mixed_precision = false;
+	options.multigrid_preconditioner = true;
+	ck_assert_int_eq(solve_ode_constant_opts(&m, &sol, -1, -5, 0, 5, field, &options), 1);
+	options.multigrid_preconditioner = false;
+	options.streaming = true;
+	ck_assert_int_eq(solve_ode_constant_opts(&m, &sol, -1, -5, 0, 5, field, &options), 1);
+
+	free_mesh_memory(&m);
+
+}
+END_TEST
+
+Suite* matrix_free_suite() {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Matrix-Free Operator Tests");
+
+	tc_core = tcase_create("Core");
+	tcase_add_checked_fixture(
+		tc_core,
+		setup_function_field,
+		teardown_function_field
+	);
+	tcase_set_timeout(tc_core, 60);
+
+	tcase_add_test(tc_core, operator_apply);
+	tcase_add_test(tc_core, matrix_free_solutions);
+	tcase_add_test(tc_core, rejected_options);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+
+}
+
+int main() {
+	int number_failed;
+	Suite *s_matrix_free;
+	SRunner *sr_matrix_free;
+
+	s_matrix_free = matrix_free_suite();
+	sr_matrix_free = srunner_create(s_matrix_free);
+
+	srunner_set_fork_status(sr_matrix_free, CK_NOFORK);
+	srunner_run_all(sr_matrix_free, CK_NORMAL);
+
+	number_failed = srunner_ntests_failed(sr_matrix_free);
+
+	srunner_free(sr_matrix_free);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
@@ -0,0 +1,166 @@
+#include <stdlib.h>
+#include <check.h>
+#include <math.h>
+#include <float.h>
+
+#include "fe_section.h"
+#include "band_matrix.h"
+#include "solver_stats.h"
+
+struct Function_Field *field = NULL;
+
+double driving_func(double x) {
+	return x*x + x + 3;
+
+}
+
+static void setup_function_field() {
+	struct Function_Field *f_field_temp = malloc(sizeof(struct Function_Field));
+
+	create_function_field(f_field_temp, 0, 15, 2001, driving_func);
+
+	field = f_field_temp;
+
+}
+
+static void teardown_function_field() {
+	free_function_field(field);
+	free(field);
+	field = NULL;
+
+}
+
+START_TEST(refined_solutions) {
+	// L2 and L3 meshes small enough for the single-precision factors to converge
+	double cases[4][2] = {{4, 4}, {-1, -5}, {60, -5}, {0, 0}};
+	Element_2D_Type kinds[2] = {LINEAR, QUAD};
+
+	for (int k = 0; k < 2; k++) {
+		struct Mesh m;
+		ck_assert_int_eq(generate_uniform_mesh(&m, 0, 10, 150, kinds[k]), 0);
+
+		for (int c = 0; c < 4; c++) {
+			struct ODE_Solution full, mixed;
+			struct Solver_Options options = {0};
+			options.no_condensation = true;
+			ck_assert_int_eq(solve_ode_constant_opts(&m, &full, cases[c][0], cases[c][1], 0, 5, field, &options), 0);
+			ck_assert_ptr_null(full.refinement);
+
+			// L3 meshes are solved as the full system without no_condensation as well
+			options.no_condensation = false;
+			options.mixed_precision = true;
+			options.collect_stats = true;
+			ck_assert_int_eq(solve_ode_constant_opts(&m, &mixed, cases[c][0], cases[c][1], 0, 5, field, &options), 0);
+
+			struct Refinement_Report* report = mixed.refinement;
+			ck_assert_ptr_nonnull(report);
+			ck_assert(!report->fallback);
+			ck_assert_int_le(report->iterations, BAND_REFINE_MAX_ITERATIONS);
+			ck_assert_uint_eq(mixed.stats->counters[STATS_REFINEMENTS], report->iterations);
+			ck_assert(report->backward_error <= sqrt(m.num_nodes)*DBL_EPSILON);
+			ck_assert(report->residual >= 0);
+
+			double scale = 0;
+			for (size_t i = 0; i < m.num_nodes; i++) {
+				scale = fmax(scale, fabs(gsl_vector_get(full.solution_coeff, i)));
+			}
+			for (size_t i = 0; i < m.num_nodes; i++) {
+				ck_assert_double_eq_tol(gsl_vector_get(mixed.solution_coeff, i), gsl_vector_get(full.solution_coeff, i), 1e-10*scale);
+			}
+
+			free_solution_memory(&full);
+			free_solution_memory(&mixed);
+		}
+
+		free_mesh_memory(&m);
+	}
+
+}
+END_TEST
+
+START_TEST(double_precision_fallback) {
+	// [1 1; 1 1 + 1e-9] is singular once rounded to single precision, so the solve has to fall back to the double-precision factors
+	struct Band_Matrix A;
+	ck_assert_int_eq(create_band_matrix(&A, 2, 1, 1), 0);
+	band_matrix_set(&A, 0, 0, 1);
+	band_matrix_set(&A, 0, 1, 1);
+	band_matrix_set(&A, 1, 0, 1);
+	band_matrix_set(&A, 1, 1, 1 + 1e-9);
+
+	gsl_vector* b = gsl_vector_alloc(2);
+	gsl_vector_set(b, 0, 2);
+	gsl_vector_set(b, 1, 2 + 1e-9);
+	gsl_vector* x = gsl_vector_alloc(2);
+
+	struct Refinement_Report report;
+	ck_assert_int_eq(band_mixed_solve(&A, b, x, &report), 0);
+	ck_assert(report.fallback);
+	ck_assert_double_eq_tol(gsl_vector_get(x, 0), 1, 1e-5);
+	ck_assert_double_eq_tol(gsl_vector_get(x, 1), 1, 1e-5);
+
+	// The matrix is left unfactored for the residuals
+	ck_assert(!A.factored);
+	ck_assert_double_eq(band_matrix_get(&A, 1, 1), 1 + 1e-9);
+
+	gsl_vector_free(b);
+	gsl_vector_free(x);
+	free_band_matrix(&A);
+
+}
+END_TEST
+
+START_TEST(streaming_rejected) {
+	// A streaming solve does not keep the matrix, so it cannot be refined
+	struct Mesh m;
+	struct ODE_Solution sol;
+	struct Solver_Options options = {0};
+	options.streaming = true;
+	options.mixed_precision = true;
+
+	ck_assert_int_eq(generate_uniform_mesh(&m, 0, 10, 20, LINEAR), 0);
+	ck_assert_int_eq(solve_ode_constant_opts(&m, &sol, 1, 1, 0, 5, field, &options), 1);
+	free_mesh_memory(&m);
+
+}
+END_TEST
+
+Suite* mixed_precision_suite() {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Mixed Precision Tests");
+
+	tc_core = tcase_create("Core");
+	tcase_add_checked_fixture(
+		tc_core,
+		setup_function_field,
+		teardown_function_field
+	);
+
+	tcase_add_test(tc_core, refined_solutions);
+	tcase_add_test(tc_core, double_precision_fallback);
+	tcase_add_test(tc_core, streaming_rejected);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+
+}
+
+int main() {
+	int number_failed;
+	Suite *s_mixed;
+	SRunner *sr_mixed;
+
+	s_mixed = mixed_precision_suite();
+	sr_mixed = srunner_create(s_mixed);
+
+	srunner_set_fork_status(sr_mixed, CK_NOFORK);
+	srunner_run_all(sr_mixed, CK_NORMAL);
+
+	number_failed = srunner_ntests_failed(sr_mixed);
+
+	srunner_free(sr_mixed);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
@@ -0,0 +1,237 @@
+#include <stdlib.h>
+#include <check.h>
+#include <math.h>
+
+#include "fe_section.h"
+#include "band_matrix.h"
+#include "multigrid.h"
+#include "krylov.h"
+
+struct Function_Field *field = NULL;
+
+double driving_func(double x) {
+	return x*x + x + 3;
+
+}
+
+static void setup_function_field() {
+	struct Function_Field *f_field_temp = malloc(sizeof(struct Function_Field));
+
+	create_function_field(f_field_temp, 0, 15, 2001, driving_func);
+
+	field = f_field_temp;
+
+}
+
+static void teardown_function_field() {
+	free_function_field(field);
+	free(field);
+	field = NULL;
+
+}
+
+// Diffusion, reaction, oscillatory (positive B) and convection dominated cases
+static double cases[4][2] = {{0, 0}, {-1, -5}, {4, 4}, {60, -5}};
+
+// The iterative solutions are compared with the band LU to a tolerance that allows for the conditioning of the larger meshes
+static void assert_matches_direct(struct Mesh* m, double a, double b, struct Solver_Options* options) {
+	struct ODE_Solution direct, iterative;
+	struct Solver_Options direct_options = {0};
+	direct_options.no_condensation = true;
+	ck_assert_int_eq(solve_ode_constant_opts(m, &direct, a, b, 0, 5, field, &direct_options), 0);
+
+	options->collect_stats = true;
+	ck_assert_int_eq(solve_ode_constant_opts(m, &iterative, a, b, 0, 5, field, options), 0);
+	ck_assert_ptr_nonnull(iterative.iterative);
+	ck_assert(iterative.iterative->converged);
+	ck_assert(iterative.iterative->residual <= ITERATIVE_DEFAULT_TOLERANCE);
+	ck_assert_int_le(iterative.iterative->iterations, 30);
+	ck_assert_uint_eq(iterative.stats->counters[STATS_ITERATIONS], iterative.iterative->iterations);
+
+	double scale = 0;
+	for (size_t i = 0; i < m->num_nodes; i++) {
+		scale = fmax(scale, fabs(gsl_vector_get(direct.solution_coeff, i)));
+	}
+	for (size_t i = 0; i < m->num_nodes; i++) {
+		ck_assert_double_eq_tol(gsl_vector_get(iterative.solution_coeff, i), gsl_vector_get(direct.solution_coeff, i), 1e-5*scale);
+	}
+
+	free_solution_memory(&direct);
+	free_solution_memory(&iterative);
+
+}
+
+START_TEST(multigrid_cycles) {
+	Element_2D_Type kinds[2] = {LINEAR, QUAD};
+	int sizes[2] = {150, 5000};
+	Multigrid_Cycle cycles[3] = {MULTIGRID_V_CYCLE, MULTIGRID_W_CYCLE, MULTIGRID_F_CYCLE};
+
+	for (int k = 0; k < 2; k++) {
+		for (int s = 0; s < 2; s++) {
+			struct Mesh m;
+			ck_assert_int_eq(generate_uniform_mesh(&m, 0, 10, sizes[s], kinds[k]), 0);
+
+			for (int c = 0; c < 4; c++) {
+				for (int y = 0; y < 3; y++) {
+					struct Solver_Options options = {0};
+					options.linear_solver = SOLVER_MULTIGRID;
+					options.cycle = cycles[y];
+					assert_matches_direct(&m, cases[c][0], cases[c][1], &options);
+				}
+			}
+
+			free_mesh_memory(&m);
+		}
+	}
+
+}
+END_TEST
+
+START_TEST(mesh_independence) {
+	// The V-cycles needed for the diffusion case do not grow with the mesh
+	int sizes[3] = {1000, 8000, 64000};
+	int cycles[3];
+
+	for (int s = 0; s < 3; s++) {
+		struct Mesh m;
+		struct ODE_Solution sol;
+		struct Solver_Options options = {0};
+		options.linear_solver = SOLVER_MULTIGRID;
+		ck_assert_int_eq(generate_uniform_mesh(&m, 0, 10, sizes[s], LINEAR), 0);
+		ck_assert_int_eq(solve_ode_constant_opts(&m, &sol, 0, 0, 0, 5, field, &options), 0);
+		cycles[s] = sol.iterative->iterations;
+
+		free_solution_memory(&sol);
+		free_mesh_memory(&m);
+	}
+	ck_assert_int_le(cycles[1], cycles[0] + 1);
+	ck_assert_int_le(cycles[2], cycles[0] + 1);
+
+}
+END_TEST
+
+START_TEST(galerkin_operators) {
+	// For linear interpolation, the Galerkin operator of the L2 Laplacian is the Laplacian of the mesh with every other node
+	struct Mesh fine_mesh, coarse_mesh;
+	ck_assert_int_eq(generate_uniform_mesh(&fine_mesh, 0, 10, 256, LINEAR), 0);
+	ck_assert_int_eq(generate_uniform_mesh(&coarse_mesh, 0, 10, 128, LINEAR), 0);
+
+	struct Band_Matrix K_fine, K_coarse;
+	ck_assert_int_eq(assemble_coefficient_matrix(&fine_mesh, 0, 0, &K_fine), 0);
+	ck_assert_int_eq(assemble_coefficient_matrix(&coarse_mesh, 0, 0, &K_coarse), 0);
+	band_matrix_set_row_identity(&K_fine, 0);
+	band_matrix_set_row_identity(&K_fine, fine_mesh.num_nodes - 1);
+
+	struct Multigrid mg;
+	ck_assert_int_eq(create_multigrid(&mg, fine_mesh.node_coordinates, &K_fine, MULTIGRID_V_CYCLE), 0);
+	ck_assert_int_eq(mg.num_levels, 4);
+	ck_assert_uint_eq(mg.levels[1].size, coarse_mesh.num_nodes);
+	ck_assert_uint_eq(mg.levels[3].size, 33);
+
+	for (size_t i = 1; i + 1 < coarse_mesh.num_nodes; i++) {
+		for (size_t j = i - 1; j <= i + 1; j++) {
+			ck_assert_double_eq_tol(band_matrix_get(mg.levels[1].A, i, j), band_matrix_get(&K_coarse, i, j), 1e-10);
+		}
+	}
+
+	// A mesh with an odd number of elements keeps its last node
+	struct Mesh odd_mesh;
+	struct Band_Matrix K_odd;
+	struct Multigrid odd;
+	ck_assert_int_eq(generate_uniform_mesh(&odd_mesh, 0, 10, 101, LINEAR), 0);
+	ck_assert_int_eq(assemble_coefficient_matrix(&odd_mesh, 0, 0, &K_odd), 0);
+	ck_assert_int_eq(create_multigrid(&odd, odd_mesh.node_coordinates, &K_odd, MULTIGRID_V_CYCLE), 0);
+	ck_assert_uint_eq(odd.levels[1].size, 52);
+	ck_assert_uint_eq(odd.levels[0].parent[101], 51);
+	ck_assert_double_eq(odd.levels[0].weight[101], 1);
+
+	free_multigrid(&mg);
+	free_multigrid(&odd);
+	free_band_matrix(&K_fine);
+	free_band_matrix(&K_coarse);
+	free_band_matrix(&K_odd);
+	free_mesh_memory(&fine_mesh);
+	free_mesh_memory(&coarse_mesh);
+	free_mesh_memory(&odd_mesh);
+
+}
+END_TEST
+
+START_TEST(krylov_solutions) {
+	// BiCGSTAB with a multigrid preconditioner, and without one on a small mesh
+	struct Mesh m;
+	ck_assert_int_eq(generate_uniform_mesh(&m, 0, 10, 5000, QUAD), 0);
+	for (int c = 0; c < 4; c++) {
+		struct Solver_Options options = {0};
+		options.linear_solver = SOLVER_BICGSTAB;
+		options.multigrid_preconditioner = true;
+		assert_matches_direct(&m, cases[c][0], cases[c][1], &options);
+	}
+	free_mesh_memory(&m);
+
+	ck_assert_int_eq(generate_uniform_mesh(&m, 0, 10, 20, LINEAR), 0);
+	struct ODE_Solution direct, krylov;
+	struct Solver_Options options = {0};
+	ck_assert_int_eq(solve_ode_constant_opts(&m, &direct, -1, -5, 0, 5, field, &options), 0);
+	options.linear_solver = SOLVER_BICGSTAB;
+	ck_assert_int_eq(solve_ode_constant_opts(&m, &krylov, -1, -5, 0, 5, field, &options), 0);
+	ck_assert(krylov.iterative->converged);
+	for (size_t i = 0; i < m.num_nodes; i++) {
+		ck_assert_double_eq_tol(gsl_vector_get(krylov.solution_coeff, i), gsl_vector_get(direct.solution_coeff, i), 1e-8);
+	}
+
+	// The iterative solvers need the assembled band
+	options.streaming = true;
+	ck_assert_int_eq(solve_ode_constant_opts(&m, &krylov, -1, -5, 0, 5, field, &options), 1);
+	options.streaming = false;
+	options.mixed_precision = true;
+	ck_assert_int_eq(solve_ode_constant_opts(&m, &krylov, -1, -5, 0, 5, field, &options), 1);
+
+	free_solution_memory(&direct);
+	free_mesh_memory(&m);
+
+}
+END_TEST
+
+Suite* multigrid_suite() {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Multigrid and Krylov Tests");
+
+	tc_core = tcase_create("Core");
+	tcase_add_checked_fixture(
+		tc_core,
+		setup_function_field,
+		teardown_function_field
+	);
+	tcase_set_timeout(tc_core, 60);
+
+	tcase_add_test(tc_core, multigrid_cycles);
+	tcase_add_test(tc_core, mesh_independence);
+	tcase_add_test(tc_core, galerkin_operators);
+	tcase_add_test(tc_core, krylov_solutions);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+
+}
+
+int main() {
+	int number_failed;
+	Suite *s_multigrid;
+	SRunner *sr_multigrid;
+
+	s_multigrid = multigrid_suite();
+	sr_multigrid = srunner_create(s_multigrid);
+
+	srunner_set_fork_status(sr_multigrid, CK_NOFORK);
+	srunner_run_all(sr_multigrid, CK_NORMAL);
+
+	number_failed = srunner_ntests_failed(sr_multigrid);
+
+	srunner_free(sr_multigrid);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
@@ -0,0 +1,246 @@
+#include <stdlib.h>
+#include <check.h>
+#include <math.h>
+
+#include "fe_section.h"
+#include "nonlinear.h"
+
+struct Function_Field *field = NULL;
+struct Function_Field *sinh_field = NULL;
+
+// y = sin(pi x) solves y'' + y' - y^3 - y = f
+double driving_func(double x) {
+	double s = sin(M_PI*x);
+
+	return -M_PI*M_PI*s + M_PI*cos(M_PI*x) - s*s*s - s;
+
+}
+
+double sinh_driving_func(double x) {
+	return -2000;
+
+}
+
+static void setup_function_field() {
+	struct Function_Field *f_field_temp = malloc(sizeof(struct Function_Field));
+	struct Function_Field *sinh_field_temp = malloc(sizeof(struct Function_Field));
+
+	create_function_field(f_field_temp, -1, 2, 30001, driving_func);
+	create_function_field(sinh_field_temp, -1, 2, 3001, sinh_driving_func);
+
+	field = f_field_temp;
+	sinh_field = sinh_field_temp;
+
+}
+
+static void teardown_function_field() {
+	free_function_field(field);
+	free(field);
+	field = NULL;
+	free_function_field(sinh_field);
+	free(sinh_field);
+	sinh_field = NULL;
+
+}
+
+static double cubic_g(double y, void* context) {
+	return -y*y*y - y;
+
+}
+
+static double cubic_dg(double y, void* context) {
+	return -3*y*y - 1;
+
+}
+
+static double sinh_g(double y, void* context) {
+	return -sinh(y);
+
+}
+
+static double sinh_dg(double y, void* context) {
+	return -cosh(y);
+
+}
+
+static double nodal_error(struct Mesh* m, const gsl_vector* y) {
+	double error = 0;
+	for (uint32_t i = 0; i < m->num_nodes; i++) {
+		error = fmax(error, fabs(gsl_vector_get(y, i) - sin(M_PI*m->node_coordinates[i])));
+	}
+
+	return error;
+
+}
+
+START_TEST(manufactured_convergence) {
+	// The error drops by 4 per mesh halving on L2 meshes and by at least 8 on L3 meshes
+	Element_2D_Type kinds[2] = {LINEAR, QUAD};
+	double min_ratio[2] = {3.5, 7};
+	struct Nonlinear_Term g = {cubic_g, cubic_dg, NULL};
+	for (int k = 0; k < 2; k++) {
+		double previous = 0;
+		for (uint32_t elements = 10; elements <= 40; elements *= 2) {
+			struct Mesh m;
+			ck_assert_int_eq(generate_uniform_mesh(&m, 0, 1, elements, kinds[k]), 0);
+
+			struct ODE_Solution solution;
+			struct Newton_Options options = {0};
+			struct Newton_Report report;
+			ck_assert_int_eq(solve_ode_nonlinear(&m, &solution, 1, &g, 0, 0, field, &options, &report), 0);
+			ck_assert(report.converged);
+			ck_assert_double_le(report.residual, NEWTON_DEFAULT_TOLERANCE);
+
+			double error = nodal_error(&m, solution.solution_coeff);
+			if (previous > 0) {
+				ck_assert_double_ge(previous/error, min_ratio[k]);
+			}
+			previous = error;
+
+			free_solution_memory(&solution);
+			free_mesh_memory(&m);
+		}
+	}
+
+}
+END_TEST
+
+START_TEST(modified_newton) {
+	// Full Newton converges quadratically; modified Newton reaches the same solution in more, cheaper steps
+	struct Nonlinear_Term g = {cubic_g, cubic_dg, NULL};
+	struct Mesh m;
+	ck_assert_int_eq(generate_uniform_mesh(&m, 0, 1, 200, QUAD), 0);
+
+	struct ODE_Solution full, modified;
+	struct Newton_Options options = {0};
+	struct Newton_Report full_report, modified_report;
+	ck_assert_int_eq(solve_ode_nonlinear(&m, &full, 1, &g, 0, 0, field, &options, &full_report), 0);
+	options.method = NEWTON_MODIFIED;
+	ck_assert_int_eq(solve_ode_nonlinear(&m, &modified, 1, &g, 0, 0, field, &options, &modified_report), 0);
+
+	ck_assert(full_report.converged);
+	ck_assert(modified_report.converged);
+	ck_assert_int_le(full_report.iterations, 6);
+	ck_assert_int_eq(full_report.factorizations, full_report.iterations);
+	ck_assert_int_lt(modified_report.factorizations, modified_report.iterations);
+	ck_assert_int_lt(modified_report.factorizations, full_report.factorizations);
+
+	// Modified Newton stops just under the tolerance (about 4e-11), which the conditioning of the 401-node band turns into differences of about 2e-9
+	for (uint32_t i = 0; i < m.num_nodes; i++) {
+		ck_assert_double_eq_tol(gsl_vector_get(modified.solution_coeff, i), gsl_vector_get(full.solution_coeff, i), 1e-8);
+	}
+
+	// Starting from the solution takes no steps
+	options.initial_guess = full.solution_coeff;
+	struct ODE_Solution restarted;
+	struct Newton_Report restarted_report;
+	ck_assert_int_eq(solve_ode_nonlinear(&m, &restarted, 1, &g, 0, 0, field, &options, &restarted_report), 0);
+	ck_assert(restarted_report.converged);
+	ck_assert_int_eq(restarted_report.iterations, 0);
+	ck_assert_int_eq(restarted_report.factorizations, 1);
+
+	free_solution_memory(&full);
+	free_solution_memory(&modified);
+	free_solution_memory(&restarted);
+	free_mesh_memory(&m);
+
+}
+END_TEST
+
+START_TEST(globalization) {
+	// y'' - sinh(y) = -2000: plain Newton from the zero line overshoots into sinh overflow, a line search or continuation converges
+	struct Nonlinear_Term g = {sinh_g, sinh_dg, NULL};
+	struct Mesh m;
+	ck_assert_int_eq(generate_uniform_mesh(&m, 0, 1, 200, LINEAR), 0);
+
+	struct ODE_Solution plain;
+	struct Newton_Options options = {0};
+	struct Newton_Report report;
+	ck_assert_int_eq(solve_ode_nonlinear(&m, &plain, 0, &g, 0, 0, sinh_field, &options, &report), 0);
+	ck_assert(!report.converged);
+	ck_assert_int_eq(report.backtracks, 0);
+	free_solution_memory(&plain);
+
+	struct ODE_Solution solutions[3];
+	for (int configuration = 0; configuration < 3; configuration++) {
+		options.line_search = (configuration != 1);
+		options.continuation_steps = (configuration > 0) ? 10 : 0;
+		ck_assert_int_eq(solve_ode_nonlinear(&m, &solutions[configuration], 0, &g, 0, 0, sinh_field, &options, &report), 0);
+		ck_assert(report.converged);
+		ck_assert_int_eq(report.continuation_steps, (configuration > 0) ? 10 : 1);
+		if (configuration == 0) {
+			ck_assert_int_gt(report.backtracks, 0);
+		}
+	}
+	for (uint32_t i = 0; i < m.num_nodes; i++) {
+		ck_assert_double_eq_tol(gsl_vector_get(solutions[1].solution_coeff, i), gsl_vector_get(solutions[0].solution_coeff, i), 1e-8);
+		ck_assert_double_eq_tol(gsl_vector_get(solutions[2].solution_coeff, i), gsl_vector_get(solutions[0].solution_coeff, i), 1e-8);
+	}
+	for (int configuration = 0; configuration < 3; configuration++) {
+		free_solution_memory(&solutions[configuration]);
+	}
+	free_mesh_memory(&m);
+
+}
+END_TEST
+
+START_TEST(invalid_initial_guess) {
+	struct Nonlinear_Term g = {cubic_g, cubic_dg, NULL};
+	struct Mesh m;
+	ck_assert_int_eq(generate_uniform_mesh(&m, 0, 1, 20, LINEAR), 0);
+
+	gsl_vector* guess = gsl_vector_calloc(m.num_nodes + 1);
+	struct ODE_Solution solution;
+	struct Newton_Options options = {0};
+	struct Newton_Report report;
+	options.initial_guess = guess;
+	ck_assert_int_eq(solve_ode_nonlinear(&m, &solution, 1, &g, 0, 0, field, &options, &report), 1);
+	ck_assert_ptr_null(solution.solution_coeff);
+
+	gsl_vector_free(guess);
+	free_mesh_memory(&m);
+
+}
+END_TEST
+
+Suite* nonlinear_suite() {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Nonlinear Tests");
+
+	tc_core = tcase_create("Core");
+	tcase_add_checked_fixture(
+		tc_core,
+		setup_function_field,
+		teardown_function_field
+	);
+
+	tcase_add_test(tc_core, manufactured_convergence);
+	tcase_add_test(tc_core, modified_newton);
+	tcase_add_test(tc_core, globalization);
+	tcase_add_test(tc_core, invalid_initial_guess);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+
+}
+
+int main() {
+	int number_failed;
+	Suite *s_nonlinear;
+	SRunner *sr_nonlinear;
+
+	s_nonlinear = nonlinear_suite();
+	sr_nonlinear = srunner_create(s_nonlinear);
+
+	srunner_set_fork_status(sr_nonlinear, CK_NOFORK);
+	srunner_run_all(sr_nonlinear, CK_NORMAL);
+
+	number_failed = srunner_ntests_failed(sr_nonlinear);
+
+	srunner_free(sr_nonlinear);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
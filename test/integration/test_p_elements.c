@@ -0,0 +1,220 @@
+#include <stdlib.h>
+#include <check.h>
+#include <math.h>
+
+#include "fe_section.h"
+#include "band_matrix.h"
+#include "p_elements.h"
+
+struct Function_Field *field = NULL;
+struct Function_Field *zero_field = NULL;
+
+double driving_func(double x) {
+	return x*x + x + 3;
+
+}
+
+double zero_func(double x) {
+	return 0;
+
+}
+
+static void setup_function_field() {
+	field = malloc(sizeof(struct Function_Field));
+	create_function_field(field, 0, 15, 2001, driving_func);
+	zero_field = malloc(sizeof(struct Function_Field));
+	create_function_field(zero_field, -1, 2, 301, zero_func);
+
+}
+
+static void teardown_function_field() {
+	free_function_field(field);
+	free(field);
+	field = NULL;
+	free_function_field(zero_field);
+	free(zero_field);
+	zero_field = NULL;
+
+}
+
+// README Homogenous Case 5: y'' + 10y' + 7y = 0 on [0, 1] with y(0) = 0 and y(1) = 1
+static double case5_exact(double x) {
+	double r1 = (-10 + sqrt(72))/2;
+	double r2 = (-10 - sqrt(72))/2;
+
+	return (exp(r1*x) - exp(r2*x))/(exp(r1) - exp(r2));
+
+}
+
+static double case5_error(struct P_Mesh* m) {
+	gsl_vector* solution = NULL;
+	ck_assert_int_eq(solve_ode_p(m, &solution, 10, 7, 0, 1, zero_field), 0);
+
+	size_t n = 2001;
+	double* x = malloc(n*sizeof(double));
+	double* y = malloc(n*sizeof(double));
+	for (size_t i = 0; i < n; i++) {
+		x[i] = (double) i/(n - 1);
+	}
+	ck_assert_int_eq(evaluate_p_solution(m, solution, x, n, y, NULL), 0);
+
+	double error = 0;
+	for (size_t i = 0; i < n; i++) {
+		error = fmax(error, fabs(y[i] - case5_exact(x[i])));
+	}
+	free(x);
+	free(y);
+	gsl_vector_free(solution);
+
+	return error;
+
+}
+
+START_TEST(lobatto_basis) {
+	for (int k = 2; k <= P_MAX_ORDER; k++) {
+		// The bubbles vanish at the vertices, and their derivatives match finite differences
+		ck_assert_double_eq_tol(lobatto_shape(k, -1), 0, 1e-14);
+		ck_assert_double_eq_tol(lobatto_shape(k, 1), 0, 1e-14);
+		for (double zeta = -0.9; zeta < 1; zeta += 0.3) {
+			double difference = (lobatto_shape(k, zeta + 1e-6) - lobatto_shape(k, zeta - 1e-6))/2e-6;
+			ck_assert_double_eq_tol(lobatto_derivative(k, zeta), difference, 1e-7);
+		}
+	}
+
+	// On an element of length 2 the bubble block of y'' alone is minus the identity
+	struct P_Mesh m;
+	ck_assert_int_eq(generate_uniform_p_mesh(&m, 0, 2, 1, P_MAX_ORDER), 0);
+	struct Band_Matrix K;
+	gsl_vector* F;
+	ck_assert_int_eq(assemble_p_system(&m, 0, 0, zero_field, &K, &F), 0);
+	for (size_t i = 1; i < m.num_dofs - 1; i++) {
+		for (size_t j = 1; j < m.num_dofs - 1; j++) {
+			ck_assert_double_eq_tol(band_matrix_get(&K, i, j), (i == j) ? -1 : 0, 1e-13);
+		}
+	}
+	free_band_matrix(&K);
+	gsl_vector_free(F);
+	free_p_mesh(&m);
+
+}
+END_TEST
+
+START_TEST(low_orders) {
+	// p = 1 spans the L2 space and p = 2 the L3 space, so the vertex values are those of the L2 and L3 solvers
+	// (up to the different quadrature of the piecewise-linear field in the load vector)
+	Element_2D_Type kinds[2] = {LINEAR, QUAD};
+
+	for (int p = 1; p <= 2; p++) {
+		struct Mesh m;
+		struct ODE_Solution reference;
+		struct Solver_Options options = {0};
+		options.no_condensation = true;
+		ck_assert_int_eq(generate_uniform_mesh(&m, 0, 10, 40, kinds[p - 1]), 0);
+		ck_assert_int_eq(solve_ode_constant_opts(&m, &reference, -1, -5, 1, 4, field, &options), 0);
+
+		struct P_Mesh pm;
+		gsl_vector* solution = NULL;
+		ck_assert_int_eq(generate_uniform_p_mesh(&pm, 0, 10, 40, p), 0);
+		ck_assert_int_eq(solve_ode_p(&pm, &solution, -1, -5, 1, 4, field), 0);
+		ck_assert_uint_eq(pm.num_dofs, m.num_nodes);
+		for (uint32_t e = 0; e <= pm.num_elements; e++) {
+			double expected = gsl_vector_get(reference.solution_coeff, p*e);
+			ck_assert_double_eq_tol(gsl_vector_get(solution, pm.first_dof[e]), expected, 1e-6*fmax(1, fabs(expected)));
+		}
+
+		gsl_vector_free(solution);
+		free_p_mesh(&pm);
+		free_solution_memory(&reference);
+		free_mesh_memory(&m);
+	}
+
+}
+END_TEST
+
+START_TEST(exponential_convergence) {
+	// Each order divides the error of a 4-element mesh by more than 4
+	double previous = 0;
+	for (int p = 3; p <= P_MAX_ORDER; p++) {
+		struct P_Mesh m;
+		ck_assert_int_eq(generate_uniform_p_mesh(&m, 0, 1, 4, p), 0);
+		double error = case5_error(&m);
+		if (p > 3) {
+			ck_assert_double_lt(error, previous/4);
+		}
+		previous = error;
+		free_p_mesh(&m);
+	}
+	ck_assert_double_lt(previous, 1e-9);
+
+}
+END_TEST
+
+START_TEST(mixed_orders) {
+	// Orders can differ between elements; the band is as wide as the highest one
+	double vertices[5] = {0, 0.05, 0.2, 0.6, 1};
+	int orders[4] = {10, 6, 4, 4};
+	struct P_Mesh m;
+	ck_assert_int_eq(create_p_mesh(&m, vertices, 4, orders), 0);
+	ck_assert_uint_eq(m.num_dofs, 25);
+	ck_assert_uint_eq(m.first_dof[2], 16);
+	ck_assert_int_eq(m.max_order, 10);
+	double error = case5_error(&m);
+	ck_assert_double_lt(error, 2e-3);
+	free_p_mesh(&m);
+
+	// Raising the order of the two long elements alone removes most of the error
+	orders[2] = 8;
+	orders[3] = 8;
+	ck_assert_int_eq(create_p_mesh(&m, vertices, 4, orders), 0);
+	ck_assert_double_lt(case5_error(&m), error/100);
+	free_p_mesh(&m);
+
+	orders[1] = 0;
+	ck_assert_int_eq(create_p_mesh(&m, vertices, 4, orders), 1);
+	orders[1] = P_MAX_ORDER + 1;
+	ck_assert_int_eq(create_p_mesh(&m, vertices, 4, orders), 1);
+
+}
+END_TEST
+
+Suite* p_elements_suite() {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("P-Element Tests");
+
+	tc_core = tcase_create("Core");
+	tcase_add_checked_fixture(
+		tc_core,
+		setup_function_field,
+		teardown_function_field
+	);
+
+	tcase_add_test(tc_core, lobatto_basis);
+	tcase_add_test(tc_core, low_orders);
+	tcase_add_test(tc_core, exponential_convergence);
+	tcase_add_test(tc_core, mixed_orders);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+
+}
+
+int main() {
+	int number_failed;
+	Suite *s_p_elements;
+	SRunner *sr_p_elements;
+
+	s_p_elements = p_elements_suite();
+	sr_p_elements = srunner_create(s_p_elements);
+
+	srunner_set_fork_status(sr_p_elements, CK_NOFORK);
+	srunner_run_all(sr_p_elements, CK_NORMAL);
+
+	number_failed = srunner_ntests_failed(sr_p_elements);
+
+	srunner_free(sr_p_elements);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
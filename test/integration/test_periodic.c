@@ -0,0 +1,189 @@
+#include <stdlib.h>
+#include <check.h>
+#include <math.h>
+
+#include "fe_section.h"
+#include "band_matrix.h"
+
+struct Function_Field *field = NULL;
+
+// y = sin(2 pi x) + cos(4 pi x)/2 is periodic on [0, 1] and solves y'' + 3y' - 5y = f
+double exact(double x) {
+	return sin(2*M_PI*x) + 0.5*cos(4*M_PI*x);
+
+}
+
+double driving_func(double x) {
+	double w = 2*M_PI;
+	double v = 4*M_PI;
+
+	return -w*w*sin(w*x) - 0.5*v*v*cos(v*x) + 3*(w*cos(w*x) - 0.5*v*sin(v*x)) - 5*exact(x);
+
+}
+
+static void setup_function_field() {
+	struct Function_Field *f_field_temp = malloc(sizeof(struct Function_Field));
+
+	create_function_field(f_field_temp, -1, 2, 100001, driving_func);
+
+	field = f_field_temp;
+
+}
+
+static void teardown_function_field() {
+	free_function_field(field);
+	free(field);
+	field = NULL;
+
+}
+
+START_TEST(periodic_convergence) {
+	// The error drops by 16 per refinement by 4 on L2 meshes and by at least 64 on L3 meshes (condensed or not), and the ends match
+	Element_2D_Type kinds[2] = {LINEAR, QUAD};
+	double min_ratio[2] = {14, 60};
+	for (int k = 0; k < 2; k++) {
+		for (int condensed = 0; condensed < 2; condensed++) {
+			double previous = 0;
+			for (uint32_t elements = 8; elements <= 128; elements *= 4) {
+				struct Mesh m;
+				ck_assert_int_eq(generate_uniform_mesh(&m, 0, 1, elements, kinds[k]), 0);
+
+				struct ODE_Solution solution;
+				struct Solver_Options options = {0};
+				options.periodic = true;
+				options.no_condensation = !condensed;
+				ck_assert_int_eq(solve_ode_constant_opts(&m, &solution, 3, -5, 0, 0, field, &options), 0);
+				ck_assert_double_eq(gsl_vector_get(solution.solution_coeff, m.num_nodes - 1), gsl_vector_get(solution.solution_coeff, 0));
+
+				double error = 0;
+				for (uint32_t i = 0; i < m.num_nodes; i++) {
+					error = fmax(error, fabs(gsl_vector_get(solution.solution_coeff, i) - exact(m.node_coordinates[i])));
+				}
+				if (previous > 0) {
+					ck_assert_double_ge(previous/error, min_ratio[k]);
+				}
+				previous = error;
+
+				free_solution_memory(&solution);
+				free_mesh_memory(&m);
+			}
+		}
+	}
+
+}
+END_TEST
+
+START_TEST(cyclic_band) {
+	// Random cyclic bands (diagonally dominant, with both corners filled) against the dense product, down to the smallest size
+	size_t sizes[4] = {2, 5, 9, 300};
+	srand(7);
+	for (int bandwidth = 1; bandwidth <= 2; bandwidth++) {
+		for (int s = 0; s < 4; s++) {
+			size_t n = sizes[s];
+			if (n < 2*(size_t) bandwidth) {
+				continue;
+			}
+
+			struct Cyclic_Band_Matrix m;
+			ck_assert_int_eq(create_cyclic_band_matrix(&m, n, bandwidth), 0);
+			gsl_matrix* dense = gsl_matrix_calloc(n, n);
+			for (size_t i = 0; i < n; i++) {
+				for (int d = -bandwidth; d <= bandwidth; d++) {
+					size_t j = (i + n + d) % n;
+					double x = (d == 0) ? 4*bandwidth + 1 : (double) rand()/RAND_MAX - 0.5;
+					cyclic_band_matrix_add(&m, i, j, x);
+					*gsl_matrix_ptr(dense, i, j) += x;
+				}
+			}
+
+			gsl_vector* b = gsl_vector_alloc(n);
+			gsl_vector* x = gsl_vector_alloc(n);
+			for (size_t i = 0; i < n; i++) {
+				gsl_vector_set(b, i, (double) rand()/RAND_MAX);
+			}
+			ck_assert_int_eq(cyclic_lu_decomp(&m), 0);
+			ck_assert_int_eq(cyclic_lu_solve(&m, b, x), 0);
+
+			for (size_t i = 0; i < n; i++) {
+				double row = 0;
+				for (size_t j = 0; j < n; j++) {
+					row += gsl_matrix_get(dense, i, j)*gsl_vector_get(x, j);
+				}
+				ck_assert_double_eq_tol(row, gsl_vector_get(b, i), 1e-12);
+			}
+
+			gsl_vector_free(b);
+			gsl_vector_free(x);
+			gsl_matrix_free(dense);
+			free_cyclic_band_matrix(&m);
+		}
+	}
+
+}
+END_TEST
+
+START_TEST(invalid_periodic_options) {
+	struct Mesh m;
+	struct ODE_Solution solution;
+	struct Solver_Options options = {0};
+	options.periodic = true;
+
+	// A single L3 element has 2 periodic nodes for a bandwidth of 2
+	ck_assert_int_eq(generate_uniform_mesh(&m, 0, 1, 1, QUAD), 0);
+	ck_assert_int_eq(solve_ode_constant_opts(&m, &solution, 3, -5, 0, 0, field, &options), 1);
+	free_mesh_memory(&m);
+
+	ck_assert_int_eq(generate_uniform_mesh(&m, 0, 1, 20, LINEAR), 0);
+	options.mixed_precision = true;
+	ck_assert_int_eq(solve_ode_constant_opts(&m, &solution, 3, -5, 0, 0, field, &options), 1);
+	options.mixed_precision = false;
+	options.streaming = true;
+	ck_assert_int_eq(solve_ode_constant_opts(&m, &solution, 3, -5, 0, 0, field, &options), 1);
+	options.streaming = false;
+	options.linear_solver = SOLVER_MATRIX_FREE;
+	ck_assert_int_eq(solve_ode_constant_opts(&m, &solution, 3, -5, 0, 0, field, &options), 1);
+	free_mesh_memory(&m);
+
+}
+END_TEST
+
+Suite* periodic_suite() {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Periodic Tests");
+
+	tc_core = tcase_create("Core");
+	tcase_add_checked_fixture(
+		tc_core,
+		setup_function_field,
+		teardown_function_field
+	);
+
+	tcase_add_test(tc_core, periodic_convergence);
+	tcase_add_test(tc_core, cyclic_band);
+	tcase_add_test(tc_core, invalid_periodic_options);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+
+}
+
+int main() {
+	int number_failed;
+	Suite *s_periodic;
+	SRunner *sr_periodic;
+
+	s_periodic = periodic_suite();
+	sr_periodic = srunner_create(s_periodic);
+
+	srunner_set_fork_status(sr_periodic, CK_NOFORK);
+	srunner_run_all(sr_periodic, CK_NORMAL);
+
+	number_failed = srunner_ntests_failed(sr_periodic);
+
+	srunner_free(sr_periodic);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
@@ -0,0 +1,307 @@
+#include <stdlib.h>
+#include <check.h>
+#include <math.h>
+
+#include "fe_section.h"
+#include "band_matrix.h"
+#include "regions.h"
+#include "variable_coefficients.h"
+#include "solver_stats.h"
+
+struct Function_Field *field = NULL;
+
+double driving_func(double x) {
+	return 1 + x*x;
+
+}
+
+static void setup_function_field() {
+	struct Function_Field *f_field_temp = malloc(sizeof(struct Function_Field));
+
+	create_function_field(f_field_temp, -1, 2, 3001, driving_func);
+
+	field = f_field_temp;
+
+}
+
+static void teardown_function_field() {
+	free_function_field(field);
+	free(field);
+	field = NULL;
+
+}
+
+static int parse_mesh_text(const char* text, struct Mesh* m, Element_2D_Type kind) {
+	FILE* mesh_file = fopen("regions_mesh.in", "w");
+	fputs(text, mesh_file);
+	fclose(mesh_file);
+	mesh_file = fopen("regions_mesh.in", "r");
+	int status = parse_input_file(mesh_file, m, kind);
+	fclose(mesh_file);
+	remove("regions_mesh.in");
+
+	return status;
+
+}
+
+// Layers [0, 0.3), [0.3, 0.7) and [0.7, 1]; the layer boundaries are nodes of the meshes below, so each element lies in one layer
+struct Layers {
+	double bounds[2];
+	struct Mesh_Region values[3];
+
+};
+
+static int layer_of(const struct Layers* layers, double x) {
+	return (x < layers->bounds[0]) ? 0 : (x < layers->bounds[1]) ? 1 : 2;
+
+}
+
+static double layer_a(double x, void* context) {
+	const struct Layers* layers = context;
+
+	return layers->values[layer_of(layers, x)].a;
+
+}
+
+static double layer_b(double x, void* context) {
+	const struct Layers* layers = context;
+
+	return layers->values[layer_of(layers, x)].b;
+
+}
+
+// The same layers solved with a coefficient table, as the reference
+static gsl_vector* reference_solution(struct Mesh* m, struct Layers* layers) {
+	struct Coefficient_Function a = {NULL, layer_a, layers, 0};
+	struct Coefficient_Function b = {NULL, layer_b, layers, 0};
+	struct Coefficient_Table table;
+	struct ODE_Solution sol;
+	ck_assert_int_eq(create_coefficient_table(&table, m, &a, &b), 0);
+	ck_assert_int_eq(solve_ode_variable(&table, &sol, 1, -1, field), 0);
+	free_coefficient_table(&table);
+
+	return sol.solution_coeff;
+
+}
+
+static void layered_mesh(struct Mesh* m, int num_elements, Element_2D_Type kind, struct Layers* layers) {
+	ck_assert_int_eq(generate_uniform_mesh(m, 0, 1, num_elements, kind), 0);
+	uint32_t* element_region = malloc(m->num_elements*sizeof(uint32_t));
+	for (uint32_t e = 0; e < m->num_elements; e++) {
+		int first = (kind == QUAD) ? m->connectivity_grid[e].node_list.L3.node_id[0] : m->connectivity_grid[e].node_list.L2.node_id[0];
+		int last = (kind == QUAD) ? m->connectivity_grid[e].node_list.L3.node_id[2] : m->connectivity_grid[e].node_list.L2.node_id[1];
+		element_region[e] = layer_of(layers, (m->node_coordinates[first] + m->node_coordinates[last])/2);
+	}
+	ck_assert_int_eq(assign_mesh_regions(m, element_region, layers->values, 3), 0);
+	free(element_region);
+
+}
+
+START_TEST(region_files) {
+	// Each element takes the region of its first node; the table follows the nodes
+	struct Mesh m;
+	ck_assert_int_eq(parse_mesh_text("5\n0 1\n0.25 1\n0.5 0\n0.75 0\n1\nregions 2\n-1 2\n4.5 0\n", &m, QUAD), 0);
+	ck_assert_uint_eq(m.num_elements, 2);
+	ck_assert_uint_eq(m.num_regions, 2);
+	ck_assert_uint_eq(m.element_region[0], 1);
+	ck_assert_uint_eq(m.element_region[1], 0);
+	ck_assert_double_eq(m.regions[0].a, -1);
+	ck_assert_double_eq(m.regions[1].a, 4.5);
+	ck_assert_double_eq(m.regions[1].b, 0);
+	free_mesh_memory(&m);
+
+	// A table without tags puts every element in region 0, and plain mesh files have no regions
+	ck_assert_int_eq(parse_mesh_text("3\n0\n0.5\n1\nregions 1\n3 4\n", &m, LINEAR), 0);
+	ck_assert_uint_eq(m.num_regions, 1);
+	ck_assert_uint_eq(m.element_region[1], 0);
+	free_mesh_memory(&m);
+	ck_assert_int_eq(parse_mesh_text("3\n0\n0.5\n1\n", &m, LINEAR), 0);
+	ck_assert_ptr_null(m.element_region);
+	ck_assert_ptr_null(m.regions);
+	free_mesh_memory(&m);
+
+	// Region ids out of the table, tags without a table, short tables and trailing lines are rejected
+	ck_assert_int_eq(parse_mesh_text("3\n0 0\n0.5 2\n1\nregions 2\n0 0\n1 1\n", &m, LINEAR), 1);
+	ck_assert_int_eq(parse_mesh_text("3\n0 0\n0.5 1\n1\n", &m, LINEAR), 1);
+	ck_assert_int_eq(parse_mesh_text("3\n0\n0.5\n1\nregions 2\n0 0\n", &m, LINEAR), 1);
+	ck_assert_int_eq(parse_mesh_text("3\n0\n0.5\n1\nregions 1\n0 0\n7\n", &m, LINEAR), 1);
+
+	// Extra lines without the keyword are extra nodes, and the count must be a positive integer
+	ck_assert_int_eq(parse_mesh_text("3\n0\n0.5\n1\n2\n1 2\n3 4\n", &m, LINEAR), 1);
+	ck_assert_int_eq(parse_mesh_text("3\n0\n0.5\n1\n1.5\n2\n", &m, LINEAR), 1);
+	ck_assert_int_eq(parse_mesh_text("3\n0\n0.5\n1\nregions 0\n", &m, LINEAR), 1);
+	ck_assert_int_eq(parse_mesh_text("3\n0\n0.5\n1\nregions two\n0 0\n1 1\n", &m, LINEAR), 1);
+
+}
+END_TEST
+
+START_TEST(region_solves) {
+	// The cached region operators give the solution of the same layers through a coefficient table, on L2 and L3 meshes
+	Element_2D_Type kinds[2] = {LINEAR, QUAD};
+	for (int k = 0; k < 2; k++) {
+		struct Layers layers = {{0.3, 0.7}, {{5, -2}, {-40, 0}, {0, 30}}};
+		struct Mesh m;
+		layered_mesh(&m, 500, kinds[k], &layers);
+
+		struct Region_Operator op;
+		struct ODE_Solution sol;
+		ck_assert_int_eq(create_region_operator(&op, &m), 0);
+		ck_assert_int_eq(solve_ode_regions(&op, &sol, 1, -1, field), 0);
+
+		gsl_vector* expected = reference_solution(&m, &layers);
+		for (uint32_t i = 0; i < m.num_nodes; i++) {
+			ck_assert_double_eq_tol(gsl_vector_get(sol.solution_coeff, i), gsl_vector_get(expected, i), 1e-11);
+		}
+
+		gsl_vector_free(expected);
+		free_solution_memory(&sol);
+		free_region_operator(&op);
+		free_mesh_memory(&m);
+	}
+
+	// A mesh without regions has no region operator
+	struct Mesh m;
+	struct Region_Operator op;
+	ck_assert_int_eq(generate_uniform_mesh(&m, 0, 1, 10, LINEAR), 0);
+	ck_assert_int_eq(create_region_operator(&op, &m), 1);
+	free_mesh_memory(&m);
+
+}
+END_TEST
+
+START_TEST(incremental_refactorization) {
+	// Changing the last layer only redoes the decomposition from that layer on, and many changes leave the same solution as a fresh operator
+	struct Layers layers = {{0.3, 0.7}, {{5, -2}, {-40, 0}, {0, 30}}};
+	struct Mesh m;
+	layered_mesh(&m, 4000, QUAD, &layers);
+
+	struct Region_Operator op;
+	ck_assert_int_eq(create_region_operator(&op, &m), 0);
+
+	struct Solver_Stats stats = {0};
+	struct Solver_Stats* previous = stats_activate(&stats);
+	for (int run = 1; run <= 50; run++) {
+		ck_assert_int_eq(set_region_coefficients(&op, 2, run, 30 - run), 0);
+		ck_assert_int_eq(factorize_region_operator(&op), 0);
+	}
+	stats_activate(previous);
+	// The last layer starts at node 0.7*(num_nodes - 1); each refactorization restarts at most a checkpoint interval and `lower` rows before it
+	uint64_t rows_per_run = stats.counters[STATS_REFACTORED_ROWS]/50;
+	ck_assert_uint_le(rows_per_run, (uint64_t) (0.3*(m.num_nodes - 1)) + 1 + BAND_CHECKPOINT_INTERVAL + 2);
+	ck_assert_uint_ge(rows_per_run, (uint64_t) (0.3*(m.num_nodes - 1)));
+
+	// Change the other layers too, some back and forth
+	ck_assert_int_eq(set_region_coefficients(&op, 1, 12, 3), 0);
+	ck_assert_int_eq(set_region_coefficients(&op, 0, -7, 1), 0);
+	ck_assert_int_eq(set_region_coefficients(&op, 1, -25, 4), 0);
+	ck_assert_int_eq(set_region_coefficients(&op, 3, 0, 0), 1);
+
+	struct ODE_Solution sol;
+	ck_assert_int_eq(solve_ode_regions(&op, &sol, 1, -1, field), 0);
+	layers.values[0] = m.regions[0];
+	layers.values[1] = m.regions[1];
+	layers.values[2] = m.regions[2];
+	ck_assert_double_eq(layers.values[2].a, 50);
+
+	struct Region_Operator fresh;
+	struct ODE_Solution fresh_sol;
+	ck_assert_int_eq(create_region_operator(&fresh, &m), 0);
+	ck_assert_int_eq(solve_ode_regions(&fresh, &fresh_sol, 1, -1, field), 0);
+	// The coefficient table sums the same integrals in another order, which the conditioning of 8001 nodes turns into differences of a few 1e-10
+	gsl_vector* expected = reference_solution(&m, &layers);
+	for (uint32_t i = 0; i < m.num_nodes; i++) {
+		ck_assert_double_eq_tol(gsl_vector_get(sol.solution_coeff, i), gsl_vector_get(fresh_sol.solution_coeff, i), 1e-12);
+		ck_assert_double_eq_tol(gsl_vector_get(sol.solution_coeff, i), gsl_vector_get(expected, i), 1e-8);
+	}
+
+	gsl_vector_free(expected);
+	free_solution_memory(&sol);
+	free_solution_memory(&fresh_sol);
+	free_region_operator(&fresh);
+	free_region_operator(&op);
+	free_mesh_memory(&m);
+
+}
+END_TEST
+
+START_TEST(band_refactorization) {
+	// Refactoring after a change to the later rows reproduces the full decomposition exactly, row interchanges included
+	size_t n = 300;
+	struct Band_Matrix A, fresh, lu;
+	ck_assert_int_eq(create_band_matrix(&A, n, 2, 2), 0);
+	srand(7);
+	for (size_t i = 0; i < n; i++) {
+		for (size_t j = (i < 2) ? 0 : i - 2; j <= i + 2 && j < n; j++) {
+			band_matrix_set(&A, i, j, (double) rand()/RAND_MAX - 0.5);
+		}
+	}
+	ck_assert_int_eq(copy_band_matrix(&lu, &A), 0);
+	struct Band_Checkpoints checkpoints;
+	ck_assert_int_eq(band_lu_decomp_checkpointed(&lu, &checkpoints, 16), 0);
+
+	size_t changed[4] = {250, 100, 33, 1};
+	for (int c = 0; c < 4; c++) {
+		for (size_t i = changed[c]; i < n; i += 7) {
+			band_matrix_add(&A, i, i, 0.25);
+		}
+		ck_assert_int_eq(band_lu_refactor(&lu, &A, &checkpoints, changed[c]), 0);
+
+		ck_assert_int_eq(copy_band_matrix(&fresh, &A), 0);
+		ck_assert_int_eq(band_lu_decomp(&fresh), 0);
+		for (size_t i = 0; i < n; i++) {
+			ck_assert_uint_eq(lu.pivots[i], fresh.pivots[i]);
+		}
+		for (size_t k = 0; k < n*lu.width; k++) {
+			ck_assert_double_eq(lu.data[k], fresh.data[k]);
+		}
+		free_band_matrix(&fresh);
+	}
+
+	free_band_checkpoints(&checkpoints);
+	free_band_matrix(&lu);
+	free_band_matrix(&A);
+
+}
+END_TEST
+
+Suite* regions_suite() {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Region Mesh Tests");
+
+	tc_core = tcase_create("Core");
+	tcase_add_checked_fixture(
+		tc_core,
+		setup_function_field,
+		teardown_function_field
+	);
+
+	tcase_add_test(tc_core, region_files);
+	tcase_add_test(tc_core, region_solves);
+	tcase_add_test(tc_core, incremental_refactorization);
+	tcase_add_test(tc_core, band_refactorization);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+
+}
+
+int main() {
+	int number_failed;
+	Suite *s_regions;
+	SRunner *sr_regions;
+
+	s_regions = regions_suite();
+	sr_regions = srunner_create(s_regions);
+
+	srunner_set_fork_status(sr_regions, CK_NOFORK);
+	srunner_run_all(sr_regions, CK_NORMAL);
+
+	number_failed = srunner_ntests_failed(sr_regions);
+
+	srunner_free(sr_regions);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
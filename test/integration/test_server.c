@@ -0,0 +1,300 @@
+#include <stdlib.h>
+#include <check.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "fe_section.h"
+#include "band_matrix.h"
+#include "solver_cache.h"
+#include "solver_server.h"
+
+#define TOL 1e-9
+
+struct Function_Field *field = NULL;
+
+// Directory where the input meshes are.
+char input_mesh_dir[250];
+
+double driving_func(double x) {
+	return x*x + x + 3;
+
+}
+
+static void setup_function_field() {
+	struct Function_Field *f_field_temp = malloc(sizeof(struct Function_Field));
+
+	create_function_field(f_field_temp, 0, 15, 2001, driving_func);
+
+	field = f_field_temp;
+
+}
+
+static void teardown_function_field() {
+	free_function_field(field);
+	free(field);
+	field = NULL;
+
+}
+
+START_TEST(factorized_matches_solver) {
+	// Reusing one factorization for several boundary values gives the same answers as separate solves
+	struct Mesh m;
+	char dir[250];
+	memcpy(dir, input_mesh_dir, 250);
+	strcat(dir, "test_reference_array/quadratic_mesh.in");
+
+	FILE* quad_mesh = fopen(dir, "r");
+	ck_assert_ptr_nonnull(quad_mesh);
+	ck_assert_int_eq(parse_input_file(quad_mesh, &m, QUAD), 0);
+	fclose(quad_mesh);
+
+	struct Band_Matrix K_lu;
+	ck_assert_int_eq(factorize_ode_constant(&m, 4., 4., &K_lu), 0);
+	gsl_vector* F_const = assemble_constant_vector(&m, field);
+	ck_assert_ptr_nonnull(F_const);
+
+	for (int d2 = 0; d2 < 3; d2++) {
+		struct ODE_Solution sol;
+		ck_assert_int_eq(solve_ode_constant(&m, &sol, 4., 4., 0, d2, field, false), 0);
+
+		gsl_vector* y = solve_ode_factorized(&m, &K_lu, F_const, 0, d2);
+		ck_assert_ptr_nonnull(y);
+		for (int i = 0; i < m.num_nodes; i++) {
+			ck_assert_double_eq_tol(gsl_vector_get(y, i), gsl_vector_get(sol.solution_coeff, i), TOL);
+		}
+
+		gsl_vector_free(y);
+		free_solution_memory(&sol);
+	}
+
+	gsl_vector_free(F_const);
+	free_band_matrix(&K_lu);
+	free_mesh_memory(&m);
+
+}
+END_TEST
+
+static int values_freed = 0;
+
+static void count_free(void *value) {
+	values_freed++;
+	free(value);
+
+}
+
+START_TEST(cache_lru_and_references) {
+	struct Solver_Cache cache;
+	ck_assert_int_eq(create_solver_cache(&cache, 2), 0);
+	values_freed = 0;
+
+	struct Cache_Entry *first = cache_insert(&cache, 1, malloc(8), count_free);
+	cache_release(&cache, cache_insert(&cache, 2, malloc(8), count_free));
+	ck_assert_ptr_null(cache_acquire(&cache, 3));
+
+	// Key 1 is still referenced, so the third insert evicts it without freeing it yet
+	cache_release(&cache, cache_insert(&cache, 3, malloc(8), count_free));
+	ck_assert_int_eq(values_freed, 0);
+	ck_assert_ptr_null(cache_acquire(&cache, 1));
+	cache_release(&cache, first);
+	ck_assert_int_eq(values_freed, 1);
+
+	struct Cache_Entry *hit = cache_acquire(&cache, 2);
+	ck_assert_ptr_nonnull(hit);
+	cache_release(&cache, hit);
+	ck_assert_uint_eq(cache.hits, 1);
+	ck_assert_uint_eq(cache.misses, 2);
+
+	free_solver_cache(&cache);
+	ck_assert_int_eq(values_freed, 3);
+
+}
+END_TEST
+
+START_TEST(server_cached_requests) {
+	output_function_field(field, "server_field.dat");
+
+	struct Solver_Server server;
+	ck_assert_int_eq(create_solver_server(&server, 2, 16), 0);
+
+	char *buffer = NULL;
+	size_t length = 0;
+	char line[SERVER_LINE_LENGTH];
+	char header[SERVER_LINE_LENGTH];
+
+	// Same problem twice; only the boundary values differ, so everything but the solve is a hit the second time
+	for (int pass = 0; pass < 2; pass++) {
+		FILE *response = open_memstream(&buffer, &length);
+		snprintf(line, SERVER_LINE_LENGTH, "SOLVE id=%d a=-1 b=-5 d1=%d d2=1 field=server_field.dat start=0 end=10 elements=40 kind=L3\n", pass, pass);
+		ck_assert_int_eq(handle_server_line(&server, line, response), 0);
+		fclose(response);
+
+		sscanf(buffer, "%[^\n]", header);
+		ck_assert_ptr_nonnull(strstr(header, "nodes=81"));
+		if (pass == 0) {
+			ck_assert_ptr_nonnull(strstr(header, "field=miss mesh=miss load=miss factor=miss"));
+		}
+		else {
+			ck_assert_ptr_nonnull(strstr(header, "field=hit mesh=hit load=hit factor=hit"));
+		}
+
+		// First value is the left boundary
+		double x, y;
+		sscanf(strchr(buffer, '\n') + 1, "%lf\t%lf", &x, &y);
+		ck_assert_double_eq_tol(x, 0, TOL);
+		ck_assert_double_eq_tol(y, pass, TOL);
+
+		free(buffer);
+		buffer = NULL;
+	}
+
+	// Malformed requests are answered with an error
+	FILE *response = open_memstream(&buffer, &length);
+	strcpy(line, "SOLVE a=1 field=server_field.dat\n");
+	ck_assert_int_eq(handle_server_line(&server, line, response), 1);
+	fclose(response);
+	ck_assert_int_eq(strncmp(buffer, "ERROR", 5), 0);
+	free(buffer);
+
+	free_solver_server(&server);
+	remove("server_field.dat");
+
+}
+END_TEST
+
+struct Socket_Run {
+	struct Solver_Server *server;
+	const char *path;
+	int status;
+
+};
+
+static void* run_socket(void *args) {
+	struct Socket_Run *run = (struct Socket_Run*) args;
+	run->status = run_solver_server(run->server, run->path);
+
+	return NULL;
+
+}
+
+static int connect_socket(const char *path) {
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(struct sockaddr_un));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+
+	// The server may not be listening yet
+	for (int attempt = 0; attempt < 500; attempt++) {
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (connect(fd, (struct sockaddr*) &address, sizeof(struct sockaddr_un)) == 0) {
+			return fd;
+		}
+		close(fd);
+		usleep(10000);
+	}
+
+	return -1;
+
+}
+
+// Sends one line and reads the first line of the answer
+static void exchange_line(int fd, const char *line, char *answer, size_t size) {
+	ck_assert_int_eq(write(fd, line, strlen(line)), (ssize_t) strlen(line));
+	size_t length = 0;
+	while (length + 1 < size && read(fd, &answer[length], 1) == 1 && answer[length] != '\n') {
+		length++;
+	}
+	answer[length] = '\0';
+
+}
+
+START_TEST(socket_idle_clients) {
+	char path[64] = "/tmp/solver_server_XXXXXX";
+	int fd = mkstemp(path);
+	ck_assert(fd >= 0);
+	close(fd);
+
+	// A file that is not a socket is never replaced
+	struct Solver_Server server;
+	ck_assert_int_eq(create_solver_server(&server, 1, 16), 0);
+	ck_assert_int_eq(run_solver_server(&server, path), 1);
+	ck_assert_int_eq(access(path, F_OK), 0);
+	remove(path);
+
+	// More idle clients than workers neither hold up other clients nor shutdown
+	struct Socket_Run run = {&server, path, -1};
+	pthread_t thread;
+	ck_assert_int_eq(pthread_create(&thread, NULL, run_socket, &run), 0);
+	int idle[2];
+	for (int i = 0; i < 2; i++) {
+		idle[i] = connect_socket(path);
+		ck_assert(idle[i] >= 0);
+	}
+	int client = connect_socket(path);
+	ck_assert(client >= 0);
+
+	char answer[SERVER_LINE_LENGTH];
+	exchange_line(client, "STATS\n", answer, SERVER_LINE_LENGTH);
+	ck_assert_int_eq(strncmp(answer, "OK served=0", 11), 0);
+	exchange_line(client, "SHUTDOWN\n", answer, SERVER_LINE_LENGTH);
+	ck_assert_str_eq(answer, "OK shutdown");
+
+	ck_assert_int_eq(pthread_join(thread, NULL), 0);
+	ck_assert_int_eq(run.status, 0);
+	ck_assert_int_ne(access(path, F_OK), 0);
+
+	close(client);
+	close(idle[0]);
+	close(idle[1]);
+	free_solver_server(&server);
+
+}
+END_TEST
+
+Suite* server_suite() {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Solver Server Tests");
+
+	tc_core = tcase_create("Core");
+	tcase_add_checked_fixture(
+		tc_core,
+		setup_function_field,
+		teardown_function_field
+	);
+
+	tcase_add_test(tc_core, factorized_matches_solver);
+	tcase_add_test(tc_core, cache_lru_and_references);
+	tcase_add_test(tc_core, server_cached_requests);
+	tcase_add_test(tc_core, socket_idle_clients);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+
+}
+
+int main() {
+	// Assign directory here
+	const char *dir_name = "./integration/";
+	strcpy(input_mesh_dir, dir_name);
+
+	int number_failed;
+	Suite *s_server;
+	SRunner *sr_server;
+
+	s_server = server_suite();
+	sr_server = srunner_create(s_server);
+
+	srunner_set_fork_status(sr_server, CK_NOFORK);
+	srunner_run_all(sr_server, CK_NORMAL);
+
+	number_failed = srunner_ntests_failed(sr_server);
+
+	srunner_free(sr_server);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
@@ -1,6 +1,7 @@
 #include <stdlib.h>
 #include <check.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "fe_section.h"
 
@@ -286,6 +287,50 @@ START_TEST(L3_solver) {
 }
 END_TEST
 
+START_TEST(field_out_of_range) {
+	// A mesh past the end of the field fails every solve path, with one message per solve instead of one per element block
+	struct Mesh m;
+	ck_assert_int_eq(generate_uniform_mesh(&m, 10, 20, 1000, QUAD), 0);
+
+	FILE* captured = tmpfile();
+	ck_assert_ptr_nonnull(captured);
+	fflush(stdout);
+	int saved_stdout = dup(STDOUT_FILENO);
+	dup2(fileno(captured), STDOUT_FILENO);
+
+	int statuses[4];
+	struct Solver_Options options = {0};
+	struct ODE_Solution solution;
+	statuses[0] = solve_ode_constant_opts(&m, &solution, 1, 1, 0, 0, field, &options);
+	options.no_condensation = true;
+	statuses[1] = solve_ode_constant_opts(&m, &solution, 1, 1, 0, 0, field, &options);
+	options.supg = true;
+	statuses[2] = solve_ode_constant_opts(&m, &solution, 1, 1, 0, 0, field, &options);
+	options.supg = false;
+	options.streaming = true;
+	statuses[3] = solve_ode_constant_opts(&m, &solution, 1, 1, 0, 0, field, &options);
+
+	fflush(stdout);
+	dup2(saved_stdout, STDOUT_FILENO);
+	close(saved_stdout);
+
+	for (int i = 0; i < 4; i++) {
+		ck_assert_int_eq(statuses[i], 1);
+	}
+	int messages = 0;
+	char line[512];
+	rewind(captured);
+	while (fgets(line, sizeof(line), captured) != NULL) {
+		messages += (strstr(line, "outside of the range") != NULL);
+	}
+	ck_assert_int_eq(messages, 4);
+
+	fclose(captured);
+	free_mesh_memory(&m);
+
+}
+END_TEST
+
 Suite* solver_suite() {
 	Suite *s;
 	TCase *tc_linear, *tc_quad;
@@ -301,6 +346,7 @@ Suite* solver_suite() {
 	);
 
 	tcase_add_test(tc_linear, L2_solver);
+	tcase_add_test(tc_linear, field_out_of_range);
 	suite_add_tcase(s, tc_linear);
 
 	tc_quad = tcase_create("Quadratic Mesh Case");
@@ -0,0 +1,194 @@
+#include <stdlib.h>
+#include <check.h>
+#include <string.h>
+
+#include "fe_section.h"
+#include "solver_stats.h"
+
+#define NUM_ELEMENTS 50
+
+struct Function_Field *field = NULL;
+
+double driving_func(double x) {
+	return x*x + x + 3;
+
+}
+
+static void setup_function_field() {
+	struct Function_Field *f_field_temp = malloc(sizeof(struct Function_Field));
+
+	create_function_field(f_field_temp, 0, 15, 2001, driving_func);
+
+	field = f_field_temp;
+
+}
+
+static void teardown_function_field() {
+	free_function_field(field);
+	free(field);
+	field = NULL;
+
+}
+
+START_TEST(L2_counters) {
+	// Each L2 element integrates 4 matrix entries and 2 vector entries with 9 points; only the vector entries evaluate f
+	struct Mesh m;
+	struct ODE_Solution sol;
+	ck_assert_int_eq(generate_uniform_mesh(&m, 0, 10, NUM_ELEMENTS, LINEAR), 0);
+
+	struct Solver_Options options = {0};
+	options.collect_stats = true;
+	ck_assert_int_eq(solve_ode_constant_opts(&m, &sol, 4., 4., 0, 5, field, &options), 0);
+	ck_assert_ptr_nonnull(sol.stats);
+
+	ck_assert_uint_eq(sol.stats->counters[STATS_ELEMENTS], NUM_ELEMENTS);
+	ck_assert_uint_eq(sol.stats->counters[STATS_QUAD_EVALS], NUM_ELEMENTS*6*9);
+	ck_assert_uint_eq(sol.stats->counters[STATS_F_EVALS], NUM_ELEMENTS*9); // Once per quadrature point, shared by the shape functions
+	ck_assert_uint_gt(sol.stats->counters[STATS_ALLOCATIONS], 0);
+	ck_assert_uint_gt(sol.stats->counters[STATS_BYTES], 0);
+	ck_assert_double_gt(sol.stats->phase_seconds[STATS_LOCAL_KERNELS], 0);
+	ck_assert_double_gt(sol.stats->phase_seconds[STATS_FACTOR], 0);
+
+	// Nothing was parsed or written during the solve
+	ck_assert_double_eq(sol.stats->phase_seconds[STATS_PARSE], 0);
+	ck_assert_double_eq(sol.stats->phase_seconds[STATS_OUTPUT], 0);
+
+	free_mesh_memory(&m);
+	free_solution_memory(&sol);
+
+}
+END_TEST
+
+START_TEST(outer_collection) {
+	// A caller collecting around parse and solve gets both, and the solution without collect_stats gets nothing attached
+	struct Solver_Stats outer = {0};
+	struct Solver_Stats* previous = stats_activate(&outer);
+
+	struct Mesh m;
+	struct ODE_Solution sol;
+	FILE* quad_mesh = tmpfile();
+	fprintf(quad_mesh, "5\n0\n1\n2\n3.5\n5\n");
+	rewind(quad_mesh);
+	ck_assert_int_eq(parse_input_file(quad_mesh, &m, QUAD), 0);
+	fclose(quad_mesh);
+
+	ck_assert_int_eq(solve_ode_constant(&m, &sol, 0, 0, 0, 25, field, false), 0);
+	ck_assert_ptr_null(sol.stats);
+
+	stats_activate(previous);
+
+	ck_assert_double_gt(outer.phase_seconds[STATS_PARSE], 0);
+	ck_assert_uint_eq(outer.counters[STATS_ELEMENTS], 2);
+	ck_assert_uint_eq(outer.counters[STATS_QUAD_EVALS], 2*12*10);
+	ck_assert_uint_eq(outer.counters[STATS_F_EVALS], 2*10);
+
+	// The JSON output names every phase and counter
+	char* buffer = NULL;
+	size_t length = 0;
+	FILE* json = open_memstream(&buffer, &length);
+	ck_assert_int_eq(output_stats_json(json, &outer), 0);
+	fclose(json);
+	for (int p = 0; p < STATS_NUM_PHASES; p++) {
+		ck_assert_ptr_nonnull(strstr(buffer, stats_phase_name(p)));
+	}
+	for (int c = 0; c < STATS_NUM_COUNTERS; c++) {
+		ck_assert_ptr_nonnull(strstr(buffer, stats_counter_name(c)));
+	}
+	free(buffer);
+
+	free_mesh_memory(&m);
+	free_solution_memory(&sol);
+
+}
+END_TEST
+
+START_TEST(hw_counters) {
+	// Either the three regions are measured, or nothing is and the JSON output says why
+	int status = hw_counters_enable();
+
+	struct Mesh m;
+	struct ODE_Solution sol;
+	ck_assert_int_eq(generate_uniform_mesh(&m, 0, 10, NUM_ELEMENTS, LINEAR), 0);
+
+	struct Solver_Options options = {0};
+	options.collect_stats = true;
+	ck_assert_int_eq(solve_ode_constant_opts(&m, &sol, 4., 4., 0, 5, field, &options), 0);
+	ck_assert_ptr_nonnull(sol.stats);
+
+	char* buffer = NULL;
+	size_t length = 0;
+	FILE* json = open_memstream(&buffer, &length);
+	ck_assert_int_eq(output_stats_json(json, sol.stats), 0);
+	fclose(json);
+
+	if (status == 0) {
+		ck_assert_ptr_null(hw_counters_unavailable_reason());
+		ck_assert_uint_eq(sol.stats->hw_entries[HW_ELEMENT_LOOP], 2); // Coefficient matrix and constant vector loops
+		ck_assert_uint_eq(sol.stats->hw_entries[HW_F_EVAL], 1); // One f_eval_batch() call per block of elements
+		ck_assert_uint_eq(sol.stats->hw_entries[HW_FACTOR], 1);
+		ck_assert_uint_gt(sol.stats->hw_counts[HW_ELEMENT_LOOP][HW_CYCLES], 0);
+		ck_assert_ptr_nonnull(strstr(buffer, "\"available\": true"));
+		for (int r = 0; r < HW_NUM_REGIONS; r++) {
+			ck_assert_ptr_nonnull(strstr(buffer, hw_region_name(r)));
+		}
+		ck_assert_ptr_nonnull(strstr(buffer, "cycles_per_element"));
+	}
+	else {
+		ck_assert_ptr_nonnull(hw_counters_unavailable_reason());
+		for (int r = 0; r < HW_NUM_REGIONS; r++) {
+			ck_assert_uint_eq(sol.stats->hw_entries[r], 0);
+		}
+		ck_assert_ptr_nonnull(strstr(buffer, "\"available\": false"));
+	}
+
+	// The software counters are recorded either way
+	ck_assert_uint_eq(sol.stats->counters[STATS_ELEMENTS], NUM_ELEMENTS);
+
+	hw_counters_requested = false;
+	free(buffer);
+	free_mesh_memory(&m);
+	free_solution_memory(&sol);
+
+}
+END_TEST
+
+Suite* stats_suite() {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Solver Statistics Tests");
+
+	tc_core = tcase_create("Core");
+	tcase_add_checked_fixture(
+		tc_core,
+		setup_function_field,
+		teardown_function_field
+	);
+
+	tcase_add_test(tc_core, L2_counters);
+	tcase_add_test(tc_core, outer_collection);
+	tcase_add_test(tc_core, hw_counters);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+
+}
+
+int main() {
+	int number_failed;
+	Suite *s_stats;
+	SRunner *sr_stats;
+
+	s_stats = stats_suite();
+	sr_stats = srunner_create(s_stats);
+
+	srunner_set_fork_status(sr_stats, CK_NOFORK);
+	srunner_run_all(sr_stats, CK_NORMAL);
+
+	number_failed = srunner_ntests_failed(sr_stats);
+
+	srunner_free(sr_stats);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
@@ -0,0 +1,203 @@
+#include <stdlib.h>
+#include <check.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "fe_section.h"
+#include "streaming_solver.h"
+
+#define SCRATCH_FILE "streaming_scratch.bin"
+
+struct Function_Field *field = NULL;
+
+double driving_func(double x) {
+	return x*x + x + 3;
+
+}
+
+static void setup_function_field() {
+	struct Function_Field *f_field_temp = malloc(sizeof(struct Function_Field));
+
+	create_function_field(f_field_temp, 0, 15, 2001, driving_func);
+
+	field = f_field_temp;
+
+}
+
+static void teardown_function_field() {
+	free_function_field(field);
+	free(field);
+	field = NULL;
+
+}
+
+// The streaming solve does the same operations in the same order, so the solutions must be identical
+static void assert_same_solution(const gsl_vector* streamed, const gsl_vector* banded) {
+	ck_assert_uint_eq(streamed->size, banded->size);
+	for (size_t i = 0; i < banded->size; i++) {
+		ck_assert_double_eq(gsl_vector_get(streamed, i), gsl_vector_get(banded, i));
+	}
+
+}
+
+// The banded solve the streaming one replicates (L3 meshes would otherwise be condensed)
+static int solve_banded(struct Mesh* m, struct ODE_Solution* sol, double a, double b, double d1, double d2) {
+	struct Solver_Options options = {0};
+	options.no_condensation = true;
+	return solve_ode_constant_opts(m, sol, a, b, d1, d2, field, &options);
+
+}
+
+START_TEST(mesh_streaming) {
+	// L2 and L3 meshes, including a convection dominated case whose elimination swaps rows
+	double cases[3][2] = {{4, 4}, {-1, -5}, {60, -5}};
+	Element_2D_Type kinds[2] = {LINEAR, QUAD};
+
+	for (int k = 0; k < 2; k++) {
+		for (int c = 0; c < 3; c++) {
+			struct Mesh m;
+			struct ODE_Solution sol;
+			ck_assert_int_eq(generate_uniform_mesh(&m, 0, 10, 150, kinds[k]), 0);
+			ck_assert_int_eq(solve_banded(&m, &sol, cases[c][0], cases[c][1], 0, 5), 0);
+
+			gsl_vector* in_memory = solve_ode_streaming(&m, cases[c][0], cases[c][1], 0, 5, field, NULL);
+			ck_assert_ptr_nonnull(in_memory);
+			assert_same_solution(in_memory, sol.solution_coeff);
+
+			// The scratch file is only there during the solve
+			gsl_vector* mapped = solve_ode_streaming(&m, cases[c][0], cases[c][1], 0, 5, field, SCRATCH_FILE);
+			ck_assert_ptr_nonnull(mapped);
+			assert_same_solution(mapped, sol.solution_coeff);
+			ck_assert_int_ne(access(SCRATCH_FILE, F_OK), 0);
+
+			// The same through the solver options; the global arrays are never formed
+			struct ODE_Solution streamed;
+			struct Solver_Options options = {0};
+			options.streaming = true;
+			ck_assert_int_eq(solve_ode_constant_opts(&m, &streamed, cases[c][0], cases[c][1], 0, 5, field, &options), 0);
+			assert_same_solution(streamed.solution_coeff, sol.solution_coeff);
+			ck_assert_ptr_null(streamed.coeff_matrix_global);
+
+			options.output_global_arrays = true;
+			ck_assert_int_eq(solve_ode_constant_opts(&m, &streamed, cases[c][0], cases[c][1], 0, 5, field, &options), 1);
+
+			gsl_vector_free(in_memory);
+			gsl_vector_free(mapped);
+			gsl_vector_free(streamed.solution_coeff);
+			free_solution_memory(&sol);
+			free_mesh_memory(&m);
+		}
+	}
+
+}
+END_TEST
+
+START_TEST(node_streams) {
+	// A mesh file streamed node by node solves as the parsed mesh does, including an L3 mesh with an unused last node
+	const char* mesh_files[3] = {"integration/test_meshes/linear_mesh_1.in", "integration/test_meshes/quadratic_mesh_1.in", "streaming_even.in"};
+	Element_2D_Type kinds[3] = {LINEAR, QUAD, QUAD};
+
+	FILE* even = fopen("streaming_even.in", "w");
+	fprintf(even, "6\n0\n1\n2.5\n3\n4\n5.5\n");
+	fclose(even);
+
+	for (int f = 0; f < 3; f++) {
+		struct Mesh m;
+		struct ODE_Solution sol;
+		FILE* mesh_file = fopen(mesh_files[f], "r");
+		ck_assert_ptr_nonnull(mesh_file);
+		ck_assert_int_eq(parse_input_file(mesh_file, &m, kinds[f]), 0);
+		fclose(mesh_file);
+		ck_assert_int_eq(solve_banded(&m, &sol, -2, 3, 1, 4), 0);
+
+		struct Node_Stream nodes;
+		mesh_file = fopen(mesh_files[f], "r");
+		ck_assert_int_eq(open_node_stream_file(&nodes, mesh_file), 0);
+		gsl_vector* streamed = solve_ode_streaming_nodes(&nodes, kinds[f], -2, 3, 1, 4, field, NULL);
+		fclose(mesh_file);
+		ck_assert_ptr_nonnull(streamed);
+		assert_same_solution(streamed, sol.solution_coeff);
+
+		gsl_vector_free(streamed);
+		free_solution_memory(&sol);
+		free_mesh_memory(&m);
+	}
+
+	// A generated uniform mesh matches generate_uniform_mesh()
+	struct Mesh m;
+	struct ODE_Solution sol;
+	ck_assert_int_eq(generate_uniform_mesh(&m, 0.5, 12, 333, QUAD), 0);
+	ck_assert_int_eq(solve_banded(&m, &sol, 0, -4, 2, 0), 0);
+
+	struct Node_Stream nodes;
+	ck_assert_int_eq(open_node_stream_uniform(&nodes, 0.5, 12, 333, QUAD), 0);
+	gsl_vector* streamed = solve_ode_streaming_nodes(&nodes, QUAD, 0, -4, 2, 0, field, SCRATCH_FILE);
+	ck_assert_ptr_nonnull(streamed);
+	assert_same_solution(streamed, sol.solution_coeff);
+
+	gsl_vector_free(streamed);
+	free_solution_memory(&sol);
+	free_mesh_memory(&m);
+	remove("streaming_even.in");
+
+}
+END_TEST
+
+START_TEST(malformed_streams) {
+	// Descending, missing and extra nodes are rejected as parse_input_file() rejects them
+	const char* contents[3] = {"4\n0\n2\n1\n3\n", "4\n0\n1\n2\n", "3\n0\n1\n2\n3\n"};
+
+	for (int c = 0; c < 3; c++) {
+		FILE* mesh_file = tmpfile();
+		fputs(contents[c], mesh_file);
+		rewind(mesh_file);
+
+		struct Node_Stream nodes;
+		ck_assert_int_eq(open_node_stream_file(&nodes, mesh_file), 0);
+		ck_assert_ptr_null(solve_ode_streaming_nodes(&nodes, LINEAR, 0, -4, 0, 1, field, NULL));
+		fclose(mesh_file);
+	}
+
+}
+END_TEST
+
+Suite* streaming_suite() {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Streaming Solver Tests");
+
+	tc_core = tcase_create("Core");
+	tcase_add_checked_fixture(
+		tc_core,
+		setup_function_field,
+		teardown_function_field
+	);
+
+	tcase_add_test(tc_core, mesh_streaming);
+	tcase_add_test(tc_core, node_streams);
+	tcase_add_test(tc_core, malformed_streams);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+
+}
+
+int main() {
+	int number_failed;
+	Suite *s_streaming;
+	SRunner *sr_streaming;
+
+	s_streaming = streaming_suite();
+	sr_streaming = srunner_create(s_streaming);
+
+	srunner_set_fork_status(sr_streaming, CK_NOFORK);
+	srunner_run_all(sr_streaming, CK_NORMAL);
+
+	number_failed = srunner_ntests_failed(sr_streaming);
+
+	srunner_free(sr_streaming);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
@@ -0,0 +1,197 @@
+#include <stdlib.h>
+#include <check.h>
+#include <math.h>
+
+#include "fe_section.h"
+
+struct Function_Field *field = NULL;
+static double field_a = 0;
+
+// f for y = x^2 in y'' + A y' = f
+double driving_func(double x) {
+	return 2 + 2*field_a*x;
+
+}
+
+double zero_func(double x) {
+	return 0;
+
+}
+
+static void setup_function_field() {
+	struct Function_Field *f_field_temp = malloc(sizeof(struct Function_Field));
+
+	field_a = 0;
+	create_function_field(f_field_temp, -1, 2, 301, driving_func);
+
+	field = f_field_temp;
+
+}
+
+static void teardown_function_field() {
+	free_function_field(field);
+	free(field);
+	field = NULL;
+
+}
+
+static void solve(struct Mesh* m, struct ODE_Solution* sol, double a, double b, double d1, double d2, struct Function_Field* f, bool supg) {
+	struct Solver_Options options = {0};
+	options.supg = supg;
+	ck_assert_int_eq(solve_ode_constant_opts(m, sol, a, b, d1, d2, f, &options), 0);
+
+}
+
+START_TEST(nodal_exactness) {
+	// y'' + A y' = 0 with y(0) = 0 and y(1) = 1 has y = (1 - e^(-Ax))/(1 - e^(-A)): a layer at x = 0 for A > 0 and at x = 1 for A < 0.
+	// With the optimal tau the L2 nodal values are exact at any cell Péclet number; Galerkin elements oscillate above 1.
+	double a[3] = {50, 1000, -50};
+	struct Mesh m;
+	ck_assert_int_eq(generate_uniform_mesh(&m, 0, 1, 10, LINEAR), 0);
+	struct Function_Field zero;
+	create_function_field(&zero, -1, 2, 301, zero_func);
+
+	for (int c = 0; c < 3; c++) {
+		struct ODE_Solution supg, galerkin;
+		solve(&m, &supg, a[c], 0, 0, 1, &zero, true);
+		solve(&m, &galerkin, a[c], 0, 0, 1, &zero, false);
+
+		double galerkin_error = 0;
+		int sign_changes = 0;
+		for (uint32_t i = 0; i < m.num_nodes; i++) {
+			double x = m.node_coordinates[i];
+			double exact = (a[c] > 0) ? (1 - exp(-a[c]*x))/(1 - exp(-a[c])) : (exp(-a[c]*(x - 1)) - exp(a[c]))/(1 - exp(a[c]));
+			ck_assert_double_eq_tol(gsl_vector_get(supg.solution_coeff, i), exact, 1e-12);
+			galerkin_error = fmax(galerkin_error, fabs(gsl_vector_get(galerkin.solution_coeff, i) - exact));
+			if (i >= 2) {
+				double d0 = gsl_vector_get(galerkin.solution_coeff, i - 1) - gsl_vector_get(galerkin.solution_coeff, i - 2);
+				double d1 = gsl_vector_get(galerkin.solution_coeff, i) - gsl_vector_get(galerkin.solution_coeff, i - 1);
+				sign_changes += (d0*d1 < 0);
+			}
+		}
+		ck_assert_double_gt(galerkin_error, 0.1);
+		ck_assert_int_gt(sign_changes, 3);
+
+		free_solution_memory(&supg);
+		free_solution_memory(&galerkin);
+	}
+	free_function_field(&zero);
+	free_mesh_memory(&m);
+
+}
+END_TEST
+
+START_TEST(consistency) {
+	// The residual of the exact solution vanishes, so y = x^2 stays exact on L3 elements with their middle nodes centered, whatever A is
+	double* nodes = malloc(5*sizeof(double));
+	double coordinates[5] = {0, 0.2, 0.4, 0.7, 1};
+	for (int i = 0; i < 5; i++) {
+		nodes[i] = coordinates[i];
+	}
+	struct Mesh m;
+	ck_assert_int_eq(build_mesh_from_nodes(&m, nodes, 5, QUAD), 0); // The mesh takes the node array
+	double a[2] = {3, 400};
+
+	for (int c = 0; c < 2; c++) {
+		field_a = a[c];
+		free_function_field(field);
+		create_function_field(field, -1, 2, 301, driving_func);
+
+		struct ODE_Solution sol;
+		solve(&m, &sol, a[c], 0, 0, 1, field, true);
+		for (uint32_t i = 0; i < m.num_nodes; i++) {
+			double x = m.node_coordinates[i];
+			ck_assert_double_eq_tol(gsl_vector_get(sol.solution_coeff, i), x*x, 1e-10);
+		}
+		free_solution_memory(&sol);
+	}
+	free_mesh_memory(&m);
+
+	// Without convection there is nothing to stabilize
+	field_a = 0;
+	free_function_field(field);
+	create_function_field(field, -1, 2, 301, driving_func);
+	ck_assert_int_eq(generate_uniform_mesh(&m, 0, 1, 20, QUAD), 0);
+	struct ODE_Solution supg, galerkin;
+	solve(&m, &supg, 0, -4, 1, 2, field, true);
+	solve(&m, &galerkin, 0, -4, 1, 2, field, false);
+	for (uint32_t i = 0; i < m.num_nodes; i++) {
+		ck_assert_double_eq_tol(gsl_vector_get(supg.solution_coeff, i), gsl_vector_get(galerkin.solution_coeff, i), 1e-12);
+	}
+	free_solution_memory(&supg);
+	free_solution_memory(&galerkin);
+	free_mesh_memory(&m);
+
+}
+END_TEST
+
+START_TEST(solver_paths) {
+	// The stabilized band goes to the iterative solvers as well; the streaming and matrix-free solves reject it
+	struct Mesh m;
+	ck_assert_int_eq(generate_uniform_mesh(&m, 0, 1, 64, QUAD), 0);
+	struct ODE_Solution lu, iterative;
+	struct Solver_Options options = {0};
+	options.supg = true;
+	ck_assert_int_eq(solve_ode_constant_opts(&m, &lu, 500, 7, 0, 1, field, &options), 0);
+
+	options.linear_solver = SOLVER_BICGSTAB;
+	ck_assert_int_eq(solve_ode_constant_opts(&m, &iterative, 500, 7, 0, 1, field, &options), 0);
+	ck_assert(iterative.iterative->converged);
+	// The backward error of 1e-12 is amplified by the conditioning of the band
+	for (uint32_t i = 0; i < m.num_nodes; i++) {
+		ck_assert_double_eq_tol(gsl_vector_get(iterative.solution_coeff, i), gsl_vector_get(lu.solution_coeff, i), 1e-6);
+	}
+	free_solution_memory(&lu);
+	free_solution_memory(&iterative);
+
+	struct ODE_Solution rejected;
+	options.linear_solver = SOLVER_MATRIX_FREE;
+	ck_assert_int_eq(solve_ode_constant_opts(&m, &rejected, 500, 7, 0, 1, field, &options), 1);
+	options.linear_solver = SOLVER_BAND_LU;
+	options.streaming = true;
+	ck_assert_int_eq(solve_ode_constant_opts(&m, &rejected, 500, 7, 0, 1, field, &options), 1);
+	free_mesh_memory(&m);
+
+}
+END_TEST
+
+Suite* supg_suite() {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("SUPG Stabilization Tests");
+
+	tc_core = tcase_create("Core");
+	tcase_add_checked_fixture(
+		tc_core,
+		setup_function_field,
+		teardown_function_field
+	);
+
+	tcase_add_test(tc_core, nodal_exactness);
+	tcase_add_test(tc_core, consistency);
+	tcase_add_test(tc_core, solver_paths);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+
+}
+
+int main() {
+	int number_failed;
+	Suite *s_supg;
+	SRunner *sr_supg;
+
+	s_supg = supg_suite();
+	sr_supg = srunner_create(s_supg);
+
+	srunner_set_fork_status(sr_supg, CK_NOFORK);
+	srunner_run_all(sr_supg, CK_NORMAL);
+
+	number_failed = srunner_ntests_failed(sr_supg);
+
+	srunner_free(sr_supg);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
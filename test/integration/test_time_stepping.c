@@ -0,0 +1,303 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <check.h>
+#include <math.h>
+
+#include "fe_section.h"
+#include "time_stepping.h"
+
+struct Function_Field *field = NULL;
+static char snapshot_path[64] = ""; // Removed in teardown, so a failed test leaves nothing behind
+
+// y = x^3 solves y'' + y' - 2y = f
+double driving_func(double x) {
+	return 6*x + 3*x*x - 2*x*x*x;
+
+}
+
+// u = e^(-t) sin(pi x) solves u_t = u_xx + u_x - 2u + f
+static double decay_source(double x, double t, void* context) {
+	return exp(-t)*((M_PI*M_PI + 1)*sin(M_PI*x) - M_PI*cos(M_PI*x));
+
+}
+
+// The steady state of u_t = u_xx + u_x - 2u - f solves the ODE with f
+static double steady_source(double x, double t, void* context) {
+	return -driving_func(x);
+
+}
+
+static void setup_function_field() {
+	struct Function_Field *f_field_temp = malloc(sizeof(struct Function_Field));
+
+	create_function_field(f_field_temp, -1, 2, 30001, driving_func);
+
+	field = f_field_temp;
+
+}
+
+static void teardown_function_field() {
+	free_function_field(field);
+	free(field);
+	field = NULL;
+	if (snapshot_path[0] != '\0') {
+		remove(snapshot_path);
+		snapshot_path[0] = '\0';
+	}
+
+}
+
+static gsl_vector* sine_values(struct Mesh* m) {
+	gsl_vector* u = gsl_vector_alloc(m->num_nodes);
+	for (uint32_t i = 0; i < m->num_nodes; i++) {
+		gsl_vector_set(u, i, sin(M_PI*m->node_coordinates[i]));
+	}
+
+	return u;
+
+}
+
+START_TEST(temporal_convergence) {
+	// On a fine L3 mesh the error at t = 1 halves with the step for backward Euler and drops by 4 for Crank-Nicolson and BDF2
+	Time_Scheme schemes[3] = {TIME_BACKWARD_EULER, TIME_CRANK_NICOLSON, TIME_BDF2};
+	double min_ratio[3] = {1.8, 3.5, 3.5};
+	int factorizations[3] = {1, 1, 2};
+	struct Mesh m;
+	ck_assert_int_eq(generate_uniform_mesh(&m, 0, 1, 200, QUAD), 0);
+	gsl_vector* initial = sine_values(&m);
+	struct Time_Problem problem = {1, -2, decay_source, NULL, false, 0, 0, initial};
+
+	for (int k = 0; k < 3; k++) {
+		double previous = 0;
+		for (size_t steps = 20; steps <= 80; steps *= 2) {
+			struct Time_Options options = {schemes[k], 0, 1.0/steps, steps, 0, NULL};
+			struct Time_Report report;
+			struct ODE_Solution solution;
+			ck_assert_int_eq(solve_ode_transient(&m, &solution, &problem, &options, &report), 0);
+			ck_assert_uint_eq(report.steps, steps);
+			ck_assert_int_eq(report.factorizations, factorizations[k]);
+
+			double error = 0;
+			for (uint32_t i = 0; i < m.num_nodes; i++) {
+				error = fmax(error, fabs(gsl_vector_get(solution.solution_coeff, i) - exp(-1.0)*sin(M_PI*m.node_coordinates[i])));
+			}
+			if (previous > 0) {
+				ck_assert_double_ge(previous/error, min_ratio[k]);
+			}
+			previous = error;
+
+			free_solution_memory(&solution);
+		}
+	}
+
+	gsl_vector_free(initial);
+	free_mesh_memory(&m);
+
+}
+END_TEST
+
+START_TEST(time_dependent_source) {
+	// Backward Euler and BDF2 only weight the load at the new time; scratch memory left full of NaN by earlier allocations must not reach the steps
+	for (size_t size = 64; size <= 8192; size += 64) {
+		double* scratch[4];
+		for (int i = 0; i < 4; i++) {
+			scratch[i] = malloc(size);
+			for (size_t j = 0; j < size/sizeof(double); j++) {
+				scratch[i][j] = NAN;
+			}
+		}
+		for (int i = 0; i < 4; i++) {
+			free(scratch[i]);
+		}
+	}
+
+	Time_Scheme schemes[2] = {TIME_BACKWARD_EULER, TIME_BDF2};
+	struct Mesh m;
+	ck_assert_int_eq(generate_uniform_mesh(&m, 0, 1, 20, LINEAR), 0);
+	gsl_vector* initial = sine_values(&m);
+	struct Time_Problem problem = {1, -2, decay_source, NULL, false, 0, 0, initial};
+	for (int k = 0; k < 2; k++) {
+		struct Time_Options options = {schemes[k], 0, 0.01, 100, 0, NULL};
+		struct Time_Report report;
+		struct ODE_Solution solution;
+		ck_assert_int_eq(solve_ode_transient(&m, &solution, &problem, &options, &report), 0);
+		for (uint32_t i = 0; i < m.num_nodes; i++) {
+			ck_assert_double_eq_tol(gsl_vector_get(solution.solution_coeff, i), exp(-1.0)*sin(M_PI*m.node_coordinates[i]), 1e-2);
+		}
+		free_solution_memory(&solution);
+	}
+
+	gsl_vector_free(initial);
+	free_mesh_memory(&m);
+
+}
+END_TEST
+
+START_TEST(steady_state) {
+	// From u = 0 (and the jump to u = 1 at x = 1), a time-independent source drives the L-stable schemes to the steady solve of the same mesh;
+	// Crank-Nicolson damps the stiff components of the jump by a factor close to -1 per step, so at this step they have not decayed
+	Time_Scheme schemes[3] = {TIME_BACKWARD_EULER, TIME_CRANK_NICOLSON, TIME_BDF2};
+	Element_2D_Type kinds[2] = {LINEAR, QUAD};
+	for (int k = 0; k < 2; k++) {
+		struct Mesh m;
+		ck_assert_int_eq(generate_uniform_mesh(&m, 0, 1, 40, kinds[k]), 0);
+
+		struct ODE_Solution expected;
+		struct Solver_Options solver_options = {0};
+		solver_options.no_condensation = true;
+		ck_assert_int_eq(solve_ode_constant_opts(&m, &expected, 1, -2, 0, 1, field, &solver_options), 0);
+
+		struct Time_Problem problem = {1, -2, steady_source, NULL, false, 0, 1, NULL};
+		for (int s = 0; s < 3; s++) {
+			struct Time_Options options = {schemes[s], 0, 0.05, 600, 0, NULL};
+			struct Time_Report report;
+			struct ODE_Solution solution;
+			problem.steady_source = false;
+			ck_assert_int_eq(solve_ode_transient(&m, &solution, &problem, &options, &report), 0);
+
+			// Assembling the load once gives the same steps
+			struct ODE_Solution reused;
+			problem.steady_source = true;
+			ck_assert_int_eq(solve_ode_transient(&m, &reused, &problem, &options, &report), 0);
+			ck_assert_int_eq(memcmp(reused.solution_coeff->data, solution.solution_coeff->data, m.num_nodes*sizeof(double)), 0);
+			free_solution_memory(&reused);
+
+			double difference = 0;
+			for (uint32_t i = 0; i < m.num_nodes; i++) {
+				difference = fmax(difference, fabs(gsl_vector_get(solution.solution_coeff, i) - gsl_vector_get(expected.solution_coeff, i)));
+			}
+			if (schemes[s] == TIME_CRANK_NICOLSON) {
+				ck_assert_double_gt(difference, 1e-4);
+			}
+			else {
+				ck_assert_double_le(difference, 1e-8);
+			}
+			free_solution_memory(&solution);
+		}
+
+		free_solution_memory(&expected);
+		free_mesh_memory(&m);
+	}
+
+}
+END_TEST
+
+START_TEST(snapshots) {
+	// Every third step and the last one go to the writer, indexed by step, starting with the initial state
+	struct Mesh m;
+	ck_assert_int_eq(generate_uniform_mesh(&m, 0, 1, 20, LINEAR), 0);
+	gsl_vector* initial = sine_values(&m);
+	struct Time_Problem problem = {1, -2, decay_source, NULL, false, 0, 0, initial};
+
+	struct Solution_Writer writer;
+	strcpy(snapshot_path, "/tmp/time_snapshots_XXXXXX");
+	int fd = mkstemp(snapshot_path);
+	ck_assert(fd >= 0);
+	close(fd);
+	ck_assert_int_eq(open_solution_writer(&writer, snapshot_path, WRITER_BINARY), 0);
+	struct Time_Options options = {TIME_CRANK_NICOLSON, 0, 0.01, 10, 3, &writer};
+	struct Time_Report report;
+	struct ODE_Solution solution;
+	ck_assert_int_eq(solve_ode_transient(&m, &solution, &problem, &options, &report), 0);
+	ck_assert_int_eq(close_solution_writer(&writer), 0);
+	ck_assert_uint_eq(report.snapshots, 5);
+
+	FILE* input = fopen(snapshot_path, "rb");
+	ck_assert_ptr_nonnull(input);
+	char magic[8];
+	ck_assert_uint_eq(fread(magic, 1, 8, input), 8);
+	uint64_t expected_steps[5] = {0, 3, 6, 9, 10};
+	double* x = malloc(m.num_nodes*sizeof(double));
+	double* y = malloc(m.num_nodes*sizeof(double));
+	for (int r = 0; r < 5; r++) {
+		uint64_t header[2];
+		ck_assert_uint_eq(fread(header, sizeof(uint64_t), 2, input), 2);
+		ck_assert_uint_eq(header[0], expected_steps[r]);
+		ck_assert_uint_eq(header[1], m.num_nodes);
+		ck_assert_uint_eq(fread(x, sizeof(double), m.num_nodes, input), m.num_nodes);
+		ck_assert_uint_eq(fread(y, sizeof(double), m.num_nodes, input), m.num_nodes);
+		// The initial state, with the boundary values set
+		if (r == 0) {
+			ck_assert_int_eq(memcmp(&y[1], &initial->data[1], (m.num_nodes - 2)*sizeof(double)), 0);
+			ck_assert_double_eq(y[m.num_nodes - 1], 0);
+		}
+	}
+	ck_assert_int_eq(memcmp(y, solution.solution_coeff->data, m.num_nodes*sizeof(double)), 0);
+	ck_assert_int_eq(fgetc(input), EOF);
+
+	free(x);
+	free(y);
+	fclose(input);
+	free_solution_memory(&solution);
+	gsl_vector_free(initial);
+	free_mesh_memory(&m);
+
+}
+END_TEST
+
+START_TEST(invalid_options) {
+	struct Mesh m;
+	ck_assert_int_eq(generate_uniform_mesh(&m, 0, 1, 20, LINEAR), 0);
+	gsl_vector* initial = gsl_vector_calloc(m.num_nodes + 1);
+	struct Time_Problem problem = {1, -2, NULL, NULL, false, 0, 0, NULL};
+	struct Time_Options options = {TIME_BDF2, 0, 0, 10, 0, NULL};
+	struct Time_Report report;
+	struct ODE_Solution solution;
+
+	ck_assert_int_eq(solve_ode_transient(&m, &solution, &problem, &options, &report), 1);
+	ck_assert_ptr_null(solution.solution_coeff);
+
+	options.dt = 0.1;
+	problem.initial = initial;
+	ck_assert_int_eq(solve_ode_transient(&m, &solution, &problem, &options, &report), 1);
+	ck_assert_ptr_null(solution.solution_coeff);
+
+	gsl_vector_free(initial);
+	free_mesh_memory(&m);
+
+}
+END_TEST
+
+Suite* time_stepping_suite() {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Time Stepping Tests");
+
+	tc_core = tcase_create("Core");
+	tcase_add_checked_fixture(
+		tc_core,
+		setup_function_field,
+		teardown_function_field
+	);
+
+	tcase_add_test(tc_core, temporal_convergence);
+	tcase_add_test(tc_core, time_dependent_source);
+	tcase_add_test(tc_core, steady_state);
+	tcase_add_test(tc_core, snapshots);
+	tcase_add_test(tc_core, invalid_options);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+
+}
+
+int main() {
+	int number_failed;
+	Suite *s_time;
+	SRunner *sr_time;
+
+	s_time = time_stepping_suite();
+	sr_time = srunner_create(s_time);
+
+	srunner_set_fork_status(sr_time, CK_NOFORK);
+	srunner_run_all(sr_time, CK_NORMAL);
+
+	number_failed = srunner_ntests_failed(sr_time);
+
+	srunner_free(sr_time);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
@@ -0,0 +1,135 @@
+#include <stdlib.h>
+#include <check.h>
+#include <string.h>
+
+#include "fe_section.h"
+#include "batch.h"
+#include "trace.h"
+
+#define EVENTS_PER_THREAD 64
+
+double linear_func(double x) {
+	return x;
+
+}
+
+// Trace JSON recorded so far
+static char* trace_json() {
+	char* buffer = NULL;
+	size_t length = 0;
+	FILE* json = open_memstream(&buffer, &length);
+	ck_assert_int_eq(output_trace_json(json), 0);
+	fclose(json);
+
+	return buffer;
+
+}
+
+static unsigned long long dropped_events(const char* json) {
+	const char* dropped = strstr(json, "\"dropped_events\": ");
+	ck_assert_ptr_nonnull(dropped);
+
+	return strtoull(dropped + strlen("\"dropped_events\": "), NULL, 10);
+
+}
+
+START_TEST(batch_timeline) {
+	// A two thread batch must show the pool tasks, the batch groups, the solver phases and the writer on their own threads
+	struct Function_Field field;
+	create_function_field(&field, 0, 6, 601, linear_func);
+	output_function_field(&field, "trace_field.dat");
+
+	FILE* manifest = tmpfile();
+	fprintf(manifest, "0 -4 -10 10 trace_field.dat 0 5 30\n");
+	fprintf(manifest, "-1 -5 -1 1 trace_field.dat 0 5 60\n");
+	fprintf(manifest, "0 -4 0 1 trace_field.dat 0 5 30\n");
+	rewind(manifest);
+
+	struct Batch_Options options = {2, "trace_output.bin", WRITER_BINARY};
+	struct Batch_Summary summary;
+	ck_assert_int_eq(run_batch(manifest, &options, &summary), 0);
+	fclose(manifest);
+
+	char* json = trace_json();
+	const char* expected[] = {
+		"\"name\": \"main\"", "\"name\": \"worker\"", "\"name\": \"writer\"",
+		"\"name\": \"task\"", "\"name\": \"group\"", "\"name\": \"subgroup\"",
+		"\"name\": \"assemble load vector\"", "\"name\": \"factor\"", "\"name\": \"triangular solve\"",
+		"\"name\": \"writer queue\"", "\"ph\": \"X\"", "\"ph\": \"C\""
+	};
+	for (size_t i = 0; i < sizeof(expected)/sizeof(expected[0]); i++) {
+		ck_assert_msg(strstr(json, expected[i]) != NULL, "%s is missing from the trace", expected[i]);
+	}
+	ck_assert_uint_eq(dropped_events(json), 0);
+
+	free(json);
+	free_function_field(&field);
+	remove("trace_output.bin");
+	remove("trace_field.dat");
+
+}
+END_TEST
+
+START_TEST(ring_buffer_overwrite) {
+	// Once a thread's buffer is full its oldest events are overwritten and counted as dropped
+	char* before = trace_json();
+	unsigned long long dropped = dropped_events(before);
+	free(before);
+
+	for (int i = 0; i < 2*EVENTS_PER_THREAD; i++) {
+		TRACE_INSTANT("overwrite", "test");
+	}
+
+	char* json = trace_json();
+	ck_assert_uint_ge(dropped_events(json), dropped + EVENTS_PER_THREAD);
+
+	// Only the newest events of the main thread are kept, so there are exactly EVENTS_PER_THREAD of them
+	size_t count = 0;
+	for (const char* p = strstr(json, "\"overwrite\""); p != NULL; p = strstr(p + 1, "\"overwrite\"")) {
+		count++;
+	}
+	ck_assert_uint_eq(count, EVENTS_PER_THREAD);
+
+	free(json);
+
+}
+END_TEST
+
+Suite* trace_suite() {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Trace Timeline Tests");
+
+	tc_core = tcase_create("Core");
+	tcase_add_test(tc_core, batch_timeline);
+	tcase_add_test(tc_core, ring_buffer_overwrite);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+
+}
+
+int main() {
+	// Tracing is process-wide, so it is started once for both tests; the file is written at exit
+	if (trace_start("trace_test.json", EVENTS_PER_THREAD)) {
+		return EXIT_FAILURE;
+	}
+
+	int number_failed;
+	Suite *s_trace;
+	SRunner *sr_trace;
+
+	s_trace = trace_suite();
+	sr_trace = srunner_create(s_trace);
+
+	srunner_set_fork_status(sr_trace, CK_NOFORK);
+	srunner_run_all(sr_trace, CK_NORMAL);
+
+	number_failed = srunner_ntests_failed(sr_trace);
+
+	srunner_free(sr_trace);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
@@ -0,0 +1,223 @@
+#include <stdlib.h>
+#include <check.h>
+#include <math.h>
+
+#include "fe_section.h"
+#include "band_matrix.h"
+#include "variable_coefficients.h"
+
+struct Function_Field *field = NULL;
+
+// y = x^3 solves y'' + (1 + x) y' - (2 + x) y = f
+double driving_func(double x) {
+	return 6*x + 3*x*x + x*x*x - x*x*x*x;
+
+}
+
+double a_func(double x) {
+	return 1 + x;
+
+}
+
+static void setup_function_field() {
+	struct Function_Field *f_field_temp = malloc(sizeof(struct Function_Field));
+
+	create_function_field(f_field_temp, -1, 2, 30001, driving_func);
+
+	field = f_field_temp;
+
+}
+
+static void teardown_function_field() {
+	free_function_field(field);
+	free(field);
+	field = NULL;
+
+}
+
+// Counts its calls in the context
+static double counted_b(double x, void* context) {
+	(*(size_t*) context)++;
+
+	return -(2 + x);
+
+}
+
+static double callback_a(double x, void* context) {
+	return a_func(x);
+
+}
+
+static double nodal_error(struct Mesh* m, const gsl_vector* y) {
+	double error = 0;
+	for (uint32_t i = 0; i < m->num_nodes; i++) {
+		double x = m->node_coordinates[i];
+		error = fmax(error, fabs(gsl_vector_get(y, i) - x*x*x));
+	}
+
+	return error;
+
+}
+
+START_TEST(constant_coefficients) {
+	// Constants, given directly or by callback, reproduce the constant-coefficient solve on L2 and L3 meshes
+	Element_2D_Type kinds[2] = {LINEAR, QUAD};
+	for (int k = 0; k < 2; k++) {
+		struct Mesh m;
+		ck_assert_int_eq(generate_uniform_mesh(&m, 0, 1, 40, kinds[k]), 0);
+
+		struct ODE_Solution expected, variable;
+		struct Solver_Options options = {0};
+		options.no_condensation = true;
+		ck_assert_int_eq(solve_ode_constant_opts(&m, &expected, -3, 5, 1, 2, field, &options), 0);
+
+		size_t calls = 0;
+		struct Coefficient_Function a = {NULL, NULL, NULL, -3};
+		struct Coefficient_Function b = {NULL, counted_b, &calls, 0};
+		struct Coefficient_Table table;
+		ck_assert_int_eq(create_coefficient_table(&table, &m, &a, &b), 0);
+		ck_assert_uint_eq(calls, table.num_values);
+		ck_assert_uint_eq(table.num_values, m.num_elements*element_quadrature_points(kinds[k]));
+
+		// B = 5 everywhere
+		struct Coefficient_Function five = {NULL, NULL, NULL, 5};
+		ck_assert_int_eq(update_coefficient_table(&table, &a, &five), 0);
+		ck_assert_int_eq(solve_ode_variable(&table, &variable, 1, 2, field), 0);
+		for (uint32_t i = 0; i < m.num_nodes; i++) {
+			ck_assert_double_eq_tol(gsl_vector_get(variable.solution_coeff, i), gsl_vector_get(expected.solution_coeff, i), 1e-12);
+		}
+
+		free_solution_memory(&expected);
+		free_solution_memory(&variable);
+		free_coefficient_table(&table);
+		free_mesh_memory(&m);
+	}
+
+}
+END_TEST
+
+START_TEST(varying_coefficients) {
+	// The error at the nodes falls as h^2 on L2 elements and faster on L3 elements, with A as a field or a callback
+	struct Function_Field a_field;
+	create_function_field(&a_field, -1, 2, 3001, a_func);
+	Element_2D_Type kinds[2] = {LINEAR, QUAD};
+	double min_ratio[2] = {3.5, 7};
+
+	for (int k = 0; k < 2; k++) {
+		double error[2];
+		for (int level = 0; level < 2; level++) {
+			struct Mesh m;
+			ck_assert_int_eq(generate_uniform_mesh(&m, 0, 1, 10 << level, kinds[k]), 0);
+
+			size_t calls = 0;
+			struct Coefficient_Function a = {NULL, callback_a, NULL, 0};
+			struct Coefficient_Function b = {NULL, counted_b, &calls, 0};
+			struct Coefficient_Table table;
+			struct ODE_Solution sol;
+			ck_assert_int_eq(create_coefficient_table(&table, &m, &a, &b), 0);
+			ck_assert_int_eq(solve_ode_variable(&table, &sol, 0, 1, field), 0);
+			error[level] = nodal_error(&m, sol.solution_coeff);
+
+			// A linear A is interpolated exactly by the field
+			struct Coefficient_Function a_tabulated = {&a_field, NULL, NULL, 0};
+			struct ODE_Solution tabulated;
+			ck_assert_int_eq(update_coefficient_table(&table, &a_tabulated, &b), 0);
+			ck_assert_int_eq(solve_ode_variable(&table, &tabulated, 0, 1, field), 0);
+			for (uint32_t i = 0; i < m.num_nodes; i++) {
+				ck_assert_double_eq_tol(gsl_vector_get(tabulated.solution_coeff, i), gsl_vector_get(sol.solution_coeff, i), 1e-12);
+			}
+
+			free_solution_memory(&sol);
+			free_solution_memory(&tabulated);
+			free_coefficient_table(&table);
+			free_mesh_memory(&m);
+		}
+		ck_assert_double_gt(error[0]/error[1], min_ratio[k]);
+	}
+	free_function_field(&a_field);
+
+}
+END_TEST
+
+START_TEST(table_reuse) {
+	// One table serves a factorization and several load vectors without evaluating the coefficients again
+	struct Mesh m;
+	ck_assert_int_eq(generate_uniform_mesh(&m, 0, 1, 200, QUAD), 0);
+	size_t calls = 0;
+	struct Coefficient_Function a = {NULL, callback_a, NULL, 0};
+	struct Coefficient_Function b = {NULL, counted_b, &calls, 0};
+	struct Coefficient_Table table;
+	ck_assert_int_eq(create_coefficient_table(&table, &m, &a, &b), 0);
+
+	struct Band_Matrix K_lu;
+	ck_assert_int_eq(factorize_ode_variable(&table, &K_lu), 0);
+	gsl_vector* F_const = assemble_variable_vector(&table, field);
+	ck_assert_ptr_nonnull(F_const);
+
+	double boundary[3][2] = {{0, 1}, {2, -1}, {0.5, 0.5}};
+	for (int c = 0; c < 3; c++) {
+		struct ODE_Solution sol;
+		gsl_vector* factorized = solve_ode_factorized(&m, &K_lu, F_const, boundary[c][0], boundary[c][1]);
+		ck_assert_int_eq(solve_ode_variable(&table, &sol, boundary[c][0], boundary[c][1], field), 0);
+		for (uint32_t i = 0; i < m.num_nodes; i++) {
+			ck_assert_double_eq(gsl_vector_get(factorized, i), gsl_vector_get(sol.solution_coeff, i));
+		}
+		gsl_vector_free(factorized);
+		free_solution_memory(&sol);
+	}
+	ck_assert_uint_eq(calls, table.num_values);
+
+	// A mesh with another number of nodes than the factorization is refused
+	struct Mesh other;
+	ck_assert_int_eq(generate_uniform_mesh(&other, 0, 1, 100, QUAD), 0);
+	ck_assert_ptr_null(solve_ode_factorized(&other, &K_lu, F_const, 0, 1));
+	free_mesh_memory(&other);
+
+	gsl_vector_free(F_const);
+	free_band_matrix(&K_lu);
+	free_coefficient_table(&table);
+	free_mesh_memory(&m);
+
+}
+END_TEST
+
+Suite* variable_coefficients_suite() {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Variable Coefficient Tests");
+
+	tc_core = tcase_create("Core");
+	tcase_add_checked_fixture(
+		tc_core,
+		setup_function_field,
+		teardown_function_field
+	);
+
+	tcase_add_test(tc_core, constant_coefficients);
+	tcase_add_test(tc_core, varying_coefficients);
+	tcase_add_test(tc_core, table_reuse);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+
+}
+
+int main() {
+	int number_failed;
+	Suite *s_variable;
+	SRunner *sr_variable;
+
+	s_variable = variable_coefficients_suite();
+	sr_variable = srunner_create(s_variable);
+
+	srunner_set_fork_status(sr_variable, CK_NOFORK);
+	srunner_run_all(sr_variable, CK_NORMAL);
+
+	number_failed = srunner_ntests_failed(sr_variable);
+
+	srunner_free(sr_variable);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
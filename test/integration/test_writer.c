@@ -0,0 +1,172 @@
+#include <stdlib.h>
+#include <check.h>
+#include <string.h>
+
+#include "fe_section.h"
+#include "solution_writer.h"
+
+#define NUM_POINTS 1000
+
+double x_values[NUM_POINTS];
+double y_values[NUM_POINTS];
+
+static void setup_values() {
+	// Values that do not survive a `%f` round trip
+	for (int i = 0; i < NUM_POINTS; i++) {
+		x_values[i] = i/3.0;
+		y_values[i] = exp(-i/7.0)*1e-3 + 1/3.0;
+	}
+
+}
+
+START_TEST(text_round_trip) {
+	struct Solution_Writer writer;
+	int status = open_solution_writer(&writer, "writer_text.dat", WRITER_TEXT);
+	ck_assert_int_eq(status, 0);
+
+	status = submit_solution_values(&writer, x_values, y_values, NUM_POINTS, WRITER_NO_INDEX);
+	ck_assert_int_eq(status, 0);
+	status = close_solution_writer(&writer);
+	ck_assert_int_eq(status, 0);
+
+	// Read back and check the values are bit-for-bit identical
+	FILE *input = fopen("writer_text.dat", "r");
+	char buffer[100];
+	fgets(buffer, 100, input);
+	ck_assert_int_eq(strcmp(buffer, "x\ty\n"), 0);
+
+	int counter = 0;
+	while (fgets(buffer, 100, input) != NULL) {
+		double x = strtod(strtok(buffer, "\t"), NULL);
+		double y = strtod(strtok(NULL, "\t"), NULL);
+
+		ck_assert(x == x_values[counter]);
+		ck_assert(y == y_values[counter]);
+		counter++;
+	}
+	ck_assert_int_eq(counter, NUM_POINTS);
+
+	fclose(input);
+	remove("writer_text.dat");
+
+}
+END_TEST
+
+START_TEST(binary_round_trip) {
+	struct Solution_Writer writer;
+	int status = open_solution_writer(&writer, "writer_binary.bin", WRITER_BINARY);
+	ck_assert_int_eq(status, 0);
+
+	// Two indexed records
+	submit_solution_values(&writer, x_values, y_values, NUM_POINTS, 3);
+	submit_solution_values(&writer, y_values, x_values, NUM_POINTS/2, 7);
+	status = close_solution_writer(&writer);
+	ck_assert_int_eq(status, 0);
+
+	FILE *input = fopen("writer_binary.bin", "rb");
+	char magic[8];
+	fread(magic, 1, 8, input);
+	ck_assert_int_eq(memcmp(magic, WRITER_BINARY_MAGIC, 8), 0);
+
+	uint64_t header[2];
+	double *x = malloc(NUM_POINTS*sizeof(double));
+	double *y = malloc(NUM_POINTS*sizeof(double));
+
+	fread(header, sizeof(uint64_t), 2, input);
+	ck_assert_uint_eq(header[0], 3);
+	ck_assert_uint_eq(header[1], NUM_POINTS);
+	fread(x, sizeof(double), NUM_POINTS, input);
+	fread(y, sizeof(double), NUM_POINTS, input);
+	ck_assert_int_eq(memcmp(x, x_values, NUM_POINTS*sizeof(double)), 0);
+	ck_assert_int_eq(memcmp(y, y_values, NUM_POINTS*sizeof(double)), 0);
+
+	fread(header, sizeof(uint64_t), 2, input);
+	ck_assert_uint_eq(header[0], 7);
+	ck_assert_uint_eq(header[1], NUM_POINTS/2);
+	fread(x, sizeof(double), NUM_POINTS/2, input);
+	fread(y, sizeof(double), NUM_POINTS/2, input);
+	ck_assert_int_eq(memcmp(x, y_values, NUM_POINTS/2*sizeof(double)), 0);
+	ck_assert_int_eq(memcmp(y, x_values, NUM_POINTS/2*sizeof(double)), 0);
+
+	free(x);
+	free(y);
+	fclose(input);
+	remove("writer_binary.bin");
+
+}
+END_TEST
+
+START_TEST(columnar_layout) {
+	struct Solution_Writer writer;
+	int status = open_solution_writer(&writer, "writer_columnar.dat", WRITER_COLUMNAR);
+	ck_assert_int_eq(status, 0);
+
+	for (size_t c = 0; c < 3; c++) {
+		submit_solution_values(&writer, x_values, y_values, NUM_POINTS, c);
+	}
+	status = close_solution_writer(&writer);
+	ck_assert_int_eq(status, 0);
+
+	FILE *input = fopen("writer_columnar.dat", "r");
+	char buffer[200];
+	fgets(buffer, 200, input);
+	ck_assert_int_eq(strcmp(buffer, "x\ty_0\ty_1\ty_2\n"), 0);
+
+	int counter = 0;
+	while (fgets(buffer, 200, input) != NULL) {
+		double x = strtod(strtok(buffer, "\t"), NULL);
+		ck_assert(x == x_values[counter]);
+		for (int c = 0; c < 3; c++) {
+			double y = strtod(strtok(NULL, "\t"), NULL);
+			ck_assert(y == y_values[counter]);
+		}
+		counter++;
+	}
+	ck_assert_int_eq(counter, NUM_POINTS);
+
+	fclose(input);
+	remove("writer_columnar.dat");
+
+}
+END_TEST
+
+Suite* writer_suite() {
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create("Solution Writer Tests");
+
+	tc_core = tcase_create("Core");
+	tcase_add_checked_fixture(
+		tc_core,
+		setup_values,
+		NULL
+	);
+
+	tcase_add_test(tc_core, text_round_trip);
+	tcase_add_test(tc_core, binary_round_trip);
+	tcase_add_test(tc_core, columnar_layout);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+
+}
+
+int main() {
+	int number_failed;
+	Suite *s_writer;
+	SRunner *sr_writer;
+
+	s_writer = writer_suite();
+	sr_writer = srunner_create(s_writer);
+
+	srunner_set_fork_status(sr_writer, CK_NOFORK);
+	srunner_run_all(sr_writer, CK_NORMAL);
+
+	number_failed = srunner_ntests_failed(sr_writer);
+
+	srunner_free(sr_writer);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}